@@ -0,0 +1,189 @@
+// Mars lander simulator
+// Version 1.8
+// Atmosphere class implementation
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "atmosphere.h"
+
+Atmosphere mars_atmosphere;
+
+static vector<double> spline_second_derivatives (const vector<double> &x, const vector<double> &y)
+  // Natural cubic spline through the points (x, y), by the tridiagonal algorithm
+{
+  unsigned n = x.size(), i;
+  vector<double> m(n, 0.0), c(n, 0.0), d(n, 0.0);
+  double h0, h1, w;
+
+  for (i=1; i+1<n; i++) {
+    h0 = x[i]-x[i-1];
+    h1 = x[i+1]-x[i];
+    w = 2.0*(h0+h1) - h0*c[i-1];
+    c[i] = h1/w;
+    d[i] = (6.0*((y[i+1]-y[i])/h1 - (y[i]-y[i-1])/h0) - h0*d[i-1])/w;
+  }
+  for (i=n-2; i>0; i--) m[i] = d[i] - c[i]*m[i+1];
+  return m;
+}
+
+static void spline_evaluate (const vector<double> &x, const vector<double> &y, const vector<double> &m, double at, bool hold,
+                             double &value, double &slope)
+  // Value and slope of the spline at at - beyond the samples it carries on in a straight line, or stays level if hold is set
+{
+  unsigned n = x.size(), lo = 0, hi = n-1, mid;
+  double h, a, b;
+
+  if ((at <= x[0]) || (at >= x[n-1])) {
+    lo = (at <= x[0]) ? 0 : n-2;
+    h = x[lo+1]-x[lo];
+    slope = (y[lo+1]-y[lo])/h + (at <= x[0] ? -(2.0*m[0]+m[1]) : (m[n-2]+2.0*m[n-1]))*h/6.0;
+    value = (at <= x[0]) ? y[0] : y[n-1];
+    if (hold) slope = 0.0;
+    else value += slope*(at - ((at <= x[0]) ? x[0] : x[n-1]));
+    return;
+  }
+  while (hi-lo > 1) {
+    mid = (lo+hi)/2;
+    if (x[mid] > at) hi = mid;
+    else lo = mid;
+  }
+  h = x[hi]-x[lo];
+  a = (x[hi]-at)/h;
+  b = (at-x[lo])/h;
+  value = a*y[lo] + b*y[hi] + ((a*a*a-a)*m[lo] + (b*b*b-b)*m[hi])*h*h/6.0;
+  slope = (y[hi]-y[lo])/h + (-(3.0*a*a-1.0)*m[lo] + (3.0*b*b-1.0)*m[hi])*h/6.0;
+}
+
+static void hermite_coefficients (double *c, double p0, double d0, double p1, double d1, double step)
+  // Cubic in x = 0 to 1 across an interval of the given length, from the values and slopes at its ends
+{
+  d0 *= step;
+  d1 *= step;
+  c[0] = p0;
+  c[1] = d0;
+  c[2] = 3.0*(p1-p0) - 2.0*d0 - d1;
+  c[3] = 2.0*(p0-p1) + d0 + d1;
+}
+
+// Atmosphere class's member functions
+
+// constructor
+Atmosphere::Atmosphere()
+{
+  use_exponential();
+}
+
+// resample the profile given by the samples onto the lookup tables
+void Atmosphere::build(const vector<double> &altitude, const vector<double> &log_density, const vector<double> &temperature,
+                       const vector<double> &log_pressure)
+{
+  vector<double> m_density = spline_second_derivatives(altitude, log_density);
+  vector<double> m_temperature = spline_second_derivatives(altitude, temperature);
+  vector<double> m_pressure = spline_second_derivatives(altitude, log_pressure);
+  double rho0 = 0.0, drho0 = 0.0, t0 = 0.0, dt0 = 0.0, p0 = 0.0, dp0 = 0.0, rho1, drho1, t1, dt1, p1, dp1, h;
+  unsigned i;
+
+  n_intervals = (unsigned) ceil(EXOSPHERE/ATMOSPHERE_STEP);
+  inv_step = 1.0/ATMOSPHERE_STEP;
+  density_table.resize(4*n_intervals);
+  temperature_table.resize(4*n_intervals);
+  pressure_table.resize(4*n_intervals);
+
+  for (i=0; i<=n_intervals; i++) {
+    h = i*ATMOSPHERE_STEP;
+    spline_evaluate(altitude, log_density, m_density, h, false, rho1, drho1);
+    spline_evaluate(altitude, temperature, m_temperature, h, true, t1, dt1);
+    spline_evaluate(altitude, log_pressure, m_pressure, h, false, p1, dp1);
+    rho1 = exp(rho1); drho1 *= rho1;
+    p1 = exp(p1); dp1 *= p1;
+    if (i > 0) {
+      hermite_coefficients(&density_table[4*(i-1)], rho0, drho0, rho1, drho1, ATMOSPHERE_STEP);
+      hermite_coefficients(&temperature_table[4*(i-1)], t0, dt0, t1, dt1, ATMOSPHERE_STEP);
+      hermite_coefficients(&pressure_table[4*(i-1)], p0, dp0, p1, dp1, ATMOSPHERE_STEP);
+    }
+    rho0 = rho1; drho0 = drho1;
+    t0 = t1; dt0 = dt1;
+    p0 = p1; dp0 = dp1;
+  }
+}
+
+// the simulator's original atmosphere - isothermal, so density and pressure fall off with one scale height
+void Atmosphere::use_exponential(void)
+{
+  double surface_gravity = GRAVITY*MARS_MASS/(MARS_RADIUS*MARS_RADIUS);
+  double temperature = EXPONENTIAL_SCALE_HEIGHT*surface_gravity/MARS_GAS_CONSTANT;
+  vector<double> altitude(2), log_density(2), temperatures(2, temperature), log_pressure(2);
+
+  altitude[0] = 0.0;
+  altitude[1] = EXOSPHERE;
+  log_density[0] = log(EXPONENTIAL_SURFACE_DENSITY);
+  log_density[1] = log_density[0] - EXOSPHERE/EXPONENTIAL_SCALE_HEIGHT;
+  log_pressure[0] = log(EXPONENTIAL_SURFACE_DENSITY*MARS_GAS_CONSTANT*temperature);
+  log_pressure[1] = log_pressure[0] - EXOSPHERE/EXPONENTIAL_SCALE_HEIGHT;
+  build(altitude, log_density, temperatures, log_pressure);
+  name = "exponential";
+}
+
+// read a profile from a text file
+bool Atmosphere::load(string filename)
+{
+  ifstream in(filename.c_str());
+  vector<double> altitude, log_density, temperature, log_pressure;
+  double h, rho, t, p;
+  string line;
+
+  if (!in.good()) return false;
+  while (getline(in, line)) {
+    if (line.find('#') != string::npos) line.erase(line.find('#'));
+    if (line.find_first_not_of(" \t\r") == string::npos) continue;
+    istringstream fields(line);
+    if (!(fields >> h >> rho >> t >> p) || (rho <= 0.0) || (t <= 0.0) || (p <= 0.0)) return false;
+    if (!altitude.empty() && (h <= altitude.back())) return false;
+    altitude.push_back(h);
+    log_density.push_back(log(rho));
+    temperature.push_back(t);
+    log_pressure.push_back(log(p));
+  }
+  if (altitude.size() < 2) return false;
+  build(altitude, log_density, temperature, log_pressure);
+  name = filename;
+  return true;
+}
+
+// name of the profile, the file name for one read from a file
+string Atmosphere::get_name(void) const
+{
+  return name;
+}
+
+// is the built-in profile in use
+bool Atmosphere::is_exponential(void) const
+{
+  return name == "exponential";
+}
+
+// temperature in K
+double Atmosphere::temperature(double altitude) const
+{
+  if ((altitude > EXOSPHERE) || (altitude < 0.0)) return 0.0;
+  return lookup(temperature_table, altitude);
+}
+
+// pressure in Pa
+double Atmosphere::pressure(double altitude) const
+{
+  if ((altitude > EXOSPHERE) || (altitude < 0.0)) return 0.0;
+  return lookup(pressure_table, altitude);
+}
@@ -0,0 +1,84 @@
+// Mars lander simulator
+// Version 1.8
+// Atmosphere class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Density, temperature and pressure against altitude, from the surface up to
+// the exosphere. Whatever the source of the profile, it is resampled once
+// onto a uniform grid every ATMOSPHERE_STEP metres, with the coefficients of a
+// cubic Hermite polynomial stored for each interval, so that a lookup is an
+// index and a polynomial evaluation rather than a call to exp(). The built-in
+// profile is the simulator's original isothermal exponential atmosphere.
+// Other profiles are read from text files, one sample per line:
+//
+//   altitude (m)   density (kg/m^3)   temperature (K)   pressure (Pa)
+//
+// with altitudes increasing, and # starting a comment. The samples need not
+// be evenly spaced: a natural cubic spline is fitted through the logarithms
+// of density and pressure, and through temperature, and the profile is
+// continued beyond the last sample with the scale heights found there.
+
+#ifndef __ATMOSPHERE_INCLUDED__
+#define __ATMOSPHERE_INCLUDED__
+
+#include <string>
+#include <vector>
+
+#include "define_constants.h"
+
+using namespace std;
+
+#define ATMOSPHERE_STEP 100.0 // (m) interval of the lookup tables
+#define EXPONENTIAL_SURFACE_DENSITY 0.017 // (kg/m^3)
+#define EXPONENTIAL_SCALE_HEIGHT 11000.0 // (m)
+#define MARS_GAS_CONSTANT 188.92 // (J/kg/K) specific gas constant of carbon dioxide
+
+class Atmosphere
+{
+  private:
+    string name;
+    unsigned n_intervals;
+    double inv_step;
+    vector<double> density_table, temperature_table, pressure_table; // four coefficients per interval
+
+    void build(const vector<double> &altitude, const vector<double> &log_density, const vector<double> &temperature,
+               const vector<double> &log_pressure);
+    inline double lookup(const vector<double> &table, double altitude) const {
+      double x = altitude*inv_step;
+      unsigned i = (unsigned) x;
+      const double *c;
+
+      if (i >= n_intervals) i = n_intervals-1;
+      x -= i;
+      c = &table[4*i];
+      return c[0] + x*(c[1] + x*(c[2] + x*c[3]));
+    }
+
+  public:
+    Atmosphere(); // constructor, starts with the exponential profile
+    void use_exponential(void);
+    bool load(string filename); // leaves the current profile in place if the file cannot be read
+    string get_name(void) const;
+    bool is_exponential(void) const;
+
+    // Zero outside the atmosphere, as are pressure and temperature
+    inline double density(double altitude) const {
+      if ((altitude > EXOSPHERE) || (altitude < 0.0)) return 0.0;
+      return lookup(density_table, altitude);
+    }
+    double temperature(double altitude) const; // (K)
+    double pressure(double altitude) const; // (Pa)
+};
+
+extern Atmosphere mars_atmosphere;
+
+#endif
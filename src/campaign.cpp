@@ -0,0 +1,283 @@
+// Mars lander simulator
+// Version 1.8
+// Monte Carlo landing campaign runner
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Runs one autopilot landing per random seed, spread over all cores, and
+// reports success and crash rates, the touchdown speed distribution and the
+// fuel used. Each run owns its SimulationContext, so runs are independent
+// and the result for a given seed does not depend on the number of threads.
+//
+// With --batch, the runs are flown in lockstep by Lander_batch, BATCH_CHUNK landers
+// at a time per thread. That is much faster, but the landers are simplified (see
+// lander_batch.h): touchdown speeds and fuel differ from the full simulation in
+// the last digits, though the landing and crash rates agree (e.g. all 2048 gusty
+// scenario 5 seeds land safely either way).
+//
+// Usage: ./campaign --scenario=5 --seeds=0-999 [--gust | --steady-wind] [--moon]
+//                   [--no-rotation] [--threads=N] [--time-limit=seconds]
+//                   [--integrator=verlet|dopri|velocity-verlet|yoshida4 | --batch] [--warp]
+//                   [--atmosphere=file] [--gains=file] [--powered-descent]
+
+#include <algorithm>
+
+#include "lander_dynamics.h"
+#include "thread_pool.h"
+#include "lander_batch.h"
+
+#define BATCH_CHUNK 256 // landers per Lander_batch in --batch mode
+
+// Outcome of a single landing
+struct run_result_t {
+  bool landed, crashed;
+  double descent_rate, ground_speed, fuel_used, simulation_time;
+  unsigned long steps;
+};
+
+// Settings shared by every run in the campaign
+struct campaign_settings_t {
+  unsigned short scenario;
+  unsigned long first_seed, last_seed;
+  bool rotation_on, steady_wind_on, gust_wind_on, moon_effect_on;
+  double time_limit;
+  unsigned threads;
+  int integrator; // negative keeps the scenario's own choice
+  bool time_warp;
+  bool batch;
+  autopilot_gains_t gains;
+  bool powered_descent; // land with the fuel-optimal planner, see powered_descent.h
+};
+
+run_result_t run_landing (const campaign_settings_t &settings, unsigned long long seed)
+  // One autopilot landing from the chosen scenario, with its own random gust sequence
+{
+  SimulationContext sim;
+  run_result_t result;
+
+  sim.scenario = settings.scenario;
+  sim.rotation_on = settings.rotation_on;
+  sim.steady_wind_on = settings.steady_wind_on;
+  sim.gust_wind_on = settings.gust_wind_on;
+  sim.moon_effect_on = settings.moon_effect_on;
+  reset_simulation_state(sim);
+  if (settings.integrator >= 0) sim.integrator = (integrator_t) settings.integrator;
+  sim.time_warp = settings.time_warp;
+  seed_random_number(sim, seed);
+  sim.autopilot_enabled = true;
+  sim.autopilot_gains = settings.gains;
+  if (settings.powered_descent && (sim.current_autopilot_mode == descent_mode)) sim.current_autopilot_mode = powered_descent_mode;
+
+  result.steps = run_to_touchdown(sim, settings.time_limit);
+  result.landed = sim.landed && (sim.altitude >= LANDER_SIZE/2.0);
+  result.crashed = sim.landed && (sim.crashed || (sim.altitude < LANDER_SIZE/2.0));
+  result.descent_rate = -sim.climb_speed;
+  result.ground_speed = sim.ground_speed;
+  result.fuel_used = FUEL_CAPACITY*(1.0-sim.fuel);
+  result.simulation_time = sim.simulation_time;
+  return result;
+}
+
+void run_landing_batch (const campaign_settings_t &settings, unsigned long first_task, unsigned long n_tasks, vector<run_result_t> &results)
+  // Landings for seeds first_seed+first_task onwards, flown together in one Lander_batch
+{
+  Lander_batch batch(n_tasks);
+  unsigned long lane;
+
+  batch.rotation_on = settings.rotation_on;
+  batch.steady_wind_on = settings.steady_wind_on;
+  batch.gust_wind_on = settings.gust_wind_on;
+  batch.moon_effect_on = settings.moon_effect_on;
+  batch.autopilot_enabled = true;
+  batch.autopilot_gains = settings.gains;
+  for (lane=0; lane<n_tasks; lane++) {
+    SimulationContext sim;
+    sim.scenario = settings.scenario;
+    sim.rotation_on = settings.rotation_on;
+    reset_simulation_state(sim);
+    batch.set_lander(lane, sim, settings.first_seed + first_task + lane);
+  }
+
+  batch.run_to_touchdown(settings.time_limit);
+  for (lane=0; lane<n_tasks; lane++) {
+    run_result_t &result = results[first_task + lane];
+    result.crashed = (batch.landed[lane] > 0.5) && batch.crashed[lane];
+    result.landed = (batch.landed[lane] > 0.5) && !batch.crashed[lane];
+    result.descent_rate = batch.descent_rate[lane];
+    result.ground_speed = batch.ground_speed[lane];
+    result.fuel_used = FUEL_CAPACITY*(1.0-batch.fuel[lane]);
+    result.simulation_time = (batch.landed[lane] > 0.5) ? batch.touchdown_time[lane] : batch.simulation_time;
+    result.steps = (unsigned long) ceil(result.simulation_time/batch.delta_t - SMALL_NUM);
+  }
+}
+
+double percentile (const vector<double> &sorted, double p)
+  // Nearest-rank percentile of an already sorted sample
+{
+  unsigned long rank;
+
+  if (sorted.empty()) return 0.0;
+  rank = (unsigned long) ceil(p/100.0*sorted.size());
+  if (rank > 0) rank--;
+  if (rank >= sorted.size()) rank = sorted.size()-1;
+  return sorted[rank];
+}
+
+void print_distribution (string title, vector<double> sample)
+  // Prints min, percentiles, max and mean of a sample on one line
+{
+  double sum = 0.0;
+  unsigned long i;
+
+  cout << title;
+  if (sample.empty()) {
+    cout << " n/a" << endl;
+    return;
+  }
+  sort(sample.begin(), sample.end());
+  for (i=0; i<sample.size(); i++) sum += sample[i];
+  cout << " min " << sample.front() << " p10 " << percentile(sample, 10.0) << " p50 " << percentile(sample, 50.0)
+       << " p90 " << percentile(sample, 90.0) << " p99 " << percentile(sample, 99.0) << " max " << sample.back()
+       << " mean " << sum/sample.size() << endl;
+}
+
+void print_usage (char *name)
+{
+  cerr << "Usage: " << name << " --scenario=N --seeds=first-last [--gust | --steady-wind] [--moon] [--no-rotation]"
+       << " [--threads=N] [--time-limit=seconds] [--integrator=verlet|dopri|velocity-verlet|yoshida4 | --batch] [--warp]"
+       << " [--atmosphere=file] [--gains=file] [--powered-descent]" << endl;
+}
+
+int main (int argc, char* argv[])
+  // Parses the campaign settings, runs all seeds on a work-stealing thread pool and prints a summary
+{
+  campaign_settings_t settings;
+  vector<run_result_t> results;
+  vector<double> descent_rates, ground_speeds, fuel_used;
+  unsigned long n_runs, n_landed = 0, n_crashed = 0, n_timed_out = 0, total_steps = 0, i;
+  unsigned long long t_start, t_end;
+  size_t dash;
+  double wall_time;
+  int a;
+
+  settings.scenario = 5;
+  settings.first_seed = 0; settings.last_seed = 99;
+  settings.rotation_on = true; settings.steady_wind_on = false; settings.gust_wind_on = false;
+  settings.moon_effect_on = false;
+  settings.time_limit = 100000.0;
+  settings.threads = 0;
+  settings.integrator = -1;
+  settings.time_warp = false;
+  settings.batch = false;
+  settings.powered_descent = false;
+
+  for (a=1; a<argc; a++) {
+    string arg = argv[a];
+    if (arg.compare(0, 11, "--scenario=") == 0) settings.scenario = (unsigned short) atoi(arg.substr(11).c_str());
+    else if (arg.compare(0, 8, "--seeds=") == 0) {
+      dash = arg.find('-', 8);
+      settings.first_seed = strtoul(arg.substr(8, dash-8).c_str(), NULL, 10);
+      if (dash == string::npos) settings.last_seed = settings.first_seed;
+      else settings.last_seed = strtoul(arg.substr(dash+1).c_str(), NULL, 10);
+    }
+    else if (arg == "--gust") settings.gust_wind_on = true;
+    else if (arg == "--steady-wind") settings.steady_wind_on = true;
+    else if (arg == "--moon") settings.moon_effect_on = true;
+    else if (arg == "--no-rotation") settings.rotation_on = false;
+    else if (arg.compare(0, 10, "--threads=") == 0) settings.threads = (unsigned) atoi(arg.substr(10).c_str());
+    else if (arg.compare(0, 13, "--time-limit=") == 0) settings.time_limit = atof(arg.substr(13).c_str());
+    else if (arg == "--batch") settings.batch = true;
+    else if (arg == "--powered-descent") settings.powered_descent = true;
+    else if (arg == "--warp") settings.time_warp = true;
+    else if ((arg.compare(0, 13, "--integrator=") == 0) && (integrator_from_name(arg.substr(13)) >= 0)) settings.integrator = integrator_from_name(arg.substr(13));
+    else if (arg.compare(0, 13, "--atmosphere=") == 0) {
+      if (!mars_atmosphere.load(arg.substr(13))) {
+        cerr << "Cannot read atmosphere profile " << arg.substr(13) << endl;
+        return 1;
+      }
+    }
+    else if (arg.compare(0, 8, "--gains=") == 0) {
+      if (!load_autopilot_gains(arg.substr(8), settings.gains)) {
+        cerr << "Cannot read autopilot gains " << arg.substr(8) << endl;
+        return 1;
+      }
+    }
+    else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  if ((settings.scenario > 9) || (settings.last_seed < settings.first_seed) || (settings.gust_wind_on && settings.steady_wind_on)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  if (settings.batch && ((settings.scenario >= 7) || (settings.integrator >= 0))) {
+    cerr << "--batch does not model launches from the surface, and always uses position Verlet" << endl;
+    return 1;
+  }
+  if (settings.batch && settings.powered_descent) {
+    cerr << "--batch flies only the descent law, not powered descent" << endl;
+    return 1;
+  }
+  if (settings.batch && !mars_atmosphere.is_exponential()) {
+    cerr << "--batch only models the exponential atmosphere" << endl;
+    return 1;
+  }
+
+  // Run every seed, each result lands in its own slot so no locking is needed
+  n_runs = settings.last_seed - settings.first_seed + 1;
+  results.resize(n_runs);
+  Work_stealing_pool pool(settings.threads);
+  microsecond_time(t_start);
+  if (settings.batch) {
+    pool.run((n_runs + BATCH_CHUNK - 1)/BATCH_CHUNK, [&](unsigned long chunk, unsigned) {
+      run_landing_batch(settings, chunk*BATCH_CHUNK, min((unsigned long) BATCH_CHUNK, n_runs - chunk*BATCH_CHUNK), results);
+    });
+  } else {
+    pool.run(n_runs, [&](unsigned long task, unsigned) {
+      results[task] = run_landing(settings, settings.first_seed + task);
+    });
+  }
+  microsecond_time(t_end);
+  wall_time = (t_end-t_start)/1000000.0;
+
+  // Gather statistics
+  for (i=0; i<n_runs; i++) {
+    total_steps += results[i].steps;
+    if (!results[i].landed && !results[i].crashed) {
+      n_timed_out++;
+      continue;
+    }
+    if (results[i].crashed) n_crashed++;
+    else n_landed++;
+    descent_rates.push_back(results[i].descent_rate);
+    ground_speeds.push_back(results[i].ground_speed);
+    fuel_used.push_back(results[i].fuel_used);
+  }
+
+  cout.precision(3);
+  cout << fixed;
+  cout << "Scenario " << settings.scenario << ": " << scenario_description[settings.scenario] << endl;
+  cout << "Seeds " << settings.first_seed << "-" << settings.last_seed << ", rotation " << (settings.rotation_on ? "on" : "off")
+       << ", steady wind " << (settings.steady_wind_on ? "on" : "off") << ", gust wind " << (settings.gust_wind_on ? "on" : "off")
+       << ", moons " << (settings.moon_effect_on ? "on" : "off") << ", atmosphere " << mars_atmosphere.get_name() << endl;
+  if (settings.batch) cout << "Lockstep batches of " << BATCH_CHUNK << " landers, " << Lander_batch::get_simd_path() << " kernel" << endl;
+  cout << "Runs " << n_runs << " on " << pool.get_threads() << " threads in " << wall_time << " s ("
+       << n_runs/wall_time << " runs/s, " << total_steps/wall_time << " steps/s)" << endl;
+  cout << "Landed safely " << n_landed << " (" << 100.0*n_landed/n_runs << "%)" << endl;
+  cout << "Crashed " << n_crashed << " (" << 100.0*n_crashed/n_runs << "%)" << endl;
+  cout << "Time limit reached " << n_timed_out << " (" << 100.0*n_timed_out/n_runs << "%)" << endl;
+  print_distribution("Descent rate at touchdown (m/s):", descent_rates);
+  print_distribution("Ground speed at touchdown (m/s):", ground_speeds);
+  print_distribution("Fuel used (litres):", fuel_used);
+
+  return 0;
+}
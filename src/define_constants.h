@@ -30,7 +30,9 @@
 #define TERRAIN_TEXTURE_SIZE 1024
 #define INNER_DIAL_RADIUS 65.0
 #define OUTER_DIAL_RADIUS 75.0
-#define MAX_DELAY 160000
+#define MAX_CATCHUP 0.25 // seconds of wall time the simulation will make up in one burst after falling behind
+#define COAST_FRAME_TIME 0.02 // seconds of wall time between the views drawn part way through a long adaptive step, see publish_coast_view()
+#define SPEED_REPORT_INTERVAL 1000000 // microseconds over which the achieved simulation speed is measured
 #define N_TRACK 1000
 #define TRACK_DISTANCE_DELTA 100000.0
 #define TRACK_ANGLE_DELTA 0.999
@@ -69,4 +71,15 @@
 #define MAX_IMPACT_DESCENT_RATE 1.0 // (m/s)
 #define LAUNCHPAD_HEIGHT 20.0 // (m) for launching lander
 
+// Adaptive integrator constants
+#define ADAPTIVE_RELATIVE_TOLERANCE 1.0E-10 // per step, relative to the size of the state
+#define ADAPTIVE_POSITION_TOLERANCE 1.0E-3 // (m) per step
+#define ADAPTIVE_VELOCITY_TOLERANCE 1.0E-6 // (m/s) per step
+#define ADAPTIVE_MAX_STEP 60.0 // (s) while coasting in vacuum
+#define ADAPTIVE_MIN_STEP 1.0E-4 // (s)
+
+// Coast time warp constants
+#define KEPLER_MAX_COAST 3600.0 // (s) longest single analytic jump
+#define KEPLER_COAST_MARGIN 10.0 // (s) stop this far short of atmosphere entry or an autopilot burn
+
 #endif
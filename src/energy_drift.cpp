@@ -0,0 +1,120 @@
+// Mars lander simulator
+// Version 1.8
+// Integrator energy drift benchmark
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Flies the coasting orbits of scenarios 0, 2 and 6 with every integrator and
+// several step lengths, and reports how far the specific orbital energy that
+// Kepler_solver computes wanders from its starting value, against the CPU time
+// taken. Gravity is the only force, so any change in energy is integration error.
+//
+// Usage: ./energy_drift [--duration=seconds] [--delta-t=0.1,1,...] [--scenarios=0,2,6]
+//
+// One line is printed per run, as whitespace separated columns: scenario, integrator,
+// step (s), steps, CPU time (s), largest relative energy error, final relative energy
+// error and largest relative energy error per CPU-second.
+
+#include <ctime>
+
+#include "lander_dynamics.h"
+
+struct drift_result_t {
+  unsigned long steps;
+  double cpu_time, max_error, final_error;
+};
+
+vector<double> parse_list (string list)
+  // Comma separated numbers
+{
+  vector<double> values;
+  size_t start = 0, comma;
+
+  while (start < list.size()) {
+    comma = list.find(',', start);
+    if (comma == string::npos) comma = list.size();
+    values.push_back(atof(list.substr(start, comma-start).c_str()));
+    start = comma + 1;
+  }
+  return values;
+}
+
+drift_result_t measure_drift (unsigned short scenario, integrator_t integrator, double delta_t, double duration)
+  // Coasts the scenario's orbit for duration seconds and tracks the energy error
+{
+  SimulationContext sim;
+  drift_result_t result;
+  double initial_energy, error;
+  clock_t t_start;
+
+  sim.scenario = scenario;
+  sim.rotation_on = false;
+  reset_simulation_state(sim);
+  sim.integrator = integrator;
+  sim.delta_t = delta_t;
+  sim.control_interval = delta_t;
+  sim.adaptive_step = delta_t;
+  sim.autopilot_enabled = false;
+  sim.lander_Kepler.update_Kepler(sim.position, sim.velocity);
+  initial_energy = sim.lander_Kepler.energy;
+
+  result.steps = 0;
+  result.max_error = 0.0;
+  t_start = clock();
+  while (!sim.landed && (sim.simulation_time < duration)) {
+    advance_simulation(sim);
+    update_flight_status(sim);
+    error = fabs((sim.lander_Kepler.energy - initial_energy)/initial_energy);
+    if (error > result.max_error) result.max_error = error;
+    result.steps++;
+  }
+  result.cpu_time = (double) (clock() - t_start)/CLOCKS_PER_SEC;
+  result.final_error = (sim.lander_Kepler.energy - initial_energy)/initial_energy;
+  return result;
+}
+
+int main (int argc, char* argv[])
+{
+  vector<double> steps, scenarios;
+  drift_result_t result;
+  double duration = MARS_DAY;
+  unsigned long s, d;
+  int a, i;
+
+  steps.push_back(0.1); steps.push_back(1.0);
+  scenarios.push_back(0); scenarios.push_back(2); scenarios.push_back(6);
+
+  for (a=1; a<argc; a++) {
+    string arg = argv[a];
+    if (arg.compare(0, 11, "--duration=") == 0) duration = atof(arg.substr(11).c_str());
+    else if (arg.compare(0, 10, "--delta-t=") == 0) steps = parse_list(arg.substr(10));
+    else if (arg.compare(0, 12, "--scenarios=") == 0) scenarios = parse_list(arg.substr(12));
+    else {
+      cerr << "Usage: " << argv[0] << " [--duration=seconds] [--delta-t=0.1,1,...] [--scenarios=0,2,6]" << endl;
+      return 1;
+    }
+  }
+
+  cout << "# scenario integrator delta_t steps cpu_s max_rel_energy_error final_rel_energy_error max_error_per_cpu_s" << endl;
+  for (s=0; s<scenarios.size(); s++) {
+    for (i=0; i<N_INTEGRATORS; i++) {
+      for (d=0; d<steps.size(); d++) {
+        if ((i == DORMAND_PRINCE) && (d > 0)) continue; // chooses its own steps
+        result = measure_drift((unsigned short) scenarios[s], (integrator_t) i, steps[d], duration);
+        cout.precision(6);
+        cout << (unsigned short) scenarios[s] << " " << integrator_name[i] << " " << steps[d] << " " << result.steps << " "
+             << result.cpu_time << " " << scientific << result.max_error << " " << result.final_error << " "
+             << result.max_error/fmax(result.cpu_time, 1.0e-6) << defaultfloat << endl;
+      }
+    }
+  }
+  return 0;
+}
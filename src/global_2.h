@@ -1,24 +0,0 @@
-// Mars lander simulator
-// Version 1.8
-// Global variables 2 header
-// Gabor Csanyi and Andrew Gee, October 2014
-
-// Permission is hereby granted, free of charge, to any person obtaining
-// a copy of this software and associated documentation, to make use of it
-// for non-commercial purposes, provided that (a) its original authorship
-// is acknowledged and (b) no modified versions of the source code are
-// published. Restriction (b) is designed to protect the integrity of the
-// exercise for future generations of students. The authors would be happy
-// to receive any suggested modifications by private correspondence to
-// ahg@eng.cam.ac.uk and gc121@eng.cam.ac.uk.
-
-// Separated from global_variables_1 because Orbiting_object class refers
-// to delta_t and simulation_time but global_variables_1 contains an
-// object of type Orbiting_object
-
-#ifndef __GLOBAL_2_INCLUDED__
-#define __GLOBAL_2_INCLUDED__
-
-extern double delta_t, simulation_time;
-
-#endif
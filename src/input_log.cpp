@@ -0,0 +1,104 @@
+// Mars lander simulator
+// Version 1.8
+// Input_log class implementation
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+#include "input_log.h"
+
+// Input_log class's member functions
+
+// create the log and write its header
+bool Input_log::start(string filename, unsigned short scenario, unsigned long long seed)
+{
+  unsigned char header[14] = {'M', 'L', 'I', 'L', INPUT_LOG_VERSION, (unsigned char) scenario};
+  int i;
+
+  for (i=0; i<8; i++) header[6+i] = (unsigned char) (seed >> (8*i));
+  file.open(filename.c_str(), ios::binary | ios::trunc);
+  if (!file.good()) return false;
+  file.write((const char *) header, sizeof(header));
+  file.flush();
+  last_step = 0;
+  return file.good();
+}
+
+// is a log open
+bool Input_log::is_recording(void)
+{
+  return file.is_open();
+}
+
+// append one input
+void Input_log::record(unsigned long step, input_event_t event, int code)
+{
+  unsigned char buffer[12];
+  unsigned long delta = step - last_step;
+  int n = 0;
+
+  if (!file.is_open()) return;
+  do { // varint, seven bits at a time with the top bit set on all but the last byte
+    buffer[n] = (unsigned char) (delta & 0x7f);
+    delta >>= 7;
+    if (delta) buffer[n] |= 0x80;
+    n++;
+  } while (delta);
+  buffer[n++] = (unsigned char) event;
+  buffer[n++] = (unsigned char) code;
+  file.write((const char *) buffer, n);
+  file.flush();
+  last_step = step;
+}
+
+// close the log
+void Input_log::stop(void)
+{
+  if (file.is_open()) file.close();
+}
+
+// read a whole log back
+bool Input_log::read(string filename, unsigned short &scenario, unsigned long long &seed, vector<input_record_t> &records)
+{
+  ifstream in(filename.c_str(), ios::binary);
+  unsigned char header[14];
+  input_record_t r;
+  unsigned long step = 0, delta;
+  int c, shift, i;
+
+  in.read((char *) header, sizeof(header));
+  if ((in.gcount() != sizeof(header)) || (header[0] != 'M') || (header[1] != 'L') || (header[2] != 'I') || (header[3] != 'L')
+      || (header[4] != INPUT_LOG_VERSION)) return false;
+  scenario = header[5];
+  seed = 0;
+  for (i=0; i<8; i++) seed |= ((unsigned long long) header[6+i]) << (8*i);
+
+  records.clear();
+  while (true) {
+    delta = 0;
+    shift = 0;
+    do {
+      c = in.get();
+      if (c == EOF) return true; // a record cut short by a crash is dropped
+      if (shift >= 8*(int) sizeof(delta)) return false; // too long for a step count, the log is corrupt
+      delta |= ((unsigned long) (c & 0x7f)) << shift;
+      shift += 7;
+    } while (c & 0x80);
+    step += delta;
+    r.step = step;
+    c = in.get();
+    if (c == EOF) return true;
+    r.event = (input_event_t) c;
+    c = in.get();
+    if (c == EOF) return true;
+    r.code = c;
+    records.push_back(r);
+  }
+}
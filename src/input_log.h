@@ -0,0 +1,64 @@
+// Mars lander simulator
+// Version 1.8
+// Input_log class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Records the inputs of a run, so that it can be replayed exactly: the scenario
+// and random seed it started from, then every key press that changes the
+// simulation, stamped with the number of time steps taken when it arrived.
+// Since the physics only depends on these, feeding them back in at the same
+// steps reproduces the run bit for bit.
+//
+// File layout, all integers little-endian:
+//   header  "MLIL", version byte, scenario byte, 8 byte seed
+//   record  step count since the previous record (LEB128 varint), event byte, code byte
+// Records are appended and flushed one at a time, so a log stays readable up
+// to the last input even if the program dies. A typical mission is well under
+// a kilobyte.
+
+#ifndef __INPUT_LOG_INCLUDED__
+#define __INPUT_LOG_INCLUDED__
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define INPUT_LOG_VERSION 1
+
+enum input_event_t { KEY_EVENT = 0, SPECIAL_EVENT = 1, PAUSE_EVENT = 2, QUIT_EVENT = 3 };
+
+struct input_record_t {
+  unsigned long step; // time steps taken before the input arrived
+  input_event_t event;
+  int code; // key for KEY_EVENT and SPECIAL_EVENT, 0 or 1 for PAUSE_EVENT
+};
+
+class Input_log
+{
+  private:
+    ofstream file;
+    unsigned long last_step;
+
+  public:
+    Input_log() {last_step=0;}
+    bool start(string filename, unsigned short scenario, unsigned long long seed); // create the log and write its header
+    bool is_recording(void);
+    void record(unsigned long step, input_event_t event, int code);
+    void stop(void);
+
+    // read a whole log back, returns false if the file is missing or not an input log
+    static bool read(string filename, unsigned short &scenario, unsigned long long &seed, vector<input_record_t> &records);
+};
+
+#endif
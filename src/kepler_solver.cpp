@@ -22,34 +22,36 @@
 void Kepler_solver::update_Kepler(vector3d r, vector3d v)
 {
   double mu = GRAVITY*MARS_MASS;
+  double r_abs = r.abs(), v_abs2 = v.abs2(), e_abs;
   
   // Solve for h, e, energy
   h=r^v;
-  e = (((v.abs2()-mu/r.abs())*r)-((r*v)*v))/mu;
-  energy = 0.5*v.abs2() - mu/r.abs(); // negative for circular and ellipse orbits, zero for parabolic escape, positive for hyperbolic escape
+  e = (((v_abs2-mu/r_abs)*r)-((r*v)*v))/mu;
+  e_abs = e.abs();
+  energy = 0.5*v_abs2 - mu/r_abs; // negative for circular and ellipse orbits, zero for parabolic escape, positive for hyperbolic escape
   
   // Solve for a, p, q, q_complement
-  if (abs(e.abs()-1.0) > SMALL_NUM) {
+  if (abs(e_abs-1.0) > SMALL_NUM) {
     // either circular, elliptic or hyperbolic BUT NOT parabolic
-    if (e.abs() <= SMALL_NUM) {
+    if (e_abs <= SMALL_NUM) {
       // circular orbit
       a = -0.5*mu/energy; // positive
       p = a; // simplified version to improve speed of program
       q = a; // simplified version to improve speed of program
-      q_complement = a*(1+e.abs());
+      q_complement = a*(1+e_abs);
     }
-    else if (SMALL_NUM < e.abs() && e.abs() < 1) {
+    else if (SMALL_NUM < e_abs && e_abs < 1) {
       // elliptical orbit
       a = -0.5*mu/energy; // positive
       p = a*(1-e.abs2()); // positive
-      q = a*(1-e.abs()); // positive
-      q_complement = a*(1+e.abs());
+      q = a*(1-e_abs); // positive
+      q_complement = a*(1+e_abs);
     }
     else {
       // hyperbolic escape
       a = -0.5*mu/energy; // negative
       p = a*(1-e.abs2()); // positive
-      q = a*(1-e.abs()); // positive
+      q = a*(1-e_abs); // positive
     }
   }
   else {
@@ -59,3 +61,133 @@ void Kepler_solver::update_Kepler(vector3d r, vector3d v)
     q = 0.5*p; // positive
   }
 }
+
+// Formulae for the universal-variable propagation are adapted from H. D. Curtis, Orbital Mechanics
+// for Engineering Students, sections 3.7 and 3.10, and for the time of flight to a given radius from
+// the eccentric (or hyperbolic) anomaly form of Kepler's equation
+
+void stumpff(double z, double &c, double &s)
+  // C(z) and S(z) together, from one square root and one sine and cosine (or sinh and cosh)
+{
+  double w;
+  
+  if (z > 1.0E-4) {
+    w = sqrt(z);
+    c = (1.0 - cos(w))/z;
+    s = (w - sin(w))/(z*w);
+  }
+  else if (z < -1.0E-4) {
+    w = sqrt(-z);
+    c = (cosh(w) - 1.0)/(-z);
+    s = (sinh(w) - w)/(-z*w);
+  }
+  else { // series, avoids cancellation near z = 0
+    c = 1.0/2.0 - z/24.0 + z*z/720.0;
+    s = 1.0/6.0 - z/120.0 + z*z/5040.0;
+  }
+}
+
+void Kepler_solver::propagate(vector3d r0, vector3d v0, double dt, vector3d &r, vector3d &v)
+{
+  double mu = GRAVITY*MARS_MASS;
+  double sqrt_mu = sqrt(mu);
+  double r0_abs, vr0, alpha, period, chi, z, c, s, f, df, ratio, f_lagrange, g_lagrange, fdot, gdot, r_abs;
+  int i;
+  
+  r0_abs = r0.abs();
+  vr0 = (r0*v0)/r0_abs;
+  alpha = 2.0/r0_abs - v0.abs2()/mu; // reciprocal of the semi-major axis
+  
+  // For an ellipse, whole orbits make no difference, and removing them keeps Newton's method well behaved
+  if (alpha > 0.0) {
+    period = 2.0*M_PI/sqrt(mu*alpha*alpha*alpha);
+    dt = fmod(dt, period);
+  }
+  
+  // Solve the universal Kepler equation for chi by Newton's method
+  chi = sqrt_mu*fabs(alpha)*dt;
+  if (alpha <= 1.0E-12) chi = sqrt_mu*dt/r0_abs; // near-parabolic or hyperbolic, start from the initial speed
+  for (i=0; i<100; i++) {
+    z = alpha*chi*chi;
+    stumpff(z, c, s);
+    f = r0_abs*vr0/sqrt_mu*chi*chi*c + (1.0 - alpha*r0_abs)*chi*chi*chi*s + r0_abs*chi - sqrt_mu*dt;
+    df = r0_abs*vr0/sqrt_mu*chi*(1.0 - alpha*chi*chi*s) + (1.0 - alpha*r0_abs)*chi*chi*c + r0_abs;
+    ratio = f/df;
+    chi -= ratio;
+    if (fabs(ratio) <= 1.0E-12*(1.0 + fabs(chi))) break;
+  }
+  
+  // Lagrange coefficients
+  z = alpha*chi*chi;
+  stumpff(z, c, s);
+  f_lagrange = 1.0 - chi*chi/r0_abs*c;
+  g_lagrange = dt - chi*chi*chi*s/sqrt_mu;
+  r = f_lagrange*r0 + g_lagrange*v0;
+  r_abs = r.abs();
+  fdot = sqrt_mu/(r_abs*r0_abs)*(alpha*chi*chi*chi*s - chi);
+  gdot = 1.0 - chi*chi/r_abs*c;
+  v = fdot*r0 + gdot*v0;
+}
+
+double Kepler_solver::time_to_radius(vector3d r, vector3d v, double radius)
+{
+  double mu = GRAVITY*MARS_MASS;
+  double r_abs, v_abs2, alpha, ecc, n, E, E_target, M, M_target, F, F_target, cos_target;
+  
+  r_abs = r.abs();
+  v_abs2 = v.abs2();
+  alpha = 2.0/r_abs - v_abs2/mu;
+  ecc = ((((v_abs2-mu/r_abs)*r)-((r*v)*v))/mu).abs();
+  if (ecc < SMALL_NUM) return -1.0; // circular, the radius never changes
+  cos_target = (1.0 - radius*alpha)/ecc;
+  
+  if (alpha > 1.0E-12) { // ellipse, r = a(1 - e cos E)
+    if ((cos_target < -1.0) || (cos_target > 1.0)) return -1.0; // radius is outside [periapsis, apoapsis]
+    n = sqrt(mu*alpha*alpha*alpha);
+    E = atan2((r*v)*sqrt(alpha/mu)/ecc, (1.0 - r_abs*alpha)/ecc);
+    M = E - ecc*sin(E);
+    E_target = -acos(cos_target); // on the way in, E between -pi and 0
+    M_target = E_target - ecc*sin(E_target);
+    while (M_target < M) M_target += 2.0*M_PI;
+    return (M_target - M)/n;
+  }
+  else if (alpha < -1.0E-12) { // hyperbola, r = a(1 - e cosh F) with a negative
+    if (cos_target < 1.0) return -1.0; // inside periapsis
+    n = sqrt(-mu*alpha*alpha*alpha);
+    F = asinh((r*v)*sqrt(-alpha/mu)/ecc);
+    M = ecc*sinh(F) - F;
+    F_target = -acosh(cos_target);
+    M_target = ecc*sinh(F_target) - F_target;
+    if (M_target < M) return -1.0; // already past it, and there is only one pass
+    return (M_target - M)/n;
+  }
+  else return -1.0; // parabolic, left to numerical integration
+}
+
+double Kepler_solver::time_to_apsis(vector3d r, vector3d v)
+{
+  double mu = GRAVITY*MARS_MASS;
+  double r_abs, v_abs2, alpha, ecc, n, E, M, M_target, F;
+  
+  r_abs = r.abs();
+  v_abs2 = v.abs2();
+  alpha = 2.0/r_abs - v_abs2/mu;
+  ecc = ((((v_abs2-mu/r_abs)*r)-((r*v)*v))/mu).abs();
+  if (ecc < SMALL_NUM) return -1.0; // circular, every point is an apsis
+  
+  if (alpha > 1.0E-12) { // ellipse, apsides at E = 0 and E = pi
+    n = sqrt(mu*alpha*alpha*alpha);
+    E = atan2((r*v)*sqrt(alpha/mu)/ecc, (1.0 - r_abs*alpha)/ecc);
+    M = E - ecc*sin(E);
+    if (M < 0.0) M_target = 0.0;
+    else M_target = M_PI;
+    return (M_target - M)/n;
+  }
+  else if (alpha < -1.0E-12) { // hyperbola, periapsis only
+    n = sqrt(-mu*alpha*alpha*alpha);
+    F = asinh((r*v)*sqrt(-alpha/mu)/ecc);
+    if (F >= 0.0) return -1.0;
+    return (F - ecc*sinh(F))/n;
+  }
+  else return -1.0;
+}
@@ -44,6 +44,17 @@ class Kepler_solver
     
     // update h, e, energy, a, p, q, q_complement
     void update_Kepler(vector3d r, vector3d v);
+    
+    // two-body state after time dt from (r0, v0), by the universal-variable Kepler equation
+    void propagate(vector3d r0, vector3d v0, double dt, vector3d &r, vector3d &v);
+    
+    // time until the conic through (r, v) next reaches radius on the way in, or until its next apsis,
+    // negative if it never does
+    double time_to_radius(vector3d r, vector3d v, double radius);
+    double time_to_apsis(vector3d r, vector3d v);
 };
 
+// Stumpff functions C(z) and S(z) used by the universal-variable formulation
+void stumpff(double z, double &c, double &s);
+
 #endif
@@ -0,0 +1,387 @@
+// Mars lander simulator
+// Version 1.8
+// Lander_batch class implementation
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+#include "lander_dynamics.h"
+#include "lander_batch.h"
+#include "simd_pack.h"
+
+// Lanes are padded to a multiple of the widest pack, so every build can use the same layout
+#define BATCH_LANE_ALIGNMENT 8
+
+// Drag coefficient times area of the lander body and of the parachute, as in acceleration_drag()
+#define LANDER_DRAG_AREA (DRAG_COEF_LANDER*M_PI*LANDER_SIZE*LANDER_SIZE)
+#define CHUTE_DRAG_AREA (DRAG_COEF_CHUTE*5.0*2.0*LANDER_SIZE*2.0*LANDER_SIZE)
+
+// The kernel is written once against the pack operations of simd_pack.h, so that step_pack()
+// below serves every instruction set
+
+typedef simd_pack_t P;
+typedef P::value V;
+typedef P::mask M;
+typedef vector3d_pack V3;
+
+const char *batch_simd_path = SIMD_PACK_PATH;
+
+// Settings that are the same for every lane during one step
+struct batch_step_t {
+  double delta_t, lag_k;
+  bool first_step, autopilot_enabled, moon_effect_on;
+  autopilot_gains_t gains;
+  V rotation_on, steady_wind_on, gust_wind_on; // 0.0 or 1.0
+  vector3d phobos[2], deimos[2]; // moon positions at the start and the end of the step
+  double *delayed_throttle; // this step's slot in the engine delay buffer, NULL if there is no delay
+};
+
+static inline void moon_gravity (const V3 &p, const vector3d &moon, double moon_mass, V3 &g)
+  // Adds the pull of one moon, which is at the same place for every lane
+{
+  V3 d = p - V3::set(moon);
+  V d2 = d.abs2();
+
+  g = g + d*(P::set(-GRAVITY*moon_mass)/(P::sqrt(d2)*d2));
+}
+
+static inline void gravity_and_air (const V3 &p, const V3 &v, V gust, const batch_step_t &s, unsigned end,
+                                    V3 &g, V3 &air, V &density, V &air_speed, V &inv_r)
+  // Gravity, atmospheric density and the lander velocity relative to the (possibly windy) atmosphere,
+  // for a pack of lanes - the batch equivalent of acceleration_gravity(), atmospheric_density() and
+  // mars_velocity_wrt_world(). end picks the moon positions at the start (0) or end (1) of the step.
+{
+  V zero = P::set(0.0);
+  V r2, r, alt, xy, wind, f;
+  M in_atmosphere;
+
+  r2 = p.abs2();
+  r = P::sqrt(r2);
+  inv_r = P::set(1.0)/r;
+  g = p*(P::set(-GRAVITY*MARS_MASS)*inv_r/r2);
+  if (s.moon_effect_on) {
+    moon_gravity(p, s.phobos[end], PHOBOS_MASS, g);
+    moon_gravity(p, s.deimos[end], DEIMOS_MASS, g);
+  }
+
+  // Simple exponential atmosphere, the built-in profile of atmospheric_density()
+  alt = r - P::set(MARS_RADIUS);
+  in_atmosphere = P::both(P::less_equal(zero, alt), P::less_equal(alt, P::set(EXOSPHERE)));
+  density = P::set(0.017)*pack_exp(P::min(P::max(alt, zero), P::set(EXOSPHERE))*P::set(-1.0/11000.0));
+  density = P::select(in_atmosphere, density, zero);
+
+  // Atmosphere velocity is omega x r, plus steady wind and gusts along the same direction
+  xy = P::sqrt(p.x*p.x + p.y*p.y);
+  wind = P::set(10.0)*s.steady_wind_on + gust*s.gust_wind_on;
+  wind = P::select(P::less(zero, xy), wind/P::max(xy, P::set(SMALL_NUM)), zero);
+  f = P::set(2*M_PI/MARS_DAY)*s.rotation_on + wind;
+  air = V3(v.x + p.y*f, v.y - p.x*f, v.z);
+  air_speed = air.abs();
+}
+
+static inline V3 ground_track (const V3 &p, const V3 &v, const V3 &up, const batch_step_t &s, V &ground_speed)
+  // Direction of the lander's horizontal motion relative to the ground below it, and its speed - the plane
+  // of motion wrt Mars of attitude_stabilization()
+{
+  V f = P::set(2*M_PI/MARS_DAY)*s.rotation_on;
+  V3 h = v - up*(v*up);
+
+  h = V3(h.x + p.y*f, h.y - p.x*f, h.z);
+  ground_speed = h.abs();
+  return h/P::max(ground_speed, P::set(SMALL_NUM));
+}
+
+static bool step_pack (Lander_batch &b, unsigned long i, const batch_step_t &s)
+  // One time step for lanes i to i+P::width-1. Follows the order of advance_simulation() followed by
+  // update_flight_status(): engine delay and lag, Verlet update, autopilot, then fuel, touchdown and
+  // parachute checks. Returns true if any lane touched down, for step() to tidy up.
+{
+  V zero = P::set(0.0), one = P::set(1.0), dt = P::set(s.delta_t);
+  V throttle, lagged, fuel, chute, gust, landed, tilt_cos, tilt_sin;
+  V density, air_speed, inv_r, mass, k, alt, delayed, ground_speed;
+  V3 p, q, v, g, air, a, up;
+  M flying, just_landed, unsafe;
+
+  landed = P::load(&b.landed[i]);
+  flying = P::less(landed, P::set(0.5));
+  if (!P::any(flying)) return false;
+
+  p = V3::load(&b.position_x[i], &b.position_y[i], &b.position_z[i]);
+  q = V3::load(&b.previous_position_x[i], &b.previous_position_y[i], &b.previous_position_z[i]);
+  v = V3::load(&b.velocity_x[i], &b.velocity_y[i], &b.velocity_z[i]);
+  throttle = P::load(&b.throttle[i]); lagged = P::load(&b.lagged_throttle[i]);
+  fuel = P::load(&b.fuel[i]); chute = P::load(&b.parachute_status[i]); gust = P::load(&b.gust_speed[i]);
+  tilt_cos = P::load(&b.tilt_cos[i]); tilt_sin = P::load(&b.tilt_sin[i]);
+
+  // Engine delay and lag, as in thrust_wrt_world()
+  throttle = P::min(P::max(throttle, zero), one);
+  throttle = P::select(P::equal(fuel, zero), zero, throttle);
+  if (s.delayed_throttle) {
+    delayed = P::load(s.delayed_throttle + i);
+    P::store(s.delayed_throttle + i, throttle);
+  } else delayed = throttle;
+  k = P::set(s.lag_k);
+  lagged = k*lagged + (one-k)*delayed;
+
+  // Total acceleration at x(t): gravity, drag of lander and parachute, thrust along the local vertical
+  // tilted by the autopilot about the horizontal axis across the ground track, as in thrust_wrt_world()
+  gravity_and_air(p, v, gust, s, 0, g, air, density, air_speed, inv_r);
+  mass = P::set(UNLOADED_LANDER_MASS) + fuel*P::set(FUEL_CAPACITY*FUEL_DENSITY);
+  k = P::set(-0.5)*density*(P::set(LANDER_DRAG_AREA) + P::select(P::equal(chute, one), P::set(CHUTE_DRAG_AREA), zero))*air_speed/mass;
+  a = g + air*k;
+  up = p*inv_r;
+  a = a + (up*tilt_cos + ground_track(p, v, up, s, ground_speed)*tilt_sin)*(lagged*P::set(MAX_THRUST)/mass);
+
+  // Verlet update, with a second order Taylor step to get started, as in numerical_dynamics()
+  if (s.first_step) {
+    q = p;
+    p = p + v*dt + a*P::set(0.5*s.delta_t*s.delta_t);
+  } else {
+    a = p + p - q + a*P::set(s.delta_t*s.delta_t);
+    q = p;
+    p = a;
+  }
+  v = (p - q)/dt;
+
+  // Conditions at x(t+dt), for the autopilot and the parachute checks
+  gravity_and_air(p, v, gust, s, 1, g, air, density, air_speed, inv_r);
+  alt = p.abs() - P::set(MARS_RADIUS);
+
+  if (s.autopilot_enabled) {
+    // viva_la_vida descent law: deploy the parachute below the switch altitude when it is safe, lose it at 100m
+    V target, radial_speed, drag, offset, out;
+    M low = P::less(alt, P::set(s.gains.switch_altitude));
+    M deploy = P::both(low, P::equal(chute, zero));
+    deploy = P::both(deploy, P::less_equal(P::set(0.5*CHUTE_DRAG_AREA)*density*air_speed*air_speed, P::set(MAX_PARACHUTE_DRAG)));
+    deploy = P::both(deploy, P::less(P::set(0.5*LANDER_DRAG_AREA)*density*air_speed*air_speed, P::set(MAX_PARACHUTE_DRAG)));
+    deploy = P::both(deploy, P::less(v.abs(), P::set(MAX_PARACHUTE_SPEED)));
+    chute = P::select(deploy, one, chute);
+    chute = P::select(P::both(low, P::less_equal(alt, P::set(100.0))), P::set(LOST), chute);
+
+    target = P::select(low, P::set(-s.gains.landing_speed) - P::set(s.gains.landing_kh)*alt,
+                       P::set(-s.gains.entry_speed) - P::set(s.gains.entry_kh)*alt);
+    radial_speed = (v*p)*inv_r;
+    out = P::set(s.gains.kp)*(target - radial_speed);
+
+    // Throttle needed to balance gravity and drag, using the mass after this step's fuel burn
+    mass = P::set(UNLOADED_LANDER_MASS) + (fuel - throttle*P::set(FUEL_RATE_AT_MAX_THRUST*s.delta_t/FUEL_CAPACITY))*P::set(FUEL_CAPACITY*FUEL_DENSITY);
+    drag = P::set(-0.5)*density*(P::set(LANDER_DRAG_AREA) + P::select(P::equal(chute, one), P::set(CHUTE_DRAG_AREA), zero))*air_speed/mass;
+    offset = ((g + air*drag)*p)*inv_r*(zero-mass)/P::set(MAX_THRUST);
+    throttle = P::min(P::max(offset + out, zero), one);
+
+    // Below 100m, lean 5 degrees against a ground speed of 0.5 m/s or more, and 45 degrees from 2 m/s
+    M near_ground = P::less_equal(alt, P::set(100.0));
+    ground_track(p, v, p*inv_r, s, ground_speed);
+    M fast = P::both(near_ground, P::less_equal(P::set(2.0), ground_speed));
+    M drifting = P::both(near_ground, P::less_equal(P::set(0.5), ground_speed));
+    tilt_cos = P::select(fast, P::set(cos(-45.0*M_PI/180.0)), P::select(drifting, P::set(cos(-5.0*M_PI/180.0)), one));
+    tilt_sin = P::select(fast, P::set(sin(-45.0*M_PI/180.0)), P::select(drifting, P::set(sin(-5.0*M_PI/180.0)), zero));
+  }
+
+  // Touchdown, fuel and parachute, as in update_flight_status()
+  just_landed = P::both(flying, P::less(alt, P::set(LANDER_SIZE/2.0)));
+  fuel = P::max(fuel - dt*P::set(FUEL_RATE_AT_MAX_THRUST/FUEL_CAPACITY)*P::min(P::max(throttle, zero), one), zero);
+  throttle = P::select(P::either(just_landed, P::equal(fuel, zero)), zero, throttle);
+  unsafe = P::less(P::set(MAX_PARACHUTE_DRAG), P::set(0.5*CHUTE_DRAG_AREA)*density*air_speed*air_speed);
+  unsafe = P::either(unsafe, P::both(P::less(P::set(MAX_PARACHUTE_SPEED), v.abs()), P::less(alt, P::set(EXOSPHERE))));
+  chute = P::select(P::both(P::equal(chute, one), unsafe), P::set(LOST), chute);
+
+  // Lanes that were already down keep their state
+  V3::select(flying, p, V3::load(&b.position_x[i], &b.position_y[i], &b.position_z[i])).store(&b.position_x[i], &b.position_y[i], &b.position_z[i]);
+  V3::select(flying, q, V3::load(&b.previous_position_x[i], &b.previous_position_y[i], &b.previous_position_z[i]))
+    .store(&b.previous_position_x[i], &b.previous_position_y[i], &b.previous_position_z[i]);
+  V3::select(flying, v, V3::load(&b.velocity_x[i], &b.velocity_y[i], &b.velocity_z[i])).store(&b.velocity_x[i], &b.velocity_y[i], &b.velocity_z[i]);
+  P::store(&b.throttle[i], P::select(flying, throttle, P::load(&b.throttle[i])));
+  P::store(&b.lagged_throttle[i], P::select(flying, lagged, P::load(&b.lagged_throttle[i])));
+  P::store(&b.fuel[i], P::select(flying, fuel, P::load(&b.fuel[i])));
+  P::store(&b.parachute_status[i], P::select(flying, chute, P::load(&b.parachute_status[i])));
+  P::store(&b.tilt_cos[i], P::select(flying, tilt_cos, P::load(&b.tilt_cos[i])));
+  P::store(&b.tilt_sin[i], P::select(flying, tilt_sin, P::load(&b.tilt_sin[i])));
+  P::store(&b.landed[i], P::select(just_landed, P::set(2.0), landed)); // 2.0 marks a fresh touchdown for step()
+  return P::any(just_landed);
+}
+
+// Lander_batch class's member functions
+
+// constructor - all lanes start parked on the ground until set_lander() is called
+Lander_batch::Lander_batch(unsigned long n_landers, double step)
+{
+  unsigned long throttle_buffer_length;
+
+  n_lanes = n_landers;
+  n_padded = ((n_lanes + BATCH_LANE_ALIGNMENT - 1)/BATCH_LANE_ALIGNMENT)*BATCH_LANE_ALIGNMENT;
+  n_landed = n_lanes;
+
+  position_x.assign(n_padded, 2.0*MARS_RADIUS); position_y.assign(n_padded, 0.0); position_z.assign(n_padded, 0.0);
+  previous_position_x = position_x; previous_position_y = position_y; previous_position_z = position_z;
+  velocity_x.assign(n_padded, 0.0); velocity_y.assign(n_padded, 0.0); velocity_z.assign(n_padded, 0.0);
+  throttle.assign(n_padded, 0.0); lagged_throttle.assign(n_padded, 0.0); fuel.assign(n_padded, 0.0);
+  parachute_status.assign(n_padded, NOT_DEPLOYED);
+  landed.assign(n_padded, 1.0);
+  gust_speed.assign(n_padded, 0.0);
+  tilt_cos.assign(n_padded, 1.0); tilt_sin.assign(n_padded, 0.0);
+  random_state.assign(n_padded, 0x9E3779B97F4A7C15ULL);
+  touchdown_time.assign(n_padded, 0.0); descent_rate.assign(n_padded, 0.0); ground_speed.assign(n_padded, 0.0);
+  crashed.assign(n_padded, false);
+
+  delta_t = step;
+  simulation_time = 0.0;
+  rotation_on = true; steady_wind_on = false; gust_wind_on = false; moon_effect_on = false;
+  autopilot_enabled = false;
+
+  if (delta_t > 0.0) throttle_buffer_length = (unsigned long) (ENGINE_DELAY/delta_t + 0.5);
+  else throttle_buffer_length = 0;
+  throttle_buffer.assign(throttle_buffer_length*n_padded, 0.0);
+  throttle_buffer_pointer = 0;
+}
+
+// copy the initial state of a reset context into one lane, with its own gust seed
+void Lander_batch::set_lander(unsigned long lane, const SimulationContext &sim, unsigned long long seed)
+{
+  unsigned long slot;
+
+  if (lane >= n_lanes) return;
+  if (landed[lane] > 0.5) n_landed--;
+
+  position_x[lane] = sim.position.x; position_y[lane] = sim.position.y; position_z[lane] = sim.position.z;
+  previous_position_x[lane] = sim.position.x; previous_position_y[lane] = sim.position.y; previous_position_z[lane] = sim.position.z;
+  velocity_x[lane] = sim.velocity.x; velocity_y[lane] = sim.velocity.y; velocity_z[lane] = sim.velocity.z;
+  throttle[lane] = sim.throttle; lagged_throttle[lane] = 0.0; fuel[lane] = sim.fuel;
+  parachute_status[lane] = sim.parachute_status;
+  landed[lane] = sim.landed ? 1.0 : 0.0;
+  gust_speed[lane] = 0.0;
+  tilt_cos[lane] = cos(sim.stabilized_attitude_angle*M_PI/180.0); tilt_sin[lane] = sin(sim.stabilized_attitude_angle*M_PI/180.0);
+  seed_random_number(random_state[lane], seed);
+  touchdown_time[lane] = 0.0; descent_rate[lane] = 0.0; ground_speed[lane] = 0.0;
+  crashed[lane] = false;
+  for (slot=0; slot<throttle_buffer.size()/n_padded; slot++) throttle_buffer[slot*n_padded+lane] = sim.throttle;
+
+  if (sim.landed) n_landed++;
+  Phobos = sim.Phobos; // the same for every lane
+  Deimos = sim.Deimos;
+}
+
+// draw this step's gust speed for every lane still flying
+void Lander_batch::draw_gusts(void)
+{
+  unsigned long lane;
+
+  for (lane=0; lane<n_lanes; lane++) {
+    if (landed[lane] < 0.5) gust_speed[lane] = weibull_random_number(random_state[lane]);
+  }
+}
+
+// estimate the point and time of impact and the touchdown speeds, as update_flight_status() does
+void Lander_batch::record_touchdown(unsigned long lane, double last_x, double last_y, double last_z)
+{
+  vector3d p, last, d, av_p, v;
+  double a, b, c, mu, climb_speed;
+
+  p = vector3d(position_x[lane], position_y[lane], position_z[lane]);
+  last = vector3d(last_x, last_y, last_z);
+
+  av_p = (p + last).norm();
+  v = (p - last)/delta_t;
+  climb_speed = v*av_p;
+  descent_rate[lane] = -climb_speed;
+  ground_speed[lane] = (v - climb_speed*av_p - (vector3d(0.0, 0.0, 2*M_PI/MARS_DAY)^(p.norm()*MARS_RADIUS))*rotation_on).abs();
+
+  d = p - last;
+  a = d.abs2();
+  b = 2.0*last*d;
+  c = last.abs2() - (MARS_RADIUS + LANDER_SIZE/2.0) * (MARS_RADIUS + LANDER_SIZE/2.0);
+  mu = (-b - sqrt(b*b-4.0*a*c))/(2.0*a);
+  p = last + mu*d;
+  position_x[lane] = p.x; position_y[lane] = p.y; position_z[lane] = p.z;
+  touchdown_time[lane] = simulation_time - (1.0-mu)*delta_t;
+  crashed[lane] = (fabs(climb_speed) > MAX_IMPACT_DESCENT_RATE) || (fabs(ground_speed[lane]) > MAX_IMPACT_GROUND_SPEED);
+  velocity_x[lane] = 0.0; velocity_y[lane] = 0.0; velocity_z[lane] = 0.0;
+  landed[lane] = 1.0;
+  n_landed++;
+}
+
+// advance every lane by delta_t
+void Lander_batch::step(void)
+{
+  batch_step_t s;
+  vector3d moon_velocity;
+  unsigned long i, lane, throttle_buffer_length;
+  bool touchdown = false;
+
+  if (gust_wind_on) draw_gusts();
+
+  s.delta_t = delta_t;
+  s.lag_k = (ENGINE_LAG <= 0.0) ? 0.0 : pow(exp(-1.0), delta_t/ENGINE_LAG);
+  s.first_step = (simulation_time == 0.0);
+  s.autopilot_enabled = autopilot_enabled;
+  s.gains = autopilot_gains;
+  s.rotation_on = P::set(rotation_on ? 1.0 : 0.0);
+  s.steady_wind_on = P::set(steady_wind_on ? 1.0 : 0.0);
+  s.gust_wind_on = P::set(gust_wind_on ? 1.0 : 0.0);
+  s.moon_effect_on = moon_effect_on;
+  if (moon_effect_on) { // one ephemeris evaluation per moon per step serves every lane
+    Phobos.ephemeris(simulation_time, s.phobos[0], moon_velocity);
+    Phobos.ephemeris(simulation_time + delta_t, s.phobos[1], moon_velocity);
+    Deimos.ephemeris(simulation_time, s.deimos[0], moon_velocity);
+    Deimos.ephemeris(simulation_time + delta_t, s.deimos[1], moon_velocity);
+  }
+  throttle_buffer_length = throttle_buffer.size()/n_padded;
+  if (throttle_buffer_length) s.delayed_throttle = &throttle_buffer[throttle_buffer_pointer*n_padded];
+  else s.delayed_throttle = NULL;
+
+  for (i=0; i<n_padded; i+=P::width) {
+    if (step_pack(*this, i, s)) touchdown = true;
+  }
+
+  if (throttle_buffer_length) throttle_buffer_pointer = (throttle_buffer_pointer + 1) % throttle_buffer_length;
+  simulation_time += delta_t;
+
+  if (touchdown) {
+    for (lane=0; lane<n_lanes; lane++) {
+      if (landed[lane] > 1.5) record_touchdown(lane, previous_position_x[lane], previous_position_y[lane], previous_position_z[lane]);
+    }
+  }
+}
+
+// step until all lanes are down or time_limit is reached, returns the number of steps taken
+unsigned long Lander_batch::run_to_touchdown(double time_limit)
+{
+  unsigned long steps = 0;
+
+  while ((n_landed < n_lanes) && (simulation_time < time_limit)) {
+    step();
+    steps++;
+  }
+  return steps;
+}
+
+// get number of lanes
+unsigned long Lander_batch::get_lanes(void) const
+{
+  return n_lanes;
+}
+
+// get number of lanes including padding
+unsigned long Lander_batch::get_padded_lanes(void) const
+{
+  return n_padded;
+}
+
+// get number of lanes that are down
+unsigned long Lander_batch::get_landed(void) const
+{
+  return n_landed;
+}
+
+// get name of the instruction set the kernel was built for
+const char *Lander_batch::get_simd_path(void)
+{
+  return batch_simd_path;
+}
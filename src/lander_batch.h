@@ -0,0 +1,85 @@
+// Mars lander simulator
+// Version 1.8
+// Lander_batch class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Advances many independent landers in lockstep, for dispersion studies. The
+// per-lander state is held as structure-of-arrays, one array per component,
+// so that the Verlet update, Mars gravity, drag and the exponential atmosphere
+// run across several landers at once with AVX-512 or AVX2 (whichever the
+// compiler is allowed to use, e.g. CCSW="-O3 -march=native"), with SSE2 on any
+// other x86-64 build and with plain scalar code elsewhere - see simd_pack.h.
+//
+// Compared with a full SimulationContext, each lander is a point mass with its
+// thrust along the local vertical, tilted towards or away from its motion over
+// the ground, as in the autopilot's stabilized descent. The moons, if switched
+// on, follow their analytic ephemerides (which the Orbiting_objects must be
+// in), and the lander cannot be held on a launchpad. With autopilot_enabled
+// set, every lane flies the viva_la_vida descent law: radial speed control,
+// parachute deployment and the sideways corrections in the last 100m.
+
+#ifndef __LANDER_BATCH_INCLUDED__
+#define __LANDER_BATCH_INCLUDED__
+
+#include <vector>
+
+#include "simulation_context.h"
+
+using namespace std;
+
+class Lander_batch
+{
+  public:
+    // Lander state, one entry per lane; the lane count is padded to a whole number of SIMD packs
+    // and the padding lanes are parked as landed
+    vector<double> position_x, position_y, position_z;
+    vector<double> previous_position_x, previous_position_y, previous_position_z; // 'x(t-dt)' used by the Verlet integrator
+    vector<double> velocity_x, velocity_y, velocity_z;
+    vector<double> throttle, lagged_throttle, fuel;
+    vector<double> parachute_status; // NOT_DEPLOYED, DEPLOYED or LOST, stored as double for the SIMD kernel
+    vector<double> landed; // 0.0 while flying, 1.0 once down - landed lanes are frozen
+    vector<double> gust_speed;
+    vector<double> tilt_cos, tilt_sin; // of the autopilot's stabilized_attitude_angle, by which the thrust leans along the ground track
+    vector<unsigned long long> random_state; // per-lane gust generator, as in SimulationContext
+
+    // Touchdown record, filled in when a lane lands
+    vector<double> touchdown_time, descent_rate, ground_speed;
+    vector<bool> crashed;
+
+    // Settings shared by all lanes
+    double delta_t, simulation_time;
+    bool rotation_on, steady_wind_on, gust_wind_on, moon_effect_on;
+    bool autopilot_enabled;
+    autopilot_gains_t autopilot_gains; // defaults to the full autopilot's
+    Orbiting_object Phobos, Deimos; // copied from the contexts by set_lander()
+
+    // Engine delay, throttle_buffer[slot*get_padded_lanes()+lane]
+    vector<double> throttle_buffer;
+    unsigned long throttle_buffer_pointer;
+
+    Lander_batch(unsigned long n_landers, double step = 0.1); // constructor
+    void set_lander(unsigned long lane, const SimulationContext &sim, unsigned long long seed); // copy the initial state of a reset context
+    void step(void); // advance every lane by delta_t
+    unsigned long run_to_touchdown(double time_limit); // step until all lanes are down or time_limit is reached
+    unsigned long get_lanes(void) const;
+    unsigned long get_padded_lanes(void) const;
+    unsigned long get_landed(void) const;
+    static const char *get_simd_path(void);
+
+  private:
+    unsigned long n_lanes, n_padded, n_landed;
+
+    void draw_gusts(void);
+    void record_touchdown(unsigned long lane, double last_x, double last_y, double last_z);
+};
+
+#endif
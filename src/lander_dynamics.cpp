@@ -15,53 +15,90 @@
 
 #include "lander_dynamics.h"
 
-void autopilot (void)
+const string scenario_description[10] = {
+  "circular orbit",
+  "descent from 10km",
+  "polar elliptical orbit",
+  "drag prevents polar escape",
+  "elliptical orbit that clips the atmosphere",
+  "descent from 200km",
+  "areostationary orbit",
+  "polar launch",
+  "equatorial launch",
+  "launch from Northern hemisphere"
+};
+
+const string integrator_name[N_INTEGRATORS] = {"verlet", "dopri", "velocity-verlet", "yoshida4"};
+
+// Dormand-Prince 5(4) tableau, http://en.wikipedia.org/wiki/Dormand-Prince_method
+static const double dp_c[7] = {0.0, 1.0/5.0, 3.0/10.0, 4.0/5.0, 8.0/9.0, 1.0, 1.0};
+static const double dp_a[7][6] = {
+  {0.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+  {1.0/5.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+  {3.0/40.0, 9.0/40.0, 0.0, 0.0, 0.0, 0.0},
+  {44.0/45.0, -56.0/15.0, 32.0/9.0, 0.0, 0.0, 0.0},
+  {19372.0/6561.0, -25360.0/2187.0, 64448.0/6561.0, -212.0/729.0, 0.0, 0.0},
+  {9017.0/3168.0, -355.0/33.0, 46732.0/5247.0, 49.0/176.0, -5103.0/18656.0, 0.0},
+  {35.0/384.0, 0.0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0}
+};
+static const double dp_b[7] = {35.0/384.0, 0.0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0, 0.0}; // 5th order
+static const double dp_e[7] = {71.0/57600.0, 0.0, -71.0/16695.0, 71.0/1920.0, -17253.0/339200.0, 22.0/525.0, -1.0/40.0}; // 5th minus 4th order
+
+int integrator_from_name (string name)
+  // Integrator with the given name, as used on the command line, or -1 if there is none
+{
+  int i;
+
+  for (i=0; i<N_INTEGRATORS; i++) if (name == integrator_name[i]) return i;
+  return -1;
+}
+
+void autopilot (SimulationContext &sim)
   // Autopilot to adjust the engine throttle, parachute and attitude control
 {
   double Kh_radial;
-  double Kp = 0.3; // obtained by trial and error
+  double Kp = sim.autopilot_gains.kp; // originally obtained by trial and error, see tune_autopilot.cpp
   double P_out = 0.0;
   double throttle_offset = 0.0;
-  static double target_radial_speed, actual_radial_speed;
-  static double target_tangential_speed, actual_tangential_speed;
-  static double current_radius, target_radius;
-  static bool one_more_ignition_needed;
   double cosine_between_velocity_and_position;
+  double horizontal_speed;
+  const DerivedState &d = sim.derived; // worked out once this step, see update_derived_state()
+  const autopilot_gains_t &gains = sim.autopilot_gains;
   
-  if (!accept_input_altitude) {
+  if (!sim.accept_input_altitude) {
     
-    switch (current_lander_phase) {
+    switch (sim.current_lander_phase) {
     
     // ASCENT GUIDANCE
     case let_it_go:
-      if (lander_unheld) {
-        if (position.abs()-MARS_RADIUS <= 1000.0) {
-          throttle = 1.0;
-          stabilized_attitude = true;
-          stabilized_attitude_in_plane_wrt_mars = false;
-          stabilized_attitude_angle = 0.0;
+      if (sim.lander_unheld) {
+        if (d.altitude <= gains.vertical_rise) {
+          sim.throttle = 1.0;
+          sim.stabilized_attitude = true;
+          sim.stabilized_attitude_in_plane_wrt_mars = false;
+          sim.stabilized_attitude_angle = 0.0;
         }
-        else if (position.abs()-MARS_RADIUS > 1000.0 && position.abs()-MARS_RADIUS <= EXOSPHERE) {
-          throttle = 1.0;
-          stabilized_attitude = true;
-          stabilized_attitude_in_plane_wrt_mars = false;
-          stabilized_attitude_angle = 30.0;
-          if (lander_Kepler.q_complement-MARS_RADIUS>=300000.0 && position.abs()-MARS_RADIUS > 50000.0) throttle = 0.0;
+        else if (d.altitude > gains.vertical_rise && d.altitude <= EXOSPHERE) {
+          sim.throttle = 1.0;
+          sim.stabilized_attitude = true;
+          sim.stabilized_attitude_in_plane_wrt_mars = false;
+          sim.stabilized_attitude_angle = gains.ascent_pitch;
+          if (sim.lander_Kepler.q_complement-MARS_RADIUS>=300000.0 && d.altitude > 50000.0) sim.throttle = 0.0;
         }
         else {
-          throttle = 0.0;
-          stabilized_attitude = true;
-          stabilized_attitude_in_plane_wrt_mars = false;
-          stabilized_attitude_angle = (acos((velocity*position)/((velocity.abs())*(position.abs()))))*180/M_PI-10.0; // point the nose in the direction of travel for added realism
-          current_radius = position.abs();
-          target_radius = lander_Kepler.q_complement;
-          target_tangential_speed = sqrt((2*GRAVITY*MARS_MASS)*(target_radius/current_radius)/(target_radius+current_radius));
-          actual_tangential_speed = (velocity - (position.norm())*(velocity*position.norm())).abs();
-          one_more_ignition_needed = true;
-          cosine_between_velocity_and_position = (velocity.norm())*(position.norm());
+          sim.throttle = 0.0;
+          sim.stabilized_attitude = true;
+          sim.stabilized_attitude_in_plane_wrt_mars = false;
+          sim.stabilized_attitude_angle = (acos((sim.velocity*sim.position)/(sim.velocity.abs()*d.radius)))*180/M_PI-10.0; // point the nose in the direction of travel for added realism
+          sim.current_radius = d.radius;
+          sim.target_radius = sim.lander_Kepler.q_complement;
+          sim.target_tangential_speed = sqrt((2*GRAVITY*MARS_MASS)*(sim.target_radius/sim.current_radius)/(sim.target_radius+sim.current_radius));
+          sim.actual_tangential_speed = d.tangential_speed;
+          sim.one_more_ignition_needed = true;
+          cosine_between_velocity_and_position = (sim.velocity.norm())*d.radial;
           if (-0.0005 <= cosine_between_velocity_and_position && cosine_between_velocity_and_position <= 0.0005) {
             // ignite engine at perigee/apogee
-            current_lander_phase = chariots_of_fire;
+            sim.current_lander_phase = chariots_of_fire;
           }
         }
       }
@@ -69,84 +106,88 @@ void autopilot (void)
     
     // LANDER IN STABLE ORBIT
     case let_it_be:
-      current_radius = position.abs();
-      switch (current_autopilot_mode) {
+      sim.current_radius = d.radius;
+      switch (sim.current_autopilot_mode) {
       case descent_mode:
-        target_radius = MARS_RADIUS + 15000.0;
-        target_tangential_speed = sqrt((2*GRAVITY*MARS_MASS)*(target_radius/current_radius)/(target_radius+current_radius));
-        actual_tangential_speed = (velocity - (position.norm())*(velocity*position.norm())).abs();
-        current_lander_phase = chariots_of_fire;
+      case powered_descent_mode:
+        sim.target_radius = MARS_RADIUS + 15000.0;
+        sim.target_tangential_speed = sqrt((2*GRAVITY*MARS_MASS)*(sim.target_radius/sim.current_radius)/(sim.target_radius+sim.current_radius));
+        sim.actual_tangential_speed = d.tangential_speed;
+        sim.current_lander_phase = chariots_of_fire;
         break;
       case transfer_mode:
-        target_radius = MARS_RADIUS + input_altitude;
-        target_tangential_speed = sqrt((2*GRAVITY*MARS_MASS)*(target_radius/current_radius)/(target_radius+current_radius));
-        actual_tangential_speed = (velocity - (position.norm())*(velocity*position.norm())).abs();
-        one_more_ignition_needed = true;
-        cosine_between_velocity_and_position = (velocity.norm())*(position.norm());
+        sim.target_radius = MARS_RADIUS + sim.input_altitude;
+        sim.target_tangential_speed = sqrt((2*GRAVITY*MARS_MASS)*(sim.target_radius/sim.current_radius)/(sim.target_radius+sim.current_radius));
+        sim.actual_tangential_speed = d.tangential_speed;
+        sim.one_more_ignition_needed = true;
+        cosine_between_velocity_and_position = (sim.velocity.norm())*d.radial;
         if (-0.0005 <= cosine_between_velocity_and_position && cosine_between_velocity_and_position <= 0.0005) {
           // ignite engine at perigee/apogee
-          current_lander_phase = chariots_of_fire;
+          sim.current_lander_phase = chariots_of_fire;
         }
         break;
       case maintain_mode:
-        stabilized_attitude = true;
-        stabilized_attitude_angle = 0;
+        sim.stabilized_attitude = true;
+        sim.stabilized_attitude_angle = 0;
+        break;
+      case launch_mode:
+        // launch only applies on the surface, so nothing to do in orbit
         break;
       }
       break;
     
     // APPLYING IMPULSE
     case chariots_of_fire:
-      actual_tangential_speed = (velocity - (position.norm())*(velocity*position.norm())).abs();
-      if (actual_tangential_speed < (target_tangential_speed + 0.5) && actual_tangential_speed > (target_tangential_speed - 0.5))
+      sim.actual_tangential_speed = d.tangential_speed;
+      if (sim.actual_tangential_speed < (sim.target_tangential_speed + 0.5) && sim.actual_tangential_speed > (sim.target_tangential_speed - 0.5))
       {
-        throttle = 0.0;
-        stabilized_attitude = true;
-        stabilized_attitude_angle = 0;
-        current_lander_phase = the_sound_of_silence;
+        sim.throttle = 0.0;
+        sim.stabilized_attitude = true;
+        sim.stabilized_attitude_angle = 0;
+        sim.current_lander_phase = the_sound_of_silence;
         break;
       }
-      if (actual_tangential_speed > target_tangential_speed)
+      if (sim.actual_tangential_speed > sim.target_tangential_speed)
       {
-        throttle = 1.0;
-        stabilized_attitude = true;
-        stabilized_attitude_angle = -90;
-        if (current_autopilot_mode == launch_mode) stabilized_attitude_angle = -80;
+        sim.throttle = 1.0;
+        sim.stabilized_attitude = true;
+        sim.stabilized_attitude_angle = -90;
+        if (sim.current_autopilot_mode == launch_mode) sim.stabilized_attitude_angle = -80;
         break;
       }
-      if (actual_tangential_speed < target_tangential_speed)
+      if (sim.actual_tangential_speed < sim.target_tangential_speed)
       {
-        throttle = 1.0;
-        stabilized_attitude = true;
-        stabilized_attitude_angle = 90;
-        if (current_autopilot_mode == launch_mode) stabilized_attitude_angle = 80;
+        sim.throttle = 1.0;
+        sim.stabilized_attitude = true;
+        sim.stabilized_attitude_angle = 90;
+        if (sim.current_autopilot_mode == launch_mode) sim.stabilized_attitude_angle = 80;
         break;
       }
       break;
     
     // COASTING PHASE
     case the_sound_of_silence:
-      if (current_autopilot_mode == descent_mode) {
-        current_lander_phase = viva_la_vida;
+      if ((sim.current_autopilot_mode == descent_mode) || (sim.current_autopilot_mode == powered_descent_mode)) {
+        sim.current_lander_phase = viva_la_vida;
         break;
       }
-      cosine_between_velocity_and_position = (velocity.norm())*(position.norm());
-      if (((target_radius*0.975) <= position.abs()) && (position.abs() <= (target_radius*1.025)) && -0.0005 <= cosine_between_velocity_and_position && cosine_between_velocity_and_position <= 0.0005)
+      cosine_between_velocity_and_position = (sim.velocity.norm())*d.radial;
+      if (((sim.target_radius*0.975) <= d.radius) && (d.radius <= (sim.target_radius*1.025)) && -0.0005 <= cosine_between_velocity_and_position && cosine_between_velocity_and_position <= 0.0005)
       {
-        if (one_more_ignition_needed)
+        if (sim.one_more_ignition_needed)
         {
-          target_tangential_speed = sqrt(GRAVITY*MARS_MASS/target_radius);
-          one_more_ignition_needed = false;
-          current_lander_phase = chariots_of_fire;
+          sim.target_tangential_speed = sqrt(GRAVITY*MARS_MASS/sim.target_radius);
+          sim.one_more_ignition_needed = false;
+          sim.current_lander_phase = chariots_of_fire;
         }
         else
         {
-          current_autopilot_mode = maintain_mode;
-          current_lander_phase = let_it_be;
+          sim.current_autopilot_mode = maintain_mode;
+          sim.current_lander_phase = let_it_be;
         }
       }
       else {
-        stabilized_attitude_angle = (acos((velocity*position)/((velocity.abs())*(position.abs()))))*180/M_PI; // point the nose opposite the direction of travel for added realism
+        sim.stabilized_attitude_angle = (acos((sim.velocity*sim.position)/(sim.velocity.abs()*d.radius)))*180/M_PI; // point the nose opposite the direction of travel for added realism
       }
       break;
     
@@ -154,305 +195,960 @@ void autopilot (void)
     case viva_la_vida:
     
       // Handle vertical speed
-      if ((position.abs()-MARS_RADIUS) >= 12000.0)
+      if (d.altitude >= gains.switch_altitude)
       { // slow down to ~ -480m/s at the altitude of 12km
-        Kh_radial = 0.003;
-        target_radial_speed = -440.0-Kh_radial*(position.abs()-MARS_RADIUS);
-        actual_radial_speed = velocity*position.norm();
-        P_out = Kp*(target_radial_speed-actual_radial_speed);
+        Kh_radial = gains.entry_kh;
+        sim.target_radial_speed = -gains.entry_speed-Kh_radial*d.altitude;
+        sim.actual_radial_speed = d.radial_speed;
+        P_out = Kp*(sim.target_radial_speed-sim.actual_radial_speed);
       }
       else
       { // deploy parachute and slow down to ~ -0.5m/s at surface
-        Kh_radial = 0.05;
-        if ((safe_to_deploy_parachute() == true) && (parachute_status == NOT_DEPLOYED) && ((acceleration_drag().abs())*current_lander_mass() < MAX_PARACHUTE_DRAG) && (velocity.abs() < MAX_PARACHUTE_SPEED))
+        Kh_radial = gains.landing_kh;
+        if ((safe_to_deploy_parachute(sim) == true) && (sim.parachute_status == NOT_DEPLOYED) && (d.lander_drag.abs() < MAX_PARACHUTE_DRAG) && (sim.velocity.abs() < MAX_PARACHUTE_SPEED))
         {
-        parachute_status = DEPLOYED;
+        sim.parachute_status = DEPLOYED;
         }
-        if ((position.abs()-MARS_RADIUS) <= 100.0) parachute_status = LOST;
-        target_radial_speed = -0.5-Kh_radial*(position.abs()-MARS_RADIUS);
-        actual_radial_speed = velocity*position.norm();
-        P_out = Kp*(target_radial_speed-actual_radial_speed);
+        if (d.altitude <= 100.0) sim.parachute_status = LOST;
+        sim.target_radial_speed = -gains.landing_speed-Kh_radial*d.altitude;
+        sim.actual_radial_speed = d.radial_speed;
+        P_out = Kp*(sim.target_radial_speed-sim.actual_radial_speed);
       }
       
-      // Tuning throttle offset
-      double temp_fuel = fuel; // store fuel at 'x(t)'
-      fuel = fuel - throttle*FUEL_RATE_AT_MAX_THRUST*delta_t/FUEL_CAPACITY; // get fuel at 'x(t+dt)'
-      throttle_offset = ((acceleration_gravity() + acceleration_drag())*position.norm())*(-current_lander_mass())/MAX_THRUST; // minus sign as thrust is on when acceleration is 'downwards'
-      fuel = temp_fuel; // set fuel to its value at 'x(t)' so the graphic routines work properly    
+      // Tuning throttle offset - thrust to balance gravity and drag
+      throttle_offset = hover_throttle(sim);
     
       // Set throttle value
       if (P_out <= -throttle_offset) {
-        throttle = 0;
+        sim.throttle = 0;
       }
       else if (P_out >= 1-throttle_offset) {
-        throttle = 1;
+        sim.throttle = 1;
       }
       else {
-        throttle = throttle_offset + P_out;
+        sim.throttle = throttle_offset + P_out;
       }
       
       // Handle attitude control
-      stabilized_attitude = true;
-      stabilized_attitude_in_plane_wrt_mars = true;
-      stabilized_attitude_angle = 0.0;
+      sim.stabilized_attitude = true;
+      sim.stabilized_attitude_in_plane_wrt_mars = true;
+      sim.stabilized_attitude_angle = 0.0;
       
       // Handle horizontal speed
-      if ((position.abs()-MARS_RADIUS) <= 100.0)
+      if (d.altitude <= 100.0)
       {
-        if ((velocity - (velocity*(position.norm()))*position.norm() - mars_velocity_wrt_world(position.abs(),true)).abs() >= 0.5) stabilized_attitude_angle = -5;
-        if ((velocity - (velocity*(position.norm()))*position.norm() - mars_velocity_wrt_world(position.abs(),true)).abs() >= 2.0) stabilized_attitude_angle = -45;
+        horizontal_speed = (sim.velocity - d.radial_speed*d.radial - d.surface_velocity).abs();
+        if (horizontal_speed >= 0.5) sim.stabilized_attitude_angle = -5;
+        if (horizontal_speed >= 2.0) sim.stabilized_attitude_angle = -45;
+      }
+      
+      // Fuel-optimal powered descent takes over the throttle and attitude near the ground
+      if ((sim.current_autopilot_mode == powered_descent_mode) && (d.altitude < PD_START_ALTITUDE) && (d.altitude > PD_END_ALTITUDE + LANDER_SIZE/2.0)) {
+        powered_descent_guidance(sim);
       }
+      else sim.powered_descent.valid = false;
       
       break;
     }
   }
-  
-  
-  //~ // Comment this out to read lander data into a csv file //
-  //~ //-----------------------LANDER DATA RECORDER-----------------------//
-  //~ // Parameters recorded: Kh, Kp, altitude, actual descent rate, target descent rate
-  //~ ofstream fileout;
-  //~ fileout.open("../octave-assignment/lander_data.csv", ios::binary | ios::app);
-  //~ if (!fileout.good()) {
-    //~ cout << "Error while opening file\n";
-  //~ }
-  //~ else {
-    //~ fileout << Kh_radial << "," << Kp << "," << position.abs()-MARS_RADIUS << "," << actual_radial_speed << "," << target_radial_speed <<"\n";
-  //~ }
-  //~ fileout.close();
 }
 
-void numerical_dynamics (void)
+double hover_throttle (SimulationContext &sim)
+  // Throttle at which thrust along the local vertical balances gravity and drag on the lander as it will be
+  // at 'x(t+dt)', after this step's fuel is burnt - the autopilot's throttle offset in entry, descent and landing
+{
+  const DerivedState &d = sim.derived;
+  double mass = d.mass - sim.throttle*FUEL_RATE_AT_MAX_THRUST*sim.delta_t*FUEL_DENSITY;
+  vector3d drag = d.lander_drag;
+
+  if (sim.parachute_status == DEPLOYED) drag += d.chute_drag;
+  return -((acceleration_gravity(sim)*mass + drag)*d.radial)/MAX_THRUST; // minus sign as thrust is on when acceleration is 'downwards'
+}
+
+void powered_descent_guidance (SimulationContext &sim)
+  // Follows a fuel-optimal plan down to PD_END_ALTITUDE, see powered_descent.h. Every PD_REPLAN_INTERVAL the plan is
+  // made afresh from the current state, searching for the best time of flight near the last plan's (or, for
+  // the first plan, over a wide range), and in between the lander holds the thrust of the current segment.
+  // The engine is pointed along the thrust by turning the lander the shortest way from where it points now.
+{
+  const double first_solves[PD_FIRST_SOLVES] = {0.4, 0.6, 0.8, 1.0, 1.2, 1.4, 1.7, 2.0}; // times the free fall time
+  const DerivedState &d = sim.derived;
+  powered_descent_plan_t &plan = sim.powered_descent;
+  powered_descent_problem_t problem;
+  vector3d east, north, up, v, a, axis, guess[PD_STEPS], thrust[PD_STEPS], best[PD_STEPS];
+  double time_of_flight[PD_FIRST_SOLVES], t, merit, best_merit, best_time, fall_time;
+  unsigned n_solves, i, j, k;
+
+  if (!plan.valid || (sim.simulation_time >= plan.next_replan - SMALL_NUM)) {
+    // Local frame at the lander, with the ground speed, and the altitude and descent rate the descent law wants at the end
+    up = d.radial;
+    east = vector3d(0.0, 0.0, 1.0)^up;
+    if (east.abs() < SMALL_NUM) east = vector3d(1.0, 0.0, 0.0)^up; // over a pole
+    east = east.norm();
+    north = up^east;
+    v = sim.velocity - d.surface_velocity;
+    problem.altitude = fmax(d.altitude - LANDER_SIZE/2.0 - PD_END_ALTITUDE, 0.0);
+    problem.velocity = vector3d(v*east, v*north, v*up);
+    problem.end_speed = sim.autopilot_gains.landing_speed + sim.autopilot_gains.landing_kh*PD_END_ALTITUDE;
+    problem.gravity = -(acceleration_gravity(sim)*up);
+    problem.max_acceleration = (sim.fuel > 0.0) ? MAX_THRUST/d.mass : 0.0;
+
+    // Times of flight to try, each starting from the last plan where there is one
+    if (plan.valid) {
+      t = fmax(plan.time_of_flight - (sim.simulation_time - plan.start_time), PD_MIN_TIME_OF_FLIGHT);
+      n_solves = PD_SOLVES;
+      for (i=0; i<n_solves; i++) time_of_flight[i] = fmax(t*(1.0 + PD_TIME_STEP*((int) i - (int) (n_solves/2))), PD_MIN_TIME_OF_FLIGHT);
+      for (j=0; j<PD_STEPS; j++) { // the last plan's thrust at the middle of each new segment
+        k = (unsigned) fmin(floor((sim.simulation_time - plan.start_time + (j+0.5)*t/PD_STEPS)*PD_STEPS/plan.time_of_flight), PD_STEPS-1);
+        a = plan.east*plan.thrust[k].x + plan.north*plan.thrust[k].y + plan.up*plan.thrust[k].z;
+        guess[j] = vector3d(a*east, a*north, a*up);
+      }
+    }
+    else {
+      fall_time = (problem.velocity.z + sqrt(problem.velocity.z*problem.velocity.z + 2.0*problem.gravity*problem.altitude))/problem.gravity;
+      n_solves = PD_FIRST_SOLVES;
+      for (i=0; i<n_solves; i++) time_of_flight[i] = fmax(first_solves[i]*fall_time, PD_MIN_TIME_OF_FLIGHT);
+      for (j=0; j<PD_STEPS; j++) guess[j] = vector3d(0.0, 0.0, 0.0);
+    }
+
+    best_merit = HUGE_VAL;
+    best_time = time_of_flight[0];
+    for (i=0; i<n_solves; i++) {
+      merit = powered_descent_solver.solve(problem, time_of_flight[i], guess, thrust);
+      if (merit < best_merit) {
+        best_merit = merit;
+        best_time = time_of_flight[i];
+        for (j=0; j<PD_STEPS; j++) best[j] = thrust[j];
+      }
+    }
+
+    plan.valid = true;
+    plan.start_time = sim.simulation_time;
+    plan.next_replan = sim.simulation_time + PD_REPLAN_INTERVAL;
+    plan.time_of_flight = best_time;
+    plan.east = east;
+    plan.north = north;
+    plan.up = up;
+    plan.predicted_fuel = 0.0;
+    for (j=0; j<PD_STEPS; j++) {
+      plan.thrust[j] = best[j];
+      plan.predicted_fuel += best[j].abs()*d.mass/MAX_THRUST*FUEL_RATE_AT_MAX_THRUST*best_time/PD_STEPS;
+    }
+  }
+
+  // Thrust of the current segment, in the world frame
+  k = (unsigned) fmin(floor((sim.simulation_time - plan.start_time)*PD_STEPS/plan.time_of_flight), PD_STEPS-1);
+  a = plan.east*plan.thrust[k].x + plan.north*plan.thrust[k].y + plan.up*plan.thrust[k].z;
+  sim.throttle = a.abs()*d.mass/MAX_THRUST;
+
+  // Turn the lander so that its up axis, and so the engine, points along the thrust (or straight up if there is none)
+  if (a.abs() > SMALL_NUM) a = a.norm();
+  else a = d.radial;
+  axis = sim.attitude.z_axis()^a;
+  if (axis.abs() > SMALL_NUM) set_attitude(sim, rotation_vector_to_quaternion(axis.norm()*atan2(axis.abs(), sim.attitude.z_axis()*a))*sim.attitude);
+  sim.stabilized_attitude = false;
+}
+
+void update_derived_state (SimulationContext &sim)
+  // Works out sim.derived from the lander state, once a step after the integrator has moved the lander
+  // (and whenever the state is set by other means), so that the autopilot, attitude control, parachute
+  // checks and instruments need not each recompute the same quantities
+{
+  DerivedState &d = sim.derived;
+  vector3d air, air_direction; // lander velocity relative to the atmosphere
+  double air_speed, air_speed2;
+
+  d.radial = sim.position.unit(d.radius);
+  d.altitude = d.radius - MARS_RADIUS;
+  d.radial_speed = sim.velocity*d.radial;
+  d.tangential_speed = (sim.velocity - d.radial*d.radial_speed).abs();
+  d.surface_velocity = mars_velocity_wrt_world(sim, d.radius, true);
+  d.air_velocity = mars_velocity_wrt_world(sim, d.radius, false);
+  d.density = mars_atmosphere.density(d.altitude);
+  d.mass = current_lander_mass(sim);
+
+  // Assume high Reynolds number, quadratic drag = -0.5 * rho * v^2 * A * C_d
+  air = sim.velocity - d.air_velocity;
+  air_direction = air.unit(air_speed, air_speed2);
+  d.lander_drag = air_direction*(-0.5*d.density*DRAG_COEF_LANDER*M_PI*LANDER_SIZE*LANDER_SIZE*air_speed2);
+  d.chute_drag = air_direction*(-0.5*d.density*DRAG_COEF_CHUTE*5.0*2.0*LANDER_SIZE*2.0*LANDER_SIZE*air_speed2);
+}
+
+void state_derivative (SimulationContext &sim, vector3d pos, vector3d vel, vector3d &dpos, vector3d &dvel)
+  // Derivative of the lander state (position, velocity) for the adaptive integrator. Fuel, parachute,
+  // engine lag and gust speed are held at their values for the current step.
+{
+  sim.position = pos;
+  sim.velocity = vel;
+  dpos = vel;
+  dvel = acceleration(sim);
+}
+
+void adaptive_dynamics (SimulationContext &sim)
+  // One Dormand-Prince 5(4) step with error control. Steps grow to ADAPTIVE_MAX_STEP while coasting in
+  // vacuum, but never exceed the control interval while the engine is firing, the parachute is out, the
+  // autopilot is flying or the lander is in the atmosphere. Sets sim.delta_t to the step taken.
+{
+  vector3d p0, v0, p, v, kp[7], kv[7], ep, ev;
+  double h, max_step, lagged_throttle_at_start, error, scale, factor;
+  int i, j;
+
+  p0 = sim.position;
+  v0 = sim.velocity;
+  lagged_throttle_at_start = sim.lagged_throttle;
+
+  max_step = ADAPTIVE_MAX_STEP;
+  if ((sim.throttle > 0.0) || (sim.lagged_throttle > SMALL_NUM) || (sim.parachute_status == DEPLOYED) || sim.autopilot_enabled
+      || (sim.position.abs() - MARS_RADIUS < EXOSPHERE)) max_step = sim.control_interval;
+  h = sim.adaptive_step;
+  if (h > max_step) h = max_step;
+
+  while (true) {
+    // The engine lag depends on the step length, so it is redone for every attempt
+    sim.lagged_throttle = lagged_throttle_at_start;
+    update_engine(sim, h);
+
+    for (i=0; i<7; i++) {
+      p = p0; v = v0;
+      for (j=0; j<i; j++) {
+        p += (h*dp_a[i][j])*kp[j];
+        v += (h*dp_a[i][j])*kv[j];
+      }
+      state_derivative(sim, p, v, kp[i], kv[i]);
+    }
+    p = p0; v = v0; ep = vector3d(0.0, 0.0, 0.0); ev = vector3d(0.0, 0.0, 0.0);
+    for (i=0; i<7; i++) {
+      p += (h*dp_b[i])*kp[i];
+      v += (h*dp_b[i])*kv[i];
+      ep += (h*dp_e[i])*kp[i];
+      ev += (h*dp_e[i])*kv[i];
+    }
+
+    // Error relative to the tolerance, worst of position and velocity
+    scale = ADAPTIVE_POSITION_TOLERANCE + ADAPTIVE_RELATIVE_TOLERANCE*fmax(p0.abs(), p.abs());
+    error = ep.abs()/scale;
+    scale = ADAPTIVE_VELOCITY_TOLERANCE + ADAPTIVE_RELATIVE_TOLERANCE*fmax(v0.abs(), v.abs());
+    if (ev.abs()/scale > error) error = ev.abs()/scale;
+
+    if ((error <= 1.0) || (h <= ADAPTIVE_MIN_STEP)) break;
+    factor = 0.9*pow(error, -0.2);
+    if (factor < 0.2) factor = 0.2;
+    h *= factor;
+    if (h < ADAPTIVE_MIN_STEP) h = ADAPTIVE_MIN_STEP;
+  }
+
+  sim.previous_position = p0;
+  sim.position = p;
+  sim.velocity = v;
+  sim.delta_t = h;
+
+  // Propose the next step, growing by at most a factor of five
+  if (error > 0.0) factor = 0.9*pow(error, -0.2);
+  else factor = 5.0;
+  if (factor > 5.0) factor = 5.0;
+  if (factor < 0.2) factor = 0.2;
+  sim.adaptive_step = h*factor;
+}
+
+void symplectic_dynamics (SimulationContext &sim)
+  // One step of velocity Verlet (kick-drift-kick), or of Yoshida's fourth order method, which chains three
+  // velocity Verlet substeps of w1, w0 and w1 times the step (the same scheme as Forest-Ruth). Both are
+  // symplectic under gravity alone, so the orbital energy error stays bounded instead of drifting; drag and
+  // thrust are evaluated at the half-kicked velocity. The velocity is in step with the position.
+{
+  static const double w1 = 1.0/(2.0 - cbrt(2.0)), w0 = 1.0 - 2.0*w1;
+  const double yoshida_weights[3] = {w1, w0, w1}, verlet_weights[1] = {1.0};
+  const double *weights;
+  vector3d a;
+  double h;
+  int i, n_substeps;
+  bool a_current = false;
+
+  if (sim.integrator == YOSHIDA_4) {
+    weights = yoshida_weights;
+    n_substeps = 3;
+  }
+  else {
+    weights = verlet_weights;
+    n_substeps = 1;
+  }
+
+  sim.previous_position = sim.position;
+  for (i=0; i<n_substeps; i++) {
+    h = weights[i]*sim.delta_t;
+    if (!a_current) a = acceleration(sim);
+    sim.velocity += a*(0.5*h);
+    sim.position += sim.velocity*h;
+    a = acceleration(sim);
+    sim.velocity += a*(0.5*h);
+    a_current = (sim.position.abs() - MARS_RADIUS > EXOSPHERE); // no drag, so the next substep can start from the same acceleration
+  }
+}
+
+bool kepler_coast (SimulationContext &sim)
+  // Time warp. While the lander coasts above the exosphere with the engine off and the moons ignored, its
+  // orbit is a fixed conic, so jump along it analytically to KEPLER_COAST_MARGIN short of atmosphere entry
+  // or of the apsis where the autopilot's next burn may fall due, but at most KEPLER_MAX_COAST ahead. The
+  // normal step follows on from there. Returns true if a jump was made.
+{
+  vector3d v0, p, v;
+  double jump, t, dt = sim.control_interval;
+  unsigned long i;
+
+  if (!sim.time_warp || !sim.lander_unheld || sim.landed || sim.moon_effect_on || (sim.parachute_status == DEPLOYED)) return false;
+  if ((sim.position.abs() - MARS_RADIUS <= EXOSPHERE) || (sim.throttle > 0.0) || (sim.lagged_throttle > SMALL_NUM)) return false;
+  for (i=0; i<sim.throttle_history.size(); i++) if (sim.throttle_history[i] > 0.0) return false; // a command is still on its way
+
+  // Autopilot phases that wait for an apsis may coast up to it; any other active phase may fire at any time
+  jump = KEPLER_MAX_COAST;
+  if (sim.autopilot_enabled && !sim.accept_input_altitude) {
+    switch (sim.current_lander_phase) {
+    case let_it_be:
+      if (sim.current_autopilot_mode == maintain_mode) break;
+      if (sim.current_autopilot_mode != transfer_mode) return false;
+      // fall through
+    case let_it_go:
+    case the_sound_of_silence:
+      if ((sim.current_lander_phase == the_sound_of_silence) && ((sim.current_autopilot_mode == descent_mode) || (sim.current_autopilot_mode == powered_descent_mode))) return false;
+      t = sim.lander_Kepler.time_to_apsis(sim.position, sim.velocity);
+      if (t < 0.0) return false; // circular, the next burn could be anywhere
+      jump = t - KEPLER_COAST_MARGIN;
+      break;
+    default:
+      return false;
+    }
+  }
+
+  v0 = sim.velocity;
+  if (sim.integrator == VERLET) v0 += acceleration_gravity(sim)*(0.5*dt); // Verlet's velocity lags by half a step
+
+  t = sim.lander_Kepler.time_to_radius(sim.position, v0, MARS_RADIUS + EXOSPHERE);
+  if ((t >= 0.0) && (t - KEPLER_COAST_MARGIN < jump)) jump = t - KEPLER_COAST_MARGIN;
+  if (sim.simulation_time + jump > sim.time_warp_limit) jump = sim.time_warp_limit - sim.simulation_time;
+  if (jump < 2.0*dt) return false;
+
+  // Jump the lander, leaving previous_position one step behind for Verlet
+  sim.lander_Kepler.propagate(sim.position, v0, jump - dt, sim.previous_position, v);
+  sim.lander_Kepler.propagate(sim.position, v0, jump, p, v);
+  sim.position = p;
+  if (sim.integrator == VERLET) sim.velocity = (sim.position - sim.previous_position)/dt;
+  else sim.velocity = v;
+  sim.last_position = sim.position; // so that update_flight_status() only sees the step that follows
+
+  // Jump the moons and the clock, and let the engine lag die away
+  sim.Phobos.jump_object(jump, dt, sim.simulation_time);
+  sim.Deimos.jump_object(jump, dt, sim.simulation_time);
+  sim.simulation_time += jump;
+  sim.lagged_throttle = 0.0;
+  return true;
+}
+
+vector3d rotate_with_planet (SimulationContext &sim, vector3d v)
+  // Carries v round with the planet over one step, for a lander held on the launchpad. The rotation
+  // matrix is only worked out again when the step length or sim.rotation_on change.
+{
+  double angle = sim.rotation_on*sim.delta_t*2*M_PI/MARS_DAY;
+
+  if (angle != sim.planet_rotation_angle) {
+    sim.planet_rotation = matrix3d::rotation_z(angle);
+    sim.planet_rotation_angle = angle;
+  }
+  return sim.planet_rotation*v;
+}
+
+void numerical_dynamics (SimulationContext &sim)
   // This is the function that performs the numerical integration to update the
-  // lander's pose. The time step is delta_t (global variable).
+  // lander's pose. With the fixed step integrators the time step is sim.delta_t; with the
+  // adaptive integrator, sim.delta_t is set to the length of the step actually taken.
 {
-  static vector3d previous_position; // static local variable to store previous position
   vector3d temp_position = vector3d(0.0, 0.0, 0.0); // local variable to store 'x(t-dt)' position
-  vector3d z_axis = vector3d(0.0, 0.0, 1.0); // for moving the lander around on launchpad
   
-  gust_speed = weibull_random_number(); // random gust speed
+  kepler_coast(sim); // time warp over coast arcs, if enabled
+  sim.gust_speed = weibull_random_number(sim); // random gust speed
+  if (sim.integrator != DORMAND_PRINCE) update_engine(sim, sim.delta_t); // the adaptive integrator does this once it knows the step length
   
   // UPDATE LANDER'S POSE
-  if (simulation_time == 0.0) { // first iteration
-    previous_position = position;
-    if (lander_unheld) {
-      position = position + velocity*delta_t +acceleration()*(0.5*delta_t*delta_t);
-      velocity = (position - previous_position)/delta_t;
+  if (sim.integrator == DORMAND_PRINCE) {
+    if (sim.lander_unheld) adaptive_dynamics(sim);
+    else {
+      sim.delta_t = sim.control_interval;
+      update_engine(sim, sim.delta_t);
+      sim.previous_position = sim.position;
+      sim.position = rotate_with_planet(sim, sim.position);
+      sim.velocity = rotate_with_planet(sim, sim.velocity);
+    }
+  }
+  else if (sim.lander_unheld && (sim.integrator != VERLET)) symplectic_dynamics(sim);
+  else if (sim.simulation_time == 0.0) { // first iteration
+    sim.previous_position = sim.position;
+    if (sim.lander_unheld) {
+      sim.position = sim.position + sim.velocity*sim.delta_t +acceleration(sim)*(0.5*sim.delta_t*sim.delta_t);
+      sim.velocity = (sim.position - sim.previous_position)/sim.delta_t;
     }
     else {
-      position = rodrigues_rotation(position, z_axis, rotation_on*delta_t*2*M_PI/MARS_DAY);
-      velocity = rodrigues_rotation(velocity, z_axis, rotation_on*delta_t*2*M_PI/MARS_DAY);
+      sim.position = rotate_with_planet(sim, sim.position);
+      sim.velocity = rotate_with_planet(sim, sim.velocity);
     }
   }
   else { // subsequent iterations
-    if (lander_unheld) {
-      temp_position = position;
-      position = position*2.0 - previous_position + acceleration()*(delta_t*delta_t);
-      previous_position = temp_position;
-      velocity = (position - previous_position)/delta_t;
+    if (sim.lander_unheld) {
+      temp_position = sim.position;
+      sim.position = sim.position*2.0 - sim.previous_position + acceleration(sim)*(sim.delta_t*sim.delta_t);
+      sim.previous_position = temp_position;
+      sim.velocity = (sim.position - sim.previous_position)/sim.delta_t;
     }
     else {
-      temp_position = position;
-      position = rodrigues_rotation(position, z_axis, rotation_on*delta_t*2*M_PI/MARS_DAY);
-      previous_position = temp_position;
-      velocity = rodrigues_rotation(velocity, z_axis, rotation_on*delta_t*2*M_PI/MARS_DAY);
+      temp_position = sim.position;
+      sim.position = rotate_with_planet(sim, sim.position);
+      sim.previous_position = temp_position;
+      sim.velocity = rotate_with_planet(sim, sim.velocity);
     }
   }
   
+  update_derived_state(sim);
+  
   // UPDATE LANDER'S KEPLERIAN ELEMENTS
-  lander_Kepler.update_Kepler(position, velocity);
+  sim.lander_Kepler.update_Kepler(sim.position, sim.velocity);
   
-  // UPDATE PHOBOS & DEIMOS STATES
-  Phobos.update_object();
-  Phobos_Kepler.update_Kepler(Phobos.get_position(), Phobos.get_velocity());
-  Deimos.update_object();
-  Deimos_Kepler.update_Kepler(Deimos.get_position(), Deimos.get_velocity());
+  // UPDATE PHOBOS & DEIMOS STATES - with analytic ephemerides their orbits are fixed, so the elements are set once
+  sim.Phobos.update_object(sim.delta_t, sim.simulation_time);
+  if (!sim.Phobos.get_analytic()) sim.Phobos_Kepler.update_Kepler(sim.Phobos.get_position(), sim.Phobos.get_velocity());
+  sim.Deimos.update_object(sim.delta_t, sim.simulation_time);
+  if (!sim.Deimos.get_analytic()) sim.Deimos_Kepler.update_Kepler(sim.Deimos.get_position(), sim.Deimos.get_velocity());
   
   // AUTOPILOT AND ATTITUDE STABILIZATION ROUTINES
-  if (autopilot_enabled) autopilot(); // autopilot to adjust the thrust, parachute and attitude
-  if (stabilized_attitude) attitude_stabilization(); // 3D stabilization
+  if (sim.autopilot_enabled) autopilot(sim); // autopilot to adjust the thrust, parachute and attitude
+  if (sim.stabilized_attitude) attitude_stabilization(sim); // 3D stabilization
   
   // Update closeup view axes to be used in manual attitude control
-  update_closeup_coords();
-  previous_out = (closeup_coords.right).norm();
-  previous_up = position.norm();
-  previous_left = (previous_up^previous_out).norm();
+  update_closeup_coords(sim);
+  sim.previous_out = (sim.closeup_coords.right).norm();
+  sim.previous_up = sim.derived.radial;
+  sim.previous_left = (sim.previous_up^sim.previous_out).norm();
   
 }
 
-void initialize_simulation (void)
+void initialize_simulation (SimulationContext &sim)
   // Lander pose initialization - selects one of 10 possible scenarios
 {
-  //~ // Comment this out to read lander data into a csv file //
-  //~ // Truncate old data in .csv file before each simulation
-  //~ ofstream fileout;
-  //~ fileout.open("../octave-assignment/lander_data.csv", ios::binary | ios::trunc);
-  //~ if (!fileout.good()) {
-    //~ cout << "Error while initializing data file\n";
-  //~ }
-  //~ fileout.close();
-  
   // Initialise Phobos & Deimos states
   vector3d moon_initial_position, moon_initial_velocity;
   
   moon_initial_position = vector3d(9234420*cos(1.093*M_PI/180.0), 0.0, 9234420*sin(1.093*M_PI/180.0)); // approx. circular motion
   moon_initial_velocity = vector3d(0.0, sqrt(GRAVITY*MARS_MASS/9234420), 0.0);
-  Phobos = Orbiting_object(moon_initial_position, moon_initial_velocity, PHOBOS_MASS);
+  sim.Phobos = Orbiting_object(moon_initial_position, moon_initial_velocity, PHOBOS_MASS);
+  sim.Phobos_Kepler.update_Kepler(moon_initial_position, moon_initial_velocity);
   
   moon_initial_position = vector3d(-23455500*cos(0.93*M_PI/180.0), 0.0, -23455500*sin(0.93*M_PI/180.0)); // approx. circular motion
   moon_initial_velocity = vector3d(0.0, -sqrt(GRAVITY*MARS_MASS/23455500), 0.0);
-  Deimos = Orbiting_object(moon_initial_position, moon_initial_velocity, DEIMOS_MASS);
+  sim.Deimos = Orbiting_object(moon_initial_position, moon_initial_velocity, DEIMOS_MASS);
+  sim.Deimos_Kepler.update_Kepler(moon_initial_position, moon_initial_velocity);
   
   // Set some parameters
-
-  scenario_description[0] = "circular orbit";
-  scenario_description[1] = "descent from 10km";
-  scenario_description[2] = "polar elliptical orbit";
-  scenario_description[3] = "drag prevents polar escape";
-  scenario_description[4] = "elliptical orbit that clips the atmosphere";
-  scenario_description[5] = "descent from 200km";
-  scenario_description[6] = "areostationary orbit";
-  scenario_description[7] = "polar launch";
-  scenario_description[8] = "equatorial launch";
-  scenario_description[9] = "launch from Northern hemisphere";
-  
-  lander_unheld = true;
+  sim.lander_unheld = true;
   
-  switch (scenario) {
+  switch (sim.scenario) {
 
   case 0:
     // a circular equatorial orbit
-    position = vector3d(1.2*MARS_RADIUS, 0.0, 0.0);
-    velocity = vector3d(0.0, -3247.087385863725, 0.0);
-    orientation = vector3d(0.0, 90.0, 0.0);
-    delta_t = 0.1;
-    parachute_status = NOT_DEPLOYED;
-    stabilized_attitude = false;
-    autopilot_enabled = false;
-    current_lander_phase = let_it_be;
-    current_autopilot_mode = maintain_mode;
+    sim.position = vector3d(1.2*MARS_RADIUS, 0.0, 0.0);
+    sim.velocity = vector3d(0.0, -3247.087385863725, 0.0);
+    sim.attitude = xyz_euler_to_quaternion(vector3d(0.0, 90.0, 0.0));
+    sim.delta_t = 0.1;
+    sim.integrator = DORMAND_PRINCE;
+    sim.parachute_status = NOT_DEPLOYED;
+    sim.stabilized_attitude = false;
+    sim.autopilot_enabled = false;
+    sim.current_lander_phase = let_it_be;
+    sim.current_autopilot_mode = maintain_mode;
     break;
 
   case 1:
     // a descent from rest at 10km altitude
-    position = vector3d(0.0, -(MARS_RADIUS + 10000.0), 0.0);
-    velocity = vector3d(0.0, 0.0, 0.0);
-    orientation = vector3d(0.0, 0.0, 90.0);
-    delta_t = 0.1;
-    parachute_status = NOT_DEPLOYED;
-    stabilized_attitude = true;
-    autopilot_enabled = false;
-    current_lander_phase = viva_la_vida;
-    current_autopilot_mode = descent_mode;
+    sim.position = vector3d(0.0, -(MARS_RADIUS + 10000.0), 0.0);
+    sim.velocity = vector3d(0.0, 0.0, 0.0);
+    sim.attitude = xyz_euler_to_quaternion(vector3d(0.0, 0.0, 90.0));
+    sim.delta_t = 0.1;
+    sim.integrator = VERLET;
+    sim.parachute_status = NOT_DEPLOYED;
+    sim.stabilized_attitude = true;
+    sim.autopilot_enabled = false;
+    sim.current_lander_phase = viva_la_vida;
+    sim.current_autopilot_mode = descent_mode;
     break;
 
   case 2:
     // an elliptical polar orbit
-    position = vector3d(0.0, 0.0, 1.2*MARS_RADIUS);
-    velocity = vector3d(3500.0, 0.0, 0.0);
-    orientation = vector3d(0.0, 0.0, 90.0);
-    delta_t = 0.1;
-    parachute_status = NOT_DEPLOYED;
-    stabilized_attitude = false;
-    autopilot_enabled = false;
-    current_lander_phase = let_it_be;
-    current_autopilot_mode = maintain_mode;
+    sim.position = vector3d(0.0, 0.0, 1.2*MARS_RADIUS);
+    sim.velocity = vector3d(3500.0, 0.0, 0.0);
+    sim.attitude = xyz_euler_to_quaternion(vector3d(0.0, 0.0, 90.0));
+    sim.delta_t = 0.1;
+    sim.integrator = DORMAND_PRINCE;
+    sim.parachute_status = NOT_DEPLOYED;
+    sim.stabilized_attitude = false;
+    sim.autopilot_enabled = false;
+    sim.current_lander_phase = let_it_be;
+    sim.current_autopilot_mode = maintain_mode;
     break;
 
   case 3:
     // polar surface launch at escape velocity (but drag prevents escape)
-    position = vector3d(0.0, 0.0, MARS_RADIUS + LANDER_SIZE/2.0);
-    velocity = vector3d(0.0, 0.0, 5027.0);
-    orientation = vector3d(0.0, 0.0, 0.0);
-    delta_t = 0.1;
-    parachute_status = NOT_DEPLOYED;
-    stabilized_attitude = false;
-    autopilot_enabled = false;
-    current_lander_phase = viva_la_vida;
-    current_autopilot_mode = descent_mode;
+    sim.position = vector3d(0.0, 0.0, MARS_RADIUS + LANDER_SIZE/2.0);
+    sim.velocity = vector3d(0.0, 0.0, 5027.0);
+    sim.attitude = xyz_euler_to_quaternion(vector3d(0.0, 0.0, 0.0));
+    sim.delta_t = 0.1;
+    sim.integrator = VERLET;
+    sim.parachute_status = NOT_DEPLOYED;
+    sim.stabilized_attitude = false;
+    sim.autopilot_enabled = false;
+    sim.current_lander_phase = viva_la_vida;
+    sim.current_autopilot_mode = descent_mode;
     break;
 
   case 4:
     // an elliptical orbit that clips the atmosphere each time round, losing energy
-    position = vector3d(0.0, 0.0, MARS_RADIUS + 100000.0);
-    velocity = vector3d(4000.0, 0.0, 0.0);
-    orientation = vector3d(0.0, 90.0, 0.0);
-    delta_t = 0.1;
-    parachute_status = NOT_DEPLOYED;
-    stabilized_attitude = false;
-    autopilot_enabled = false;
-    current_lander_phase = viva_la_vida;
-    current_autopilot_mode = descent_mode;
+    sim.position = vector3d(0.0, 0.0, MARS_RADIUS + 100000.0);
+    sim.velocity = vector3d(4000.0, 0.0, 0.0);
+    sim.attitude = xyz_euler_to_quaternion(vector3d(0.0, 90.0, 0.0));
+    sim.delta_t = 0.1;
+    sim.integrator = DORMAND_PRINCE;
+    sim.parachute_status = NOT_DEPLOYED;
+    sim.stabilized_attitude = false;
+    sim.autopilot_enabled = false;
+    sim.current_lander_phase = viva_la_vida;
+    sim.current_autopilot_mode = descent_mode;
     break;
 
   case 5:
     // a descent from rest at the edge of the exosphere
-    position = vector3d(0.0, -(MARS_RADIUS + EXOSPHERE), 0.0);
-    velocity = vector3d(0.0, 0.0, 0.0);
-    orientation = vector3d(0.0, 0.0, 90.0);
-    delta_t = 0.1;
-    parachute_status = NOT_DEPLOYED;
-    stabilized_attitude = true;
-    autopilot_enabled = false;
-    current_lander_phase = viva_la_vida;
-    current_autopilot_mode = descent_mode;
+    sim.position = vector3d(0.0, -(MARS_RADIUS + EXOSPHERE), 0.0);
+    sim.velocity = vector3d(0.0, 0.0, 0.0);
+    sim.attitude = xyz_euler_to_quaternion(vector3d(0.0, 0.0, 90.0));
+    sim.delta_t = 0.1;
+    sim.integrator = VERLET;
+    sim.parachute_status = NOT_DEPLOYED;
+    sim.stabilized_attitude = true;
+    sim.autopilot_enabled = false;
+    sim.current_lander_phase = viva_la_vida;
+    sim.current_autopilot_mode = descent_mode;
     break;
 
   case 6:
     // an areostationary orbit
-    position = vector3d(cbrt((GRAVITY*MARS_MASS*MARS_DAY*MARS_DAY)/(4.0*M_PI*M_PI)), 0.0, 0.0);
-    velocity = vector3d(0.0, 2.0*M_PI*cbrt((GRAVITY*MARS_MASS*MARS_DAY*MARS_DAY)/(4.0*M_PI*M_PI))/MARS_DAY, 0.0);
-    orientation = vector3d(0.0, 90.0, 0.0);
-    delta_t = 0.1;
-    parachute_status = NOT_DEPLOYED;
-    stabilized_attitude = true;
-    autopilot_enabled = false;
-    current_lander_phase = let_it_be;
-    current_autopilot_mode = maintain_mode;
+    sim.position = vector3d(cbrt((GRAVITY*MARS_MASS*MARS_DAY*MARS_DAY)/(4.0*M_PI*M_PI)), 0.0, 0.0);
+    sim.velocity = vector3d(0.0, 2.0*M_PI*cbrt((GRAVITY*MARS_MASS*MARS_DAY*MARS_DAY)/(4.0*M_PI*M_PI))/MARS_DAY, 0.0);
+    sim.attitude = xyz_euler_to_quaternion(vector3d(0.0, 90.0, 0.0));
+    sim.delta_t = 0.1;
+    sim.integrator = DORMAND_PRINCE;
+    sim.parachute_status = NOT_DEPLOYED;
+    sim.stabilized_attitude = true;
+    sim.autopilot_enabled = false;
+    sim.current_lander_phase = let_it_be;
+    sim.current_autopilot_mode = maintain_mode;
     break;
   
   case 7:
     // polar launch
-    position = vector3d(0.0, 0.0, MARS_RADIUS+LAUNCHPAD_HEIGHT);
-    velocity = vector3d(0.0, 0.0, 0.0);
-    orientation = vector3d(0.0, 0.0, 0.0);
-    delta_t = 0.1;
-    parachute_status = NOT_DEPLOYED;
-    stabilized_attitude = true;
-    autopilot_enabled = false;
-    current_lander_phase = let_it_go;
-    current_autopilot_mode = launch_mode;
-    lander_unheld = false;
+    sim.position = vector3d(0.0, 0.0, MARS_RADIUS+LAUNCHPAD_HEIGHT);
+    sim.velocity = vector3d(0.0, 0.0, 0.0);
+    sim.attitude = xyz_euler_to_quaternion(vector3d(0.0, 0.0, 0.0));
+    sim.delta_t = 0.1;
+    sim.integrator = VERLET;
+    sim.parachute_status = NOT_DEPLOYED;
+    sim.stabilized_attitude = true;
+    sim.autopilot_enabled = false;
+    sim.current_lander_phase = let_it_go;
+    sim.current_autopilot_mode = launch_mode;
+    sim.lander_unheld = false;
     break;
 
   case 8:
     // equatorial launch
-    position = vector3d(MARS_RADIUS+LAUNCHPAD_HEIGHT, 0.0, 0.0);
-    velocity = mars_velocity_wrt_world(MARS_RADIUS+LAUNCHPAD_HEIGHT, true);
-    orientation = vector3d(0.0, 90.0, 0.0);
-    delta_t = 0.1;
-    parachute_status = NOT_DEPLOYED;
-    stabilized_attitude = true;
-    autopilot_enabled = false;
-    current_lander_phase = let_it_go;
-    current_autopilot_mode = launch_mode;
-    lander_unheld = false;
+    sim.position = vector3d(MARS_RADIUS+LAUNCHPAD_HEIGHT, 0.0, 0.0);
+    sim.velocity = mars_velocity_wrt_world(sim, MARS_RADIUS+LAUNCHPAD_HEIGHT, true);
+    sim.attitude = xyz_euler_to_quaternion(vector3d(0.0, 90.0, 0.0));
+    sim.delta_t = 0.1;
+    sim.integrator = VERLET;
+    sim.parachute_status = NOT_DEPLOYED;
+    sim.stabilized_attitude = true;
+    sim.autopilot_enabled = false;
+    sim.current_lander_phase = let_it_go;
+    sim.current_autopilot_mode = launch_mode;
+    sim.lander_unheld = false;
     break;
 
   case 9:
     // random launch
-    position = vector3d((MARS_RADIUS+LAUNCHPAD_HEIGHT)*cos(M_PI/4), 0.0, (MARS_RADIUS+LAUNCHPAD_HEIGHT)*cos(M_PI/4));
-    velocity = mars_velocity_wrt_world(MARS_RADIUS+LAUNCHPAD_HEIGHT, true);
-    orientation = vector3d(0.0, 90.0, 0.0);
-    delta_t = 0.1;
-    parachute_status = NOT_DEPLOYED;
-    stabilized_attitude = true;
-    autopilot_enabled = false;
-    current_lander_phase = let_it_go;
-    current_autopilot_mode = launch_mode;
-    lander_unheld = false;
+    sim.position = vector3d((MARS_RADIUS+LAUNCHPAD_HEIGHT)*cos(M_PI/4), 0.0, (MARS_RADIUS+LAUNCHPAD_HEIGHT)*cos(M_PI/4));
+    sim.velocity = mars_velocity_wrt_world(sim, MARS_RADIUS+LAUNCHPAD_HEIGHT, true);
+    sim.attitude = xyz_euler_to_quaternion(vector3d(0.0, 90.0, 0.0));
+    sim.delta_t = 0.1;
+    sim.integrator = VERLET;
+    sim.parachute_status = NOT_DEPLOYED;
+    sim.stabilized_attitude = true;
+    sim.autopilot_enabled = false;
+    sim.current_lander_phase = let_it_go;
+    sim.current_autopilot_mode = launch_mode;
+    sim.lander_unheld = false;
     break;
 
   }
 }
 
+void update_closeup_coords (SimulationContext &sim)
+  // Updates the close-up view's coordinate frame, based on the lander's current position and velocity.
+  // This needs to be called every time step, even if the view is not being rendered, since any-angle
+  // attitude stabilizers reference closeup_coords.right
+{
+  vector3d s, tv, t;
+  double tmp;
+
+  // Direction from surface to lander (radial) - this must map to the world y-axis
+  s = sim.derived.radial;
+
+  // Direction of tangential velocity - this must map to the world x-axis
+  tv = sim.velocity_from_positions - (sim.velocity_from_positions*s)*s;
+  if (tv.abs() < SMALL_NUM) // vertical motion only, use last recorded tangential velocity
+    tv = sim.closeup_coords.backwards ? (sim.closeup_coords.right*s)*s - sim.closeup_coords.right : sim.closeup_coords.right - (sim.closeup_coords.right*s)*s; 
+  if (tv.abs() > SMALL_NUM) t = tv.norm();
+
+  // Check these two vectors are non-zero and perpendicular (they should be, unless s and closeup_coords.right happen to be parallel)
+  if ((tv.abs() <= SMALL_NUM) || (fabs(s*t) > SMALL_NUM)) {
+    // Set t to something perpendicular to s
+    t.x = -s.y; t.y = s.x; t.z = 0.0;
+    if (t.abs() < SMALL_NUM) {t.x = -s.z; t.y = 0.0; t.z = s.x;}
+    t = t.norm();
+  }
+
+  // Adjust the terrain texture angle if the lander has changed direction. The motion will still be along
+  // the x-axis, so we need to rotate the texture to compensate.
+  if (sim.closeup_coords.initialized) {
+    if (sim.closeup_coords.backwards) {
+      tmp = -sim.closeup_coords.right*t;
+      if (tmp > 1.0) tmp = 1.0; if (tmp < -1.0) tmp = -1.0;
+      if ((-sim.closeup_coords.right^t)*s < 0.0) sim.terrain_angle += (180.0/M_PI)*acos(tmp);
+      else sim.terrain_angle -= (180.0/M_PI)*acos(tmp);
+    } else {
+      tmp = sim.closeup_coords.right*t;
+      if (tmp > 1.0) tmp = 1.0; if (tmp < -1.0) tmp = -1.0;
+      if ((sim.closeup_coords.right^t)*s < 0.0) sim.terrain_angle += (180.0/M_PI)*acos(tmp);
+      else sim.terrain_angle -= (180.0/M_PI)*acos(tmp);
+    }
+    while (sim.terrain_angle < 0.0) sim.terrain_angle += 360.0;
+    while (sim.terrain_angle >= 360.0) sim.terrain_angle -= 360.0;
+  }
+
+  // Normally we maintain motion to the right, the one exception being when the ground speed passes
+  // through zero and changes sign. A sudden 180 degree change of viewpoint would be confusing, so
+  // in this instance we allow the lander to fly to the left.
+  if (sim.closeup_coords.initialized && (sim.closeup_coords.right*t < 0.0)) {
+    sim.closeup_coords.backwards = true;
+    sim.closeup_coords.right = -1.0*t;
+  } else {
+    sim.closeup_coords.backwards = false;
+    sim.closeup_coords.right = t;
+    sim.closeup_coords.initialized = true;
+  }
+}
+
+bool safe_to_deploy_parachute (SimulationContext &sim)
+  // Checks whether the parachute is safe to deploy at the current position and velocity
+{
+  double drag;
+
+  // Assume high Reynolds number, quadratic drag = -0.5 * rho * v^2 * A * C_d
+  drag = 0.5*DRAG_COEF_CHUTE*sim.derived.density*5.0*2.0*LANDER_SIZE*2.0*LANDER_SIZE*(sim.velocity_from_positions-sim.derived.air_velocity).abs2();
+  // Do not use sim.altitude here, in case this function is called from within the numerical_dynamics
+  // function, before altitude is updated in the update_flight_status function
+  if ((drag > MAX_PARACHUTE_DRAG) || ((sim.velocity_from_positions.abs() > MAX_PARACHUTE_SPEED) && (sim.derived.altitude < EXOSPHERE))) return false;
+  else return true;
+}
+
+void update_flight_status (SimulationContext &sim)
+  // The non-drawing part of the idle function. Re-estimates altitude, velocity, climb speed and ground
+  // speed from current and previous positions, checks for touchdown, then updates throttle, fuel and
+  // parachute status. Safe to call without a GLUT window, e.g. in headless mode.
+{
+  vector3d av_p, d;
+  double a, b, c, mu;
+
+  sim.simulation_time += sim.delta_t;
+  sim.altitude = sim.derived.altitude;
+
+  // Use average of current and previous positions when calculating climb and ground speeds
+  av_p = (sim.position + sim.last_position).norm();
+  if (sim.delta_t != 0.0) sim.velocity_from_positions = (sim.position - sim.last_position)/sim.delta_t;
+  else sim.velocity_from_positions = vector3d(0.0, 0.0, 0.0);
+  sim.climb_speed = sim.velocity_from_positions*av_p;
+  sim.ground_speed = (sim.velocity_from_positions - sim.climb_speed*av_p - mars_velocity_wrt_world(sim, MARS_RADIUS, true)).abs();
+
+  // Check to see whether the lander has landed
+  if (sim.altitude < LANDER_SIZE/2.0) {
+    // Estimate position and time of impact
+    d = sim.position - sim.last_position;
+    a = d.abs2();
+    b = 2.0*sim.last_position*d;
+    c = sim.last_position.abs2() - (MARS_RADIUS + LANDER_SIZE/2.0) * (MARS_RADIUS + LANDER_SIZE/2.0);
+    mu = (-b - sqrt(b*b-4.0*a*c))/(2.0*a);
+    sim.position = sim.last_position + mu*d;
+    sim.simulation_time -= (1.0-mu)*sim.delta_t; 
+    sim.altitude = LANDER_SIZE/2.0;
+    sim.landed = true;
+    if ((fabs(sim.climb_speed) > MAX_IMPACT_DESCENT_RATE) || (fabs(sim.ground_speed) > MAX_IMPACT_GROUND_SPEED)) sim.crashed = true;
+    sim.velocity_from_positions = vector3d(0.0, 0.0, 0.0);
+    update_derived_state(sim); // the lander has moved to the point of impact
+  }
+
+  // Update throttle and fuel (throttle might have been adjusted by the autopilot)
+  if (sim.throttle < 0.0) sim.throttle = 0.0;
+  if (sim.throttle > 1.0) sim.throttle = 1.0;
+  sim.fuel -= sim.delta_t * (FUEL_RATE_AT_MAX_THRUST*sim.throttle) / FUEL_CAPACITY;
+  if (sim.fuel <= 0.0) sim.fuel = 0.0;
+  if (sim.landed || (sim.fuel == 0.0)) sim.throttle = 0.0;
+
+  // Check to see whether the parachute has vaporized or the tethers have snapped
+  if (sim.parachute_status == DEPLOYED) {
+    if (!safe_to_deploy_parachute(sim) || sim.parachute_lost) {
+      sim.parachute_lost = true; // to guard against the autopilot reinstating the parachute!
+      sim.parachute_status = LOST;
+    }
+  }
+
+  if (sim.telemetry) sim.telemetry->push(sim);
+}
+
+void set_attitude (SimulationContext &sim, quaternion q)
+  // Makes q, renormalized, the lander's attitude, and brings out_axis, left_axis and up_axis into line with it
+{
+  sim.attitude = q.norm();
+  sim.out_axis = sim.attitude.x_axis();
+  sim.left_axis = sim.attitude.y_axis();
+  sim.up_axis = sim.attitude.z_axis();
+}
+
+void attitude_stabilization (SimulationContext &sim)
+  // Three-axis stabilization to ensure the lander's base is always pointing downwards. The attitude is
+  // a unit quaternion: the autopilot sets it from the axes it wants, and the manual commands rotate it
+  // by a rotation vector, so there are no Euler angles (or gimbal lock) anywhere in the loop.
+{
+  vector3d normalized_lander_wrt_mars;
+  vector3d up, left, out; // up - direction to point lander yaw/overhead/z axis (its nose); left - direction to point lander pitch/port/y axis; out - direction to point lander roll/forward/x axis
+  double stabilized_angle;
+  quaternion relative; // attitude relative to the closeup view frame
+  
+  if (sim.autopilot_enabled) {
+    
+    up = sim.derived.radial; // direction of radial vector; first vector to define the plane of motion wrt Mars
+    stabilized_angle = sim.stabilized_attitude_angle*M_PI/180.0;
+    
+    // The nose points up, and the out axis along the plane of motion
+    if (sim.stabilized_attitude_in_plane_wrt_mars) { // in plane of motion wrt Mars
+      normalized_lander_wrt_mars = (sim.velocity - sim.derived.radial_speed*sim.derived.radial - sim.derived.surface_velocity).norm(); // direction of lander absolute velocity wrt Mars surface absolute velocity; second vector to define the plane of motion wrt Mars
+      out = normalized_lander_wrt_mars;
+    }
+    else out = (sim.closeup_coords.right).norm(); // in plane of motion
+    left = (up^out).norm();
+    
+    // Then tilt the lander by stabilized_attitude_angle about its left axis
+    if (stabilized_angle == 0.0) set_attitude(sim, axes_to_quaternion(out, left, up));
+    else set_attitude(sim, rotation_vector_to_quaternion(left*stabilized_angle)*axes_to_quaternion(out, left, up));
+  }
+  else {
+    stabilized_angle = sim.input_attitude_angle*M_PI/180.0;
+
+    switch (sim.input_attitude_command) {
+    
+    case pitch_command:
+      // Rotate the lander about its left axis
+      set_attitude(sim, rotation_vector_to_quaternion(sim.left_axis*stabilized_angle)*sim.attitude);
+      break;
+  
+    case roll_command:
+      // Rotate the lander about its out axis
+      set_attitude(sim, rotation_vector_to_quaternion(sim.out_axis*stabilized_angle)*sim.attitude);
+      break;
+  
+    case yaw_command:
+      // Rotate the lander about its up axis
+      set_attitude(sim, rotation_vector_to_quaternion(sim.up_axis*stabilized_angle)*sim.attitude);
+      break;
+    
+    case stabilize_command:
+      
+      // Attitude relative to the previous closeup view (lander) frame - we want this relationship to be the
+      // same when up and closeup_coords.right change due to position changes
+      relative = axes_to_quaternion(sim.previous_out, sim.previous_left, sim.previous_up).conjugate()*sim.attitude;
+      
+      // Update closeup view (lander) axes - expressed in planet frame
+      update_closeup_coords(sim);
+      up = sim.derived.radial; // new closeup view 'up'
+      out = (sim.closeup_coords.right).norm(); // new closeup view 'right'
+      left = (up^out).norm(); // new closeup view 'in'
+      
+      // Rotate the lander so that relative to the new closeup view frame, its axes are the same as before
+      set_attitude(sim, axes_to_quaternion(out, left, up)*relative);
+      
+      // Update closeup view axes here in case attitude_stabilization(sim) is called from key press
+      update_closeup_coords(sim);
+      sim.previous_out = (sim.closeup_coords.right).norm();
+      sim.previous_up = sim.derived.radial;
+      sim.previous_left = (sim.previous_up^sim.previous_out).norm();
+      
+      break;
+    
+    case reset_command:
+      // Set up, left, out to its 'zero' state
+      update_closeup_coords(sim);
+      up = sim.derived.radial;
+      out = (sim.closeup_coords.right).norm();
+      left = (up^out).norm();
+      set_attitude(sim, axes_to_quaternion(out, left, up));
+      
+      break;
+    }
+  }
+}
+
+double delayed_throttle (SimulationContext &sim)
+  // The throttle command from ENGINE_DELAY ago, looked up by time in the throttle history
+{
+  unsigned long i = 0;
+
+  if (sim.throttle_history.empty()) return sim.throttle;
+  while ((i+1 < sim.throttle_history.size()) && (sim.throttle_history_time[i+1] <= sim.simulation_time - ENGINE_DELAY + SMALL_NUM)) i++;
+  return sim.throttle_history[i];
+}
+
+void update_engine (SimulationContext &sim, double dt)
+  // Records the current throttle command in the history, then advances the engine lag (time constant
+  // ENGINE_LAG) over a step of length dt. Calling again at the same simulation time replaces the record.
+{
+  double k, lag = ENGINE_LAG;
+
+  if (sim.simulation_time < sim.last_time_lag_updated) sim.lagged_throttle = 0.0; // simulation restarted
+  if (sim.throttle < 0.0) sim.throttle = 0.0;
+  if (sim.throttle > 1.0) sim.throttle = 1.0;
+  if (sim.landed || (sim.fuel == 0.0)) sim.throttle = 0.0;
+
+  // Throttle history, keeping just one command older than ENGINE_DELAY
+  if (!sim.throttle_history_time.empty() && (sim.throttle_history_time.back() == sim.simulation_time)) sim.throttle_history.back() = sim.throttle;
+  else {
+    sim.throttle_history_time.push_back(sim.simulation_time);
+    sim.throttle_history.push_back(sim.throttle);
+  }
+  while ((sim.throttle_history.size() > 1) && (sim.throttle_history_time[1] <= sim.simulation_time - ENGINE_DELAY + SMALL_NUM)) {
+    sim.throttle_history_time.pop_front();
+    sim.throttle_history.pop_front();
+  }
+
+  // Lag, with time constant ENGINE_LAG
+  if (lag <= 0.0) k = 0.0;
+  else k = pow(exp(-1.0), dt/lag);
+  sim.lagged_throttle = k*sim.lagged_throttle + (1.0-k)*delayed_throttle(sim);
+
+  sim.last_time_lag_updated = sim.simulation_time;
+}
+
+vector3d thrust_wrt_world (SimulationContext &sim)
+  // Works out thrust vector in the world reference frame, given the lander's attitude and the
+  // lagged throttle from the last update_engine() call
+{
+  vector3d b;
+
+  if (sim.autopilot_enabled && sim.stabilized_attitude && (sim.stabilized_attitude_angle == 0)) { // specific solution, avoids rounding errors in the more general calculation below, conditions modified to accommodate for manual attitude control stabilization
+    b = sim.lagged_throttle*MAX_THRUST*sim.position.norm();
+  } else {
+    b = sim.lagged_throttle*MAX_THRUST*sim.attitude.z_axis(); // the engine fires along the lander's up axis
+  }
+  return b;
+}
+
+void reset_simulation_state (SimulationContext &sim)
+  // Resets a simulation context to the initial state of its scenario
+{
+  vector3d p, tv;
+
+  // Reset these three lander parameters here, so they can be overwritten in initialize_simulation(sim) if so desired
+  sim.stabilized_attitude_angle = 0;
+  sim.stabilized_attitude_in_plane_wrt_mars = false;
+  sim.throttle = 0.0;
+  sim.fuel = 1.0;
+  sim.gust_speed = 0.0;
+  sim.input_attitude_command = stabilize_command; // initialise input attitude command
+  sim.accept_input_altitude = false;
+  sim.input_altitude = 15000;
+  sim.powered_descent.valid = false;
+
+  // Restore initial lander state
+  initialize_simulation(sim);
+  sim.control_interval = sim.delta_t;
+  sim.adaptive_step = sim.delta_t;
+
+  // Check whether the lander is underground - if so, make sure it doesn't move anywhere
+  sim.landed = false;
+  sim.crashed = false;
+  sim.altitude = sim.position.abs() - MARS_RADIUS;
+  if (sim.altitude < LANDER_SIZE/2.0) {
+    sim.landed = true;
+    sim.velocity = vector3d(0.0, 0.0, 0.0);
+  }
+  update_derived_state(sim);
+
+  // Visualisation routine's record of various speeds and velocities
+  sim.velocity_from_positions = sim.velocity;
+  sim.last_position = sim.position - sim.delta_t*sim.velocity_from_positions;
+  p = sim.position.norm();
+  sim.climb_speed = sim.velocity_from_positions*p;
+  tv = sim.velocity_from_positions - sim.climb_speed*p - mars_velocity_wrt_world(sim, MARS_RADIUS, true);
+  sim.ground_speed = tv.abs();
+
+  // Miscellaneous state variables
+  sim.simulation_time = 0.0;  
+  sim.parachute_lost = false;
+  sim.closeup_coords.initialized = false;
+  sim.closeup_coords.backwards = false;
+  sim.closeup_coords.right = vector3d(1.0, 0.0, 0.0);
+  update_closeup_coords(sim);
+
+  // Initialize the throttle history, as if the initial throttle had been held for ENGINE_DELAY, and the engine lag
+  sim.throttle_history_time.assign(1, -ENGINE_DELAY);
+  sim.throttle_history.assign(1, sim.throttle);
+  sim.lagged_throttle = 0.0;
+  sim.last_time_lag_updated = -1.0;
+  
+  // Initialise some variables that will be used for manual attitude control, starting from the scenario's attitude
+  set_attitude(sim, sim.attitude);
+  sim.input_attitude_angle = 0.0;
+  sim.previous_out = (sim.closeup_coords.right).norm();
+  sim.previous_up = sim.position.norm();
+  sim.previous_left = (sim.previous_up^sim.previous_out).norm();
+}
+
+void advance_simulation (SimulationContext &sim)
+  // Mechanical part of a single time step, shared by the GLUT idle function and headless mode
+{
+  // This needs to be called every time step, even if the close-up view is not being rendered,
+  // since any-angle attitude stabilizers reference closeup_coords.right
+  update_closeup_coords(sim);
+  
+  // Update historical record
+  sim.last_position = sim.position;
+
+  // Mechanical dynamics
+  numerical_dynamics(sim);
+}
+
+unsigned long run_to_touchdown (SimulationContext &sim, double time_limit)
+  // Advances the simulation flat out, without any graphics, until touchdown or until the simulation
+  // time reaches time_limit. Returns the number of time steps taken.
+{
+  unsigned long steps = 0;
+
+  sim.time_warp_limit = time_limit;
+  while (!sim.landed && (sim.simulation_time < time_limit)) {
+    advance_simulation(sim);
+    update_flight_status(sim);
+    steps++;
+  }
+  return steps;
+}
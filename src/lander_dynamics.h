@@ -3,6 +3,7 @@
 // Mechanical simulation header
 // Gabor Csanyi and Andrew Gee, October 2014
 // Anh Nguyen, August 2016
+// Thanh T Bui, October 2026
 
 // Permission is hereby granted, free of charge, to any person obtaining
 // a copy of this software and associated documentation, to make use of it
@@ -16,9 +17,93 @@
 #ifndef __LANDER_DYNAMICS_INCLUDED__
 #define __LANDER_DYNAMICS_INCLUDED__
 
-#include "global_1.h"
-#include "global_2.h"
+// Everything the simulation needs, without OpenGL, GLUT or SOIL, so that the headless tools (campaign,
+// tune_autopilot, energy_drift and physics_bench) build and run on machines without a display
+
+#if defined (__MINGW32__) && !defined (WIN32)
+#define WIN32
+#endif
+
+#ifdef WIN32
+#define _USE_MATH_DEFINES
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "define_constants.h"
+#include "vector3d.h"
+#include "quaternion.h"
+#include "matrix3d.h"
+#include "kepler_solver.h"
+#include "orbiting_object.h"
+#include "other_data_types.h"
+#include "simulation_context.h"
+#include "telemetry.h"
+#include "atmosphere.h"
 
 using namespace std;
 
+extern const string scenario_description[];
+extern const string integrator_name[];
+
+// Function prototypes
+matrix3d xyz_euler_to_matrix (vector3d ang);
+quaternion xyz_euler_to_quaternion (vector3d ang);
+quaternion axes_to_quaternion (vector3d out, vector3d left, vector3d up);
+quaternion rotation_vector_to_quaternion (vector3d r);
+void quaternion_to_matrix (quaternion q, double m[]);
+void microsecond_time (unsigned long long &t);
+const char* map_file (string filename, long &size);
+void unmap_file (const char *text, long size);
+unsigned long long hash_bytes (const char *text, long size);
+vector3d matrix_times_vector (double m[], vector3d n);
+void update_closeup_coords (SimulationContext &sim);
+bool safe_to_deploy_parachute (SimulationContext &sim);
+void update_flight_status (SimulationContext &sim);
+void set_attitude (SimulationContext &sim, quaternion q);
+void attitude_stabilization (SimulationContext &sim);
+double delayed_throttle (SimulationContext &sim);
+void update_engine (SimulationContext &sim, double dt);
+vector3d thrust_wrt_world (SimulationContext &sim);
+int integrator_from_name (string name);
+void autopilot (SimulationContext &sim);
+void update_derived_state (SimulationContext &sim);
+double hover_throttle (SimulationContext &sim);
+void powered_descent_guidance (SimulationContext &sim);
+void state_derivative (SimulationContext &sim, vector3d pos, vector3d vel, vector3d &dpos, vector3d &dvel);
+void adaptive_dynamics (SimulationContext &sim);
+void symplectic_dynamics (SimulationContext &sim);
+vector3d rotate_with_planet (SimulationContext &sim, vector3d v);
+bool kepler_coast (SimulationContext &sim);
+void numerical_dynamics (SimulationContext &sim);
+void initialize_simulation (SimulationContext &sim);
+void reset_simulation_state (SimulationContext &sim);
+void advance_simulation (SimulationContext &sim);
+unsigned long run_to_touchdown (SimulationContext &sim, double time_limit);
+
+// More function prototypes
+double atmospheric_density (vector3d pos);
+double current_lander_mass (SimulationContext &sim);
+vector3d acceleration_drag (SimulationContext &sim);
+vector3d acceleration_gravity (SimulationContext &sim);
+vector3d acceleration (SimulationContext &sim);
+void seed_random_number (unsigned long long &random_state, unsigned long long seed);
+void seed_random_number (SimulationContext &sim, unsigned long long seed);
+double uniform_random_number (unsigned long long &random_state);
+double uniform_random_number (SimulationContext &sim);
+double weibull_random_number (unsigned long long &random_state);
+double weibull_random_number (SimulationContext &sim);
+bool load_autopilot_gains (string filename, autopilot_gains_t &gains);
+void write_autopilot_gains (ostream &out, const autopilot_gains_t &gains);
+vector3d mars_velocity_wrt_world (SimulationContext &sim, double distance_from_centre, bool surface_velocity);
+
 #endif
@@ -92,93 +92,6 @@ void invert (double m[], double mout[])
   mout[15] = 1.0; mout[3] = 0.0; mout[7] = 0.0; mout[11] = 0.0;
 }
 
-void xyz_euler_to_matrix (vector3d ang, double m[])
-  // Constructs a 4x4 OpenGL rotation matrix from xyz Euler angles
-{
-  double sin_a, sin_b, sin_g, cos_a, cos_b, cos_g;
-  double ra, rb, rg;
-
-  // Pre-calculate radian angles
-  ra = ang.x*M_PI/(double)180;
-  rb = ang.y*M_PI/(double)180;
-  rg = ang.z*M_PI/(double)180;
-
-  // Pre-calculate sines and cosines
-  cos_a = cos(ra);
-  cos_b = cos(rb);
-  cos_g = cos(rg);
-  sin_a = sin(ra);
-  sin_b = sin(rb);
-  sin_g = sin(rg);
-
-  // Create the correct matrix coefficients
-  m[0] = cos_a * cos_b;
-  m[1] = sin_a * cos_b;
-  m[2] = - sin_b;
-  m[3] = 0.0;
-  m[4] = cos_a * sin_b * sin_g - sin_a * cos_g;
-  m[5] = sin_a * sin_b * sin_g + cos_a * cos_g;
-  m[6] = cos_b * sin_g;
-  m[7] = 0.0;
-  m[8] = cos_a * sin_b * cos_g + sin_a * sin_g;
-  m[9] = sin_a * sin_b * cos_g - cos_a * sin_g;
-  m[10] = cos_b * cos_g;
-  m[11] = 0.0;
-  m[12] = 0.0;
-  m[13] = 0.0;
-  m[14] = 0.0;
-  m[15] = 1.0;
-}
-
-vector3d matrix_to_xyz_euler (double m[])
-  // Decomposes a 4x4 OpenGL rotation matrix into xyz Euler angles
-{
-  double tmp;
-  vector3d ang;
-
-  // Catch degenerate elevation cases
-  if (m[2] < -0.99999999) {
-    ang.y = 90.0;
-    ang.x = 0.0;
-    ang.z = acos(m[8]);
-    if ( (sin(ang.z)>0.0) ^ (m[4]>0.0) ) ang.z = -ang.z;
-    ang.z *= 180.0/M_PI;
-    return ang;
-  }
-  if (m[2] > 0.99999999) {
-    ang.y = -90.0;
-    ang.x = 0.0;
-    ang.z = acos(m[5]);
-    if ( (sin(ang.z)<0.0) ^ (m[4]>0.0) ) ang.z = -ang.z;
-    ang.z *= 180.0/M_PI;
-    return ang;
-  }
-
-  // Non-degenerate elevation - between -90 and +90
-  ang.y = asin( -m[2] );
-
-  // Now work out azimuth - between -180 and +180
-  tmp = m[0]/cos(ang.y); // the denominator will not be zero
-  if ( tmp <= -1.0 ) ang.x = M_PI;
-  else if ( tmp >= 1.0 ) ang.x = 0.0;
-  else ang.x = acos( tmp );
-  if ( ((sin(ang.x) * cos(ang.y))>0.0) ^ ((m[1])>0.0) ) ang.x = -ang.x;
-
-  // Now work out roll - between -180 and +180
-  tmp = m[10]/cos(ang.y); // the denominator will not be zero
-  if ( tmp <= -1.0 ) ang.z = M_PI;
-  else if ( tmp >= 1.0 ) ang.z = 0.0;
-  else ang.z = acos( tmp );
-  if ( ((sin(ang.z) * cos(ang.y))>0.0) ^ ((m[6])>0.0) ) ang.z = -ang.z;
-
-  // Convert to degrees
-  ang.y *= 180.0/M_PI;
-  ang.x *= 180.0/M_PI;
-  ang.z *= 180.0/M_PI;
-
-  return ang;
-}
-
 void normalize_quat (quat_t &q)
   // Normalizes a quaternion
 {
@@ -272,22 +185,6 @@ quat_t track_quats (const double p1x, const double p1y, const double p2x, const
   return axis_to_quat(a, phi);
 }
 
-void microsecond_time (unsigned long long &t)
-  // Returns system time in microseconds, used for introducing delays at low simulation speeds
-{
-#ifdef WIN32
-  LARGE_INTEGER counter, frequency;
-  QueryPerformanceFrequency(&frequency);
-  frequency.QuadPart /= 1000000;
-  QueryPerformanceCounter(&counter);
-  t = (unsigned long long)(counter.QuadPart/frequency.QuadPart);
-#else
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  t = (unsigned long long)tv.tv_usec + 1000000 * (unsigned long long)tv.tv_sec;
-#endif
-}
-
 void fghCircleTable (double **sint, double **cost, const int n)
   // Borrowed from freeglut source code, used to draw hemispheres and open cones
 {
@@ -526,26 +423,6 @@ void setup_lights (void)
   enable_lights();
 }
 
-void glut_print (float x, float y, string s)
-  // Prints string at location (x,y) in a bitmap font
-{
-  unsigned short i;
-
-  glRasterPos2f(x, y);
-  for (i = 0; i < s.length(); i++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_10, s[i]);
-}
-
-double atmospheric_density (vector3d pos)
-  // Simple exponential model between surface and exosphere (around 200km), surface density is approximately 0.017 kg/m^3,
-  // scale height is approximately 11km
-{
-  double alt;
-
-  alt = pos.abs()-MARS_RADIUS;
-  if ((alt > EXOSPHERE) || (alt < 0.0)) return 0.0;
-  else return (0.017 * exp(-alt/11000.0));
-}
-
 void draw_dial (double cx, double cy, double val, string title, string units) // modified
   // Draws a single instrument dial, position (cx, cy), value val, title
 {
@@ -695,22 +572,25 @@ void draw_indicator_lamp (double tcx, double tcy, string off_text, string on_tex
 void draw_instrument_window (void)
   // Draws the instruments
 {
-  ostringstream s;
+  view_snapshot_t &view = snapshots.get_front(); // the latest state published, see render_idle()
+  unsigned long long draw_start = Profiler::now();
+  ostringstream s, speed_text;
+  double climb_speed;
 
   s.precision(1);
   glutSetWindow(instrument_window);
   glClear(GL_COLOR_BUFFER_BIT);
   
   // Attitude indicator variables
-  update_closeup_coords();
-  vector3d up = position.norm();
-  vector3d out = (closeup_coords.right).norm();
+  update_closeup_coords(view.sim);
+  vector3d up = view.sim.derived.radial;
+  vector3d out = (view.sim.closeup_coords.right).norm();
   vector3d left = (up^out).norm();
   double pitch_sign, pitch_angle;
   double roll_sign, roll_angle;
   
   // Tangential speed variables
-  double tangential_speed = (velocity - (velocity*(position.norm()))*(position.norm())).abs();
+  double tangential_speed = view.sim.derived.tangential_speed;
   if (abs(tangential_speed) <= SMALL_NUM) tangential_speed = 0.0;
   
   if (second_control_panel_on) {
@@ -718,107 +598,109 @@ void draw_instrument_window (void)
     
     // Draw pitch indicator - pitch angle is angle between out_axis and horizontal plane
     // Draw roll indicator - roll angle is angle between left_axis and horizontal plane
-    pitch_sign = out_axis*out;
+    pitch_sign = view.sim.out_axis*out;
     if (pitch_sign>=0.0) { // out_axis 'in front of' up
-      pitch_angle = 90.0-acos(out_axis.norm()*up)*180.0/M_PI;
+      pitch_angle = 90.0-acos(view.sim.out_axis.norm()*up)*180.0/M_PI;
     }
     else { // out_axis 'behind' up
-      if (out_axis*up>=0.0) pitch_angle = acos(out_axis.norm()*up)*180.0/M_PI+90.0; // 'behind' but above plane
-      else pitch_angle = acos(out_axis.norm()*up)*180.0/M_PI-270.0; // 'behind' but below plane
+      if (view.sim.out_axis*up>=0.0) pitch_angle = acos(view.sim.out_axis.norm()*up)*180.0/M_PI+90.0; // 'behind' but above plane
+      else pitch_angle = acos(view.sim.out_axis.norm()*up)*180.0/M_PI-270.0; // 'behind' but below plane
     }
     if (abs(pitch_angle)<=SMALL_NUM) pitch_angle=0.0;
     if (abs(pitch_angle+180) <= SMALL_NUM) pitch_angle=180.0;
-    roll_sign = left_axis*left;
+    roll_sign = view.sim.left_axis*left;
     if (roll_sign>=0.0) { // left_axis 'on the left' of up
-      roll_angle = 90.0-acos(left_axis.norm()*up)*180.0/M_PI;
+      roll_angle = 90.0-acos(view.sim.left_axis.norm()*up)*180.0/M_PI;
     }
     else { // left_axis 'on the right' of up
-      if (left_axis*up>=0.0) roll_angle = acos(left_axis.norm()*up)*180.0/M_PI+90.0; // left_axis above plane
-      else roll_angle = acos(left_axis.norm()*up)*180.0/M_PI-270.0; // left_axis below plane
+      if (view.sim.left_axis*up>=0.0) roll_angle = acos(view.sim.left_axis.norm()*up)*180.0/M_PI+90.0; // left_axis above plane
+      else roll_angle = acos(view.sim.left_axis.norm()*up)*180.0/M_PI-270.0; // left_axis below plane
     }
     if (abs(roll_angle)<=SMALL_NUM) roll_angle=0.0;
     if (abs(roll_angle+180) <= SMALL_NUM) roll_angle=180.0;
-    draw_attitude_indicator (view_width+GAP-230, INSTRUMENT_HEIGHT/1.8, landed ? 0.0 : roll_angle, landed ? 0.0 : pitch_angle, "Roll", "Pitch", "degree");
+    draw_attitude_indicator (view_width+GAP-230, INSTRUMENT_HEIGHT/1.8, view.sim.landed ? 0.0 : roll_angle, view.sim.landed ? 0.0 : pitch_angle, "Roll", "Pitch", "degree");
     
     // Draw second control panel lamp
     draw_indicator_lamp (view_width+GAP-415, INSTRUMENT_HEIGHT-15, "First control panel", "Second control panel", second_control_panel_on);
     
     // Draw rotation lamp
-    draw_smaller_indicator_lamp (view_width+GAP-430, INSTRUMENT_HEIGHT-62, "Planet rotation off", "Planet rotation on", rotation_on);
+    draw_smaller_indicator_lamp (view_width+GAP-430, INSTRUMENT_HEIGHT-62, "Planet rotation off", "Planet rotation on", view.sim.rotation_on);
     
     // Draw steady wind lamp
-    draw_smaller_indicator_lamp (view_width+GAP-430, INSTRUMENT_HEIGHT-107, "Steady wind off", "Steady wind on", steady_wind_on);
+    draw_smaller_indicator_lamp (view_width+GAP-430, INSTRUMENT_HEIGHT-107, "Steady wind off", "Steady wind on", view.sim.steady_wind_on);
     
     // Draw gust wind lamp
-    draw_smaller_indicator_lamp (view_width+GAP-430, INSTRUMENT_HEIGHT-152, "Gust wind off", "Gust wind on", gust_wind_on);
+    draw_smaller_indicator_lamp (view_width+GAP-430, INSTRUMENT_HEIGHT-152, "Gust wind off", "Gust wind on", view.sim.gust_wind_on);
     
     // Draw moon lamp
-    draw_smaller_indicator_lamp (view_width+GAP-430, INSTRUMENT_HEIGHT-197, "Moon off", "Moon on", moon_effect_on);
+    draw_smaller_indicator_lamp (view_width+GAP-430, INSTRUMENT_HEIGHT-197, "Moon off", "Moon on", view.sim.moon_effect_on);
     
     // Draw lander predicted trajectory lamp
     draw_smaller_indicator_lamp (view_width+GAP-430, INSTRUMENT_HEIGHT-242, "Lander trajectory off", "Lander trajectorry on", display_predicted_trajectory);
     
     // Draw autopilot lamp
-    draw_indicator_lamp (view_width+GAP-45, INSTRUMENT_HEIGHT-15, "Auto-pilot off", "Auto-pilot on", autopilot_enabled);
-    switch (current_autopilot_mode) {
+    draw_indicator_lamp (view_width+GAP-45, INSTRUMENT_HEIGHT-15, "Auto-pilot off", "Auto-pilot on", view.sim.autopilot_enabled);
+    switch (view.sim.current_autopilot_mode) {
     case descent_mode:
-      draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-62, "Entry Descent Landing", "Entry Descent Landing", autopilot_enabled);
+    case powered_descent_mode:
+      draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-62, "Entry Descent Landing",
+                                   (view.sim.current_autopilot_mode == powered_descent_mode) ? "Fuel-optimal Landing" : "Entry Descent Landing", view.sim.autopilot_enabled);
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-107, "Orbital Transfer", "", false);
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-152, "Maintaining Orbit", "", false);
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-197, "Orbital Injection", "", false);
       break;
     case transfer_mode:
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-62, "Entry Descent Landing", "", false);
-      draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-107, "Orbital Transfer", "Orbital Transfer", autopilot_enabled);
+      draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-107, "Orbital Transfer", "Orbital Transfer", view.sim.autopilot_enabled);
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-152, "Maintaining Orbit", "", false);
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-197, "Orbital Injection", "", false);
       break;
     case maintain_mode:
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-62, "Entry Descent Landing", "", false);
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-107, "Orbital Transfer", "", false);
-      draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-152, "Maintaining Orbit", "Maintaining Orbit", autopilot_enabled);
+      draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-152, "Maintaining Orbit", "Maintaining Orbit", view.sim.autopilot_enabled);
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-197, "Orbital Injection", "", false);
       break;
     case launch_mode:
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-62, "Entry Descent Landing", "", false);
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-107, "Orbital Transfer", "", false);
       draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-152, "Maintaining Orbit", "", false);
-      draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-197, "Orbital Injection", "Orbital Injection", autopilot_enabled);
+      draw_smaller_indicator_lamp (view_width+GAP-30, INSTRUMENT_HEIGHT-197, "Orbital Injection", "Orbital Injection", view.sim.autopilot_enabled);
       break;
     }
     
     // Draw lander phase indicator
-    switch (current_lander_phase) {
+    switch (view.sim.current_lander_phase) {
     case let_it_go:
-      draw_lander_phase_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-42, "Launching", "Current lander phase: ", autopilot_enabled);
+      draw_lander_phase_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-42, "Launching", "Current lander phase: ", view.sim.autopilot_enabled);
       break;
     case let_it_be:
-      draw_lander_phase_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-42, "Lander in Idle", "Current lander phase: ", autopilot_enabled);
+      draw_lander_phase_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-42, "Lander in Idle", "Current lander phase: ", view.sim.autopilot_enabled);
       break;
     case chariots_of_fire:
-      draw_lander_phase_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-42, "Engine Ignition", "Current lander phase: ", autopilot_enabled);
+      draw_lander_phase_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-42, "Engine Ignition", "Current lander phase: ", view.sim.autopilot_enabled);
       break;
     case the_sound_of_silence:
-      draw_lander_phase_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-42, "Coasting", "Current lander phase: ", autopilot_enabled);
+      draw_lander_phase_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-42, "Coasting", "Current lander phase: ", view.sim.autopilot_enabled);
       break;
     case viva_la_vida:
-      draw_lander_phase_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-42, "Reentry and Landing", "Current lander phase: ", autopilot_enabled);
+      draw_lander_phase_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-42, "Reentry and Landing", "Current lander phase: ", view.sim.autopilot_enabled);
       break;
     }
     
     // Draw input altitude screen
-    draw_input_altitude_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-130, input_altitude, "Input altitude: ", "m", accept_input_altitude);
+    draw_input_altitude_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-130, view.sim.input_altitude, "Input altitude: ", "m", view.sim.accept_input_altitude);
     
     // Draw launch pad lamp
-    draw_smaller_indicator_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-197, "GROUND", "AIR", lander_unheld && !landed && !crashed);
+    draw_smaller_indicator_lamp (view_width+GAP+120, INSTRUMENT_HEIGHT-197, "GROUND", "AIR", view.sim.lander_unheld && !view.sim.landed && !view.sim.crashed);
     
     // Draw attitude stabilizer lamp
-    draw_indicator_lamp (view_width+GAP-45, INSTRUMENT_HEIGHT-242, "Attitude stabilizer off", "Attitude stabilizer on", stabilized_attitude);
+    draw_indicator_lamp (view_width+GAP-45, INSTRUMENT_HEIGHT-242, "Attitude stabilizer off", "Attitude stabilizer on", view.sim.stabilized_attitude);
     
     // Draw parachute lamp
-    switch (parachute_status) {
+    switch (view.sim.parachute_status) {
     case NOT_DEPLOYED:
-      draw_indicator_lamp (view_width+GAP+135, INSTRUMENT_HEIGHT-242, "Parachute not deployed", "Do not deploy parachute", !safe_to_deploy_parachute());
+      draw_indicator_lamp (view_width+GAP+135, INSTRUMENT_HEIGHT-242, "Parachute not deployed", "Do not deploy parachute", !safe_to_deploy_parachute(view.sim));
       break;
     case DEPLOYED:
       draw_indicator_lamp (view_width+GAP+135, INSTRUMENT_HEIGHT-242, "Parachute deployed", "", false);
@@ -834,29 +716,29 @@ void draw_instrument_window (void)
     draw_indicator_lamp (view_width+GAP-415, INSTRUMENT_HEIGHT-15, "Second control panel", "First control panel", !second_control_panel_on);
     
     // Draw altimeter
-    draw_dial (view_width+GAP-415, INSTRUMENT_HEIGHT/2, altitude, "Altitude", "m");
+    draw_dial (view_width+GAP-415, INSTRUMENT_HEIGHT/2, view.sim.altitude, "Altitude", "m");
   
     // Draw auto-pilot lamp
-    draw_indicator_lamp (view_width+GAP-230, INSTRUMENT_HEIGHT-15, "Auto-pilot off", "Auto-pilot on", autopilot_enabled);
+    draw_indicator_lamp (view_width+GAP-230, INSTRUMENT_HEIGHT-15, "Auto-pilot off", "Auto-pilot on", view.sim.autopilot_enabled);
   
     // Draw climb rate meter
-    if (abs(climb_speed) <= SMALL_NUM) climb_speed = 0.0;
-    if (climb_speed >= 0.0) draw_dial (view_width+GAP-235, INSTRUMENT_HEIGHT/2, landed ? 0.0 : climb_speed, "Climb rate", "m/s");
-    else draw_dial (view_width+GAP-235, INSTRUMENT_HEIGHT/2, landed ? 0.0 : -climb_speed, "Descent rate", "m/s");
+    climb_speed = (abs(view.sim.climb_speed) <= SMALL_NUM) ? 0.0 : view.sim.climb_speed; // clamped for display only
+    if (climb_speed >= 0.0) draw_dial (view_width+GAP-235, INSTRUMENT_HEIGHT/2, view.sim.landed ? 0.0 : climb_speed, "Climb rate", "m/s");
+    else draw_dial (view_width+GAP-235, INSTRUMENT_HEIGHT/2, view.sim.landed ? 0.0 : -climb_speed, "Descent rate", "m/s");
   
     // Draw attitude stabilizer lamp
-    draw_indicator_lamp (view_width+GAP-50, INSTRUMENT_HEIGHT-15, "Attitude stabilizer off", "Attitude stabilizer on", stabilized_attitude);
+    draw_indicator_lamp (view_width+GAP-50, INSTRUMENT_HEIGHT-15, "Attitude stabilizer off", "Attitude stabilizer on", view.sim.stabilized_attitude);
   
     // Draw ground speed meter
-    draw_dial (view_width+GAP-55, INSTRUMENT_HEIGHT/2, landed ? 0.0 : ground_speed, "Ground speed", "m/s");
+    draw_dial (view_width+GAP-55, INSTRUMENT_HEIGHT/2, view.sim.landed ? 0.0 : view.sim.ground_speed, "Ground speed", "m/s");
     
     // Draw tangential speed meter
-    draw_dial (view_width+GAP+125, INSTRUMENT_HEIGHT/2, landed ? 0.0 : tangential_speed, "Tangential speed", "m/s");
+    draw_dial (view_width+GAP+125, INSTRUMENT_HEIGHT/2, view.sim.landed ? 0.0 : tangential_speed, "Tangential speed", "m/s");
   
     // Draw parachute lamp
-    switch (parachute_status) {
+    switch (view.sim.parachute_status) {
     case NOT_DEPLOYED:
-      draw_indicator_lamp (view_width+GAP+130, INSTRUMENT_HEIGHT-15, "Parachute not deployed", "Do not deploy parachute", !safe_to_deploy_parachute());
+      draw_indicator_lamp (view_width+GAP+130, INSTRUMENT_HEIGHT-15, "Parachute not deployed", "Do not deploy parachute", !safe_to_deploy_parachute(view.sim));
       break;
     case DEPLOYED:
       draw_indicator_lamp (view_width+GAP+130, INSTRUMENT_HEIGHT-15, "Parachute deployed", "", false);
@@ -867,68 +749,72 @@ void draw_instrument_window (void)
     }
   }
 
-  // Draw speed bar
-  draw_control_bar(view_width+GAP+240, INSTRUMENT_HEIGHT-18, simulation_speed/10.0, 0.0, 0.0, 1.0, "Simulation speed");
+  // Draw speed bar, with the speed actually achieved as a percentage
+  speed_text << "Simulation speed " << speed_ratio[simulation_speed] << "x";
+  if (!paused && !view.sim.landed && (view.achieved_speed > 0.0)) speed_text << " (" << (int) (100.0*view.achieved_speed/speed_ratio[simulation_speed] + 0.5) << "%)";
+  draw_control_bar(view_width+GAP+240, INSTRUMENT_HEIGHT-18, simulation_speed/10.0, 0.0, 0.0, 1.0, speed_text.str());
   
   // Draw digital clock
   glColor3f(1.0, 1.0, 1.0);
-  s.str(""); s << "Time " << fixed << simulation_time << " s";
+  s.str(""); s << "Time " << fixed << view.sim.simulation_time << " s";
   glut_print(view_width+GAP+400, INSTRUMENT_HEIGHT-58, s.str());
   if (paused) {
     glColor3f(1.0, 0.0, 0.0);
     glut_print(view_width+GAP+338, INSTRUMENT_HEIGHT-32, "PAUSED");
   }
+  if (profile_overlay) draw_profile_overlay(view.achieved_speed);
 
   // Display coordinates
   glColor3f(1.0, 1.0, 1.0);
-  s.str(""); s << "x position " << fixed << position.x << " m";
+  s.str(""); s << "x position " << fixed << view.sim.position.x << " m";
   glut_print(view_width+GAP+240, INSTRUMENT_HEIGHT-97, s.str());
-  s.str(""); s << "velocity " << fixed << velocity_from_positions.x << " m/s";
+  s.str(""); s << "velocity " << fixed << view.sim.velocity_from_positions.x << " m/s";
   glut_print(view_width+GAP+380, INSTRUMENT_HEIGHT-97, s.str());
-  s.str(""); s << "y position " << fixed << position.y << " m";
+  s.str(""); s << "y position " << fixed << view.sim.position.y << " m";
   glut_print(view_width+GAP+240, INSTRUMENT_HEIGHT-117, s.str());
-  s.str(""); s << "velocity " << fixed << velocity_from_positions.y << " m/s";
+  s.str(""); s << "velocity " << fixed << view.sim.velocity_from_positions.y << " m/s";
   glut_print(view_width+GAP+380, INSTRUMENT_HEIGHT-117, s.str());
-  s.str(""); s << "z position " << fixed << position.z << " m";
+  s.str(""); s << "z position " << fixed << view.sim.position.z << " m";
   glut_print(view_width+GAP+240, INSTRUMENT_HEIGHT-137, s.str());
-  s.str(""); s << "velocity " << fixed << velocity_from_positions.z << " m/s";
+  s.str(""); s << "velocity " << fixed << view.sim.velocity_from_positions.z << " m/s";
   glut_print(view_width+GAP+380, INSTRUMENT_HEIGHT-137, s.str());
 
   // Draw thrust bar
-  s.str(""); s << "Thrust " << fixed << thrust_wrt_world().abs() << " N";
-  draw_control_bar(view_width+GAP+240, INSTRUMENT_HEIGHT-170, throttle, 1.0, 0.0, 0.0, s.str());
+  s.str(""); s << "Thrust " << fixed << thrust_wrt_world(view.sim).abs() << " N";
+  draw_control_bar(view_width+GAP+240, INSTRUMENT_HEIGHT-170, view.sim.throttle, 1.0, 0.0, 0.0, s.str());
 
   // Draw fuel bar
-  s.str(""); s << "Fuel " << fixed << fuel*FUEL_CAPACITY << " litres";
-  if (fuel > 0.5) draw_control_bar(view_width+GAP+240, INSTRUMENT_HEIGHT-242, fuel, 0.0, 1.0, 0.0, s.str());
-  else if (fuel > 0.2) draw_control_bar(view_width+GAP+240, INSTRUMENT_HEIGHT-242, fuel, 1.0, 0.5, 0.0, s.str());
-  else draw_control_bar(view_width+GAP+240, INSTRUMENT_HEIGHT-242, fuel, 1.0, 0.0, 0.0, s.str());
+  s.str(""); s << "Fuel " << fixed << view.sim.fuel*FUEL_CAPACITY << " litres";
+  if (view.sim.fuel > 0.5) draw_control_bar(view_width+GAP+240, INSTRUMENT_HEIGHT-242, view.sim.fuel, 0.0, 1.0, 0.0, s.str());
+  else if (view.sim.fuel > 0.2) draw_control_bar(view_width+GAP+240, INSTRUMENT_HEIGHT-242, view.sim.fuel, 1.0, 0.5, 0.0, s.str());
+  else draw_control_bar(view_width+GAP+240, INSTRUMENT_HEIGHT-242, view.sim.fuel, 1.0, 0.0, 0.0, s.str());
   
   
   // Display simulation status
-  if (landed) glColor3f(1.0, 1.0, 0.0);
+  if (view.sim.landed) glColor3f(1.0, 1.0, 0.0);
   else glColor3f(1.0, 1.0, 1.0);
-  s.str(""); s << "Scenario " << scenario;
-  if (!landed) s << ": " << scenario_description[scenario];
+  s.str(""); s << "Scenario " << view.sim.scenario;
+  if (!view.sim.landed) s << ": " << scenario_description[view.sim.scenario];
   glut_print(view_width+GAP-488, 17, s.str());
-  if (landed && !second_control_panel_on) {
-    if (altitude < LANDER_SIZE/2.0) glut_print(80, 17, "Lander is below the surface!");
+  if (view.sim.landed && !second_control_panel_on) {
+    if (view.sim.altitude < LANDER_SIZE/2.0) glut_print(80, 17, "Lander is below the surface!");
     else {
-      s.str(""); s << "Fuel consumed " << fixed << FUEL_CAPACITY*(1.0-fuel) << " litres";
+      s.str(""); s << "Fuel consumed " << fixed << FUEL_CAPACITY*(1.0-view.sim.fuel) << " litres";
       glut_print(view_width+GAP-427, 17, s.str());
-      s.str(""); s << "Descent rate at touchdown " << fixed << -climb_speed << " m/s";
+      s.str(""); s << "Descent rate at touchdown " << fixed << -view.sim.climb_speed << " m/s";
       glut_print(view_width+GAP-232, 17, s.str());
-      s.str(""); s << "Ground speed at touchdown " << fixed << ground_speed << " m/s";
+      s.str(""); s << "Ground speed at touchdown " << fixed << view.sim.ground_speed << " m/s";
       glut_print(view_width+GAP+16, 17, s.str());
     }
   }
 
-  glutSwapBuffers();
+  finish_frame(INSTRUMENT_PHASE, draw_start);
 }
 
 void display_help_arrows (void)
   // Displays help arrow in close-up view window
 {
+  view_snapshot_t &view = snapshots.get_front(); // the latest state published, see render_idle()
   double m[16], p[16], x, y, z, s = -closeup_offset/50.0;
   GLint v[4];
   unsigned short i;
@@ -964,7 +850,7 @@ void display_help_arrows (void)
   glPopMatrix();
 
   // Ground speed arrow
-  if ((ground_speed > MAX_IMPACT_GROUND_SPEED) && !landed) {
+  if ((view.sim.ground_speed > MAX_IMPACT_GROUND_SPEED) && !view.sim.landed) {
     glBegin(GL_LINES);
     glVertex3d(-2.0*s, 0.0, 0.0);
     glVertex3d(-6.0*s, 0.0, 0.0);
@@ -984,6 +870,7 @@ void display_help_arrows (void)
 void display_help_text (void)
   // Displays help information in orbital view window
 {
+  view_snapshot_t &view = snapshots.get_front(); // the latest state published, see render_idle()
   ostringstream s;
   unsigned short i, j;
 
@@ -1023,20 +910,20 @@ void display_help_text (void)
   
   
   // MANUAL ATTITUDE CONTROL MENU
-  if (autopilot_enabled)
+  if (view.sim.autopilot_enabled)
   {
     glut_print(290, view_height-250, "Autopilot engaged");
-    glut_print(302, view_height-265, "d - engage descent mode");
+    glut_print(302, view_height-265, "d - engage descent mode, again for fuel-optimal landing");
     glut_print(302, view_height-280, "c - engage orbital transfer mode");
     glut_print(302, view_height-295, "x - engage emergency landing mode");
-    if (current_lander_phase==let_it_be) glut_print(302, view_height-310, "v - toggle altitude input");
+    if (view.sim.current_lander_phase==let_it_be) glut_print(302, view_height-310, "v - toggle altitude input");
     glut_print(302, view_height-325, "a - disengage, e - reset autopilot");
   }
   else
   {
     glut_print(290, view_height-250, "Autopilot disengaged");
     glut_print(302, view_height-265, "a - engage autopilot");
-    if (stabilized_attitude) {
+    if (view.sim.stabilized_attitude) {
       glut_print(290, view_height-285, "Manual attitude command engaged");
       glut_print(302, view_height-300, "i - pitch up    k - pitch down");
       glut_print(302, view_height-315, "j - yaw left    l - yaw right");
@@ -1069,6 +956,12 @@ void display_help_text (void)
   // UNHOLD LANDER
   glut_print(280, view_height-95, "w - unhold lander for launching");
   
+  // COAST TIME WARP
+  glut_print(280, view_height-110, "y - toggle time warp over coast arcs");
+  
+  // PROFILER
+  glut_print(280, view_height-125, "b - toggle profiler overlay");
+  
 /*
 #ifndef WIN32
 #ifndef __APPLE__
@@ -1135,6 +1028,8 @@ void display_help_prompt (void)
 void draw_orbital_window (void)
   // Draws the orbital view
 {
+  view_snapshot_t &view = snapshots.get_front(); // the latest state published, see render_idle()
+  unsigned long long draw_start = Profiler::now();
   unsigned short i, j;
   double m[16], sf;
   GLint slices, stacks;
@@ -1149,7 +1044,7 @@ void draw_orbital_window (void)
   glMultMatrixd(m);
   if (orbital_zoom > 2.0) { // gradual pan towards the lander when zoomed in
     sf = 1.0 - exp((2.0-orbital_zoom)/5.0);
-    glTranslated(-sf*position.x, -sf*position.y, -sf*position.z);
+    glTranslated(-sf*view.sim.position.x, -sf*view.sim.position.y, -sf*view.sim.position.z);
   }
 
   if (static_lighting) {
@@ -1162,14 +1057,14 @@ void draw_orbital_window (void)
   glColor3f(0.63, 0.33, 0.22);
   glLineWidth(1.0);
   glPushMatrix();
-  if (rotation_on) glRotated(360.0*simulation_time/MARS_DAY, 0.0, 0.0, 1.0); // to make the planet spin
+  if (view.sim.rotation_on) glRotated(360.0*view.sim.simulation_time/MARS_DAY, 0.0, 0.0, 1.0); // to make the planet spin
   if (orbital_zoom > 1.0) {
     slices = (int)(16*orbital_zoom); if (slices > 160) slices = 160;
     stacks = (int)(10*orbital_zoom); if (stacks > 100) stacks = 100;
   } else {
     slices = 24; stacks = 15;
   }
-  if (do_texture) {
+  if (do_texture && orbital_mars_texture) {
     glEnable(GL_TEXTURE_2D);
     glBindTexture(GL_TEXTURE_2D, orbital_mars_texture);
     mars_model.Draw();
@@ -1190,11 +1085,11 @@ void draw_orbital_window (void)
   glLineWidth(1.0);
   glBegin(GL_LINE_STRIP);
   glColor3f(0.0, 1.0, 1.0);
-  glVertex3d(position.x, position.y, position.z);
-  j = (track.p+N_TRACK-1)%N_TRACK;
-  for (i=0; i<track.n; i++) {
+  glVertex3d(view.sim.position.x, view.sim.position.y, view.sim.position.z);
+  j = (view.track.p+N_TRACK-1)%N_TRACK;
+  for (i=0; i<view.track.n; i++) {
     glColor4f(0.0, 0.75*(N_TRACK-i)/N_TRACK, 0.75*(N_TRACK-i)/N_TRACK, 1.0*(N_TRACK-i)/N_TRACK);
-    glVertex3d(track.pos[j].x, track.pos[j].y, track.pos[j].z); 
+    glVertex3d(view.track.pos[j].x, view.track.pos[j].y, view.track.pos[j].z); 
     j = (j+N_TRACK-1)%N_TRACK;
   }
   glEnd();
@@ -1204,7 +1099,7 @@ void draw_orbital_window (void)
   glColor3f(0.0, 1.0, 1.0);
   glPointSize(3.0);
   glBegin(GL_POINTS);
-  glVertex3d(position.x, position.y, position.z);
+  glVertex3d(view.sim.position.x, view.sim.position.y, view.sim.position.z);
   glEnd();
   glEnable(GL_LIGHTING);
   
@@ -1213,7 +1108,7 @@ void draw_orbital_window (void)
   vector3d moon_current_position, moon_current_velocity;
   
   // Phobos first
-  moon_current_position = Phobos.get_position();
+  moon_current_position = view.sim.Phobos.get_position();
   
   // draw Phobos previous positions that fades with time
   glDisable(GL_LIGHTING);
@@ -1222,10 +1117,10 @@ void draw_orbital_window (void)
   glBegin(GL_LINE_STRIP);
   glColor3f(0.576, 0.439, 0.859);
   glVertex3d(moon_current_position.x, moon_current_position.y, moon_current_position.z);
-  j = (track_Phobos.p+N_TRACK-1)%N_TRACK;
-  for (i=0; i<track_Phobos.n; i++) {
+  j = (view.track_Phobos.p+N_TRACK-1)%N_TRACK;
+  for (i=0; i<view.track_Phobos.n; i++) {
     glColor4f(0.576*(N_TRACK-i)/N_TRACK, 0.439*(N_TRACK-i)/N_TRACK, 0.859*(N_TRACK-i)/N_TRACK, 1.0*(N_TRACK-i)/N_TRACK);
-    glVertex3d(track_Phobos.pos[j].x, track_Phobos.pos[j].y, track_Phobos.pos[j].z); 
+    glVertex3d(view.track_Phobos.pos[j].x, view.track_Phobos.pos[j].y, view.track_Phobos.pos[j].z); 
     j = (j+N_TRACK-1)%N_TRACK;
   }
   glEnd();
@@ -1241,7 +1136,7 @@ void draw_orbital_window (void)
   glEnable(GL_LIGHTING);
   
   // Deimos second
-  moon_current_position = Deimos.get_position();
+  moon_current_position = view.sim.Deimos.get_position();
   
   // draw Deimos previous positions that fades with time
   glDisable(GL_LIGHTING);
@@ -1250,10 +1145,10 @@ void draw_orbital_window (void)
   glBegin(GL_LINE_STRIP);
   glColor3f(0.780, 0.082, 0.522);
   glVertex3d(moon_current_position.x, moon_current_position.y, moon_current_position.z);
-  j = (track_Deimos.p+N_TRACK-1)%N_TRACK;
-  for (i=0; i<track_Deimos.n; i++) {
+  j = (view.track_Deimos.p+N_TRACK-1)%N_TRACK;
+  for (i=0; i<view.track_Deimos.n; i++) {
     glColor4f(0.780*(N_TRACK-i)/N_TRACK, 0.082*(N_TRACK-i)/N_TRACK, 0.522*(N_TRACK-i)/N_TRACK, 1.0*(N_TRACK-i)/N_TRACK);
-    glVertex3d(track_Deimos.pos[j].x, track_Deimos.pos[j].y, track_Deimos.pos[j].z); 
+    glVertex3d(view.track_Deimos.pos[j].x, view.track_Deimos.pos[j].y, view.track_Deimos.pos[j].z); 
     j = (j+N_TRACK-1)%N_TRACK;
   }
   glEnd();
@@ -1277,21 +1172,23 @@ void draw_orbital_window (void)
   glPushMatrix();
   glLoadIdentity();
   glPushMatrix();
-  glEnable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, orbital_background_texture);
-  glColor3f(1.0, 1.0, 1.0);
-  glTranslated(0.0, 0.0, 1.0);
-  glBegin(GL_QUADS);
-  glTexCoord2d(0.0, 0.0);
-  glVertex2d(-1.0, -1.0);
-  glTexCoord2d(1.0, 0.0);
-  glVertex2d(1.0f, -1.0);
-  glTexCoord2d(1.0, 1.0);
-  glVertex2d(1.0, 1.0);
-  glTexCoord2d(0.0, 1.0);
-  glVertex2d(-1.0, 1.0);
-  glEnd();
-  glDisable(GL_TEXTURE_2D);
+  if (orbital_background_texture) { // not until the image has loaded
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, orbital_background_texture);
+    glColor3f(1.0, 1.0, 1.0);
+    glTranslated(0.0, 0.0, 1.0);
+    glBegin(GL_QUADS);
+    glTexCoord2d(0.0, 0.0);
+    glVertex2d(-1.0, -1.0);
+    glTexCoord2d(1.0, 0.0);
+    glVertex2d(1.0f, -1.0);
+    glTexCoord2d(1.0, 1.0);
+    glVertex2d(1.0, 1.0);
+    glTexCoord2d(0.0, 1.0);
+    glVertex2d(-1.0, 1.0);
+    glEnd();
+    glDisable(GL_TEXTURE_2D);
+  }
   glPopMatrix();
   glMatrixMode(GL_PROJECTION);
   glPopMatrix();
@@ -1304,16 +1201,16 @@ void draw_orbital_window (void)
   
   // DRAW PREDICTED TRAJECTORIES
   // moons
-  if (moon_effect_on) {
-    draw_future_trajectory(Phobos_Kepler, 0.432, 0.329, 0.644, "Phobos orbit");
-    draw_future_trajectory(Deimos_Kepler, 0.585, 0.062, 0.196, "Deimos orbit");
+  if (view.sim.moon_effect_on) {
+    draw_future_trajectory(view.sim.Phobos_Kepler, 0.432, 0.329, 0.644, "Phobos orbit");
+    draw_future_trajectory(view.sim.Deimos_Kepler, 0.585, 0.062, 0.196, "Deimos orbit");
   }
   // lander
-  if ((position.abs() - MARS_RADIUS) > 15000.0 && display_predicted_trajectory) {
-    draw_future_trajectory(lander_Kepler, 0.0, 0.75, 0.75, "Lander predicted trajectory");
+  if ((view.sim.position.abs() - MARS_RADIUS) > 15000.0 && display_predicted_trajectory) {
+    draw_future_trajectory(view.sim.lander_Kepler, 0.0, 0.75, 0.75, "Lander predicted trajectory");
   }
 
-  glutSwapBuffers();
+  finish_frame(ORBITAL_PHASE, draw_start);
 }
 
 void draw_parachute_quad (double d)
@@ -1358,95 +1255,25 @@ void draw_parachute (double d)
   glEnable(GL_CULL_FACE);
 }
 
-bool generate_terrain_texture (void)
-  // Generates random texture map for surface terrain, with mipmap to avoid aliasing at the horizon
+bool generate_terrain_texture (unsigned long long seed, vector<unsigned char> &pixels, int &width, int &height)
+  // Generates random texture map for surface terrain - the texture loader adds the mipmaps that avoid aliasing at
+  // the horizon, and caches the lot. Called on a loader thread.
 {
-  unsigned char *tex_image;
+  unsigned long long texture_state;
   unsigned long x;
-  GLsizei ts;
-  bool texture_ok;
-
-  ts = TERRAIN_TEXTURE_SIZE;
-  texture_ok = false;
-  tex_image = (unsigned char*) calloc(sizeof(unsigned char), TERRAIN_TEXTURE_SIZE*TERRAIN_TEXTURE_SIZE);
-  for (x=0; x<TERRAIN_TEXTURE_SIZE*TERRAIN_TEXTURE_SIZE; x++) tex_image[x] = 192 + (unsigned char) (63.0*rand()/RAND_MAX);
-  glGenTextures(1, &terrain_texture);
-  glBindTexture(GL_TEXTURE_2D, terrain_texture);
-  while (!texture_ok && (ts >= 256)) { // try progressively smaller texture maps, give up below 256x256
-    glGetError(); // clear error
-    if (!gluBuild2DMipmaps(GL_TEXTURE_2D, GL_LUMINANCE, ts, ts, GL_LUMINANCE, GL_UNSIGNED_BYTE, tex_image) && (glGetError() == GL_NO_ERROR)) texture_ok = true;
-    else ts /= 2;
-  }
-  free(tex_image);
-  if (texture_ok) {
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-    return true;
-  } else return false;
-}
-
-void update_closeup_coords (void)
-  // Updates the close-up view's coordinate frame, based on the lander's current position and velocity.
-  // This needs to be called every time step, even if the view is not being rendered, since any-angle
-  // attitude stabilizers reference closeup_coords.right
-{
-  vector3d s, tv, t;
-  double tmp;
 
-  // Direction from surface to lander (radial) - this must map to the world y-axis
-  s = position.norm();
-
-  // Direction of tangential velocity - this must map to the world x-axis
-  tv = velocity_from_positions - (velocity_from_positions*s)*s;
-  if (tv.abs() < SMALL_NUM) // vertical motion only, use last recorded tangential velocity
-    tv = closeup_coords.backwards ? (closeup_coords.right*s)*s - closeup_coords.right : closeup_coords.right - (closeup_coords.right*s)*s; 
-  if (tv.abs() > SMALL_NUM) t = tv.norm();
-
-  // Check these two vectors are non-zero and perpendicular (they should be, unless s and closeup_coords.right happen to be parallel)
-  if ((tv.abs() <= SMALL_NUM) || (fabs(s*t) > SMALL_NUM)) {
-    // Set t to something perpendicular to s
-    t.x = -s.y; t.y = s.x; t.z = 0.0;
-    if (t.abs() < SMALL_NUM) {t.x = -s.z; t.y = 0.0; t.z = s.x;}
-    t = t.norm();
-  }
-
-  // Adjust the terrain texture angle if the lander has changed direction. The motion will still be along
-  // the x-axis, so we need to rotate the texture to compensate.
-  if (closeup_coords.initialized) {
-    if (closeup_coords.backwards) {
-      tmp = -closeup_coords.right*t;
-      if (tmp > 1.0) tmp = 1.0; if (tmp < -1.0) tmp = -1.0;
-      if ((-closeup_coords.right^t)*position.norm() < 0.0) terrain_angle += (180.0/M_PI)*acos(tmp);
-      else terrain_angle -= (180.0/M_PI)*acos(tmp);
-    } else {
-      tmp = closeup_coords.right*t;
-      if (tmp > 1.0) tmp = 1.0; if (tmp < -1.0) tmp = -1.0;
-      if ((closeup_coords.right^t)*position.norm() < 0.0) terrain_angle += (180.0/M_PI)*acos(tmp);
-      else terrain_angle -= (180.0/M_PI)*acos(tmp);
-    }
-    while (terrain_angle < 0.0) terrain_angle += 360.0;
-    while (terrain_angle >= 360.0) terrain_angle -= 360.0;
-  }
-
-  // Normally we maintain motion to the right, the one exception being when the ground speed passes
-  // through zero and changes sign. A sudden 180 degree change of viewpoint would be confusing, so
-  // in this instance we allow the lander to fly to the left.
-  if (closeup_coords.initialized && (closeup_coords.right*t < 0.0)) {
-    closeup_coords.backwards = true;
-    closeup_coords.right = -1.0*t;
-  } else {
-    closeup_coords.backwards = false;
-    closeup_coords.right = t;
-    closeup_coords.initialized = true;
-  }
+  seed_random_number(texture_state, seed);
+  width = height = TERRAIN_TEXTURE_SIZE;
+  pixels.resize(TERRAIN_TEXTURE_SIZE*TERRAIN_TEXTURE_SIZE);
+  for (x=0; x<TERRAIN_TEXTURE_SIZE*TERRAIN_TEXTURE_SIZE; x++) pixels[x] = 192 + (unsigned char) (63.0*uniform_random_number(texture_state));
+  return true;
 }
 
 void draw_closeup_window (void)
   // Draws the close-up view of the lander
 {
+  view_snapshot_t &view = snapshots.get_front(); // the latest state published, see render_idle()
+  unsigned long long draw_start = Profiler::now();
   static double terrain_offset_x = 0.0;
   static double terrain_offset_y = 0.0;
   static double ground_line_offset = 0.0;
@@ -1469,14 +1296,14 @@ void draw_closeup_window (void)
   // Work out an atmospheric haze colour based on prevailing atmospheric density. The power law in the
   // expression below couples with the fog calculation further down, to ensure that the fog doesn't dim
   // the scene on the way down.
-  tmp = pow(atmospheric_density(position)/atmospheric_density(vector3d(MARS_RADIUS, 0.0, 0.0)), 0.5);
-  if (static_lighting) tmp *= 0.5 * (1.0 + position.norm()*vector3d(0.0, -1.0, 0.0)); // set sky colour
+  tmp = pow(view.sim.derived.density/mars_atmosphere.density(0.0), 0.5);
+  if (static_lighting) tmp *= 0.5 * (1.0 + view.sim.derived.radial*vector3d(0.0, -1.0, 0.0)); // set sky colour
   fogcolour[0] = tmp*0.98; fogcolour[1] = tmp*0.67; fogcolour[2] = tmp*0.52; fogcolour[3] = 0.0;
   glClearColor(tmp*0.98, tmp*0.67, tmp*0.52, 0.0);
 
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  if (altitude < 0.0) { // just blank the screen if the lander is below the surface
-    glutSwapBuffers();
+  if (view.sim.altitude < 0.0) { // just blank the screen if the lander is below the surface
+    finish_frame(CLOSEUP_PHASE, draw_start);
     return;
   }
   glMatrixMode(GL_PROJECTION);
@@ -1488,15 +1315,15 @@ void draw_closeup_window (void)
   // At transition_altitude we have a totally opaque haze, to disguise the transition from spherical surface to flat surface.
   // Below transition_altitude, we can see as far as the horizon (or transition_altitude with no terrain texture), 
   // with the fog decreasing towards touchdown.
-  if (altitude > EXOSPHERE) gluPerspective(CLOSEUP_VIEW_ANGLE, aspect_ratio, 1.0, closeup_offset + 2.0*MARS_RADIUS);
+  if (view.sim.altitude > EXOSPHERE) gluPerspective(CLOSEUP_VIEW_ANGLE, aspect_ratio, 1.0, closeup_offset + 2.0*MARS_RADIUS);
   else {
-    horizon = sqrt(position.abs2() - MARS_RADIUS*MARS_RADIUS);
-    if (altitude > transition_altitude) {
-      f = (altitude-transition_altitude) / (EXOSPHERE-transition_altitude);
+    horizon = sqrt(view.sim.position.abs2() - MARS_RADIUS*MARS_RADIUS);
+    if (view.sim.altitude > transition_altitude) {
+      f = (view.sim.altitude-transition_altitude) / (EXOSPHERE-transition_altitude);
       if (f < SMALL_NUM) fog_density = 1000.0; else fog_density = (1.0-f) / (f*horizon);
       view_depth = closeup_offset + horizon;
     } else {
-      f = 1.0 - (altitude / transition_altitude);
+      f = 1.0 - (view.sim.altitude / transition_altitude);
       if (f < SMALL_NUM) fog_density = 1000.0; else fog_density = (1.0-f) / (f*transition_altitude);
       if (do_texture) {
 	fog_density = 0.00005 + 0.5*fog_density;
@@ -1512,7 +1339,7 @@ void draw_closeup_window (void)
   }
 
   // DRAW BACKGROUND IMAGE
-  if (altitude > 70000.0 || altitude < 1200.0) {
+  if ((view.sim.altitude > 70000.0 || view.sim.altitude < 1200.0) && closeup_background_texture) {
     glPushMatrix();
     glMatrixMode(GL_PROJECTION);
     glPushMatrix();
@@ -1553,10 +1380,10 @@ void draw_closeup_window (void)
   // coordinate system.
 
   // Direction from surface to lander (radial) - this must map to the world y-axis
-  s = position.norm();
+  s = view.sim.derived.radial;
 
   // Direction of tangential velocity - this must map to the world x-axis
-  t = closeup_coords.backwards ? -closeup_coords.right : closeup_coords.right; 
+  t = view.sim.closeup_coords.backwards ? -view.sim.closeup_coords.right : view.sim.closeup_coords.right; 
 
   // Mutual perpendicular to these two vectors - this must map to the world z-axis
   n = t^s;
@@ -1569,23 +1396,23 @@ void draw_closeup_window (void)
   invert(m, m2);
 
   // Update terrain texture/line offsets
-  if (simulation_time != last_redraw_time) {
-    terrain_offset_x += cos(terrain_angle*M_PI/180.0) * ground_speed * (simulation_time-last_redraw_time) / (2.0*ground_plane_size);
-    terrain_offset_y += sin(terrain_angle*M_PI/180.0) * ground_speed * (simulation_time-last_redraw_time) / (2.0*ground_plane_size);
+  if (view.sim.simulation_time != last_redraw_time) {
+    terrain_offset_x += cos(view.sim.terrain_angle*M_PI/180.0) * view.sim.ground_speed * (view.sim.simulation_time-last_redraw_time) / (2.0*ground_plane_size);
+    terrain_offset_y += sin(view.sim.terrain_angle*M_PI/180.0) * view.sim.ground_speed * (view.sim.simulation_time-last_redraw_time) / (2.0*ground_plane_size);
     while (terrain_offset_x < 0.0) terrain_offset_x += 1.0;
     while (terrain_offset_x >= 1.0) terrain_offset_x -= 1.0;
     while (terrain_offset_y < 0.0) terrain_offset_y += 1.0;
     while (terrain_offset_y >= 1.0) terrain_offset_y -= 1.0;
-    if (closeup_coords.backwards) ground_line_offset += ground_speed * (simulation_time-last_redraw_time);
-    else ground_line_offset -= ground_speed * (simulation_time-last_redraw_time);
+    if (view.sim.closeup_coords.backwards) ground_line_offset += view.sim.ground_speed * (view.sim.simulation_time-last_redraw_time);
+    else ground_line_offset -= view.sim.ground_speed * (view.sim.simulation_time-last_redraw_time);
     ground_line_offset -= GROUND_LINE_SPACING*((int)ground_line_offset/(int)(GROUND_LINE_SPACING));
-    last_redraw_time = simulation_time;
+    last_redraw_time = view.sim.simulation_time;
   }
 
   // Viewing transformation
   glTranslated(0.0, 0.0, -closeup_offset);
   glRotated(closeup_xr, 1.0, 0.0, 0.0);
-  glRotated(closeup_yr + closeup_coords.backwards*180.0, 0.0, 1.0, 0.0);
+  glRotated(closeup_yr + view.sim.closeup_coords.backwards*180.0, 0.0, 1.0, 0.0);
 
   if (static_lighting) {
     // Specify light positions here, to fix them in the planetary coordinate system
@@ -1601,33 +1428,33 @@ void draw_closeup_window (void)
   // Surface colour
   glColor3f(0.63, 0.33, 0.22);
 
-  if (altitude < transition_altitude) {
+  if (view.sim.altitude < transition_altitude) {
 
     // Draw ground plane below the lander's current position - we need to do this in quarters, with a vertex
     // nearby, to get the fog calculations correct in all OpenGL implementations.
     if (do_texture) glBindTexture(GL_TEXTURE_2D, closeup_mars_texture);
     else glBindTexture(GL_TEXTURE_2D, terrain_texture);
-    if (do_texture) glEnable(GL_TEXTURE_2D);
+    if (do_texture && closeup_mars_texture) glEnable(GL_TEXTURE_2D);
     glNormal3d(0.0, 1.0, 0.0);
     glPushMatrix();
-    glRotated(terrain_angle, 0.0, 1.0, 0.0);
+    glRotated(view.sim.terrain_angle, 0.0, 1.0, 0.0);
     glBegin(GL_QUADS);
-    glTexCoord2f(1.0 + terrain_offset_x, 1.0 + terrain_offset_y); glVertex3d(ground_plane_size, -altitude, ground_plane_size);      
-    glTexCoord2f(1.0 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(ground_plane_size, -altitude, 0.0);
-    glTexCoord2f(0.5 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(0.0, -altitude, 0.0);      
-    glTexCoord2f(0.5 + terrain_offset_x, 1.0 + terrain_offset_y); glVertex3d(0.0, -altitude, ground_plane_size);
-    glTexCoord2f(0.5 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(0.0, -altitude, 0.0);      
-    glTexCoord2f(1.0 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(ground_plane_size, -altitude, 0.0);
-    glTexCoord2f(1.0 + terrain_offset_x, 0.0 + terrain_offset_y); glVertex3d(ground_plane_size, -altitude, -ground_plane_size);
-    glTexCoord2f(0.5 + terrain_offset_x, 0.0 + terrain_offset_y); glVertex3d(0.0, -altitude, -ground_plane_size);
-    glTexCoord2f(0.5 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(0.0, -altitude, 0.0);      
-    glTexCoord2f(0.5 + terrain_offset_x, 0.0 + terrain_offset_y); glVertex3d(0.0, -altitude, -ground_plane_size);
-    glTexCoord2f(0.0 + terrain_offset_x, 0.0 + terrain_offset_y); glVertex3d(-ground_plane_size, -altitude, -ground_plane_size);
-    glTexCoord2f(0.0 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(-ground_plane_size, -altitude, 0.0);
-    glTexCoord2f(0.5 + terrain_offset_x, 1.0 + terrain_offset_y); glVertex3d(0.0, -altitude, ground_plane_size);
-    glTexCoord2f(0.5 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(0.0, -altitude, 0.0);      
-    glTexCoord2f(0.0 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(-ground_plane_size, -altitude, 0.0);
-    glTexCoord2f(0.0 + terrain_offset_x, 1.0 + terrain_offset_y); glVertex3d(-ground_plane_size, -altitude, ground_plane_size);
+    glTexCoord2f(1.0 + terrain_offset_x, 1.0 + terrain_offset_y); glVertex3d(ground_plane_size, -view.sim.altitude, ground_plane_size);      
+    glTexCoord2f(1.0 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(ground_plane_size, -view.sim.altitude, 0.0);
+    glTexCoord2f(0.5 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(0.0, -view.sim.altitude, 0.0);      
+    glTexCoord2f(0.5 + terrain_offset_x, 1.0 + terrain_offset_y); glVertex3d(0.0, -view.sim.altitude, ground_plane_size);
+    glTexCoord2f(0.5 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(0.0, -view.sim.altitude, 0.0);      
+    glTexCoord2f(1.0 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(ground_plane_size, -view.sim.altitude, 0.0);
+    glTexCoord2f(1.0 + terrain_offset_x, 0.0 + terrain_offset_y); glVertex3d(ground_plane_size, -view.sim.altitude, -ground_plane_size);
+    glTexCoord2f(0.5 + terrain_offset_x, 0.0 + terrain_offset_y); glVertex3d(0.0, -view.sim.altitude, -ground_plane_size);
+    glTexCoord2f(0.5 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(0.0, -view.sim.altitude, 0.0);      
+    glTexCoord2f(0.5 + terrain_offset_x, 0.0 + terrain_offset_y); glVertex3d(0.0, -view.sim.altitude, -ground_plane_size);
+    glTexCoord2f(0.0 + terrain_offset_x, 0.0 + terrain_offset_y); glVertex3d(-ground_plane_size, -view.sim.altitude, -ground_plane_size);
+    glTexCoord2f(0.0 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(-ground_plane_size, -view.sim.altitude, 0.0);
+    glTexCoord2f(0.5 + terrain_offset_x, 1.0 + terrain_offset_y); glVertex3d(0.0, -view.sim.altitude, ground_plane_size);
+    glTexCoord2f(0.5 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(0.0, -view.sim.altitude, 0.0);      
+    glTexCoord2f(0.0 + terrain_offset_x, 0.5 + terrain_offset_y); glVertex3d(-ground_plane_size, -view.sim.altitude, 0.0);
+    glTexCoord2f(0.0 + terrain_offset_x, 1.0 + terrain_offset_y); glVertex3d(-ground_plane_size, -view.sim.altitude, ground_plane_size);
     glEnd();
     glPopMatrix();
     glDisable(GL_TEXTURE_2D);
@@ -1637,34 +1464,34 @@ void draw_closeup_window (void)
       glEnable(GL_BLEND);
       glLineWidth(2.0);
       glBegin(GL_LINES);
-      if (closeup_coords.backwards) tmp = -ground_line_offset - transition_altitude;
+      if (view.sim.closeup_coords.backwards) tmp = -ground_line_offset - transition_altitude;
       else tmp = ground_line_offset + transition_altitude;
-      while ((closeup_coords.backwards ? -tmp : tmp) > -transition_altitude) {
+      while ((view.sim.closeup_coords.backwards ? -tmp : tmp) > -transition_altitude) {
 	// Fade the lines out towards the horizon, to avoid aliasing artefacts. The fade is a function of distance from the
 	// centre (tmp) and altitude: the lower the lander gets, the more pronounced the fade.
 	// We need to do draw each line in two parts, with a vertex nearby, to get the fog calculations correct in all OpenGL implementations.
 	// To make the lines fade more strongly when landed, decrease the second number.
 	// To make the lines less apparent at high altitude, decrease the first number. 
-	f = exp( -fabs( pow((transition_altitude-altitude) / transition_altitude, 10.0) * tmp / (10.0*GROUND_LINE_SPACING)) );
+	f = exp( -fabs( pow((transition_altitude-view.sim.altitude) / transition_altitude, 10.0) * tmp / (10.0*GROUND_LINE_SPACING)) );
 	glColor4f(0.32, 0.17, 0.11, f);
-	glVertex3d(tmp, -altitude, -transition_altitude);
-	glVertex3d(tmp, -altitude, 0.0);
-	glVertex3d(tmp, -altitude, 0.0);
-	glVertex3d(tmp, -altitude, transition_altitude);
-	if (closeup_coords.backwards) tmp += GROUND_LINE_SPACING;
+	glVertex3d(tmp, -view.sim.altitude, -transition_altitude);
+	glVertex3d(tmp, -view.sim.altitude, 0.0);
+	glVertex3d(tmp, -view.sim.altitude, 0.0);
+	glVertex3d(tmp, -view.sim.altitude, transition_altitude);
+	if (view.sim.closeup_coords.backwards) tmp += GROUND_LINE_SPACING;
 	else tmp -= GROUND_LINE_SPACING;
       }
       glEnd();
       glDisable(GL_BLEND);
     }
 
-    if (!crashed) { // draw a circular shadow below the lander
+    if (!view.sim.crashed) { // draw a circular shadow below the lander
       glColor3f(0.32, 0.17, 0.11);
       glBegin(GL_TRIANGLES);
       for (i=0; i<360; i+=10) {
-	glVertex3d(0.0, -altitude, 0.0);
-	glVertex3d(LANDER_SIZE*cos(M_PI*(i+10)/180.0), -altitude, LANDER_SIZE*sin(M_PI*(i+10)/180.0));
-	glVertex3d(LANDER_SIZE*cos(M_PI*i/180.0), -altitude, LANDER_SIZE*sin(M_PI*i/180.0));
+	glVertex3d(0.0, -view.sim.altitude, 0.0);
+	glVertex3d(LANDER_SIZE*cos(M_PI*(i+10)/180.0), -view.sim.altitude, LANDER_SIZE*sin(M_PI*(i+10)/180.0));
+	glVertex3d(LANDER_SIZE*cos(M_PI*i/180.0), -view.sim.altitude, LANDER_SIZE*sin(M_PI*i/180.0));
       }
       glEnd();
     } else {
@@ -1676,12 +1503,12 @@ void draw_closeup_window (void)
 	cx = 40.0 * (rand_tri[0] - 0.5);
 	cy = 40.0 * (rand_tri[1] - 0.5);
 	glNormal3d(0.0, 1.0, 0.0);
-	glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[2], -altitude, cy + 2.0*LANDER_SIZE*rand_tri[3]);
-	glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[4], -altitude, cy + 2.0*LANDER_SIZE*rand_tri[5]);
-	glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[6], -altitude, cy + 2.0*LANDER_SIZE*rand_tri[7]);
+	glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[2], -view.sim.altitude, cy + 2.0*LANDER_SIZE*rand_tri[3]);
+	glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[4], -view.sim.altitude, cy + 2.0*LANDER_SIZE*rand_tri[5]);
+	glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[6], -view.sim.altitude, cy + 2.0*LANDER_SIZE*rand_tri[7]);
       }
       glEnd();
-      if (parachute_status != LOST) {
+      if (view.sim.parachute_status != LOST) {
 	glColor3f(1.0, 1.0, 0.0);
 	glBegin(GL_TRIANGLES);  // draw some shreds of yellow canvas
 	for (i=0; i<30; i++) {
@@ -1689,9 +1516,9 @@ void draw_closeup_window (void)
 	  cx = 40.0 * (rand_tri[0] - 0.5);
 	  cy = 40.0 * (rand_tri[1] - 0.5);
 	  glNormal3d(0.0, 1.0, 0.0);
-	  glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[2], -altitude, cy + 2.0*LANDER_SIZE*rand_tri[3]);
-	  glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[4], -altitude, cy + 2.0*LANDER_SIZE*rand_tri[5]);
-	  glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[6], -altitude, cy + 2.0*LANDER_SIZE*rand_tri[7]);
+	  glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[2], -view.sim.altitude, cy + 2.0*LANDER_SIZE*rand_tri[3]);
+	  glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[4], -view.sim.altitude, cy + 2.0*LANDER_SIZE*rand_tri[5]);
+	  glVertex3d(cx + 2.0*LANDER_SIZE*rand_tri[6], -view.sim.altitude, cy + 2.0*LANDER_SIZE*rand_tri[7]);
 	}
 	glEnd();
       }
@@ -1703,29 +1530,29 @@ void draw_closeup_window (void)
     // Draw spherical planet - need depth test
     glPushMatrix();
 
-    if (altitude > EXOSPHERE) {
+    if (view.sim.altitude > EXOSPHERE) {
 
       // Draw the planet reduced size at a reduced displacement, to avoid numerical OpenGL problems with huge viewing distances.
       glTranslated(0.0, -MARS_RADIUS, 0.0);
       glMultMatrixd(m2); // now in the planetary coordinate system
-      if (rotation_on) glRotated(360.0*simulation_time/MARS_DAY, 0.0, 0.0, 1.0); // to make the planet spin
-      if (do_texture) {
+      if (view.sim.rotation_on) glRotated(360.0*view.sim.simulation_time/MARS_DAY, 0.0, 0.0, 1.0); // to make the planet spin
+      if (do_texture && closeup_mars_texture) {
         glEnable(GL_TEXTURE_2D);
         glBindTexture(GL_TEXTURE_2D, closeup_mars_texture);
-        glScaled((MARS_RADIUS / (altitude + MARS_RADIUS)), (MARS_RADIUS / (altitude + MARS_RADIUS)), (MARS_RADIUS / (altitude + MARS_RADIUS)));
+        glScaled((MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)), (MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)), (MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)));
         mars_model.Draw();
         glDisable(GL_TEXTURE_2D);
       } else {
-        glutMottledSphere(MARS_RADIUS * (MARS_RADIUS / (altitude + MARS_RADIUS)), 160, 100);
+        glutMottledSphere(MARS_RADIUS * (MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)), 160, 100);
       }
 
     } else {
 
       // Draw the planet actual size at the correct displacement
-      glTranslated(0.0, -(MARS_RADIUS + altitude), 0.0);
+      glTranslated(0.0, -(MARS_RADIUS + view.sim.altitude), 0.0);
       glMultMatrixd(m2); // now in the planetary coordinate system
-      if (rotation_on) glRotated(360.0*simulation_time/MARS_DAY, 0.0, 0.0, 1.0); // to make the planet spin
-      if (do_texture) {
+      if (view.sim.rotation_on) glRotated(360.0*view.sim.simulation_time/MARS_DAY, 0.0, 0.0, 1.0); // to make the planet spin
+      if (do_texture && closeup_mars_texture) {
         glEnable(GL_TEXTURE_2D);
         glBindTexture(GL_TEXTURE_2D, closeup_mars_texture);
         mars_model.Draw();
@@ -1742,31 +1569,31 @@ void draw_closeup_window (void)
   }
   
   // DRAW PHOBOS & DEIMOS IN CLOSE-UP VIEW
-  if (altitude > transition_altitude) {
+  if (view.sim.altitude > transition_altitude) {
     vector3d relative_moon_position;
     
     // Phobos first
-    relative_moon_position = position - Phobos.get_position();
-    if ((position^(relative_moon_position.norm())).abs() < MARS_RADIUS && relative_moon_position*(position.norm()) > position.abs()) {
+    relative_moon_position = view.sim.position - view.sim.Phobos.get_position();
+    if ((view.sim.position^(relative_moon_position.norm())).abs() < MARS_RADIUS && relative_moon_position*(view.sim.position.norm()) > view.sim.position.abs()) {
       // if there is no line of sight between lander and Deimos, draw Phobos orbit BUT don't draw Phobos
       glPushMatrix();
       glDisable(GL_LIGHTING);
-      if (altitude > EXOSPHERE) glTranslated(0.0, -MARS_RADIUS, 0.0);
-      else glTranslated(0.0, -(MARS_RADIUS + altitude), 0.0);
+      if (view.sim.altitude > EXOSPHERE) glTranslated(0.0, -MARS_RADIUS, 0.0);
+      else glTranslated(0.0, -(MARS_RADIUS + view.sim.altitude), 0.0);
       glMultMatrixd(m2);
-      if (altitude > EXOSPHERE) glScaled((MARS_RADIUS / (altitude + MARS_RADIUS)), (MARS_RADIUS / (altitude + MARS_RADIUS)), (MARS_RADIUS / (altitude + MARS_RADIUS)));
-      draw_future_trajectory_closeup(Phobos_Kepler, 0.432, 0.329, 0.644);
+      if (view.sim.altitude > EXOSPHERE) glScaled((MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)), (MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)), (MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)));
+      draw_future_trajectory_closeup(view.sim.Phobos_Kepler, 0.432, 0.329, 0.644);
       glPopMatrix();
     }
     else { // if Phobos is visible to lander, draw Phobos orbit AND Phobos
       glPushMatrix();
       glDisable(GL_LIGHTING);
-      if (altitude > EXOSPHERE) glTranslated(0.0, -MARS_RADIUS, 0.0);
-      else glTranslated(0.0, -(MARS_RADIUS + altitude), 0.0);
+      if (view.sim.altitude > EXOSPHERE) glTranslated(0.0, -MARS_RADIUS, 0.0);
+      else glTranslated(0.0, -(MARS_RADIUS + view.sim.altitude), 0.0);
       glMultMatrixd(m2);
-      if (altitude > EXOSPHERE) glScaled((MARS_RADIUS / (altitude + MARS_RADIUS)), (MARS_RADIUS / (altitude + MARS_RADIUS)), (MARS_RADIUS / (altitude + MARS_RADIUS)));
-      draw_future_trajectory_closeup(Phobos_Kepler, 0.432, 0.329, 0.644);
-      glTranslated(Phobos.get_position().x, Phobos.get_position().y, Phobos.get_position().z);
+      if (view.sim.altitude > EXOSPHERE) glScaled((MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)), (MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)), (MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)));
+      draw_future_trajectory_closeup(view.sim.Phobos_Kepler, 0.432, 0.329, 0.644);
+      glTranslated(view.sim.Phobos.get_position().x, view.sim.Phobos.get_position().y, view.sim.Phobos.get_position().z);
       glColor3f(0.576, 0.439, 0.859);
       glPointSize(5.0);
       glBegin(GL_POINTS);
@@ -1774,7 +1601,7 @@ void draw_closeup_window (void)
       glEnd();
       glPopMatrix();
       
-      if (moon_effect_on) { // if moon effect on, draw line connecting lander and Phobos
+      if (view.sim.moon_effect_on) { // if moon effect on, draw line connecting lander and Phobos
         relative_moon_position = -relative_moon_position;
         relative_moon_position = matrix_times_vector(m2, relative_moon_position); // express Phobos position wrt lander IN CLOSEUP VIEW
         glPushMatrix();
@@ -1790,27 +1617,27 @@ void draw_closeup_window (void)
     }
     
     // Deimos second
-    relative_moon_position = position - Deimos.get_position();
-    if ((position^(relative_moon_position.norm())).abs() < MARS_RADIUS && relative_moon_position*(position.norm()) > position.abs()) {
+    relative_moon_position = view.sim.position - view.sim.Deimos.get_position();
+    if ((view.sim.position^(relative_moon_position.norm())).abs() < MARS_RADIUS && relative_moon_position*(view.sim.position.norm()) > view.sim.position.abs()) {
       // if there is no line of sight between lander and Deimos, draw Deimos orbit BUT don't draw Deimos
       glPushMatrix();
       glDisable(GL_LIGHTING);
-      if (altitude > EXOSPHERE) glTranslated(0.0, -MARS_RADIUS, 0.0);
-      else glTranslated(0.0, -(MARS_RADIUS + altitude), 0.0);
+      if (view.sim.altitude > EXOSPHERE) glTranslated(0.0, -MARS_RADIUS, 0.0);
+      else glTranslated(0.0, -(MARS_RADIUS + view.sim.altitude), 0.0);
       glMultMatrixd(m2);
-      if (altitude > EXOSPHERE) glScaled((MARS_RADIUS / (altitude + MARS_RADIUS)), (MARS_RADIUS / (altitude + MARS_RADIUS)), (MARS_RADIUS / (altitude + MARS_RADIUS)));
-      draw_future_trajectory_closeup(Deimos_Kepler, 0.585, 0.062, 0.196);
+      if (view.sim.altitude > EXOSPHERE) glScaled((MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)), (MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)), (MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)));
+      draw_future_trajectory_closeup(view.sim.Deimos_Kepler, 0.585, 0.062, 0.196);
       glPopMatrix();
     }
     else { // if Deimos is visible to lander, draw Deimos orbit AND Deimos
       glPushMatrix();
       glDisable(GL_LIGHTING);
-      if (altitude > EXOSPHERE) glTranslated(0.0, -MARS_RADIUS, 0.0);
-      else glTranslated(0.0, -(MARS_RADIUS + altitude), 0.0);
+      if (view.sim.altitude > EXOSPHERE) glTranslated(0.0, -MARS_RADIUS, 0.0);
+      else glTranslated(0.0, -(MARS_RADIUS + view.sim.altitude), 0.0);
       glMultMatrixd(m2);
-      if (altitude > EXOSPHERE) glScaled((MARS_RADIUS / (altitude + MARS_RADIUS)), (MARS_RADIUS / (altitude + MARS_RADIUS)), (MARS_RADIUS / (altitude + MARS_RADIUS)));
-      draw_future_trajectory_closeup(Deimos_Kepler, 0.585, 0.062, 0.196);
-      glTranslated(Deimos.get_position().x, Deimos.get_position().y, Deimos.get_position().z);
+      if (view.sim.altitude > EXOSPHERE) glScaled((MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)), (MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)), (MARS_RADIUS / (view.sim.altitude + MARS_RADIUS)));
+      draw_future_trajectory_closeup(view.sim.Deimos_Kepler, 0.585, 0.062, 0.196);
+      glTranslated(view.sim.Deimos.get_position().x, view.sim.Deimos.get_position().y, view.sim.Deimos.get_position().z);
       glColor3f(0.780, 0.082, 0.522);
       glPointSize(5.0);
       glBegin(GL_POINTS);
@@ -1818,7 +1645,7 @@ void draw_closeup_window (void)
       glEnd();
       glPopMatrix();
       
-      if (moon_effect_on) { // if moon effect on, draw line connecting lander and Deimos
+      if (view.sim.moon_effect_on) { // if moon effect on, draw line connecting lander and Deimos
         relative_moon_position = -relative_moon_position;
         relative_moon_position = matrix_times_vector(m2, relative_moon_position); // express Deimos position wrt lander IN CLOSEUP VIEW
         glPushMatrix();
@@ -1837,13 +1664,13 @@ void draw_closeup_window (void)
     glEnable(GL_DEPTH_TEST);
   }
   
-  if (!help && !landed) {
+  if (!help && !view.sim.landed) {
     // Draw mars surface velocity arrow & tangential velocity arrow
     glDisable(GL_LIGHTING); // disable lighting for visibility
     glPushMatrix();
     glMultMatrixd(m2); // Step 2 - Convert from planetary view to closeup view i.e view where x-axis == tangential velocity, y-axis == radial position
-    vector3d surface_velocity = 8.0*((mars_velocity_wrt_world(MARS_RADIUS, true)).norm());
-    vector3d tangential_velocity = 7.0*((velocity - (velocity*(position.norm()))*(position.norm())).norm());
+    vector3d surface_velocity = 8.0*((mars_velocity_wrt_world(view.sim, MARS_RADIUS, true)).norm());
+    vector3d tangential_velocity = 7.0*((view.sim.velocity - view.sim.derived.radial_speed*view.sim.derived.radial).norm());
     glColor3f(1.0, 0.6, 0.4);
     glLineWidth(1.0);
     glBegin(GL_LINES); // Step 1a - Draw surface velocity arrow IN PLANET FRAME
@@ -1863,7 +1690,7 @@ void draw_closeup_window (void)
   }
 
   glDisable(GL_FOG); // fog only applies to the ground
-  dark_side = (static_lighting && (position.y > 0.0) && (sqrt(position.x*position.x + position.z*position.z) < MARS_RADIUS));
+  dark_side = (static_lighting && (view.sim.position.y > 0.0) && (sqrt(view.sim.position.x*view.sim.position.x + view.sim.position.z*view.sim.position.z) < MARS_RADIUS));
   if (dark_side) { // in the shadow of the planet, we need some diffuse lighting to highlight the lander
     glDisable(GL_LIGHT2); glDisable(GL_LIGHT3); 
     glEnable(GL_LIGHT4); glEnable(GL_LIGHT5);
@@ -1872,16 +1699,16 @@ void draw_closeup_window (void)
   // Work out drag on lander - if it's high, we will surround the lander with an incandescent glow. Also
   // work out drag on parachute: if it's zero, we will not draw the parachute fully open behind the lander.
   // Assume high Reynolds number, quadratic drag = -0.5 * rho * v^2 * A * C_d
-  lander_drag = 0.5*DRAG_COEF_LANDER*atmospheric_density(position)*M_PI*LANDER_SIZE*LANDER_SIZE*(velocity_from_positions-mars_velocity_wrt_world(position.abs(),false)).abs2();
-  chute_drag = 0.5*DRAG_COEF_CHUTE*atmospheric_density(position)*5.0*2.0*LANDER_SIZE*2.0*LANDER_SIZE*(velocity_from_positions-mars_velocity_wrt_world(position.abs(),false)).abs2();
+  lander_drag = 0.5*DRAG_COEF_LANDER*view.sim.derived.density*M_PI*LANDER_SIZE*LANDER_SIZE*(view.sim.velocity_from_positions-view.sim.derived.air_velocity).abs2();
+  chute_drag = 0.5*DRAG_COEF_CHUTE*view.sim.derived.density*5.0*2.0*LANDER_SIZE*2.0*LANDER_SIZE*(view.sim.velocity_from_positions-view.sim.derived.air_velocity).abs2();
 
   // Draw the lander's parachute - behind the lander in the direction of travel
-  if ( (parachute_status == DEPLOYED) && !crashed ) {
-    if (velocity_from_positions.abs() < SMALL_NUM) {
+  if ( (view.sim.parachute_status == DEPLOYED) && !view.sim.crashed ) {
+    if (view.sim.velocity_from_positions.abs() < SMALL_NUM) {
       // Lander is apparently stationary - so draw the parachute above and near to the lander
       gs = 0.0; cs = -1.0; tmp = 2.0;
     } else {
-      gs = ground_speed; cs = climb_speed;
+      gs = view.sim.ground_speed; cs = view.sim.climb_speed;
       if (chute_drag) tmp = 5.0; // parachute fully open
       else tmp = 2.0; // parachute not fully open
     }
@@ -1899,16 +1726,16 @@ void draw_closeup_window (void)
   glPushMatrix();
   glMultMatrixd(m2);
 
-  // Lander orientation relative to planetary coordinate system - xyz Euler angles
-  xyz_euler_to_matrix(orientation, m);
+  // Lander attitude relative to planetary coordinate system
+  quaternion_to_matrix(view.sim.attitude, m);
   glMultMatrixd(m);
 
   // Put lander's centre of gravity at the origin
-  if ((acceleration_drag()).abs() > 0.0 && gust_wind_on && abs(gust_speed) > 10 && !landed)
+  if ((acceleration_drag(view.sim)).abs() > 0.0 && view.sim.gust_wind_on && abs(view.sim.gust_speed) > 10 && !view.sim.landed)
   { // if gust is too strong, show its effect on lander
-    double random_gust_jerk_1 = weibull_random_number()/100.0;
-    double random_gust_jerk_2 = weibull_random_number()/100.0;
-    double random_gust_jerk_3 = weibull_random_number()/100.0;
+    double random_gust_jerk_1 = weibull_random_number(view.sim)/100.0;
+    double random_gust_jerk_2 = weibull_random_number(view.sim)/100.0;
+    double random_gust_jerk_3 = weibull_random_number(view.sim)/100.0;
     glTranslated(random_gust_jerk_1, random_gust_jerk_2, random_gust_jerk_3-LANDER_SIZE/2);
   }
   else
@@ -1917,7 +1744,7 @@ void draw_closeup_window (void)
   }
 
   // Draw lander
-  if (!crashed) {
+  if (!view.sim.crashed) {
     glColor3f(1.0, 1.0, 1.0);
     glutCone(LANDER_SIZE, LANDER_SIZE, 50, 50, true);
   }
@@ -1928,17 +1755,17 @@ void draw_closeup_window (void)
   }
 
   // Draw engine exhaust flare
-  if (thrust_wrt_world().abs() > 0.0) {
+  if (thrust_wrt_world(view.sim).abs() > 0.0) {
     glColor3f(1.0, 0.5, 0.0);
     glRotated(180.0, 1.0, 0.0, 0.0);
     glDisable(GL_LIGHTING);
-    glutCone(LANDER_SIZE/2, 2*LANDER_SIZE*thrust_wrt_world().abs()/MAX_THRUST, 50, 50, false);
+    glutCone(LANDER_SIZE/2, 2*LANDER_SIZE*thrust_wrt_world(view.sim).abs()/MAX_THRUST, 50, 50, false);
     glEnable(GL_LIGHTING);
   }
 
   glPopMatrix(); // back to the world coordinate system
   
-  if (!landed && !crashed)
+  if (!view.sim.landed && !view.sim.crashed)
   { // Draw lander's roll (out), pitch (left), yaw (up) axes in closeup view
     // Placed out here in order to avoid glRotated(...) in the 'Draw engine exhaust flare' routine
     
@@ -1946,8 +1773,8 @@ void draw_closeup_window (void)
     glPushMatrix();
     glMultMatrixd(m2);
 
-    // lander orientation relative to planetary coordinate system - xyz Euler angles
-    xyz_euler_to_matrix(orientation, m);
+    // lander attitude relative to planetary coordinate system
+    quaternion_to_matrix(view.sim.attitude, m);
     glMultMatrixd(m);
 
     // put lander's centre of gravity at the origin
@@ -1983,12 +1810,12 @@ void draw_closeup_window (void)
   }
 
   // Draw incandescent glow surrounding lander
-  if (lander_drag*velocity_from_positions.abs() > HEAT_FLUX_GLOW_THRESHOLD) {
+  if (lander_drag*view.sim.velocity_from_positions.abs() > HEAT_FLUX_GLOW_THRESHOLD) {
     // Calculate an heuristic "glow factor", in the range 0 to 1, for graphics effects
-    glow_factor = (lander_drag*velocity_from_positions.abs()-HEAT_FLUX_GLOW_THRESHOLD) / (4.0*HEAT_FLUX_GLOW_THRESHOLD); 
+    glow_factor = (lander_drag*view.sim.velocity_from_positions.abs()-HEAT_FLUX_GLOW_THRESHOLD) / (4.0*HEAT_FLUX_GLOW_THRESHOLD); 
     if (glow_factor > 1.0) glow_factor = 1.0;
     glow_factor *= 0.7 + 0.3*randtab[rn]; rn = (rn+1)%N_RAND; // a little random variation for added realism
-    glRotated((180.0/M_PI)*atan2(climb_speed, ground_speed), 0.0, 0.0, 1.0);
+    glRotated((180.0/M_PI)*atan2(view.sim.climb_speed, view.sim.ground_speed), 0.0, 0.0, 1.0);
     glRotated(-90.0, 0.0, 1.0, 0.0);
     glDisable(GL_LIGHTING);
     glEnable(GL_BLEND);
@@ -1999,7 +1826,7 @@ void draw_closeup_window (void)
     glEnable(GL_LIGHTING);
   }
   
-  glutSwapBuffers(); 
+  finish_frame(CLOSEUP_PHASE, draw_start); 
 }
 
 void draw_main_window (void)
@@ -2020,84 +1847,26 @@ void draw_main_window (void)
 }
 
 void refresh_all_subwindows (void)
-  // Marks all subwindows as needing a redraw every n times called, where n depends on the simulation speed
+  // Marks all subwindows as needing a redraw - GLUT thread only
 {
-  static unsigned short n = 0;
-
-  if (simulation_speed > 5) {
-    switch (simulation_speed) {
-    case 6:
-      n += 500; // update graphics every 2 iterations
-      break;
-    case 7:
-      n += 100; // update graphics every 10 iterations
-      break;
-    case 8:
-      n += 20; // update graphics every 50 iterations
-      break;
-    case 9:
-      n += 10;  // update graphics every 100 iterations
-      break;
-    case 10:
-      n += 1;  // update graphics every 1000 iterations
-      break;
-    }
-    if (n>=1000) n=0;
-    if (!paused && !landed && n) return;
-  }
-
+  if (headless) return;
   glutPostWindowRedisplay(closeup_window);
   glutPostWindowRedisplay(orbital_window);
   glutPostWindowRedisplay(instrument_window);
 }
 
-bool safe_to_deploy_parachute (void)
-  // Checks whether the parachute is safe to deploy at the current position and velocity
-{
-  double drag;
-
-  // Assume high Reynolds number, quadratic drag = -0.5 * rho * v^2 * A * C_d
-  drag = 0.5*DRAG_COEF_CHUTE*atmospheric_density(position)*5.0*2.0*LANDER_SIZE*2.0*LANDER_SIZE*(velocity_from_positions-mars_velocity_wrt_world(position.abs(),false)).abs2();
-  // Do not use the global variable "altitude" here, in case this function is called from within the
-  // numerical_dynamics function, before altitude is updated in the update_visualization function
-  if ((drag > MAX_PARACHUTE_DRAG) || ((velocity_from_positions.abs() > MAX_PARACHUTE_SPEED) && ((position.abs() - MARS_RADIUS) < EXOSPHERE))) return false;
-  else return true;
-}
-
 void update_visualization (void)
-  // The visualization part of the idle function. Re-estimates altitude, velocity, climb speed and ground
-  // speed from current and previous positions. Updates throttle and fuel levels, then redraws all subwindows.
+  // The visualization part of a time step. Updates the flight status, records the tracks of the lander
+  // and moons, then publishes the new state for the windows to draw.
 {
   static vector3d last_track_position, Phobos_last_track_position, Deimos_last_track_position;
-  vector3d av_p, d;
-  double a, b, c, mu;
-
-  simulation_time += delta_t;
-  altitude = position.abs() - MARS_RADIUS;
-
-  // Use average of current and previous positions when calculating climb and ground speeds
-  av_p = (position + last_position).norm();
-  if (delta_t != 0.0) velocity_from_positions = (position - last_position)/delta_t;
-  else velocity_from_positions = vector3d(0.0, 0.0, 0.0);
-  climb_speed = velocity_from_positions*av_p;
-  ground_speed = (velocity_from_positions - climb_speed*av_p - mars_velocity_wrt_world(MARS_RADIUS, true)).abs();
-
-  // Check to see whether the lander has landed
-  if (altitude < LANDER_SIZE/2.0) {
-    glutIdleFunc(NULL);
-    // Estimate position and time of impact
-    d = position - last_position;
-    a = d.abs2();
-    b = 2.0*last_position*d;
-    c = last_position.abs2() - (MARS_RADIUS + LANDER_SIZE/2.0) * (MARS_RADIUS + LANDER_SIZE/2.0);
-    mu = (-b - sqrt(b*b-4.0*a*c))/(2.0*a);
-    position = last_position + mu*d;
-    simulation_time -= (1.0-mu)*delta_t; 
-    altitude = LANDER_SIZE/2.0;
-    landed = true;
-    if ((fabs(climb_speed) > MAX_IMPACT_DESCENT_RATE) || (fabs(ground_speed) > MAX_IMPACT_GROUND_SPEED)) crashed = true;
-    velocity_from_positions = vector3d(0.0, 0.0, 0.0);
-    
+
+  update_flight_status(simulation);
+  update_closeup_coords(simulation); // here rather than only when drawing, so that key presses always see the same frame
+  throttle_control = (short)(simulation.throttle*THROTTLE_GRANULARITY + 0.5);
+  if (headless) return; // replaying an input log, nothing to draw
+
+  if (simulation.landed) {
     // sound effects at landing/crash
 /*
 #ifndef WIN32
@@ -2109,358 +1878,59 @@ void update_visualization (void)
 */
   }
 
-  // Update throttle and fuel (throttle might have been adjusted by the autopilot)
-  if (throttle < 0.0) throttle = 0.0;
-  if (throttle > 1.0) throttle = 1.0;
-  fuel -= delta_t * (FUEL_RATE_AT_MAX_THRUST*throttle) / FUEL_CAPACITY;
-  if (fuel <= 0.0) fuel = 0.0;
-  if (landed || (fuel == 0.0)) throttle = 0.0;
-  throttle_control = (short)(throttle*THROTTLE_GRANULARITY + 0.5);
-
-  // Check to see whether the parachute has vaporized or the tethers have snapped
-  if (parachute_status == DEPLOYED) {
-    if (!safe_to_deploy_parachute() || parachute_lost) {
-      parachute_lost = true; // to guard against the autopilot reinstating the parachute!
-      parachute_status = LOST;
-    }
-  }
-
   // Update record of lander's previous positions, but only if the position or the velocity has 
   // changed significantly since the last update
-  if ( !track.n || (position-last_track_position).norm() * velocity_from_positions.norm() < TRACK_ANGLE_DELTA
-      || (position-last_track_position).abs() > TRACK_DISTANCE_DELTA ) {
-    track.pos[track.p] = position;
+  if ( !track.n || (simulation.position-last_track_position).norm() * simulation.velocity_from_positions.norm() < TRACK_ANGLE_DELTA
+      || (simulation.position-last_track_position).abs() > TRACK_DISTANCE_DELTA ) {
+    track.pos[track.p] = simulation.position;
     track.n++; if (track.n > N_TRACK) track.n = N_TRACK;
     track.p++; if (track.p == N_TRACK) track.p = 0;
-    last_track_position = position;
+    track_version++;
+    last_track_position = simulation.position;
   }
   
   // Update record of Phobos's previous positions, but only if the position or the velocity has 
   // changed significantly since the last update
-  if ( !track_Phobos.n || (Phobos.get_position()-Phobos_last_track_position).norm() * (Phobos.get_velocity()).norm() < TRACK_ANGLE_DELTA
-      || (Phobos.get_position()-Phobos_last_track_position).abs() > TRACK_DISTANCE_DELTA ) {
-    track_Phobos.pos[track_Phobos.p] = Phobos.get_position();
+  if ( !track_Phobos.n || (simulation.Phobos.get_position()-Phobos_last_track_position).norm() * (simulation.Phobos.get_velocity()).norm() < TRACK_ANGLE_DELTA
+      || (simulation.Phobos.get_position()-Phobos_last_track_position).abs() > TRACK_DISTANCE_DELTA ) {
+    track_Phobos.pos[track_Phobos.p] = simulation.Phobos.get_position();
     track_Phobos.n++; if (track_Phobos.n > N_TRACK) track_Phobos.n = N_TRACK;
     track_Phobos.p++; if (track_Phobos.p == N_TRACK) track_Phobos.p = 0;
-    Phobos_last_track_position = Phobos.get_position();
+    track_version++;
+    Phobos_last_track_position = simulation.Phobos.get_position();
   }
   
   // Update record of Deimos's previous positions, but only if the position or the velocity has 
   // changed significantly since the last update
-  if ( !track_Deimos.n || (Deimos.get_position()-Deimos_last_track_position).norm() * (Deimos.get_velocity()).norm() < TRACK_ANGLE_DELTA
-      || (Deimos.get_position()-Deimos_last_track_position).abs() > TRACK_DISTANCE_DELTA ) {
-    track_Deimos.pos[track_Deimos.p] = Deimos.get_position();
+  if ( !track_Deimos.n || (simulation.Deimos.get_position()-Deimos_last_track_position).norm() * (simulation.Deimos.get_velocity()).norm() < TRACK_ANGLE_DELTA
+      || (simulation.Deimos.get_position()-Deimos_last_track_position).abs() > TRACK_DISTANCE_DELTA ) {
+    track_Deimos.pos[track_Deimos.p] = simulation.Deimos.get_position();
     track_Deimos.n++; if (track_Deimos.n > N_TRACK) track_Deimos.n = N_TRACK;
     track_Deimos.p++; if (track_Deimos.p == N_TRACK) track_Deimos.p = 0;
-    Deimos_last_track_position = Deimos.get_position();
+    track_version++;
+    Deimos_last_track_position = simulation.Deimos.get_position();
   }
 
-  // Redraw everything
-  refresh_all_subwindows();
-}
-
-void attitude_stabilization (void)
-  // Three-axis stabilization to ensure the lander's base is always pointing downwards 
-{
-  vector3d normalized_lander_wrt_mars;
-  vector3d up, left, out; // up - direction to point lander yaw/overhead/z axis (its nose); left - direction to point lander pitch/port/y axis; out - direction to point lander roll/forward/x axis
-  double m[16], stabilized_angle;
-  vector3d out_ref, left_ref, up_ref; // a copy of current lander axes to be used as reference axes
-  double m_stabilize[16];
-  
-  if (autopilot_enabled) {
-    
-    up_ref = position.norm(); // direction of radial vector; first vector to define the plane of motion wrt Mars
-    normalized_lander_wrt_mars = (velocity - (velocity*(position.norm()))*(position.norm()) - mars_velocity_wrt_world(position.abs(),true)).norm(); // direction of lander absolute velocity wrt Mars surface absolute velocity; second vector to define the plane of motion wrt Mars
-    up = up_ref; // this is the direction we want the lander's nose to point in
-    stabilized_angle = stabilized_attitude_angle*M_PI/180.0;
-    
-    // Rotate lander axes
-    if (stabilized_attitude_in_plane_wrt_mars) { // in plane of motion wrt Mars
-      out_ref = normalized_lander_wrt_mars;
-      up = rodrigues_rotation(up_ref, (up_ref^out_ref).norm(), stabilized_angle);
-      up = up.norm();
-      out = rodrigues_rotation(out_ref, (up_ref^out_ref).norm(), stabilized_angle);
-      out = out.norm();
-      left = up^out;
-      left = left.norm();
-    }
-    else { // in plane of motion
-      out_ref = (closeup_coords.right).norm();
-      up = rodrigues_rotation(up_ref, (up_ref^out_ref).norm(), stabilized_angle);
-      up = up.norm();
-      out = rodrigues_rotation(out_ref, (up_ref^out_ref).norm(), stabilized_angle);
-      out = out.norm();
-      left = up^out;
-      left = left.norm();
-    }
-    
-    // Update out_axis, left_axis, up_axis
-    out_axis = out;
-    left_axis = left;
-    up_axis = up;
-    
-    // Construct modelling matrix (rotation only) from these three vectors
-    m[0] = out.x; m[1] = out.y; m[2] = out.z; m[3] = 0.0;
-    m[4] = left.x; m[5] = left.y; m[6] = left.z; m[7] = 0.0;
-    m[8] = up.x; m[9] = up.y; m[10] = up.z; m[11] = 0.0;
-    m[12] = 0.0; m[13] = 0.0; m[14] = 0.0; m[15] = 1.0;
-    
-    // Decomponse into xyz Euler angles
-    orientation = matrix_to_xyz_euler(m); // had rotation matrix, get Euler angles
-  }
-  else {
-    switch (input_attitude_command) {
-    
-    case pitch_command:
-      
-      // Make a copy of current lander axes
-      out_ref = out_axis;
-      left_ref = left_axis;
-      up_ref = up_axis;
-      stabilized_angle = input_attitude_angle*M_PI/180.0;
-      
-      // Rotate lander axes
-      up = rodrigues_rotation(up_axis, left_ref, stabilized_angle);
-      up = up.norm();
-      out = rodrigues_rotation(out_axis, left_ref, stabilized_angle);
-      out = out.norm();
-      left = left_ref.norm();
-      
-      // Update out_axis, left_axis, up_axis
-      out_axis = out;
-      left_axis = left;
-      up_axis = up;
-      
-      // Construct modelling matrix (rotation only) from these three vectors
-      m[0] = out.x; m[1] = out.y; m[2] = out.z; m[3] = 0.0;
-      m[4] = left.x; m[5] = left.y; m[6] = left.z; m[7] = 0.0;
-      m[8] = up.x; m[9] = up.y; m[10] = up.z; m[11] = 0.0;
-      m[12] = 0.0; m[13] = 0.0; m[14] = 0.0; m[15] = 1.0;
-      
-      // Decomponse into xyz Euler angles
-      orientation = matrix_to_xyz_euler(m); // had rotation matrix, get Euler angles
-      
-      break;
-  
-    case roll_command:
-      
-      // Make a copy of current lander axes
-      out_ref = out_axis;
-      left_ref = left_axis;
-      up_ref = up_axis;
-      stabilized_angle = input_attitude_angle*M_PI/180.0;
-      
-      // Rotate lander axes
-      up = rodrigues_rotation(up_axis, out_ref, stabilized_angle);
-      up = up.norm();
-      left = rodrigues_rotation(left_axis, out_ref, stabilized_angle);
-      left = left.norm();
-      out = out_ref.norm();
-      
-      // Update out_axis, left_axis, up_axis
-      out_axis = out;
-      left_axis = left;
-      up_axis = up;
-      
-      // Construct modelling matrix (rotation only) from these three vectors
-      m[0] = out.x; m[1] = out.y; m[2] = out.z; m[3] = 0.0;
-      m[4] = left.x; m[5] = left.y; m[6] = left.z; m[7] = 0.0;
-      m[8] = up.x; m[9] = up.y; m[10] = up.z; m[11] = 0.0;
-      m[12] = 0.0; m[13] = 0.0; m[14] = 0.0; m[15] = 1.0;
-      
-      // Decomponse into xyz Euler angles
-      orientation = matrix_to_xyz_euler(m); // had rotation matrix, get Euler angles
-      
-      break;
-  
-    case yaw_command:
-      
-      // Make a copy of current lander axes
-      out_ref = out_axis;
-      left_ref = left_axis;
-      up_ref = up_axis;
-      stabilized_angle = input_attitude_angle*M_PI/180.0;
-      
-      // Rotate lander axes
-      out = rodrigues_rotation(out_axis, up_ref, stabilized_angle);
-      out = out.norm();
-      left = rodrigues_rotation(left_axis, up_ref, stabilized_angle);
-      left = left.norm();
-      up = up_ref.norm();
-      
-      // Update out_axis, left_axis, up_axis
-      out_axis = out;
-      left_axis = left;
-      up_axis = up;
-      
-      // Construct modelling matrix (rotation only) from these three vectors
-      m[0] = out.x; m[1] = out.y; m[2] = out.z; m[3] = 0.0;
-      m[4] = left.x; m[5] = left.y; m[6] = left.z; m[7] = 0.0;
-      m[8] = up.x; m[9] = up.y; m[10] = up.z; m[11] = 0.0;
-      m[12] = 0.0; m[13] = 0.0; m[14] = 0.0; m[15] = 1.0;
-      
-      // Decomponse into xyz Euler angles
-      orientation = matrix_to_xyz_euler(m); // had rotation matrix, get Euler angles
-      
-      break;
-    
-    case stabilize_command:
-      
-      // Construct matrix that rotates the planet axes to express previous lander axes relative to previous closeup view (lander) frame
-      // Note that this is a 'row matrix'
-      m_stabilize[0]=previous_out.x; m_stabilize[4]=previous_out.y; m_stabilize[8]=previous_out.z; m_stabilize[12]=0.0;
-      m_stabilize[1]=previous_left.x; m_stabilize[5]=previous_left.y; m_stabilize[9]=previous_left.z; m_stabilize[13]=0.0;
-      m_stabilize[2]=previous_up.x; m_stabilize[6]=previous_up.y; m_stabilize[10]=previous_up.z; m_stabilize[14]=0.0;
-      m_stabilize[3]=0.0; m_stabilize[7]=0.0; m_stabilize[11]=0.0; m_stabilize[15]=1.0;
-      
-      // Previous lander axes relative to previous closeup view
-      // We want this relationship to be the same when up and closeup_coords.right changes due to position changes
-      out_ref = matrix_times_vector(m_stabilize, out_axis);
-      out_ref = out_ref.norm();
-      left_ref = matrix_times_vector(m_stabilize, left_axis);
-      left_ref = left_ref.norm();
-      up_ref = matrix_times_vector(m_stabilize, up_axis);
-      up_ref = up_ref.norm();
-      
-      // Update closeup view (lander) axes - expressed in planet frame
-      update_closeup_coords();
-      up = position.norm(); // new closeup view 'up'
-      out = (closeup_coords.right).norm(); // new closeup view 'right'
-      left = (up^out).norm(); // new closeup view 'in'
-      
-      // Construct matrix that rotates lander axes so that relative to the new closeup view frame, the lander axes are the same as before
-      // Note that this is a 'column matrix'
-      m_stabilize[0]=out.x; m_stabilize[4]=left.x; m_stabilize[8]=up.x; m_stabilize[12]=0.0;
-      m_stabilize[1]=out.y; m_stabilize[5]=left.y; m_stabilize[9]=up.y; m_stabilize[13]=0.0;
-      m_stabilize[2]=out.z; m_stabilize[6]=left.z; m_stabilize[10]=up.z; m_stabilize[14]=0.0;
-      m_stabilize[3]=0.0; m_stabilize[7]=0.0; m_stabilize[11]=0.0; m_stabilize[15]=1.0;
-      
-      // Rotate lander axes to their new orientation
-      out = matrix_times_vector(m_stabilize, out_ref);
-      out = out.norm();
-      left = matrix_times_vector(m_stabilize, left_ref);
-      left = left.norm();
-      up = matrix_times_vector(m_stabilize, up_ref);
-      up = up.norm();
-      
-      // Update out_axis, left_axis, up_axis
-      out_axis = out;
-      left_axis = left;
-      up_axis = up;
-      
-      // Construct modelling matrix (rotation only) from these three vectors
-      m[0] = out.x; m[1] = out.y; m[2] = out.z; m[3] = 0.0;
-      m[4] = left.x; m[5] = left.y; m[6] = left.z; m[7] = 0.0;
-      m[8] = up.x; m[9] = up.y; m[10] = up.z; m[11] = 0.0;
-      m[12] = 0.0; m[13] = 0.0; m[14] = 0.0; m[15] = 1.0;
-      
-      // Decomponse into xyz Euler angles
-      orientation = matrix_to_xyz_euler(m); // had rotation matrix, get Euler angles
-      
-      // Update closeup view axes here in case attitude_stabilization() is called from key press
-      update_closeup_coords();
-      previous_out = (closeup_coords.right).norm();
-      previous_up = position.norm();
-      previous_left = (previous_up^previous_out).norm();
-      
-      break;
-    
-    case reset_command:
-      // Set up, left, out to its 'zero' state
-      update_closeup_coords();
-      up = position.norm();
-      out = (closeup_coords.right).norm();
-      left = (up^out).norm();
-      
-      // Update out_axis, left_axis, up_axis
-      out_axis = out;
-      left_axis = left;
-      up_axis = up;
-      
-      // Construct modelling matrix (rotation only) from these three vectors
-      m[0] = out.x; m[1] = out.y; m[2] = out.z; m[3] = 0.0;
-      m[4] = left.x; m[5] = left.y; m[6] = left.z; m[7] = 0.0;
-      m[8] = up.x; m[9] = up.y; m[10] = up.z; m[11] = 0.0;
-      m[12] = 0.0; m[13] = 0.0; m[14] = 0.0; m[15] = 1.0;
-      
-      // Decomponse into xyz Euler angles
-      orientation = matrix_to_xyz_euler(m); // had rotation matrix, get Euler angles
-      
-      break;
-    }
-  }
-}
-
-vector3d thrust_wrt_world (void)
-  // Works out thrust vector in the world reference frame, given the lander's orientation
-{
-  double m[16], k, delayed_throttle, lag = ENGINE_LAG;
-  vector3d a, b;
-  static double lagged_throttle = 0.0;
-  static double last_time_lag_updated = -1.0;
-
-  if (simulation_time < last_time_lag_updated) lagged_throttle = 0.0; // simulation restarted
-  if (throttle < 0.0) throttle = 0.0;
-  if (throttle > 1.0) throttle = 1.0;
-  if (landed || (fuel == 0.0)) throttle = 0.0;
-
-  if (simulation_time != last_time_lag_updated) {
-
-    // Delayed throttle value from the throttle history buffer
-    if (throttle_buffer_length > 0) {
-      delayed_throttle = throttle_buffer[throttle_buffer_pointer];
-      throttle_buffer[throttle_buffer_pointer] = throttle;
-      throttle_buffer_pointer = (throttle_buffer_pointer + 1) % throttle_buffer_length;
-    } else delayed_throttle = throttle;
-
-    // Lag, with time constant ENGINE_LAG
-    if (lag <= 0.0) k = 0.0;
-    else k = pow(exp(-1.0), delta_t/lag);
-    lagged_throttle = k*lagged_throttle + (1.0-k)*delayed_throttle;
-
-    last_time_lag_updated = simulation_time;
-  }
-
-  if (autopilot_enabled && stabilized_attitude && (stabilized_attitude_angle == 0)) { // specific solution, avoids rounding errors in the more general calculation below, conditions modified to accommodate for manual attitude control stabilization
-    b = lagged_throttle*MAX_THRUST*position.norm();
-  } else {
-    a.x = 0.0; a.y = 0.0; a.z = lagged_throttle*MAX_THRUST;
-    xyz_euler_to_matrix(orientation, m);
-    b.x = m[0]*a.x + m[4]*a.y + m[8]*a.z;
-    b.y = m[1]*a.x + m[5]*a.y + m[9]*a.z;
-    b.z = m[2]*a.x + m[6]*a.y + m[10]*a.z;
-  }
-  return b;
+  // Hand the new state over to the windows
+  publish_view();
 }
 
 void update_lander_state (void)
-  // The GLUT idle function, called every time round the event loop
+  // Takes one time step - called by the simulation thread, and by the space bar and replays with
+  // simulation_mutex held
 {
-  unsigned long delay;
-
-  // User-controlled delay
-  if ((simulation_speed > 0) && (simulation_speed < 5)) {
-    delay = (5-simulation_speed)*MAX_DELAY/4;
-#ifdef WIN32
-    Sleep(delay/1000); // milliseconds
-#else
-    usleep( (useconds_t)delay ); // microseconds
-#endif
-  }
+  unsigned long long start;
 
-  // This needs to be called every time step, even if the close-up view is not being rendered,
-  // since any-angle attitude stabilizers reference closeup_coords.right
-  update_closeup_coords();
-  
-  // Update historical record
-  last_position = position;
-
-  // Mechanical dynamics
-  numerical_dynamics();
+  // Advance the physics by one time step
+  start = Profiler::now();
+  advance_simulation(simulation); // numerical_dynamics(), after update_closeup_coords()
+  profiler.record(DYNAMICS_PHASE, Profiler::now() - start);
+  input_steps++;
 
   // Refresh the visualization
+  start = Profiler::now();
   update_visualization();
+  profiler.record(VISUALIZATION_PHASE, Profiler::now() - start);
   
 /*
 #ifndef WIN32
@@ -2481,77 +1951,283 @@ void update_lander_state (void)
 */
 }
 
+void start_pacing (pacing_t &pacing, double simulation_time)
+  // Starts timing the simulation against the wall clock from now, with nothing owed
+{
+  microsecond_time(pacing.last_wall);
+  pacing.owed = 0.0;
+  pacing.report_wall = pacing.last_wall;
+  pacing.report_simulation_time = simulation_time;
+  pacing.achieved = 0.0;
+}
+
+double pacing_owed (pacing_t &pacing, double ratio, double delta_t)
+  // Adds the simulation time owed for the wall time since the last call, at ratio simulation seconds
+  // per wall clock second, and returns the total. The caller steps while at least a time step of delta_t
+  // is owed. No more than MAX_CATCHUP seconds of wall time, plus a step, are allowed to build up, so that
+  // after a stall the simulation catches up with a bounded burst of steps rather than racing on for ever.
+{
+  unsigned long long now;
+
+  microsecond_time(now);
+  pacing.owed += ratio*(now - pacing.last_wall)/1.0e6;
+  pacing.last_wall = now;
+  if (pacing.owed > ratio*MAX_CATCHUP + delta_t) pacing.owed = ratio*MAX_CATCHUP + delta_t;
+  return pacing.owed;
+}
+
+void paced_step_taken (pacing_t &pacing, double advanced, bool time_warp)
+  // Pays off a step that advanced the simulation time by advanced. An adaptive step may overpay, which
+  // is made up by waiting longer for the next one, but with time warp on a coast can overpay by hours and
+  // is meant to run ahead of the clock, so that is forgiven.
+{
+  pacing.owed -= advanced;
+  if (time_warp && (pacing.owed < 0.0)) pacing.owed = 0.0;
+}
+
+unsigned long pacing_wait (pacing_t &pacing, double ratio, double delta_t)
+  // Microseconds until another time step of delta_t will be owed
+{
+  if ((pacing.owed >= delta_t) || (ratio <= 0.0)) return 0;
+  return (unsigned long) ((delta_t - pacing.owed)*1.0e6/ratio) + 1;
+}
+
+void update_achieved_speed (pacing_t &pacing, double simulation_time)
+  // Works out the simulation seconds actually achieved per wall clock second, once every SPEED_REPORT_INTERVAL
+{
+  if (simulation_time < pacing.report_simulation_time) { // the simulation has been reset
+    pacing.report_wall = pacing.last_wall;
+    pacing.report_simulation_time = simulation_time;
+    return;
+  }
+  if (pacing.last_wall - pacing.report_wall < SPEED_REPORT_INTERVAL) return;
+  pacing.achieved = (simulation_time - pacing.report_simulation_time)*1.0e6/(pacing.last_wall - pacing.report_wall);
+  pacing.report_wall = pacing.last_wall;
+  pacing.report_simulation_time = simulation_time;
+}
+
+void simulation_thread_loop (void)
+  // The body of the simulation thread. Keeps the simulation time advancing at speed_ratio[simulation_speed]
+  // times the wall clock, taking as many steps as are owed each time round and sleeping on simulation_wake
+  // until the next one is due. Pausing or touching down stops the clock, until quitting.
+{
+  pacing_t pacing;
+  coast_step_t coast;
+  double ratio;
+  unsigned long wait;
+
+  coast.start = coast.end = -1.0; // no step taken yet
+  simulation_mutex.lock();
+  start_pacing(pacing, simulation.simulation_time);
+  simulation_mutex.unlock();
+  while (true) {
+    while (input_waiting.load()) this_thread::yield(); // let a key press in between steps
+    unique_lock<mutex> lock(simulation_mutex);
+    if (!quitting && (paused || simulation.landed)) {
+      simulation_wake.wait(lock, [] {return quitting || (!paused && !simulation.landed);});
+      start_pacing(pacing, simulation.simulation_time); // time spent paused is not owed
+    }
+    if (quitting) return;
+
+    ratio = speed_ratio[simulation_speed];
+    pacing_owed(pacing, ratio, simulation.delta_t);
+    while ((pacing.owed >= simulation.delta_t) && !paused && !simulation.landed && !input_waiting.load()) {
+      coast.start = simulation.simulation_time;
+      coast.start_position = simulation.position;
+      coast.start_velocity = simulation.velocity;
+      update_lander_state();
+      coast.end = simulation.simulation_time;
+      coast.end_position = simulation.position;
+      coast.end_velocity = simulation.velocity;
+      paced_step_taken(pacing, coast.end - coast.start, simulation.time_warp);
+    }
+    update_achieved_speed(pacing, simulation.simulation_time);
+    achieved_speed = pacing.achieved;
+    wait = pacing_wait(pacing, ratio, simulation.delta_t);
+
+    // A long adaptive step leaves the simulation ahead of the clock until the next one is owed, so rather than
+    // freeze on the end of the step, draw the lander where the clock has got to every COAST_FRAME_TIME
+    if ((wait > COAST_FRAME_TIME*1.0e6) && (simulation.integrator == DORMAND_PRINCE) && (simulation.simulation_time == coast.end)
+        && (coast.end - coast.start == simulation.delta_t) && !paused && !simulation.landed) {
+      publish_coast_view(coast, simulation.simulation_time + pacing.owed);
+      wait = (unsigned long) (COAST_FRAME_TIME*1.0e6);
+    }
+    if (wait) simulation_wake.wait_for(lock, chrono::microseconds(wait)); // a key press cuts the wait short
+  }
+}
+
+void lock_simulation (void)
+  // Takes simulation_mutex for a GLUT callback, asking the simulation thread to stop between steps
+{
+  input_waiting++;
+  simulation_mutex.lock();
+  input_waiting--;
+}
+
+void unlock_simulation (void)
+  // Publishes whatever a GLUT callback did to the simulation, releases simulation_mutex and wakes the
+  // simulation thread in case it can now run
+{
+  if (!headless) publish_view();
+  simulation_mutex.unlock();
+  simulation_wake.notify_one();
+}
+
+void stop_simulation_thread (void)
+  // Tells the simulation thread to finish and waits for it
+{
+  simulation_mutex.lock();
+  quitting = true;
+  simulation_mutex.unlock();
+  simulation_wake.notify_one();
+  if (simulation_thread.joinable()) simulation_thread.join();
+}
+
+view_snapshot_t &fill_view (void)
+  // Copies the simulation state, and the tracks if they have changed since the slot last held them,
+  // into the back slot of snapshots, ready to publish
+{
+  view_snapshot_t &slot = snapshots.get_back();
+
+  slot.sim = simulation;
+  slot.achieved_speed = achieved_speed;
+  if (slot.track_version != track_version) {
+    slot.track = track;
+    slot.track_Phobos = track_Phobos;
+    slot.track_Deimos = track_Deimos;
+    slot.track_version = track_version;
+  }
+  return slot;
+}
+
+void publish_view (void)
+  // Publishes the simulation state for the windows to draw
+{
+  fill_view();
+  snapshots.publish();
+}
+
+void publish_coast_view (coast_step_t &coast, double time)
+  // Publishes the simulation state with the clock, the lander and the moons set back to the given time part
+  // way through the step just taken. The lander follows the cubic Hermite curve through the positions and
+  // velocities at the two ends of the step, which for a coast in vacuum is within a metre of the true orbit.
+  // Only the view is moved - the simulation carries on from the end of the step, whatever the speed.
+{
+  view_snapshot_t &slot = fill_view();
+  SimulationContext &sim = slot.sim;
+  double h = coast.end - coast.start, s, s2, s3;
+  vector3d av_p;
+
+  if (time < coast.start) time = coast.start;
+  if (time > coast.end) time = coast.end;
+  s = (time - coast.start)/h; s2 = s*s; s3 = s2*s;
+  sim.position = (2.0*s3 - 3.0*s2 + 1.0)*coast.start_position + ((s3 - 2.0*s2 + s)*h)*coast.start_velocity
+    + (3.0*s2 - 2.0*s3)*coast.end_position + ((s3 - s2)*h)*coast.end_velocity;
+  sim.velocity = ((6.0*s2 - 6.0*s)/h)*(coast.start_position - coast.end_position) + (3.0*s2 - 4.0*s + 1.0)*coast.start_velocity
+    + (3.0*s2 - 2.0*s)*coast.end_velocity;
+  sim.simulation_time = time;
+  if (sim.Phobos.get_analytic()) sim.Phobos.update_object(0.0, time);
+  if (sim.Deimos.get_analytic()) sim.Deimos.update_object(0.0, time);
+
+  // The instruments read the same quantities update_flight_status() works out after a step
+  update_derived_state(sim);
+  sim.altitude = sim.derived.altitude;
+  av_p = sim.position.norm();
+  sim.velocity_from_positions = sim.velocity;
+  sim.climb_speed = sim.velocity*av_p;
+  sim.ground_speed = (sim.velocity - sim.climb_speed*av_p - mars_velocity_wrt_world(sim, MARS_RADIUS, true)).abs();
+  snapshots.publish();
+}
+
+void render_idle (void)
+  // The GLUT idle function. Uploads any textures decoded since the last call, then redraws all subwindows
+  // whenever the simulation thread has published a new state, and otherwise sleeps for a millisecond rather
+  // than spinning.
+{
+  bool texture_failed;
+
+  if (texture_loader.busy()) {
+    texture_loader.poll(texture_failed);
+    if (texture_failed) { // as if the texture had never been available - the 't' key can no longer turn it on
+      texture_available = false;
+      do_texture = false;
+      refresh_all_subwindows();
+    }
+  }
+  if (snapshots.take()) {
+    Scoped_timer timer(profiler, IDLE_PHASE); // the sleeps are not worth timing
+    refresh_all_subwindows();
+  }
+  else this_thread::sleep_for(chrono::milliseconds(1));
+}
+
+void finish_frame (profile_phase_t phase, unsigned long long draw_start)
+  // Records how long a subwindow took to draw, then swaps its buffers and records how long that took
+{
+  unsigned long long swap_start = Profiler::now();
+
+  profiler.record(phase, swap_start - draw_start);
+  glutSwapBuffers();
+  profiler.record(SWAP_PHASE, Profiler::now() - swap_start);
+}
+
+void draw_profile_overlay (double achieved)
+  // Draws the profiler's figures since the overlay was switched on over the top left of the instrument
+  // window, with the simulation steps per second and the achieved simulation speed
+{
+  ostringstream s;
+  profile_stats_t stats;
+  double seconds = profiler.seconds_since_mark();
+  int p, y = INSTRUMENT_HEIGHT-15;
+
+  glColor3f(0.0, 0.0, 0.0);
+  glBegin(GL_QUADS);
+  glVertex2d(0.0, INSTRUMENT_HEIGHT);
+  glVertex2d(420.0, INSTRUMENT_HEIGHT);
+  glVertex2d(420.0, INSTRUMENT_HEIGHT-20.0-15.0*(N_PROFILE_PHASES+1));
+  glVertex2d(0.0, INSTRUMENT_HEIGHT-20.0-15.0*(N_PROFILE_PHASES+1));
+  glEnd();
+  glColor3f(1.0, 1.0, 0.0);
+  s.precision(1);
+  s << fixed;
+  glut_print(10, y, "Phase (microseconds)");
+  glut_print(190, y, "p50");
+  glut_print(260, y, "p99");
+  glut_print(330, y, "max");
+  glColor3f(1.0, 1.0, 1.0);
+  for (p=0; p<N_PROFILE_PHASES; p++) {
+    y -= 15;
+    stats = profiler.stats((profile_phase_t) p, true);
+    glut_print(10, y, profile_phase_name[p]);
+    s.str(""); s << stats.p50; glut_print(190, y, s.str());
+    s.str(""); s << stats.p99; glut_print(260, y, s.str());
+    s.str(""); s << stats.max; glut_print(330, y, s.str());
+  }
+  y -= 15;
+  stats = profiler.stats(DYNAMICS_PHASE, true);
+  s.str(""); s << "Steps per second " << (seconds > 0.0 ? stats.count/seconds : 0.0) << "   achieved speed " << achieved << "x";
+  glut_print(10, y, s.str());
+}
+
+void dump_profile (void)
+  // Prints the profiler's figures for the whole session, at exit
+{
+  cout << "Profile of " << input_steps << " time steps" << endl;
+  profiler.dump(cout);
+}
+
 void reset_simulation (void)
   // Resets the simulation to the initial state
 {
-  vector3d p, tv;
-  unsigned long i;
-
-  // Reset these three lander parameters here, so they can be overwritten in initialize_simulation() if so desired
-  stabilized_attitude_angle = 0;
-  stabilized_attitude_in_plane_wrt_mars = false;
-  throttle = 0.0;
-  fuel = 1.0;
-  gust_speed = 0.0;
-  input_attitude_command = stabilize_command; // initialise input attitude command
-  accept_input_altitude = false;
-  input_altitude = 15000;
-
   // Restore initial lander state
-  initialize_simulation();
-
-  // Check whether the lander is underground - if so, make sure it doesn't move anywhere
-  landed = false;
-  crashed = false;
-  altitude = position.abs() - MARS_RADIUS;
-  if (altitude < LANDER_SIZE/2.0) {
-    glutIdleFunc(NULL);
-    landed = true;
-    velocity = vector3d(0.0, 0.0, 0.0);
-  }
-
-  // Visualisation routine's record of various speeds and velocities
-  velocity_from_positions = velocity;
-  last_position = position - delta_t*velocity_from_positions;
-  p = position.norm();
-  climb_speed = velocity_from_positions*p;
-  tv = velocity_from_positions - climb_speed*p - mars_velocity_wrt_world(MARS_RADIUS, true);
-  ground_speed = tv.abs();
+  reset_simulation_state(simulation);
 
   // Miscellaneous state variables
-  throttle_control = (short)(throttle*THROTTLE_GRANULARITY + 0.5);
-  simulation_time = 0.0;  
+  throttle_control = (short)(simulation.throttle*THROTTLE_GRANULARITY + 0.5);
   track.n = 0;
   track_Phobos.n = 0;
   track_Deimos.n = 0;
-  parachute_lost = false;
-  closeup_coords.initialized = false;
-  closeup_coords.backwards = false;
-  closeup_coords.right = vector3d(1.0, 0.0, 0.0);
-  update_closeup_coords();
-
-  // Initialize the throttle history buffer
-  if (delta_t > 0.0) throttle_buffer_length = (unsigned long) (ENGINE_DELAY/delta_t + 0.5);
-  else throttle_buffer_length = 0;
-  if (throttle_buffer_length > 0) {
-    if (throttle_buffer != NULL) delete[] throttle_buffer;
-    throttle_buffer = new double[throttle_buffer_length];
-    for (i=0; i<throttle_buffer_length; i++) throttle_buffer[i] = throttle;
-    throttle_buffer_pointer = 0;
-  }
-  
-  // Initialise some variables that will be used for manual attitude control
-  out_axis = (closeup_coords.right).norm();
-  up_axis = position.norm();
-  left_axis = (up_axis^out_axis).norm();
-  input_attitude_angle = 0.0;
-  previous_out = (closeup_coords.right).norm();
-  previous_up = position.norm();
-  previous_left = (previous_up^previous_out).norm();
-
-  // Reset GLUT state
-  if (paused || landed) refresh_all_subwindows();
-  else glutIdleFunc(update_lander_state);
+  track_version++;
 }
 
 void set_orbital_projection_matrix (void)
@@ -2626,7 +2302,7 @@ void orbital_mouse_button (int button, int state, int x, int y)
     }
     save_orbital_zoom = -1.0;
     set_orbital_projection_matrix();
-    if (paused || landed) refresh_all_subwindows();
+    refresh_all_subwindows();
   }
   else if ((button == GLUT_WHEEL_DOWN) || ((button == GLUT_RIGHT_BUTTON) && (state == GLUT_DOWN))) {
     if (orbital_zoom > 0.001) {
@@ -2635,7 +2311,7 @@ void orbital_mouse_button (int button, int state, int x, int y)
     }
     save_orbital_zoom = -1.0;
     set_orbital_projection_matrix();
-    if (paused || landed) refresh_all_subwindows();
+    refresh_all_subwindows();
   }
   if (button == GLUT_LEFT_BUTTON) {
     if (state == GLUT_UP) {
@@ -2663,7 +2339,7 @@ void orbital_mouse_motion (int x, int y)
   orbital_quat = add_quats(spin_quat, orbital_quat);
   last_click_x = x;
   last_click_y = y;
-  if (paused || landed) refresh_all_subwindows();
+  refresh_all_subwindows();
 }
 
 void closeup_mouse_button (int button, int state, int x, int y)
@@ -2674,14 +2350,14 @@ void closeup_mouse_button (int button, int state, int x, int y)
       closeup_offset *= 0.9;
       if ((button == GLUT_MIDDLE_BUTTON) || glutGetModifiers()) closeup_offset *= 0.9; // to match wheel events
     }
-    if (paused || landed) refresh_all_subwindows();
+    refresh_all_subwindows();
   }
   else if ((button == GLUT_WHEEL_DOWN) || ((button == GLUT_RIGHT_BUTTON) && (state == GLUT_DOWN))) {
     if (closeup_offset < 200.0*LANDER_SIZE) {
       closeup_offset /= 0.9;
       if (button == GLUT_RIGHT_BUTTON) closeup_offset /= 0.9; // to match wheel events
     }
-    if (paused || landed) refresh_all_subwindows();
+    refresh_all_subwindows();
   }
   if (button == GLUT_LEFT_BUTTON) {
     if (state == GLUT_UP) {
@@ -2706,52 +2382,86 @@ void closeup_mouse_motion (int x, int y)
   if (closeup_xr > 90.0) closeup_xr = 90.0;
   last_click_y = y;
   last_click_x = x;
-  if (paused || landed) refresh_all_subwindows();
+  refresh_all_subwindows();
+}
+
+bool input_changes_simulation (input_event_t event, int code)
+  // Whether a key press can change the simulation, and so must go in the input log. Keys that only
+  // change the view are left out, and pausing is logged separately by record_pause_change(). The speed
+  // keys count as view keys: they only change how fast the steps are paced, never the steps themselves,
+  // see publish_coast_view(), so a run recorded at any speed replays at full speed.
+{
+  if (event == SPECIAL_EVENT) return (code == GLUT_KEY_UP) || (code == GLUT_KEY_DOWN) || (code == GLUT_KEY_HOME);
+  if (event != KEY_EVENT) return true;
+  if ((code >= '0') && (code <= '9')) return true;
+  switch (code) {
+  case 8: case 127:
+  case 'a': case 'A': case 'p': case 'P': case 's': case 'S': case 'i': case 'I': case 'k': case 'K':
+  case 'j': case 'J': case 'l': case 'L': case 'u': case 'U': case 'o': case 'O': case 'd': case 'D':
+  case 'c': case 'C': case 'x': case 'X': case 'r': case 'R': case 'f': case 'F': case 'g': case 'G':
+  case 'm': case 'M': case 'v': case 'V': case 'e': case 'E': case 'y': case 'Y': case 'w': case 'W':
+    return true;
+  default:
+    return false;
+  }
+}
+
+void record_input (input_event_t event, int code)
+  // Appends a key press to the input log, if recording and if it matters to the simulation
+{
+  if (input_log.is_recording() && input_changes_simulation(event, code)) input_log.record(input_steps, event, code);
+}
+
+void record_pause_change (void)
+  // Appends the pause state to the input log whenever it changes, since the manual attitude
+  // commands are ignored while paused
+{
+  static bool last_paused = false;
+
+  if (paused == last_paused) return;
+  last_paused = paused;
+  if (input_log.is_recording()) input_log.record(input_steps, PAUSE_EVENT, paused ? 1 : 0);
 }
 
 void glut_special (int key, int x, int y)
   // Callback for special key presses in all windows
 {
+  lock_simulation();
+  record_input(SPECIAL_EVENT, key);
   switch(key) {
   case GLUT_KEY_UP: // throttle up
-    if (!autopilot_enabled && !landed && (fuel>0.0)) {
+    if (!simulation.autopilot_enabled && !simulation.landed && (simulation.fuel>0.0)) {
       throttle_control++;
       if (throttle_control>THROTTLE_GRANULARITY) throttle_control = THROTTLE_GRANULARITY;
-      throttle = (double)throttle_control/THROTTLE_GRANULARITY;
+      simulation.throttle = (double)throttle_control/THROTTLE_GRANULARITY;
     }
     break;
   case GLUT_KEY_DOWN: // throttle down
-    if (!autopilot_enabled && !landed) {
+    if (!simulation.autopilot_enabled && !simulation.landed) {
       throttle_control--;
       if (throttle_control<0) throttle_control = 0;
-      throttle = (double)throttle_control/THROTTLE_GRANULARITY;
+      simulation.throttle = (double)throttle_control/THROTTLE_GRANULARITY;
     }
     break;
   case GLUT_KEY_RIGHT: // faster simulation
     simulation_speed++;
     if (simulation_speed>10) simulation_speed = 10;
-    if (paused) {
-      if (!landed) glutIdleFunc(update_lander_state);
-      paused = false;
-    }
+    paused = false;
     break;
   case GLUT_KEY_LEFT: // slower simulation
     simulation_speed--;
     if (simulation_speed<0) simulation_speed = 0;
-    if (!simulation_speed) {
-      glutIdleFunc(NULL);
-      paused = true;
-    }
+    if (!simulation_speed) paused = true;
     break;
   case GLUT_KEY_PAGE_UP: // switch control panel
     second_control_panel_on = !second_control_panel_on;
     break;
   case GLUT_KEY_HOME: // manually reset attitude to zero state
-    if (!autopilot_enabled && !landed && stabilized_attitude && !paused) {
-      input_attitude_command = reset_command;
-      attitude_stabilization();
-      input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization() is called from numerical_dynamics()
-      input_attitude_command = stabilize_command;
+    if (!simulation.autopilot_enabled && !simulation.landed && simulation.stabilized_attitude && !paused) {
+      simulation.input_attitude_command = reset_command;
+      attitude_stabilization(simulation);
+      simulation.input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization(simulation) is called from numerical_dynamics(simulation)
+      simulation.input_attitude_command = stabilize_command;
     }
     break;
 /*
@@ -2764,16 +2474,24 @@ void glut_special (int key, int x, int y)
 #endif
 */
   }
-  if (paused || landed) refresh_all_subwindows();
+  if (paused || simulation.landed) refresh_all_subwindows();
+  record_pause_change();
+  unlock_simulation();
 }
 
 void glut_key (unsigned char k, int x, int y)
   // Callback for key presses in all windows
 {
+  lock_simulation();
+  record_input(KEY_EVENT, k);
   switch(k) {
     
   case 27: case 'q': case 'Q':
     // Escape or q or Q  - exit
+    input_log.record(input_steps, QUIT_EVENT, 0);
+    input_log.stop();
+    unlock_simulation();
+    stop_simulation_thread();
 /*
 #ifndef WIN32
 #ifndef __APPLE__
@@ -2789,124 +2507,124 @@ void glut_key (unsigned char k, int x, int y)
   // Switch between user input altitude and toggle scenario
   case 8:
     // Backspace - erase units digit in user input altitude
-    if (accept_input_altitude) {
-      input_altitude = input_altitude/10;
+    if (simulation.accept_input_altitude) {
+      simulation.input_altitude = simulation.input_altitude/10;
     }
     break;
   
   case 127:
     // Delete - erase user input altitude
-    if (accept_input_altitude) {
-      input_altitude = 0;
+    if (simulation.accept_input_altitude) {
+      simulation.input_altitude = 0;
     }
     break;
   
   case '0':
     // switch to scenario 0
-    if (accept_input_altitude) {
-      if (input_altitude < 999999999) input_altitude = input_altitude*10+0;
+    if (simulation.accept_input_altitude) {
+      if (simulation.input_altitude < 999999999) simulation.input_altitude = simulation.input_altitude*10+0;
     }
     else {
-      scenario = 0;
+      simulation.scenario = 0;
       reset_simulation();
     }
     break;
 
   case '1':
     // switch to scenario 1
-    if (accept_input_altitude) {
-      if (input_altitude < 999999999) input_altitude = input_altitude*10+1;
+    if (simulation.accept_input_altitude) {
+      if (simulation.input_altitude < 999999999) simulation.input_altitude = simulation.input_altitude*10+1;
     }
     else {
-      scenario = 1;
+      simulation.scenario = 1;
       reset_simulation();
     }
     break;
 
   case '2':
     // switch to scenario 2
-    if (accept_input_altitude) {
-      if (input_altitude < 999999999) input_altitude = input_altitude*10+2;
+    if (simulation.accept_input_altitude) {
+      if (simulation.input_altitude < 999999999) simulation.input_altitude = simulation.input_altitude*10+2;
     }
     else {
-      scenario = 2;
+      simulation.scenario = 2;
       reset_simulation();
     }
     break;
 
   case '3':
     // switch to scenario 3
-    if (accept_input_altitude) {
-      if (input_altitude < 999999999) input_altitude = input_altitude*10+3;
+    if (simulation.accept_input_altitude) {
+      if (simulation.input_altitude < 999999999) simulation.input_altitude = simulation.input_altitude*10+3;
     }
     else {
-      scenario = 3;
+      simulation.scenario = 3;
       reset_simulation();
     }
     break;
 
   case '4':
     // switch to scenario 4
-    if (accept_input_altitude) {
-      if (input_altitude < 999999999) input_altitude = input_altitude*10+4;
+    if (simulation.accept_input_altitude) {
+      if (simulation.input_altitude < 999999999) simulation.input_altitude = simulation.input_altitude*10+4;
     }
     else {
-      scenario = 4;
+      simulation.scenario = 4;
       reset_simulation();
     }
     break;
 
   case '5':
     // switch to scenario 5
-    if (accept_input_altitude) {
-      if (input_altitude < 999999999) input_altitude = input_altitude*10+5;
+    if (simulation.accept_input_altitude) {
+      if (simulation.input_altitude < 999999999) simulation.input_altitude = simulation.input_altitude*10+5;
     }
     else {
-      scenario = 5;
+      simulation.scenario = 5;
       reset_simulation();
     }
     break;
 
   case '6':
     // switch to scenario 6
-    if (accept_input_altitude) {
-      if (input_altitude < 999999999) input_altitude = input_altitude*10+6;
+    if (simulation.accept_input_altitude) {
+      if (simulation.input_altitude < 999999999) simulation.input_altitude = simulation.input_altitude*10+6;
     }
     else {
-      scenario = 6;
+      simulation.scenario = 6;
       reset_simulation();
     }
     break;
 
   case '7':
     // switch to scenario 7
-    if (accept_input_altitude) {
-      if (input_altitude < 999999999) input_altitude = input_altitude*10+7;
+    if (simulation.accept_input_altitude) {
+      if (simulation.input_altitude < 999999999) simulation.input_altitude = simulation.input_altitude*10+7;
     }
     else {
-      scenario = 7;
+      simulation.scenario = 7;
       reset_simulation();
     }
     break;
 
   case '8':
     // switch to scenario 8
-    if (accept_input_altitude) {
-      if (input_altitude < 999999999) input_altitude = input_altitude*10+8;
+    if (simulation.accept_input_altitude) {
+      if (simulation.input_altitude < 999999999) simulation.input_altitude = simulation.input_altitude*10+8;
     }
     else {
-      scenario = 8;
+      simulation.scenario = 8;
       reset_simulation();
     }
     break;
 
   case '9':
     // switch to scenario 9
-    if (accept_input_altitude) {
-      if (input_altitude < 999999999) input_altitude = input_altitude*10+9;
+    if (simulation.accept_input_altitude) {
+      if (simulation.input_altitude < 999999999) simulation.input_altitude = simulation.input_altitude*10+9;
     }
     else {
-      scenario = 9;
+      simulation.scenario = 9;
       reset_simulation();
     }
     break;
@@ -2914,9 +2632,8 @@ void glut_key (unsigned char k, int x, int y)
 
   case 'a': case 'A':
     // a or A - autopilot
-    if (!landed) autopilot_enabled = !autopilot_enabled;
-    if (!autopilot_enabled) accept_input_altitude = false;
-    if (paused) refresh_all_subwindows();
+    if (!simulation.landed) simulation.autopilot_enabled = !simulation.autopilot_enabled;
+    if (!simulation.autopilot_enabled) simulation.accept_input_altitude = false;
     break;
 
   case 'h': case 'H':
@@ -2930,7 +2647,7 @@ void glut_key (unsigned char k, int x, int y)
       orbital_zoom = 0.4;
     }
     set_orbital_projection_matrix();
-    if (paused || landed) refresh_all_subwindows();
+    if (paused || simulation.landed) refresh_all_subwindows();
     break;
 
   case 'z': case 'Z':
@@ -2938,237 +2655,411 @@ void glut_key (unsigned char k, int x, int y)
     static_lighting = !static_lighting;
     glutSetWindow(orbital_window); enable_lights();
     glutSetWindow(closeup_window); enable_lights();
-    if (paused || landed) refresh_all_subwindows();
+    if (paused || simulation.landed) refresh_all_subwindows();
+    break;
+
+  case 'b': case 'B':
+    // b or B - toggle profiler overlay, which then shows the figures from now on
+    profile_overlay = !profile_overlay;
+    if (profile_overlay) profiler.mark();
+    refresh_all_subwindows();
     break;
 
   case 't': case 'T':
     // t or T - terrain texture
     do_texture = !do_texture;
     if (!texture_available) do_texture = false;
-    if (paused || landed) refresh_all_subwindows();
+    if (paused || simulation.landed) refresh_all_subwindows();
     break;
 
   case 'p': case 'P':
     // p or P - deploy parachute
-    if (!autopilot_enabled && !landed && (parachute_status == NOT_DEPLOYED)) parachute_status = DEPLOYED;
-    if (paused) refresh_all_subwindows();
+    if (!simulation.autopilot_enabled && !simulation.landed && (simulation.parachute_status == NOT_DEPLOYED)) simulation.parachute_status = DEPLOYED;
     break;
 
   case 's': case 'S':
     // s or S - attitude stabilizer
-    if (!autopilot_enabled && !landed) stabilized_attitude = !stabilized_attitude;
-    if (!stabilized_attitude) stabilized_attitude_angle=0.0; // when switched off, clear stabilized angle to 0
-    if (paused) refresh_all_subwindows();
+    if (!simulation.autopilot_enabled && !simulation.landed) simulation.stabilized_attitude = !simulation.stabilized_attitude;
+    if (!simulation.stabilized_attitude) simulation.stabilized_attitude_angle=0.0; // when switched off, clear stabilized angle to 0
     break;
 
   case 32:
     // space bar
     simulation_speed = 0;
-    glutIdleFunc(NULL);
-    if (paused && !landed) update_lander_state();
-    else refresh_all_subwindows();
+    if (paused && !simulation.landed) update_lander_state();
     paused = true;
     break;
   
   case 'i': case 'I':
     // i or I - manual pitch up
-    if (!autopilot_enabled && !landed && stabilized_attitude && !paused)
+    if (!simulation.autopilot_enabled && !simulation.landed && simulation.stabilized_attitude && !paused)
     {
-      input_attitude_command = pitch_command;
-      input_attitude_angle = -ATTITUDE_GRANULARITY; // right hand rule convention
-      attitude_stabilization();
-      input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization() is called from numerical_dynamics()
-      input_attitude_command = stabilize_command;
+      simulation.input_attitude_command = pitch_command;
+      simulation.input_attitude_angle = -ATTITUDE_GRANULARITY; // right hand rule convention
+      attitude_stabilization(simulation);
+      simulation.input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization(simulation) is called from numerical_dynamics(simulation)
+      simulation.input_attitude_command = stabilize_command;
     }
-    if (paused) refresh_all_subwindows();
     break;
   
   case 'k': case 'K':
     // k or K - manual pitch down
-    if (!autopilot_enabled && !landed && stabilized_attitude && !paused)
+    if (!simulation.autopilot_enabled && !simulation.landed && simulation.stabilized_attitude && !paused)
     {
-      input_attitude_command = pitch_command;
-      input_attitude_angle = ATTITUDE_GRANULARITY; // right hand rule convention
-      attitude_stabilization();
-      input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization() is called from numerical_dynamics()
-      input_attitude_command = stabilize_command;
+      simulation.input_attitude_command = pitch_command;
+      simulation.input_attitude_angle = ATTITUDE_GRANULARITY; // right hand rule convention
+      attitude_stabilization(simulation);
+      simulation.input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization(simulation) is called from numerical_dynamics(simulation)
+      simulation.input_attitude_command = stabilize_command;
     }
-    if (paused) refresh_all_subwindows();
     break;
 
   case 'j': case 'J':
     // j or J - manual yaw left
-    if (!autopilot_enabled && !landed && stabilized_attitude && !paused)
+    if (!simulation.autopilot_enabled && !simulation.landed && simulation.stabilized_attitude && !paused)
     {
-      input_attitude_command = yaw_command;
-      input_attitude_angle = ATTITUDE_GRANULARITY; // right hand rule convention for rotation
-      attitude_stabilization();
-      input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization() is called from numerical_dynamics()
-      input_attitude_command = stabilize_command;
+      simulation.input_attitude_command = yaw_command;
+      simulation.input_attitude_angle = ATTITUDE_GRANULARITY; // right hand rule convention for rotation
+      attitude_stabilization(simulation);
+      simulation.input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization(simulation) is called from numerical_dynamics(simulation)
+      simulation.input_attitude_command = stabilize_command;
     }
-    if (paused) refresh_all_subwindows();
     break;
   
   case 'l': case 'L':
     // l or L - manual yaw right
-    if (!autopilot_enabled && !landed && stabilized_attitude && !paused)
+    if (!simulation.autopilot_enabled && !simulation.landed && simulation.stabilized_attitude && !paused)
     {
-      input_attitude_command = yaw_command;
-      input_attitude_angle = -ATTITUDE_GRANULARITY; // right hand rule convention for rotation
-      attitude_stabilization();
-      input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization() is called from numerical_dynamics()
-      input_attitude_command = stabilize_command;
+      simulation.input_attitude_command = yaw_command;
+      simulation.input_attitude_angle = -ATTITUDE_GRANULARITY; // right hand rule convention for rotation
+      attitude_stabilization(simulation);
+      simulation.input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization(simulation) is called from numerical_dynamics(simulation)
+      simulation.input_attitude_command = stabilize_command;
     }
-    if (paused) refresh_all_subwindows();
     break;
 
   case 'u': case 'U':
     // u or U - manual roll left
-    if (!autopilot_enabled && !landed && stabilized_attitude && !paused)
+    if (!simulation.autopilot_enabled && !simulation.landed && simulation.stabilized_attitude && !paused)
     {
-      input_attitude_command = roll_command;
-      input_attitude_angle = -ATTITUDE_GRANULARITY; // right hand rule convention for rotation
-      attitude_stabilization();
-      input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization() is called from numerical_dynamics()
-      input_attitude_command = stabilize_command;
+      simulation.input_attitude_command = roll_command;
+      simulation.input_attitude_angle = -ATTITUDE_GRANULARITY; // right hand rule convention for rotation
+      attitude_stabilization(simulation);
+      simulation.input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization(simulation) is called from numerical_dynamics(simulation)
+      simulation.input_attitude_command = stabilize_command;
     }
-    if (paused) refresh_all_subwindows();
     break;
   
   case 'o': case 'O':
     // o or O - manual roll right
-    if (!autopilot_enabled && !landed && stabilized_attitude && !paused)
+    if (!simulation.autopilot_enabled && !simulation.landed && simulation.stabilized_attitude && !paused)
     {
-      input_attitude_command = roll_command;
-      input_attitude_angle = ATTITUDE_GRANULARITY; // right hand rule convention for rotation
-      attitude_stabilization();
-      input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization() is called from numerical_dynamics()
-      input_attitude_command = stabilize_command;
+      simulation.input_attitude_command = roll_command;
+      simulation.input_attitude_angle = ATTITUDE_GRANULARITY; // right hand rule convention for rotation
+      attitude_stabilization(simulation);
+      simulation.input_attitude_angle = 0.0; // zero to stop lander from being changed when attitude_stabilization(simulation) is called from numerical_dynamics(simulation)
+      simulation.input_attitude_command = stabilize_command;
     }
-    if (paused) refresh_all_subwindows();
     break;
   
   case 'd': case 'D':
-    // d or D - set autopilot to descent guidance mode
-    if (autopilot_enabled && current_lander_phase == let_it_be)
+    // d or D - set autopilot to descent guidance mode, or once descending, toggle fuel-optimal powered descent
+    if (simulation.autopilot_enabled && simulation.current_lander_phase == let_it_be)
     {
-      if (!accept_input_altitude) current_autopilot_mode = descent_mode;
+      if (!simulation.accept_input_altitude) simulation.current_autopilot_mode = descent_mode;
     }
+    else if (simulation.autopilot_enabled && simulation.current_autopilot_mode == descent_mode) simulation.current_autopilot_mode = powered_descent_mode;
+    else if (simulation.autopilot_enabled && simulation.current_autopilot_mode == powered_descent_mode) simulation.current_autopilot_mode = descent_mode;
     break;
   
   case 'c': case 'C':
     // c or C - set autopilot to orbital transfer mode
-    if (autopilot_enabled && current_lander_phase == let_it_be)
+    if (simulation.autopilot_enabled && simulation.current_lander_phase == let_it_be)
     {
-      if (!accept_input_altitude) current_autopilot_mode = transfer_mode;
+      if (!simulation.accept_input_altitude) simulation.current_autopilot_mode = transfer_mode;
     }
     break;
   
   case 'x': case 'X':
     // x or X - set autopilot to emergency landing
-    if (autopilot_enabled)
+    if (simulation.autopilot_enabled)
     {
-      current_autopilot_mode = descent_mode;
-      current_lander_phase = viva_la_vida;
-      accept_input_altitude = false;
+      simulation.current_autopilot_mode = descent_mode;
+      simulation.current_lander_phase = viva_la_vida;
+      simulation.accept_input_altitude = false;
     }
     break;
   
   case 'r': case 'R':
     // r or R - toggle planet rotation
-    if (!landed) rotation_on = !rotation_on;
-    if (paused) refresh_all_subwindows();
+    if (!simulation.landed) simulation.rotation_on = !simulation.rotation_on;
     break;
   
   case 'f': case 'F':
     // f or F - toggle steady wind
-    if (!landed) steady_wind_on = !steady_wind_on;
-    if (steady_wind_on) gust_wind_on = false;
-    if (paused) refresh_all_subwindows();
+    if (!simulation.landed) simulation.steady_wind_on = !simulation.steady_wind_on;
+    if (simulation.steady_wind_on) simulation.gust_wind_on = false;
     break;
   
   case 'g': case 'G':
     // g or G - toggle gust wind
-    if (!landed) gust_wind_on = !gust_wind_on;
-    if (gust_wind_on) steady_wind_on = false;
-    if (paused) refresh_all_subwindows();
+    if (!simulation.landed) simulation.gust_wind_on = !simulation.gust_wind_on;
+    if (simulation.gust_wind_on) simulation.steady_wind_on = false;
     break;
   
   case 'm': case 'M':
     // m or M - toggle gravitational effect of Phobos & Deimos on lander
-    if (!landed) moon_effect_on = !moon_effect_on;
-    if (paused) refresh_all_subwindows();
+    if (!simulation.landed) simulation.moon_effect_on = !simulation.moon_effect_on;
     break;
   
   case 'n': case 'N':
     // n or N - toggle predicted trajectory of lander
-    if (!landed) display_predicted_trajectory = !display_predicted_trajectory;
+    if (!simulation.landed) display_predicted_trajectory = !display_predicted_trajectory;
     if (paused) refresh_all_subwindows();
     break;
   
   case 'v': case 'V':
     // v or V - toggle user input altitude
-    if (autopilot_enabled && current_lander_phase == let_it_be) accept_input_altitude = !accept_input_altitude;
+    if (simulation.autopilot_enabled && simulation.current_lander_phase == let_it_be) simulation.accept_input_altitude = !simulation.accept_input_altitude;
     break;
   
   case 'e': case 'E':
     // e or E - reset autopilot and lander to idle state
-    if (autopilot_enabled) {
-      current_autopilot_mode = maintain_mode;
-      current_lander_phase = let_it_be;
-      accept_input_altitude = false;
+    if (simulation.autopilot_enabled) {
+      simulation.current_autopilot_mode = maintain_mode;
+      simulation.current_lander_phase = let_it_be;
+      simulation.accept_input_altitude = false;
     }
-    if (paused) refresh_all_subwindows();
+    break;
+  
+  case 'y': case 'Y':
+    // y or Y - toggle analytic time warp over coast arcs
+    if (!simulation.landed) simulation.time_warp = !simulation.time_warp;
     break;
   
   case 'w': case 'W':
     // w or W - unhold lander
-    if (!lander_unheld) {
-      current_lander_phase = let_it_go;
-      lander_unheld = true;
+    if (!simulation.lander_unheld) {
+      simulation.current_lander_phase = let_it_go;
+      simulation.lander_unheld = true;
     }
-    if (paused) refresh_all_subwindows();
     break;
   }
+  record_pause_change();
+  unlock_simulation();
 }
 
-bool setup_texture (string filename, GLuint &id)
+void seed_run (unsigned long long seed)
+  // Seeds the simulation's random number generator, and regenerates the random number table used
+  // for the graphics from a generator of its own, so that neither depends on rand()
 {
-  int width, height;
-  unsigned char* tex = SOIL_load_image(filename.c_str(), &width, &height, 0, SOIL_LOAD_RGB);
-  
-  if (tex != NULL) {
-    glGenTextures(1, &id);
-    glBindTexture(GL_TEXTURE_2D, id);
-    if (glGetError() != GL_NO_ERROR) {
-      cerr << "Error when binding " << id << endl;
-    return false;
+  unsigned long long table_state;
+  int i;
+
+  run_seed = seed;
+  seed_random_number(simulation, seed);
+  seed_random_number(table_state, ~seed);
+  for (i=0; i<N_RAND; i++) randtab[i] = (float) uniform_random_number(table_state);
+}
+
+int run_headless (double time_limit, bool autopilot, int integrator, bool time_warp, short speed, bool powered_descent)
+  // Runs the selected scenario without any GLUT windows, until touchdown or until the simulation time
+  // exceeds time_limit, then prints the final state. Runs flat out, or if speed is between 1 and 10 paced
+  // against the wall clock just as the GUI is. A negative integrator keeps the scenario's own choice, and
+  // powered_descent lands descent scenarios with the fuel-optimal planner, see powered_descent.h.
+  // Returns 0 for a safe landing, 1 for a crash and 2 if the time limit was reached first.
+{
+  unsigned long long t_start, t_end;
+  unsigned long steps = 0, wait;
+  pacing_t pacing;
+  double step_start;
+
+  reset_simulation();
+  if (autopilot) simulation.autopilot_enabled = true;
+  if (integrator >= 0) simulation.integrator = (integrator_t) integrator;
+  if (powered_descent && (simulation.current_autopilot_mode == descent_mode)) simulation.current_autopilot_mode = powered_descent_mode;
+  simulation.time_warp = time_warp;
+  microsecond_time(t_start);
+  if ((speed < 1) || (speed > 10)) steps = run_to_touchdown(simulation, time_limit);
+  else {
+    simulation.time_warp_limit = time_limit;
+    start_pacing(pacing, simulation.simulation_time);
+    while (!simulation.landed && (simulation.simulation_time < time_limit)) {
+      pacing_owed(pacing, speed_ratio[speed], simulation.delta_t);
+      wait = pacing_wait(pacing, speed_ratio[speed], simulation.delta_t);
+      if (wait) {
+        this_thread::sleep_for(chrono::microseconds(wait));
+        continue;
+      }
+      step_start = simulation.simulation_time;
+      advance_simulation(simulation);
+      update_flight_status(simulation);
+      steps++;
+      paced_step_taken(pacing, simulation.simulation_time - step_start, simulation.time_warp);
     }
   }
-  else return false;
-  
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-  
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex);
-  gluBuild2DMipmaps(GL_TEXTURE_2D, 3, width, height, GL_RGB, GL_UNSIGNED_BYTE, tex);
-  
-  SOIL_free_image_data(tex);
-  
-  if (glGetError() != GL_NO_ERROR) {
-    cerr << "Error when creating texture image " << id << endl;
-    return false;
+  microsecond_time(t_end);
+  return report_headless_result(steps, t_end-t_start);
+}
+
+int run_replay (string filename, double time_limit)
+  // Replays an input log flat out, without any GLUT windows. The recorded key presses go through
+  // glut_key() and glut_special() and the steps through update_lander_state(), just as in the GUI,
+  // so the run is reproduced exactly. Carries on to touchdown or time_limit after the last input,
+  // unless the log ends with the program being quit. Returns as run_headless() does, or 3 if the
+  // log cannot be read or does not fit the simulation.
+{
+  vector<input_record_t> records;
+  unsigned short scenario;
+  unsigned long long seed, t_start, t_end;
+  unsigned long r = 0;
+  bool quit = false;
+
+  if (!Input_log::read(filename, scenario, seed, records) || (scenario > 9)) {
+    cerr << "Cannot read input log " << filename << endl;
+    return 3;
+  }
+  simulation.scenario = scenario;
+  seed_run(seed);
+  reset_simulation();
+  paused = false;
+
+  microsecond_time(t_start);
+  while (!quit) {
+    for (; (r < records.size()) && (records[r].step <= input_steps); r++) {
+      if (records[r].event == KEY_EVENT) glut_key((unsigned char) records[r].code, 0, 0);
+      else if (records[r].event == SPECIAL_EVENT) glut_special(records[r].code, 0, 0);
+      else if (records[r].event == PAUSE_EVENT) paused = (records[r].code != 0);
+      else quit = true;
+      if (quit) break;
+    }
+    if (quit) break;
+    if (r < records.size()) {
+      if (simulation.landed) { // the GUI never steps a landed lander, so the log cannot be from this version
+        cerr << "Input log " << filename << " does not match the simulation: landed at step " << input_steps
+             << " with inputs still to come" << endl;
+        return 3;
+      }
+    }
+    else if (simulation.landed || (simulation.simulation_time >= time_limit)) break;
+    update_lander_state();
+  }
+  microsecond_time(t_end);
+  return report_headless_result(input_steps, t_end-t_start);
+}
+
+int report_headless_result (unsigned long steps, unsigned long long wall_time)
+  // Prints the final state after a headless run or replay, wall_time in microseconds. Returns 0 for a safe
+  // landing, 1 for a crash and 2 if the lander is still flying.
+{
+  cout.precision(3);
+  cout << fixed;
+  cout << "Scenario " << simulation.scenario << ": " << scenario_description[simulation.scenario] << endl;
+  cout << "Integrator " << integrator_name[simulation.integrator] << endl;
+  if (simulation.landed) {
+    if (simulation.altitude < LANDER_SIZE/2.0) cout << "Result: lander is below the surface" << endl;
+    else if (simulation.crashed) cout << "Result: crashed" << endl;
+    else cout << "Result: landed safely" << endl;
+    cout << "Descent rate at touchdown " << -simulation.climb_speed << " m/s" << endl;
+    cout << "Ground speed at touchdown " << simulation.ground_speed << " m/s" << endl;
   }
-  else return true;
+  else {
+    cout << "Result: time limit reached" << endl;
+    cout << "Altitude " << simulation.altitude << " m" << endl;
+    cout << "Climb rate " << simulation.climb_speed << " m/s" << endl;
+    cout << "Ground speed " << simulation.ground_speed << " m/s" << endl;
+  }
+  cout << "Simulation time " << simulation.simulation_time << " s" << endl;
+  cout << "Fuel consumed " << FUEL_CAPACITY*(1.0-simulation.fuel) << " litres" << endl;
+  cout << "Position " << simulation.position << " m" << endl;
+  cout << "Velocity " << simulation.velocity << " m/s" << endl;
+  cout << "Steps " << steps << " in " << wall_time/1000.0 << " ms of wall time" << endl;
+  if (wall_time) cout << "Simulation time per wall clock time " << simulation.simulation_time*1.0e6/wall_time << endl;
+  if (telemetry.is_recording()) {
+    telemetry.stop();
+    cout << "Telemetry records dropped " << telemetry.get_dropped() << endl;
+  }
+
+  if (!simulation.landed) return 2;
+  else if (simulation.crashed || (simulation.altitude < LANDER_SIZE/2.0)) return 1;
+  else return 0;
+}
+
+void print_usage (const char *program)
+  // Lists the command line options on standard error
+{
+  cerr << "Usage: " << program << " [--scenario=N] [--seed=N] [--record=file] [--telemetry=file] [--atmosphere=file] [--gains=file] [--compress-textures] [GLUT options]" << endl;
+  cerr << "       " << program << " --headless [--scenario=N] [--seed=N] [--time-limit=seconds] [--autopilot] [--integrator=verlet|dopri|velocity-verlet|yoshida4] [--warp] [--powered-descent] [--speed=1-10] [--telemetry=file] [--atmosphere=file] [--gains=file]" << endl;
+  cerr << "       " << program << " --replay=file [--time-limit=seconds] [--telemetry=file] [--atmosphere=file] [--gains=file]" << endl;
 }
 
 int main (int argc, char* argv[])
   // Initializes GLUT windows and lander state, then enters GLUT main loop
 {
-  int i;
+  int i, integrator = -1;
+  double time_limit = 100000.0;
+  bool autopilot = false, time_warp = false, powered_descent = false, compress_textures = false;
+  short headless_speed = 0;
+  string record_filename, replay_filename, telemetry_filename;
+  int glut_argc = 1;
+  vector<char *> glut_argv(argc + 1);
+  
+  glut_argv[0] = argv[0];
+  // Command line options for headless batch mode, and for recording and replaying inputs
+  for (i=1; i<argc; i++) {
+    string arg = argv[i];
+    if (arg == "--headless") headless = true;
+    else if (arg.compare(0, 7, "--seed=") == 0) run_seed = strtoull(arg.substr(7).c_str(), NULL, 10);
+    else if (arg.compare(0, 9, "--record=") == 0) record_filename = arg.substr(9);
+    else if (arg.compare(0, 12, "--telemetry=") == 0) telemetry_filename = arg.substr(12);
+    else if (arg.compare(0, 9, "--replay=") == 0) {
+      replay_filename = arg.substr(9);
+      headless = true;
+    }
+    else if (arg == "--autopilot") autopilot = true;
+    else if (arg.compare(0, 11, "--scenario=") == 0) simulation.scenario = (unsigned short) atoi(arg.substr(11).c_str());
+    else if (arg.compare(0, 13, "--time-limit=") == 0) time_limit = atof(arg.substr(13).c_str());
+    else if ((arg.compare(0, 13, "--integrator=") == 0) && (integrator_from_name(arg.substr(13)) >= 0)) integrator = integrator_from_name(arg.substr(13));
+    else if (arg == "--warp") time_warp = true;
+    else if (arg == "--powered-descent") powered_descent = true;
+    else if (arg == "--compress-textures") compress_textures = true;
+    else if (arg.compare(0, 8, "--speed=") == 0) headless_speed = (short) atoi(arg.substr(8).c_str());
+    else if (arg.compare(0, 13, "--atmosphere=") == 0) {
+      if (!mars_atmosphere.load(arg.substr(13))) {
+        cerr << "Cannot read atmosphere profile " << arg.substr(13) << endl;
+        return 1;
+      }
+    }
+    else if (arg.compare(0, 8, "--gains=") == 0) {
+      if (!load_autopilot_gains(arg.substr(8), simulation.autopilot_gains)) {
+        cerr << "Cannot read autopilot gains " << arg.substr(8) << endl;
+        return 1;
+      }
+    }
+    else if (arg.compare(0, 2, "--") != 0) glut_argv[glut_argc++] = argv[i]; // left for glutInit, e.g. -display or -geometry
+    else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  glut_argv[glut_argc] = NULL;
+  if ((headless || !replay_filename.empty()) && (glut_argc > 1)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  if (simulation.scenario > 9) simulation.scenario = 0;
+  if (!telemetry_filename.empty()) {
+    if (telemetry.start(telemetry_filename)) simulation.telemetry = &telemetry;
+    else cerr << "Cannot create telemetry file " << telemetry_filename << endl;
+  }
+  
+  // Initialise some display variables - the simulation settings take their defaults from the SimulationContext constructor
+  display_predicted_trajectory = false;
+  second_control_panel_on = false;
+
+  if (!replay_filename.empty()) return run_replay(replay_filename, time_limit);
+  seed_run(run_seed);
+  if (headless) return run_headless(time_limit, autopilot, integrator, time_warp, headless_speed, powered_descent);
   
   // Load terrain model
   texture_available = mars_model.Load("../image/self_made_7.obj", 1.0);
@@ -3193,14 +3084,13 @@ int main (int argc, char* argv[])
 #endif
 */
   
-  // Initialise some simulation variables
-  rotation_on = true, steady_wind_on = false, gust_wind_on = false;
-  moon_effect_on = false;
-  display_predicted_trajectory = false;
-  second_control_panel_on = false;
-
   // Main GLUT window
-  glutInit(&argc, argv);
+  glutInit(&glut_argc, glut_argv.data());
+  if (glut_argc > 1) {
+    // GLUT has removed the options it recognised, so anything left is unknown to both of us
+    print_usage(argv[0]);
+    return 1;
+  }
   glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
   glutInitWindowPosition(0, 0);
   glutInitWindowSize(PREFERRED_WIDTH, PREFERRED_HEIGHT);
@@ -3213,7 +3103,7 @@ int main (int argc, char* argv[])
   glDisable(GL_DEPTH_TEST);
   glutDisplayFunc(draw_main_window);
   glutReshapeFunc(reshape_main_window);  
-  glutIdleFunc(update_lander_state);
+  glutIdleFunc(render_idle);
   glutKeyboardFunc(glut_key);
   glutSpecialFunc(glut_special);
 
@@ -3238,12 +3128,15 @@ int main (int argc, char* argv[])
   glutMotionFunc(closeup_mouse_motion);
   glutKeyboardFunc(glut_key);
   glutSpecialFunc(glut_special);
-  texture_available = generate_terrain_texture() && setup_texture("../image/mars_4k_color.png", closeup_mars_texture) && setup_texture("../image/deep_space.jpg", closeup_background_texture) && texture_available;
   if (!texture_available) do_texture = false;
+  texture_loader.set_compression(compress_textures);
+  texture_loader.start("../image/terrain_texture.mltc", run_seed, generate_terrain_texture, closeup_window, terrain_texture);
+  texture_loader.start("../image/mars_4k_color.png", closeup_window, closeup_mars_texture);
+  texture_loader.start("../image/deep_space.jpg", closeup_window, closeup_background_texture);
   closeup_offset = 50.0;
   closeup_xr = 10.0;
   closeup_yr = 0.0;
-  terrain_angle = 0.0;
+  simulation.terrain_angle = 0.0;
 
   // The orbital view subwindow
   orbital_window = glutCreateSubWindow(main_window, view_width + 3*GAP, GAP, view_width, view_height);
@@ -3264,7 +3157,8 @@ int main (int argc, char* argv[])
   glutMotionFunc(orbital_mouse_motion);
   glutKeyboardFunc(glut_key);
   glutSpecialFunc(glut_special);
-  texture_available = setup_texture("../image/mars_2k_color.png", orbital_mars_texture) && setup_texture("../image/space.jpg", orbital_background_texture) && texture_available;
+  texture_loader.start("../image/mars_2k_color.png", orbital_window, orbital_mars_texture);
+  texture_loader.start("../image/space.jpg", orbital_window, orbital_background_texture);
   quadObj = gluNewQuadric();
   orbital_quat.v.x = 0.53; orbital_quat.v.y = -0.21;
   orbital_quat.v.z = 0.047; orbital_quat.s = 0.82;
@@ -3278,13 +3172,16 @@ int main (int argc, char* argv[])
   glutKeyboardFunc(glut_key);
   glutSpecialFunc(glut_special);
 
-  // Generate the random number table
-  srand(0);
-  for (i=0; i<N_RAND; i++) randtab[i] = (float)rand()/RAND_MAX;
-
-  // Initialize the simulation state
+  // Initialize the simulation state, and give the windows something to draw before the simulation thread starts
   reset_simulation();
+  publish_view();
+  snapshots.take();
   microsecond_time(time_program_started);
+  if (!record_filename.empty() && !input_log.start(record_filename, simulation.scenario, run_seed))
+    cerr << "Cannot create input log " << record_filename << endl;
+  simulation_thread = thread(simulation_thread_loop);
+  atexit(dump_profile);
+  atexit(stop_simulation_thread); // GLUT may exit when the window is closed - runs before dump_profile()
 
   glutMainLoop();
 }
@@ -81,7 +81,6 @@
 #define __LANDER_GRAPHICS_1_INCLUDED__
 
 #include "global_1.h"
-#include "global_2.h"
 
 // GLUT mouse wheel operations work under Linux only
 #if !defined (GLUT_WHEEL_UP)
@@ -98,6 +97,7 @@ GLuint terrain_texture, closeup_mars_texture, orbital_mars_texture, closeup_back
 short throttle_control;
 track_t track, track_Phobos, track_Deimos;
 bool texture_available;
+Texture_loader texture_loader; // decodes the image textures in the background, see render_idle()
 
 // obj model for Mars terrain
 Model_obj mars_model;
@@ -105,48 +105,53 @@ Model_obj mars_model;
 // Simulation parameters
 bool help = false;
 bool paused = false;
-bool landed = false;
-bool crashed = false;
+bool headless = false; // physics only, no GLUT windows
 int last_click_x = -1;
 int last_click_y = -1;
 short simulation_speed = 5;
-double delta_t, simulation_time;
-unsigned short scenario = 0;
-string scenario_description[10];
+const double speed_ratio[11] = {0.0, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0, 10.0, 100.0, 1000.0, 10000.0}; // simulation seconds per wall clock second at each simulation_speed
+double achieved_speed = 0.0; // as measured by the simulation thread, 0 until measured
 bool static_lighting = false;
-closeup_coords_t closeup_coords;
 float randtab[N_RAND];
 bool do_texture = true;
-unsigned long throttle_buffer_length, throttle_buffer_pointer;
-double *throttle_buffer = NULL;
 unsigned long long time_program_started;
+unsigned long long run_seed = 0; // seeds the simulation's gusts and randtab, so that a run can be repeated
 
-// Lander state - the visualization routines use velocity_from_positions, so not sensitive to 
-// any errors in the velocity update in numerical_dynamics
-vector3d position, orientation, velocity, velocity_from_positions, last_position;
-vector3d out_axis, left_axis, up_axis; // for manual attitude control
-vector3d previous_out, previous_left, previous_up; // for manual attitude control
-Orbiting_object Phobos, Deimos;
-Kepler_solver lander_Kepler, Phobos_Kepler, Deimos_Kepler;
-double climb_speed, ground_speed, altitude, throttle, fuel;
-bool stabilized_attitude, stabilized_attitude_in_plane_wrt_mars, autopilot_enabled, parachute_lost;
-bool rotation_on, steady_wind_on, gust_wind_on; // for modelling planet rotation and wind
-bool moon_effect_on; // gravitational effect of Phobos & Deimos on lander
+// Input recording for exact replay, see input_log.h
+Input_log input_log; // open while recording
+unsigned long input_steps = 0; // time steps taken by update_lander_state(), used to stamp the inputs
+
+// Per-step telemetry, see telemetry.h
+Telemetry_recorder telemetry;
+
+// Timing of the phases of each frame, see profiler.h
+Profiler profiler;
+bool profile_overlay = false;
+
+// The simulation driven by the GUI - lander state, Phobos & Deimos, autopilot and attitude control
+SimulationContext simulation;
+
+// The simulation runs on a thread of its own, see simulation_thread_loop(). It holds simulation_mutex
+// while stepping and the GLUT callbacks hold it while handling keys, so the GLUT thread never touches
+// the simulation otherwise: the windows draw from the latest snapshot published after a step.
+struct view_snapshot_t {
+  SimulationContext sim;
+  track_t track, track_Phobos, track_Deimos;
+  unsigned long track_version; // the tracks are large, so they are only copied into a slot when they have changed
+  double achieved_speed;
+};
+Snapshot_buffer<view_snapshot_t> snapshots;
+unsigned long track_version = 0;
+thread simulation_thread;
+mutex simulation_mutex;
+condition_variable simulation_wake; // notified whenever the simulation may be able to run again
+atomic<int> input_waiting(0); // GLUT callbacks waiting for simulation_mutex
+bool quitting = false;
 bool display_predicted_trajectory; // lander predicted trajectory on/off
 bool second_control_panel_on;// for switching between control panels
-bool accept_input_altitude; // for user input altitude
-bool lander_unheld; // for launching lander
-int input_altitude; // for user input altitude
-double gust_speed; // for modelling planet rotation and wind
-parachute_status_t parachute_status;
-lander_phases current_lander_phase;
-autopilot_modes current_autopilot_mode;
-manual_attitude_command input_attitude_command;
-double stabilized_attitude_angle;
-double input_attitude_angle; // for manual attitude control
 
 // Orbital and closeup view parameters
-double orbital_zoom, save_orbital_zoom, closeup_offset, closeup_xr, closeup_yr, terrain_angle;
+double orbital_zoom, save_orbital_zoom, closeup_offset, closeup_xr, closeup_yr;
 quat_t orbital_quat;
 
 // For GL lights
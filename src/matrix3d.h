@@ -0,0 +1,55 @@
+// Mars lander simulator
+// Version 1.8
+// Matrix3d class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+#ifndef __MATRIX3D_INCLUDED__
+#define __MATRIX3D_INCLUDED__
+
+#include <cmath>
+#include <iostream>
+
+#include "vector3d.h"
+
+using namespace std;
+
+class matrix3d {
+  // Utility class for 3x3 matrices, mostly rotations, held as three rows so that a matrix times a vector
+  // is three dot products. Only the conversion to OpenGL's column-major 4x4 layout deals with raw arrays.
+public:
+  constexpr matrix3d() : x(1.0, 0.0, 0.0), y(0.0, 1.0, 0.0), z(0.0, 0.0, 1.0) {}
+  constexpr matrix3d (const vector3d &a, const vector3d &b, const vector3d &c) : x(a), y(b), z(c) {} // from rows
+  static constexpr matrix3d columns (const vector3d &a, const vector3d &b, const vector3d &c) {
+    return matrix3d(vector3d(a.x, b.x, c.x), vector3d(a.y, b.y, c.y), vector3d(a.z, b.z, c.z));
+  }
+  static matrix3d rotation_z (double angle) { // anticlockwise about the z axis, looking down it
+    double c = cos(angle), s = sin(angle);
+    return matrix3d(vector3d(c, -s, 0.0), vector3d(s, c, 0.0), vector3d(0.0, 0.0, 1.0));
+  }
+  constexpr vector3d operator* (const vector3d &v) const { return vector3d(x*v, y*v, z*v); }
+  constexpr matrix3d operator* (const matrix3d &n) const { return columns(*this*n.column_x(), *this*n.column_y(), *this*n.column_z()); }
+  constexpr matrix3d transpose() const { return columns(x, y, z); }
+  constexpr vector3d column_x() const { return vector3d(x.x, y.x, z.x); }
+  constexpr vector3d column_y() const { return vector3d(x.y, y.y, z.y); }
+  constexpr vector3d column_z() const { return vector3d(x.z, y.z, z.z); }
+  void to_opengl (double m[]) const { // 4x4 column-major, as glMultMatrixd() expects
+    m[0] = x.x; m[1] = y.x; m[2] = z.x; m[3] = 0.0;
+    m[4] = x.y; m[5] = y.y; m[6] = z.y; m[7] = 0.0;
+    m[8] = x.z; m[9] = y.z; m[10] = z.z; m[11] = 0.0;
+    m[12] = 0.0; m[13] = 0.0; m[14] = 0.0; m[15] = 1.0;
+  }
+  friend ostream& operator << (ostream &out, const matrix3d &m) { out << m.x << ' ' << m.y << ' ' << m.z; return out; }
+  vector3d x, y, z; // rows
+private:
+};
+
+#endif
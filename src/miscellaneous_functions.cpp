@@ -12,667 +12,329 @@
 // to receive any suggested modifications by private correspondence to
 // dvan2@cam.ac.uk.
 
-#include "global_1.h"
+#include <cstring>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#include "lander_dynamics.h"
 
 //------dvan2's function definitions------//
 
-double current_lander_mass (void)
+double current_lander_mass (SimulationContext &sim)
   // This function calculates current mass of lander
 {
-  return UNLOADED_LANDER_MASS + fuel*FUEL_CAPACITY*FUEL_DENSITY;
+  return UNLOADED_LANDER_MASS + sim.fuel*FUEL_CAPACITY*FUEL_DENSITY;
 }
 
-vector3d acceleration_drag (void)
+vector3d acceleration_drag (SimulationContext &sim)
   // This function calculates the acceleration due to drag
 {
   vector3d force_lander_drag; // drag force due to lander
   vector3d force_chute_drag; // drag force due to parachute
+  double radius = sim.position.abs(), air_speed, air_speed2;
+  vector3d air_velocity = sim.velocity-mars_velocity_wrt_world(sim, radius, false); // lander velocity relative to the atmosphere
+  vector3d air_direction = air_velocity.unit(air_speed, air_speed2);
+  double density = mars_atmosphere.density(radius-MARS_RADIUS);
   
   // Drag force due to lander
-  force_lander_drag = (velocity-mars_velocity_wrt_world(position.abs(),false)).norm()*(-0.5*atmospheric_density(position)*DRAG_COEF_LANDER*M_PI*LANDER_SIZE*LANDER_SIZE*(velocity-mars_velocity_wrt_world(position.abs(),false)).abs2());
+  force_lander_drag = air_direction*(-0.5*density*DRAG_COEF_LANDER*M_PI*LANDER_SIZE*LANDER_SIZE*air_speed2);
   
   // Drag force due to parachute
-  if (parachute_status == DEPLOYED) {
-    force_chute_drag = (velocity-mars_velocity_wrt_world(position.abs(),false)).norm()*(-0.5*atmospheric_density(position)*DRAG_COEF_CHUTE*5.0*2.0*LANDER_SIZE*2.0*LANDER_SIZE*(velocity-mars_velocity_wrt_world(position.abs(),false)).abs2());
+  if (sim.parachute_status == DEPLOYED) {
+    force_chute_drag = air_direction*(-0.5*density*DRAG_COEF_CHUTE*5.0*2.0*LANDER_SIZE*2.0*LANDER_SIZE*air_speed2);
   }
   else {
     force_chute_drag = vector3d(0.0, 0.0, 0.0);
   }
   
   // Return acceleration due to total drag
-  return (force_lander_drag + force_chute_drag)/current_lander_mass();
+  return (force_lander_drag + force_chute_drag)/current_lander_mass(sim);
 }
 
-vector3d acceleration_gravity (void)
+vector3d acceleration_gravity (SimulationContext &sim)
   // This function calculates the acceleration due to gravity
 {
-  vector3d lander_position_wrt_Phobos, lander_position_wrt_Deimos;
-  lander_position_wrt_Phobos = position - Phobos.get_position();
-  lander_position_wrt_Deimos = position - Deimos.get_position();
-  
-  if (moon_effect_on) { // gravitation force due to Mars, Phobos, Deimos
-    return (position.norm()*(-GRAVITY*MARS_MASS/position.abs2())) + (lander_position_wrt_Phobos.norm()*(-GRAVITY*PHOBOS_MASS/lander_position_wrt_Phobos.abs2())) + (lander_position_wrt_Deimos.norm()*(-GRAVITY*DEIMOS_MASS/lander_position_wrt_Deimos.abs2()));
-  }
-  else { // gravitational force due to Mars alone
-    return position.norm()*(-GRAVITY*MARS_MASS/position.abs2());
+  vector3d lander_position_wrt_Phobos, lander_position_wrt_Deimos, direction, pull;
+  double r, r2;
+
+  direction = sim.position.unit(r, r2);
+  pull = direction*(-GRAVITY*MARS_MASS/r2);
+  if (sim.moon_effect_on) { // gravitation force due to Mars, Phobos, Deimos
+    lander_position_wrt_Phobos = sim.position - sim.Phobos.get_position();
+    direction = lander_position_wrt_Phobos.unit(r, r2);
+    pull = pull + direction*(-GRAVITY*PHOBOS_MASS/r2);
+    lander_position_wrt_Deimos = sim.position - sim.Deimos.get_position();
+    direction = lander_position_wrt_Deimos.unit(r, r2);
+    pull = pull + direction*(-GRAVITY*DEIMOS_MASS/r2);
   }
+  return pull; // gravitational force due to Mars alone if the moons are off
 }
 
-vector3d acceleration (void)
+vector3d acceleration (SimulationContext &sim)
   // This function calculates the total instantaneous acceleration
 {
-  return acceleration_drag() + acceleration_gravity() + thrust_wrt_world()/current_lander_mass();
+  return acceleration_drag(sim) + acceleration_gravity(sim) + thrust_wrt_world(sim)/current_lander_mass(sim);
 }
 
-vector3d mars_velocity_wrt_world (double distance_from_centre, bool surface_velocity)
+vector3d mars_velocity_wrt_world (SimulationContext &sim, double distance_from_centre, bool surface_velocity)
   // Calculates either Mars atmosphere velocity or steady wind velocity at a point directly below the lander
 {
-  vector3d mars_angular_velocity = vector3d(0.0, 0.0, 2*M_PI/MARS_DAY);
-  if (surface_velocity) return (mars_angular_velocity^((position.norm())*distance_from_centre))*rotation_on;
-  else return (mars_angular_velocity^((position.norm())*distance_from_centre))*rotation_on + ((mars_angular_velocity^((position.norm())*distance_from_centre)).norm())*10.0*steady_wind_on + ((mars_angular_velocity^((position.norm())*distance_from_centre)).norm())*gust_speed*gust_wind_on;
+  constexpr vector3d mars_angular_velocity = vector3d(0.0, 0.0, 2*M_PI/MARS_DAY);
+  vector3d rotation = mars_angular_velocity^((sim.position.norm())*distance_from_centre), direction;
+  if (surface_velocity) return rotation*sim.rotation_on;
+  direction = rotation.norm();
+  return rotation*sim.rotation_on + direction*10.0*sim.steady_wind_on + direction*sim.gust_speed*sim.gust_wind_on;
 }
 
-double weibull_random_number (void)
- // Generate random number that follows Weibull distribution - to model gust speed
+void seed_random_number (unsigned long long &random_state, unsigned long long seed)
+  // Seeds a random number generator state, so that runs are repeatable and independent of rand()
 {
-  double random_gust_direction = (((double)rand()/(double)RAND_MAX) >= 0.5) ? 1 : -1; // random direction
-  
-  double uniform_distributed_between_0_and_1 = ((double)rand()/(double)RAND_MAX); // a uniformly distributed number between 0 and 1
-  
-  // random Weibull-distributed number, https://www.taygeta.com/random/weibull.html
-  if (uniform_distributed_between_0_and_1 == 1.0) (weibull_random_number()); // if number is 1, regenerate
-  else return 2.0*random_gust_direction*pow((-100.0*log(1-uniform_distributed_between_0_and_1)),0.5); // generate a random Weibull-distributed number with direction (factor of 2 to make the gust stronger)
+  random_state = seed ^ 0x9E3779B97F4A7C15ULL;
+  if (random_state == 0) random_state = 0x9E3779B97F4A7C15ULL; // xorshift must not start from zero
 }
 
-void glut_print_3d (float x, float y, float z, string s)
-  // Prints string at location (x,y,z) in a bitmap font
+void seed_random_number (SimulationContext &sim, unsigned long long seed)
+  // Seeds the simulation's own random number generator
 {
-  unsigned short i;
+  seed_random_number(sim.random_state, seed);
+}
 
-  glRasterPos3f(x, y, z);
-  for (i = 0; i < s.length(); i++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_10, s[i]);
+double uniform_random_number (unsigned long long &random_state)
+  // Uniformly distributed random number in [0,1), from a xorshift64* generator
+{
+  random_state ^= random_state >> 12;
+  random_state ^= random_state << 25;
+  random_state ^= random_state >> 27;
+  return (double)((random_state * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0; // top 53 bits
 }
 
-vector3d matrix_times_vector (double m[], vector3d n)
-{ // Pre-multiply a vector by a matrix
-  vector3d result_vector;
+double uniform_random_number (SimulationContext &sim)
+  // Uniformly distributed random number in [0,1), from the generator held in the simulation context
+{
+  return uniform_random_number(sim.random_state);
+}
+
+double weibull_random_number (unsigned long long &random_state)
+ // Generate random number that follows Weibull distribution - to model gust speed
+{
+  double random_gust_direction = (uniform_random_number(random_state) >= 0.5) ? 1 : -1; // random direction
   
-  result_vector.x = m[0]*n.x + m[4]*n.y + m[8]*n.z;
-  result_vector.y = m[1]*n.x + m[5]*n.y + m[9]*n.z;
-  result_vector.z = m[2]*n.x + m[6]*n.y + m[10]*n.z;
+  double uniform_distributed_between_0_and_1 = uniform_random_number(random_state); // a uniformly distributed number between 0 and 1, never 1
   
-  return result_vector;
+  // random Weibull-distributed number, https://www.taygeta.com/random/weibull.html
+  return 2.0*random_gust_direction*pow((-100.0*log(1-uniform_distributed_between_0_and_1)),0.5); // generate a random Weibull-distributed number with direction (factor of 2 to make the gust stronger)
 }
 
-vector3d rodrigues_rotation (vector3d n, vector3d rotation_axis, double rotation_angle)
-{ // Rotate a vector using Rodrigues's rotation formula
-  n = n*cos(rotation_angle) + (rotation_axis^n)*sin(rotation_angle) + rotation_axis*((rotation_axis*n)*(1-cos(rotation_angle)));
-  return n;
+double weibull_random_number (SimulationContext &sim)
+ // Weibull-distributed gust speed from the generator held in the simulation context
+{
+  return weibull_random_number(sim.random_state);
 }
 
-void draw_future_trajectory (Kepler_solver object_Kepler, float colour_red, float colour_green, float colour_blue, string s)
-  // Draw future trajectory of an orbiting object after solving for Kepler elements
+// Names of the autopilot gains in a gains file, in the order they are written
+static const struct {
+  const char *name;
+  double autopilot_gains_t::*value;
+} autopilot_gain_names[] = {
+  {"kp", &autopilot_gains_t::kp}, {"entry_speed", &autopilot_gains_t::entry_speed}, {"entry_kh", &autopilot_gains_t::entry_kh},
+  {"landing_speed", &autopilot_gains_t::landing_speed}, {"landing_kh", &autopilot_gains_t::landing_kh},
+  {"switch_altitude", &autopilot_gains_t::switch_altitude}, {"vertical_rise", &autopilot_gains_t::vertical_rise},
+  {"ascent_pitch", &autopilot_gains_t::ascent_pitch}
+};
+
+bool load_autopilot_gains (string filename, autopilot_gains_t &gains)
+  // Reads autopilot gains from a text file of "name value" lines, # starting a comment. Gains that are not
+  // mentioned keep their values. Leaves gains untouched and returns false if the file cannot be read.
 {
-  // colour_red/green/blue = RGB colour that will be used to draw the trajectory
-  // s = string that will be used to label the trajectory drawn
-  
-  
-  // VARIABLES EXPLAINED
-  // h = angular momentum vector
-  // h_hat = normalized h
-  // e = eccentricity vector
-  // e_hat = normalized e
-  // h_e = normalized vector that is perpendicular to both h and e
-  // mu = standard grabitational parameter of Mars = GRAVITY*MARS_MASS
-  // energy = specific mechanical energy
-  // a = semi-major axis
-  // p = semi-latus rectum
-  // q = periapsis distance
-  // q_complement = apoapsis distance
-  // m = matrix that transforms a vector from reference plane to orbit plane
-  // polar_r = first polar coordinates parameter
-  // theta = second polar coordinates parameter
-  // point_in_ref_plane = position of a point on the orbit in the reference plane
-  // point_in_orbit_plane = position of a point on the orbit in the orbit plane
-  // i = counting variable
-  // points = number of points to be drawn
-  // display_periapsis = string that says "Periapsis"
-  // display_apoapsis = string that says "Apoapsis"
-  // covert = stream used for coverting from double to string
-  vector3d h_hat, e_hat, h_e;
-  double m[16], theta = 0, polar_r = 0;
-  vector3d point_in_ref_plane, point_in_orbit_plane;
-  int i = 0, points = 50;
-  string display_periapsis = "Periapsis ";
-  string display_apoapsis = "Apoapsis ";
-  ostringstream convert;
-  
-  
-  // CONSTRUCT TRANSFORMATION MATRIX
-  h_hat = object_Kepler.h.norm();
-  e_hat = object_Kepler.e.norm();
-  h_e = (h_hat^e_hat).norm();
-  m[0]=e_hat.x, m[4]=h_e.x, m[8]=h_hat.x, m[12]=0.0;
-  m[1]=e_hat.y, m[5]=h_e.y, m[9]=h_hat.y, m[13]=0.0;
-  m[2]=e_hat.z, m[6]=h_e.z, m[10]=h_hat.z, m[14]=0.0;
-  m[3]=0.0, m[7]=0.0, m[11]=0.0, m[15]=0.0;
-  
-  
-  // INITIALISE SOME GRAPHICS VARIABLES
-  glDisable(GL_LIGHTING); // disable lighting for visibility
-  glColor3f(colour_red, colour_green, colour_blue);
-  glPointSize(2.0);
-  
-  
-  // DRAW ORBIT THAT IS PREDICTED BASED ON CURRENT POSITION AND VELOCITY
-  if (abs(object_Kepler.e.abs()-1.0) > SMALL_NUM) {
-    // either circular, elliptic or hyperbolic BUT NOT parabolic
-    
-    if (object_Kepler.e.abs() <= SMALL_NUM) {
-      // circular orbit
-      
-      // if it's a collision trajectory, draw in red and display warning
-      // else if the trajectory clips the atmosphere, draw in yellow and display warning
-      if (object_Kepler.q <= MARS_RADIUS) {
-        glColor3f(1.0, 0.0, 0.0);
-        s = "ON COLLISION COURSE";
-      }
-      else if (MARS_RADIUS < object_Kepler.q && object_Kepler.q <= MARS_RADIUS+EXOSPHERE) {
-        glColor3f(1.0, 1.0, 0.0);
-        s = "CLIPS ATMOSPHERE";
-      }
-      else {
-      }
-      
-      glBegin(GL_POINTS);
-      for(i=0.0; i<points; i++ ) {
-        theta=(2*M_PI*i)/points;
-        polar_r = object_Kepler.p; // simplified version of conic polar equation to improve speed of program
-        point_in_ref_plane = vector3d(polar_r*cos(theta), polar_r*sin(theta), 0.0);
-        point_in_orbit_plane = matrix_times_vector(m, point_in_ref_plane);
-        glVertex3d(point_in_orbit_plane.x, point_in_orbit_plane.y, point_in_orbit_plane.z);
-      }
-      glEnd();
-    }
-    else if (SMALL_NUM < object_Kepler.e.abs() && object_Kepler.e.abs() < 1) {
-      // elliptical orbit
-      
-      // if it's a collision trajectory, draw in red and display warning
-      // else if the trajectory clips the atmosphere, draw in yellow and display warning
-      if (object_Kepler.q <= MARS_RADIUS) {
-        glColor3f(1.0, 0.0, 0.0);
-        s = "ON COLLISION COURSE";
-      }
-      else if (MARS_RADIUS < object_Kepler.q && object_Kepler.q <= MARS_RADIUS+EXOSPHERE) {
-        glColor3f(1.0, 1.0, 0.0);
-        s = "CLIPS ATMOSPHERE";
-      }
-      else {
-      }
-      
-      glBegin(GL_POINTS);
-      for(i=0.0; i<points; i++ ) {
-        theta=(2*M_PI*i)/points;
-        polar_r = object_Kepler.p/(1+cos(theta)*object_Kepler.e.abs());
-        point_in_ref_plane = vector3d(polar_r*cos(theta), polar_r*sin(theta), 0.0);
-        point_in_orbit_plane = matrix_times_vector(m, point_in_ref_plane);
-        glVertex3d(point_in_orbit_plane.x, point_in_orbit_plane.y, point_in_orbit_plane.z);
-      }
-      glEnd();
-    }
-    else {
-      // hyperbolic escape
-      
-      // if it's a collision trajectory, draw in red and display warning
-      // else if the trajectory clips the atmosphere, draw in yellow and display warning
-      if (object_Kepler.q <= MARS_RADIUS) {
-        glColor3f(1.0, 0.0, 0.0);
-        s = "ON COLLISION COURSE";
-      }
-      else if (MARS_RADIUS < object_Kepler.q && object_Kepler.q <= MARS_RADIUS+EXOSPHERE) {
-        glColor3f(1.0, 1.0, 0.0);
-        s = "CLIPS ATMOSPHERE";
-      }
-      else {
-      }
-      
-      glBegin(GL_POINTS);
-      for(i=0.0; i<points; i++ ) {
-        theta=(1.5*M_PI*i)/points-0.75*M_PI; // draw from -135 to 135 degree only
-        polar_r = object_Kepler.p/(1+cos(theta)*object_Kepler.e.abs());
-        point_in_ref_plane = vector3d(polar_r*cos(theta), polar_r*sin(theta), 0.0);
-        point_in_orbit_plane = matrix_times_vector(m, point_in_ref_plane);
-        glVertex3d(point_in_orbit_plane.x, point_in_orbit_plane.y, point_in_orbit_plane.z);
-      }
-      glEnd();
-    }
-  }
-  else {
-    // parabolic escape
-    
-    // if it's a collision trajectory, draw in red and display warning
-    // else if the trajectory clips the atmosphere, draw in yellow and display warning
-    if (object_Kepler.q <= MARS_RADIUS) {
-      glColor3f(1.0, 0.0, 0.0);
-      s = "ON COLLISION COURSE";
-    }
-    else if (MARS_RADIUS < object_Kepler.q && object_Kepler.q <= MARS_RADIUS+EXOSPHERE) {
-      glColor3f(1.0, 1.0, 0.0);
-      s = "CLIPS ATMOSPHERE";
-    }
-    else {
-    }
-    
-    glBegin(GL_POINTS);
-    for(i=0.0; i<points; i++ ) {
-      theta=(1.5*M_PI*i)/points-0.75*M_PI; // draw from -135 to 135 degree only
-      polar_r = object_Kepler.p/(1+cos(theta)); // simplified version of conic polar equation to improve speed of program
-      point_in_ref_plane = vector3d(polar_r*cos(theta), polar_r*sin(theta), 0.0);
-      point_in_orbit_plane = matrix_times_vector(m, point_in_ref_plane);
-      glVertex3d(point_in_orbit_plane.x, point_in_orbit_plane.y, point_in_orbit_plane.z);
+  ifstream in(filename.c_str());
+  autopilot_gains_t loaded = gains;
+  string line, name;
+  double value;
+  unsigned i;
+
+  if (!in.good()) return false;
+  while (getline(in, line)) {
+    if (line.find('#') != string::npos) line.erase(line.find('#'));
+    if (line.find_first_not_of(" \t\r") == string::npos) continue;
+    istringstream fields(line);
+    if (!(fields >> name >> value)) return false;
+    for (i=0; i<sizeof(autopilot_gain_names)/sizeof(autopilot_gain_names[0]); i++) {
+      if (name == autopilot_gain_names[i].name) break;
     }
-    glEnd();
+    if (i == sizeof(autopilot_gain_names)/sizeof(autopilot_gain_names[0])) return false;
+    loaded.*autopilot_gain_names[i].value = value;
   }
-  
-  
-  // LABEL THE TRAJECTORY DRAWN
-  glDisable(GL_DEPTH_TEST);
-  
-  polar_r = object_Kepler.p/(1+cos(0.5*M_PI)*object_Kepler.e.abs()); // print label at 90 degree to the periapsis
-  point_in_ref_plane = vector3d(polar_r*cos(0.5*M_PI), polar_r*sin(0.5*M_PI), 0.0);
-  point_in_orbit_plane = matrix_times_vector(m, point_in_ref_plane);
-  glut_print_3d(point_in_orbit_plane.x, point_in_orbit_plane.y, point_in_orbit_plane.z, s);
-  
-  polar_r = object_Kepler.p/(1+object_Kepler.e.abs()); // print periapsis distance at periapsis
-  point_in_ref_plane = vector3d(polar_r, 0.0, 0.0);
-  point_in_orbit_plane = matrix_times_vector(m, point_in_ref_plane);
-  convert.precision(1);
-  convert << fixed << object_Kepler.q; // insert the textual representation of double q in the characters in the stream
-  s = convert.str(); // set s to the contents of the stream
-  glut_print_3d(point_in_orbit_plane.x, point_in_orbit_plane.y, point_in_orbit_plane.z, display_periapsis+s); // concatenate "Periapsis " and periapsis distance
-  convert.str(""); // clear ostringstream content
-  
-  if (abs(object_Kepler.e.abs()-1.0) > SMALL_NUM) { // if not parabolic escape
-    if (object_Kepler.e.abs() > 1.0) { // if hyperbolic escape, don't print apoapsis distance
-    }
-    else { // if circular or elliptic orbit, print apoapsis distance at apoapsis
-      polar_r = object_Kepler.p/(1-object_Kepler.e.abs()); // print periapsis distance at periapsis
-      point_in_ref_plane = vector3d(-polar_r, 0.0, 0.0);
-      point_in_orbit_plane = matrix_times_vector(m, point_in_ref_plane);
-      convert.precision(1);
-      convert << fixed << object_Kepler.q_complement; // insert the textual representation of double q_complement in the characters in the stream
-      s = convert.str(); // set s to the contents of the stream
-      glut_print_3d(point_in_orbit_plane.x, point_in_orbit_plane.y, point_in_orbit_plane.z, display_apoapsis+s); // concatenate "Apoapsis " and apoapsis distance
-    }
+  gains = loaded;
+  return true;
+}
+
+void write_autopilot_gains (ostream &out, const autopilot_gains_t &gains)
+  // Writes autopilot gains in the format load_autopilot_gains() reads
+{
+  streamsize precision = out.precision(10);
+  unsigned i;
+
+  for (i=0; i<sizeof(autopilot_gain_names)/sizeof(autopilot_gain_names[0]); i++) {
+    out << autopilot_gain_names[i].name << " " << gains.*autopilot_gain_names[i].value << endl;
   }
-  glEnable(GL_DEPTH_TEST);
-  
-  glEnable(GL_LIGHTING); // enable lighting
+  out.precision(precision);
 }
 
-void draw_future_trajectory_closeup (Kepler_solver object_Kepler, float colour_red, float colour_green, float colour_blue)
-  // Adapt from draw_moon_future_trajectory(...) above
+void microsecond_time (unsigned long long &t)
+  // Returns the time in microseconds from a monotonic clock, which unlike the time of day never jumps
+  // or slews, used for pacing the simulation against the wall clock
 {
-  // colour_red/green/blue = RGB colour that will be used to draw the trajectory
-  
-  
-  // VARIABLES EXPLAINED
-  // h = angular momentum vector
-  // h_hat = normalized h
-  // e = eccentricity vector
-  // e_hat = normalized e
-  // h_e = normalized vector that is perpendicular to both h and e
-  // mu = standard grabitational parameter of Mars = GRAVITY*MARS_MASS
-  // energy = specific mechanical energy
-  // a = semi-major axis
-  // p = semi-latus rectum
-  // m = matrix that transforms a vector from reference plane to orbit plane
-  // polar_r = first polar coordinates parameter
-  // theta = second polar coordinates parameter
-  // point_in_ref_plane = position of a point on the orbit in the reference plane
-  // point_in_orbit_plane = position of a point on the orbit in the orbit plane
-  // i = counting variable
-  // points = number of points to be drawn
-  // relative_point_position = position of a point relative to lander, expressed IN PLANET FRAME
-  vector3d h_hat, e_hat, h_e;
-  double m[16], theta = 0, polar_r = 0;
-  vector3d point_in_ref_plane, point_in_orbit_plane;
-  int i = 0, points = 50;
-  
-  
-  // CONSTRUCT TRANSFORMATION MATRIX
-  h_hat = object_Kepler.h.norm();
-  e_hat = object_Kepler.e.norm();
-  h_e = (h_hat^e_hat).norm();
-  m[0]=e_hat.x, m[4]=h_e.x, m[8]=h_hat.x, m[12]=0.0;
-  m[1]=e_hat.y, m[5]=h_e.y, m[9]=h_hat.y, m[13]=0.0;
-  m[2]=e_hat.z, m[6]=h_e.z, m[10]=h_hat.z, m[14]=0.0;
-  m[3]=0.0, m[7]=0.0, m[11]=0.0, m[15]=0.0;
-  
-  
-  // INITIALISE SOME GRAPHICS VARIABLES
-  glDisable(GL_LIGHTING); // disable lighting for visibility
-  glColor3f(colour_red, colour_green, colour_blue);
-  glPointSize(3.0);
-  
-  
-  // DRAW ORBIT THAT IS PREDICTED BASED ON CURRENT POSITION AND VELOCITY
-  if (abs(object_Kepler.e.abs()-1.0) > SMALL_NUM) {
-    // either circular, elliptic or hyperbolic BUT NOT parabolic
-    
-    if (object_Kepler.e.abs() <= SMALL_NUM) {
-      // circular orbit
-      
-      glBegin(GL_POINTS);
-      for(i=0.0; i<points; i++ ) {
-        theta=(2*M_PI*i)/points;
-        polar_r = object_Kepler.p; // simplified version of conic polar equation to improve speed of program
-        point_in_ref_plane = vector3d(polar_r*cos(theta), polar_r*sin(theta), 0.0);
-        point_in_orbit_plane = matrix_times_vector(m, point_in_ref_plane);
-        glVertex3d(point_in_orbit_plane.x, point_in_orbit_plane.y, point_in_orbit_plane.z);
-      }
-      glEnd();
-    }
-    else if (SMALL_NUM < object_Kepler.e.abs() && object_Kepler.e.abs() < 1) {
-      // elliptical orbit
-      
-      glBegin(GL_POINTS);
-      for(i=0.0; i<points; i++ ) {
-        theta=(2*M_PI*i)/points;
-        polar_r = object_Kepler.p/(1+cos(theta)*object_Kepler.e.abs());
-        point_in_ref_plane = vector3d(polar_r*cos(theta), polar_r*sin(theta), 0.0);
-        point_in_orbit_plane = matrix_times_vector(m, point_in_ref_plane);
-        glVertex3d(point_in_orbit_plane.x, point_in_orbit_plane.y, point_in_orbit_plane.z);
-      }
-      glEnd();
-    }
-    else {
-      // hyperbolic escape
-      
-      glBegin(GL_POINTS);
-      for(i=0.0; i<points; i++ ) {
-        theta=(1.5*M_PI*i)/points-0.75*M_PI; // draw from -135 to 135 degree only
-        polar_r = object_Kepler.p/(1+cos(theta)*object_Kepler.e.abs());
-        point_in_ref_plane = vector3d(polar_r*cos(theta), polar_r*sin(theta), 0.0);
-        point_in_orbit_plane = matrix_times_vector(m, point_in_ref_plane);
-        glVertex3d(point_in_orbit_plane.x, point_in_orbit_plane.y, point_in_orbit_plane.z);
-      }
-      glEnd();
-    }
+  t = (unsigned long long) chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* map_file (string filename, long &size)
+  // The whole file in memory: mapped where there is mmap(), which costs no copy, otherwise read in. Returns
+  // NULL if it cannot be had; an empty file gives a pointer that must still be passed to unmap_file().
+{
+#ifdef WIN32
+  ifstream in(filename.c_str(), ios::binary);
+  char *buffer;
+
+  if (!in.good()) return NULL;
+  in.seekg(0, ios::end);
+  size = in.tellg();
+  in.seekg(0, ios::beg);
+  buffer = (char*) malloc(max(size, 1L));
+  if ((buffer != NULL) && !in.read(buffer, size)) {
+    free(buffer);
+    buffer = NULL;
   }
-  else {
-    // parabolic escape
-    
-    glBegin(GL_POINTS);
-    for(i=0.0; i<points; i++ ) {
-      theta=(1.5*M_PI*i)/points-0.75*M_PI; // draw from -135 to 135 degree only
-      polar_r = object_Kepler.p/(1+cos(theta)); // simplified version of conic polar equation to improve speed of program
-      point_in_ref_plane = vector3d(polar_r*cos(theta), polar_r*sin(theta), 0.0);
-      point_in_orbit_plane = matrix_times_vector(m, point_in_ref_plane);
-      glVertex3d(point_in_orbit_plane.x, point_in_orbit_plane.y, point_in_orbit_plane.z);
-    }
-    glEnd();
+  return buffer;
+#else
+  struct stat status;
+  void *text;
+  int fd = open(filename.c_str(), O_RDONLY);
+
+  if (fd < 0) return NULL;
+  if (fstat(fd, &status) != 0) {
+    close(fd);
+    return NULL;
   }
-  
-  glEnable(GL_LIGHTING); // enable lighting
+  size = status.st_size;
+  text = (size > 0) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : (void*) "";
+  close(fd);
+  return (text == MAP_FAILED) ? NULL : (const char*) text;
+#endif
 }
 
-void draw_pitch_indicator (double cx, double cy, double val, string title, string units)
-  // Draws a single instrument dial, position (cx, cy), value val, title
-  // Adapt from draw_dial(...) function
+void unmap_file (const char *text, long size)
+  // Releases a file had from map_file()
 {
-  int i;
-  double tick_height;
-  ostringstream s;
-  
-  // Draw four edges of the indicator
-  glColor3f(1.0, 1.0, 1.0);
-  glBegin(GL_LINE_LOOP);
-  glVertex2d(cx-OUTER_DIAL_RADIUS*0.75, cy-OUTER_DIAL_RADIUS*1.3); // lower left
-  glVertex2d(cx-OUTER_DIAL_RADIUS*0.75, cy+OUTER_DIAL_RADIUS*1.3); // upper left
-  glVertex2d(cx+OUTER_DIAL_RADIUS*0.75, cy+OUTER_DIAL_RADIUS*1.3); // upper right
-  glVertex2d(cx+OUTER_DIAL_RADIUS*0.75, cy-OUTER_DIAL_RADIUS*1.3); // lower right
-  glEnd();
-  
-  // Draw pitch angle line in green
-  glColor3f(0.0, 1.0, 0.0);
-  glBegin(GL_LINES);
-  glVertex2d(cx-OUTER_DIAL_RADIUS*0.25, cy); // left end
-  glVertex2d(cx+OUTER_DIAL_RADIUS*0.5, cy); // right end
-  glEnd();
-  glColor3f(1.0, 1.0, 1.0);
-  s.precision(1);
-  s.str(""); s << fixed << val;
-  glut_print(cx-OUTER_DIAL_RADIUS*0.6, cy-3, s.str()); // value of pitch angle in white
-  
-  // Draw reference lines
-  for(i=180;i>-180;i-=5) {
-    if (i==0) glColor3f(0.0, 1.0, 1.0);
-    else glColor3f(1.0, 1.0, 1.0);
-    tick_height=i-val; // shift from 0 degree
-    if(tick_height+345.0<=SMALL_NUM) {
-      tick_height+=360.0; // if too low, push to top
-    }
-    if(tick_height-345.0>=SMALL_NUM) {
-      tick_height-=360; // if too high, push to bottom
-    }
-    tick_height=tick_height*4.0; // convert to pixel height
-    if(tick_height>=OUTER_DIAL_RADIUS+8.0 || tick_height<=-OUTER_DIAL_RADIUS-8.0) {
-      // if tick height is out of display, don't draw it
-    }
-    else {
-      glBegin(GL_LINES);
-      glVertex2d(cx-OUTER_DIAL_RADIUS*0.25, cy+tick_height); // left end
-      glVertex2d(cx+OUTER_DIAL_RADIUS*0.25, cy+tick_height); // right end
-      glEnd();
-      s.str(""); s << fixed << i;
-      glColor3f(1.0, 1.0, 1.0);
-      glut_print(cx+OUTER_DIAL_RADIUS*0.3, cy+tick_height-3, s.str()); // value of angle
-    }
-  }
-  
-  // Draw value and title
-  glColor3f(1.0, 1.0, 1.0);
-  glut_print(cx+10-3.2*title.length(), cy-OUTER_DIAL_RADIUS-40, title);
-  s.str(""); s << fixed << val << " " << units;
-  glut_print(cx+10-3.2*s.str().length(), cy-OUTER_DIAL_RADIUS-55, s.str());
+#ifdef WIN32
+  free((void*) text);
+#else
+  if (size > 0) munmap((void*) text, size);
+#endif
 }
 
-void draw_attitude_indicator (double cx, double cy, double val, double val_2, string title, string title_2, string units)
-  // Draws a single instrument dial, position (cx, cy), value val_roll and val_pitch, title
-  // Adapt from draw_dial(...) function
+unsigned long long hash_bytes (const char *text, long size)
+  // FNV-1a, eight bytes at a time - to tell whether a file still matches a cache made from it
 {
-  int i;
-  double tick_height;
-  ostringstream s;
-  s.precision(1);
-  
-  // Draw circumference of the dial
-  glColor3f(1.0, 1.0, 1.0);
-  glBegin(GL_LINE_LOOP);
-  for(i=0;i<360;i=i+8) {
-    glVertex2d(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0), cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0)); // lower left
+  unsigned long long hash = 14695981039346656037ULL, word;
+  long i;
+
+  for (i=0; i+8<=size; i+=8) {
+    memcpy(&word, text+i, 8);
+    hash = (hash ^ word)*1099511628211ULL;
   }
-  glEnd();
+  for (; i<size; i++) hash = (hash ^ (unsigned char) text[i])*1099511628211ULL;
+  return hash;
+}
+
+vector3d matrix_times_vector (double m[], vector3d n)
+{ // Pre-multiply a vector by a matrix
+  vector3d result_vector;
   
-  glBegin(GL_LINE_LOOP);
-  for(i=0;i<360;i=i+8) {
-    glVertex2d(cx-1.6*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0), cy+1.6*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0)); // lower left
-  }
-  glEnd();
+  result_vector.x = m[0]*n.x + m[4]*n.y + m[8]*n.z;
+  result_vector.y = m[1]*n.x + m[5]*n.y + m[9]*n.z;
+  result_vector.z = m[2]*n.x + m[6]*n.y + m[10]*n.z;
   
-  // Draw dial ticks
-  glBegin(GL_LINES);
-  for(i=0;i<360;i=i+30) {
-    if (i==90) glColor3f(0.0, 1.0, 1.0); // if line zero, draw in blue
-    else glColor3f(1.0, 1.0, 1.0);
-    glVertex2d(cx-1.25*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0), cy+1.25*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0));
-    glVertex2d(cx-1.25*INNER_DIAL_RADIUS*cos(i*M_PI/180.0), cy+1.25*INNER_DIAL_RADIUS*sin(i*M_PI/180.0));
+  return result_vector;
+}
+
+matrix3d xyz_euler_to_matrix (vector3d ang)
+  // Constructs a rotation matrix from xyz Euler angles
+{
+  double sin_a, sin_b, sin_g, cos_a, cos_b, cos_g;
+  double ra, rb, rg;
+
+  // Pre-calculate radian angles
+  ra = ang.x*M_PI/(double)180;
+  rb = ang.y*M_PI/(double)180;
+  rg = ang.z*M_PI/(double)180;
+
+  // Pre-calculate sines and cosines
+  cos_a = cos(ra);
+  cos_b = cos(rb);
+  cos_g = cos(rg);
+  sin_a = sin(ra);
+  sin_b = sin(rb);
+  sin_g = sin(rg);
+
+  // Create the correct matrix coefficients
+  return matrix3d(vector3d(cos_a * cos_b, cos_a * sin_b * sin_g - sin_a * cos_g, cos_a * sin_b * cos_g + sin_a * sin_g),
+                  vector3d(sin_a * cos_b, sin_a * sin_b * sin_g + cos_a * cos_g, sin_a * sin_b * cos_g - cos_a * sin_g),
+                  vector3d(- sin_b, cos_b * sin_g, cos_b * cos_g));
+}
+
+quaternion xyz_euler_to_quaternion (vector3d ang)
+  // Unit quaternion for the rotation given by xyz Euler angles, e.g. a scenario's initial attitude
+{
+  matrix3d m = xyz_euler_to_matrix(ang);
+
+  return axes_to_quaternion(m.column_x(), m.column_y(), m.column_z());
+}
+
+quaternion axes_to_quaternion (vector3d out, vector3d left, vector3d up)
+  // Unit quaternion for the rotation taking the world x, y and z axes to the orthonormal axes out, left and up,
+  // by Shepperd's method - always divides by the largest of the four possible square roots, so it is well
+  // conditioned for any attitude
+{
+  double trace = out.x + left.y + up.z, s;
+
+  if (trace > 0.0) {
+    s = 2.0*sqrt(1.0 + trace);
+    return quaternion(0.25*s, (left.z - up.y)/s, (up.x - out.z)/s, (out.y - left.x)/s).norm();
   }
-  glEnd();
-  
-  // Draw dial labels
-  for(i=0;i<360;i=i+30) {
-    glColor3f(1.0, 1.0, 1.0);
-    switch(i) {
-    case 0:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0)-20, cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0)-3, "-90");
-      break;
-    case 30:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0)-18, cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0), "-60");
-      break;
-    case 60:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0)-18, cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0), "-30");
-      break;
-    case 90:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0)-3, cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0)+3, "0");
-      break;
-    case 120:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0), cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0), "30");
-      break;
-    case 150:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0), cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0), "60");
-      break;
-    case 180:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0)+3, cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0)-3, "90");
-      break;
-    case 210:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0)+3, cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0)-5, "120");
-      break;
-    case 240:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0)+3, cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0)-10, "150");
-      break;
-    case 270:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0)-10, cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0)-10, "180");
-      break;
-    case 300:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0)-20, cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0)-10, "-150");
-      break;
-    case 330:
-      glut_print(cx-1.3*OUTER_DIAL_RADIUS*cos(i*M_PI/180.0)-20, cy+1.3*OUTER_DIAL_RADIUS*sin(i*M_PI/180.0)-10, "-120");
-      break;
-    }
+  if ((out.x >= left.y) && (out.x >= up.z)) {
+    s = 2.0*sqrt(1.0 + out.x - left.y - up.z);
+    return quaternion((left.z - up.y)/s, 0.25*s, (left.x + out.y)/s, (up.x + out.z)/s).norm();
   }
-  
-  // Draw lander roll line in green
-  glColor3f(0.0, 1.0, 0.0);
-  glBegin(GL_LINES); // long one
-  glVertex2d(cx-INNER_DIAL_RADIUS*cos(val*M_PI/180.0), cy+INNER_DIAL_RADIUS*sin(val*M_PI/180.0)); // left end
-  glVertex2d(cx+0.75*INNER_DIAL_RADIUS*cos(val*M_PI/180.0), cy-0.75*INNER_DIAL_RADIUS*sin(val*M_PI/180.0)); // right end
-  glEnd();
-  glBegin(GL_LINES); // short one
-  glVertex2d(cx, cy);
-  glVertex2d(cx+0.25*INNER_DIAL_RADIUS*sin(val*M_PI/180.0), cy+0.25*INNER_DIAL_RADIUS*cos(val*M_PI/180.0));
-  glEnd();
-  s.str(""); s << fixed << val_2; // label value of pitch angle
-  glColor3f(1.0, 1.0, 1.0);
-  glut_print(cx+0.8*INNER_DIAL_RADIUS*cos(val*M_PI/180.0), cy-0.75*INNER_DIAL_RADIUS*sin(val*M_PI/180.0)-3, s.str());
-  
-  // Draw reference pitch lines in white
-  for(i=180;i>-180;i-=5) {
-    if (i==0) glColor3f(0.0, 1.0, 1.0); // if line zero, draw in blue
-    else glColor3f(1.0, 1.0, 1.0);
-    tick_height=i-val_2; // shift from 0 degree
-    if(tick_height+340.0<=SMALL_NUM) {
-      tick_height+=360.0; // if too low, push to top
-    }
-    if(tick_height-345.0>=SMALL_NUM) {
-      tick_height-=360.0; // if too high, push to bottom
-    }
-    tick_height=tick_height*4.0; // convert to pixel height
-    if(tick_height>=OUTER_DIAL_RADIUS+8.0 || tick_height<=-OUTER_DIAL_RADIUS-8.0) {
-      // if tick height is out of display, don't draw it
-    }
-    else {
-      glBegin(GL_LINES);
-      glVertex2d(cx-0.25*INNER_DIAL_RADIUS*cos(val*M_PI/180.0)+tick_height*sin(val*M_PI/180.0), cy+0.25*INNER_DIAL_RADIUS*sin(val*M_PI/180.0)+tick_height*cos(val*M_PI/180.0));
-      glVertex2d(cx+0.25*INNER_DIAL_RADIUS*cos(val*M_PI/180.0)+tick_height*sin(val*M_PI/180.0), cy-0.25*INNER_DIAL_RADIUS*sin(val*M_PI/180.0)+tick_height*cos(val*M_PI/180.0));
-      glEnd();
-      s.str(""); s << fixed << i;
-      glColor3f(1.0, 1.0, 1.0);
-      glut_print(cx+0.25*INNER_DIAL_RADIUS*cos(val*M_PI/180.0)+tick_height*sin(val*M_PI/180.0), cy-0.25*INNER_DIAL_RADIUS*sin(val*M_PI/180.0)+tick_height*cos(val*M_PI/180.0)-3, s.str()); // value of angle
-    }
+  if (left.y >= up.z) {
+    s = 2.0*sqrt(1.0 + left.y - out.x - up.z);
+    return quaternion((up.x - out.z)/s, (left.x + out.y)/s, 0.25*s, (up.y + left.z)/s).norm();
   }
-  
-  // Draw value and title
-  glColor3f(1.0, 1.0, 1.0);
-  glut_print(cx-30, cy-OUTER_DIAL_RADIUS-60, title);
-  s.str(""); s << fixed << val << " " << units;
-  glut_print(cx+5, cy-OUTER_DIAL_RADIUS-60, s.str());
-  glut_print(cx-30, cy-OUTER_DIAL_RADIUS-75, title_2);
-  s.str(""); s << fixed << val_2 << " " << units;
-  glut_print(cx+5, cy-OUTER_DIAL_RADIUS-75, s.str());
+  s = 2.0*sqrt(1.0 + up.z - out.x - left.y);
+  return quaternion((out.y - left.x)/s, (up.x + out.z)/s, (up.y + left.z)/s, 0.25*s).norm();
 }
 
-void draw_smaller_indicator_lamp (double tcx, double tcy, string off_text, string on_text, bool on)
-  // Draws smaller indicator lamp, top centre (tcx, tcy), appropriate text and background colour depending on on/off
+quaternion rotation_vector_to_quaternion (vector3d r)
+  // Unit quaternion for a rotation by r.abs() radians about r
 {
-  if (on) glColor3f(0.5, 0.0, 0.0);
-  else glColor3f(0.0, 0.5, 0.0);
-  glBegin(GL_QUADS);
-  glVertex2d(tcx-59.5, tcy-19.5);
-  glVertex2d(tcx+59.5, tcy-19.5);
-  glVertex2d(tcx+59.5, tcy-0.5);
-  glVertex2d(tcx-59.5, tcy-0.5);
-  glEnd();
-  glColor3f(1.0, 1.0, 1.0);
-  glBegin(GL_LINE_LOOP);
-  glVertex2d(tcx-60.0, tcy-20.0);
-  glVertex2d(tcx+60.0, tcy-20.0);
-  glVertex2d(tcx+60.0, tcy);
-  glVertex2d(tcx-60.0, tcy);
-  glEnd();
-  if (on) glut_print(tcx-55.0, tcy-14.0, on_text);
-  else glut_print(tcx-55.0, tcy-14.0, off_text);
+  double angle = r.abs(), k;
+
+  if (angle < 1.0e-4) k = 0.5 - angle*angle/48.0; // sin(angle/2)/angle, without dividing by a tiny angle
+  else k = sin(0.5*angle)/angle;
+  return quaternion(cos(0.5*angle), k*r.x, k*r.y, k*r.z);
 }
 
-void draw_input_altitude_lamp (double tcx, double tcy, double val, string title, string units, bool on)
-  // Draws smaller indicator lamp, top centre (tcx, tcy), appropriate text and background colour (blue, grey) depending on on/off
+void quaternion_to_matrix (quaternion q, double m[])
+  // Constructs a 4x4 OpenGL rotation matrix from a unit quaternion - its columns are the rotated axes
 {
-  ostringstream s;
-  s.precision(0);
-  
-  if (on) glColor3f(0.0, 0.0, 0.5);
-  else glColor3f(0.5, 0.5, 0.5);
-  glBegin(GL_QUADS);
-  glVertex2d(tcx-59.5, tcy-19.5);
-  glVertex2d(tcx+59.5, tcy-19.5);
-  glVertex2d(tcx+59.5, tcy-0.5);
-  glVertex2d(tcx-59.5, tcy-0.5);
-  glEnd();
-  glColor3f(1.0, 1.0, 1.0);
-  glBegin(GL_LINE_LOOP);
-  glVertex2d(tcx-60.0, tcy-20.0);
-  glVertex2d(tcx+60.0, tcy-20.0);
-  glVertex2d(tcx+60.0, tcy);
-  glVertex2d(tcx-60.0, tcy);
-  glEnd();
-  
-  glut_print(tcx-60.0, tcy+10.0, title);
-  s.str(""); s << fixed << val << " " << units;
-  glut_print(tcx+59.5-6.2*s.str().length(), tcy-14.0, s.str());
+  matrix3d::columns(q.x_axis(), q.y_axis(), q.z_axis()).to_opengl(m);
 }
 
-void draw_lander_phase_lamp (double tcx, double tcy, string text, string title, bool on)
-  // Draws smaller indicator lamp, top centre (tcx, tcy), appropriate text and background colour depending on on/off
+double atmospheric_density (vector3d pos)
+  // Density from the atmosphere profile in use between surface and exosphere (around 200km) - by default the simple
+  // exponential model, surface density approximately 0.017 kg/m^3 and scale height approximately 11km, see atmosphere.h
 {
-  if (on) glColor3f(0.0, 0.0, 0.5);
-  else glColor3f(0.5, 0.5, 0.5);
-  glBegin(GL_QUADS);
-  glVertex2d(tcx-59.5, tcy-19.5);
-  glVertex2d(tcx+59.5, tcy-19.5);
-  glVertex2d(tcx+59.5, tcy-0.5);
-  glVertex2d(tcx-59.5, tcy-0.5);
-  glEnd();
-  glColor3f(1.0, 1.0, 1.0);
-  glBegin(GL_LINE_LOOP);
-  glVertex2d(tcx-60.0, tcy-20.0);
-  glVertex2d(tcx+60.0, tcy-20.0);
-  glVertex2d(tcx+60.0, tcy);
-  glVertex2d(tcx-60.0, tcy);
-  glEnd();
-  
-  glut_print(tcx-60.0, tcy+10.0, title);
-  glut_print(tcx+59.5-5.6*text.length(), tcy-14.0, text);
+  return mars_atmosphere.density(pos.abs()-MARS_RADIUS);
 }
-
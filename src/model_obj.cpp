@@ -15,16 +15,267 @@
 // Adapt from the obj loader on http://openglsamples.sourceforge.net/
 // to take in UV data.
 
+#include <cstring>
+#include <functional>
+#include <sys/stat.h>
+
 #include "model_obj.h"
 
+#ifdef WIN32
+// opengl32.dll stops at OpenGL 1.1, so the buffer object functions (OpenGL 1.5) are looked up in the driver
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STATIC_DRAW 0x88E4
+#endif
+typedef void (APIENTRY *gl_gen_buffers_t) (GLsizei n, GLuint *buffers);
+typedef void (APIENTRY *gl_bind_buffer_t) (GLenum target, GLuint buffer);
+typedef void (APIENTRY *gl_buffer_data_t) (GLenum target, ptrdiff_t size, const void *data, GLenum usage);
+typedef void (APIENTRY *gl_delete_buffers_t) (GLsizei n, const GLuint *buffers);
+static gl_gen_buffers_t gl_gen_buffers = NULL;
+static gl_bind_buffer_t gl_bind_buffer = NULL;
+static gl_buffer_data_t gl_buffer_data = NULL;
+static gl_delete_buffers_t gl_delete_buffers = NULL;
+#define glGenBuffers gl_gen_buffers
+#define glBindBuffer gl_bind_buffer
+#define glBufferData gl_buffer_data
+#define glDeleteBuffers gl_delete_buffers
+#endif
+
+#define FLOATS_PER_VERTEX 8 // u, v, normal, position - see Vertex_Data
+
+static bool buffer_objects_available (void)
+  // Whether the current GL context has buffer objects, which are core from OpenGL 1.5
+{
+  const char *version = (const char *) glGetString(GL_VERSION);
+  int major = 0, minor = 0;
+
+  if ((version == NULL) || (sscanf(version, "%d.%d", &major, &minor) != 2)) return false;
+  if ((major < 1) || ((major == 1) && (minor < 5))) return false;
+#ifdef WIN32
+  gl_gen_buffers = (gl_gen_buffers_t) wglGetProcAddress("glGenBuffers");
+  gl_bind_buffer = (gl_bind_buffer_t) wglGetProcAddress("glBindBuffer");
+  gl_buffer_data = (gl_buffer_data_t) wglGetProcAddress("glBufferData");
+  gl_delete_buffers = (gl_delete_buffers_t) wglGetProcAddress("glDeleteBuffers");
+  if (!gl_gen_buffers || !gl_bind_buffer || !gl_buffer_data || !gl_delete_buffers) return false;
+#endif
+  return true;
+}
+
+// The obj file is parsed straight from memory in two passes over chunks of whole lines, one thread per chunk: the
+// first counts each chunk's vertices, texels, normals and triangles, so that every array can be allocated at its
+// exact size and every chunk knows where its elements go, and the second fills them in.
+
+#define OBJ_CHUNK_SIZE (1 << 20) // (bytes) smallest chunk worth a thread of its own
+
+// One chunk of the file, with its element counts and, once the counts are summed, the slots its elements go in
+struct obj_chunk_t {
+  const char *begin, *end;
+  long vertices, texels, normals, triangles;
+  long first_vertex, first_texel, first_normal, first_triangle;
+};
+
+// Everything in the file, in file order. Corners are {vertex, texel, normal} numbers counting from 0, -1 if the
+// face does not give one; a triangle whose vertex is -1 referred to something that is not in the file.
+struct obj_data_t {
+  float *vertices, *texels, *normals; // 3, 2 and 3 floats each
+  int *corners; // 9 per triangle
+  long n_vertices, n_texels, n_normals, n_triangles;
+};
+
+static const char* skip_spaces (const char *p, const char *end)
+{
+  while ((p < end) && ((*p == ' ') || (*p == '\t'))) p++;
+  return p;
+}
+
+static const char* parse_int (const char *p, const char *end, int &value)
+  // Reads an optionally signed whole number, returning where it stopped, or NULL if there are no digits
+{
+  bool negative = false;
+  const char *digits;
+
+  if ((p < end) && ((*p == '-') || (*p == '+'))) negative = (*p++ == '-');
+  value = 0;
+  for (digits = p; (p < end) && (*p >= '0') && (*p <= '9'); p++) value = 10*value + (*p - '0');
+  if (p == digits) return NULL;
+  if (negative) value = -value;
+  return p;
+}
+
+static const char* parse_float (const char *p, const char *end, float &value)
+  // Reads a number such as -1.25e-3, without allocating or consulting the locale as strtod() does. The digits
+  // are gathered in a double, exactly for up to 15 of them, and scaled by an exact power of ten. Returns where
+  // it stopped, or NULL if there are no digits.
+{
+  static const double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  double mantissa = 0.0;
+  int exponent = 0, e;
+  bool negative = false, any_digits = false;
+  const char *q;
+
+  p = skip_spaces(p, end);
+  if ((p < end) && ((*p == '-') || (*p == '+'))) negative = (*p++ == '-');
+  for (; (p < end) && (*p >= '0') && (*p <= '9'); p++, any_digits = true) mantissa = 10.0*mantissa + (*p - '0');
+  if ((p < end) && (*p == '.')) {
+    for (p++; (p < end) && (*p >= '0') && (*p <= '9'); p++, any_digits = true) {
+      mantissa = 10.0*mantissa + (*p - '0');
+      exponent--;
+    }
+  }
+  if (!any_digits) return NULL;
+  if ((p < end) && ((*p == 'e') || (*p == 'E')) && ((q = parse_int(p+1, end, e)) != NULL)) {
+    exponent += max(min(e, 400), -400);
+    p = q;
+  }
+  if (exponent < -22) value = (float) (mantissa*pow(10.0, exponent));
+  else if (exponent < 0) value = (float) (mantissa/powers_of_ten[-exponent]);
+  else if (exponent <= 22) value = (float) (mantissa*powers_of_ten[exponent]);
+  else value = (float) (mantissa*pow(10.0, exponent));
+  if (negative) value = -value;
+  return p;
+}
+
+static int obj_number (int number, long count)
+  // An obj index (from 1, or if negative counting back from the last element defined) as a number from 0, or -1
+{
+  if (number > 0) return (number <= count) ? number - 1 : -1;
+  if (number < 0) return (count + number >= 0) ? (int) (count + number) : -1;
+  return -1;
+}
+
+static void parse_chunk (obj_chunk_t &chunk, obj_data_t *data)
+  // With data NULL counts the chunk's elements, otherwise stores them in data at the chunk's slots. Handles
+  // v, vt, vn and f lines, faces with any number of corners (as a fan of triangles) in any of the forms
+  // v, v/vt, v//vn and v/vt/vn, and negative indices; anything else is skipped.
+{
+  const char *p = chunk.begin, *line_end, *q;
+  long vertices = 0, texels = 0, normals = 0, triangles = 0, n_corners;
+  int corner[3], first[3], previous[3], *triangle, v, t, n, i;
+  float *f;
+
+  for (; p < chunk.end; p = line_end + 1) {
+    line_end = (const char *) memchr(p, '\n', chunk.end - p);
+    if (line_end == NULL) line_end = chunk.end;
+
+    if ((line_end - p >= 2) && (p[0] == 'v') && ((p[1] == ' ') || (p[1] == '\t'))) { // vertex coordinates
+      if (data) {
+        f = data->vertices + 3*(chunk.first_vertex + vertices);
+        for (i=0, q=p+2; i<3; i++) if ((q == NULL) || ((q = parse_float(q, line_end, f[i])) == NULL)) f[i] = 0.0;
+      }
+      vertices++;
+    }
+    else if ((line_end - p >= 3) && (p[0] == 'v') && (p[1] == 't') && ((p[2] == ' ') || (p[2] == '\t'))) { // texture coordinates
+      if (data) {
+        f = data->texels + 2*(chunk.first_texel + texels);
+        for (i=0, q=p+3; i<2; i++) if ((q == NULL) || ((q = parse_float(q, line_end, f[i])) == NULL)) f[i] = 0.0;
+      }
+      texels++;
+    }
+    else if ((line_end - p >= 3) && (p[0] == 'v') && (p[1] == 'n') && ((p[2] == ' ') || (p[2] == '\t'))) { // normal
+      if (data) {
+        f = data->normals + 3*(chunk.first_normal + normals);
+        for (i=0, q=p+3; i<3; i++) if ((q == NULL) || ((q = parse_float(q, line_end, f[i])) == NULL)) f[i] = 0.0;
+      }
+      normals++;
+    }
+    else if ((line_end - p >= 2) && (p[0] == 'f') && ((p[1] == ' ') || (p[1] == '\t'))) { // face
+      q = p + 1;
+      for (n_corners = 0; ; n_corners++) {
+        q = skip_spaces(q, line_end);
+        if ((q = parse_int(q, line_end, v)) == NULL) break;
+        t = n = 0;
+        if ((q < line_end) && (*q == '/')) {
+          if ((q+1 < line_end) && (q[1] != '/')) q = parse_int(q+1, line_end, t);
+          else q++;
+          if ((q != NULL) && (q < line_end) && (*q == '/')) q = parse_int(q+1, line_end, n);
+          if (q == NULL) break;
+        }
+        if (data) {
+          corner[0] = obj_number(v, chunk.first_vertex + vertices);
+          corner[1] = obj_number(t, chunk.first_texel + texels);
+          corner[2] = obj_number(n, chunk.first_normal + normals);
+          if (n_corners == 0) copy(corner, corner+3, first);
+          else if (n_corners >= 2) {
+            triangle = data->corners + 9*(chunk.first_triangle + triangles + n_corners - 2);
+            copy(first, first+3, triangle);
+            copy(previous, previous+3, triangle+3);
+            copy(corner, corner+3, triangle+6);
+            if ((first[0] < 0) || (previous[0] < 0) || (corner[0] < 0)) triangle[0] = -1;
+          }
+          copy(corner, corner+3, previous);
+        }
+      }
+      if (n_corners >= 3) triangles += n_corners - 2;
+    }
+  }
+
+  if (!data) {
+    chunk.vertices = vertices;
+    chunk.texels = texels;
+    chunk.normals = normals;
+    chunk.triangles = triangles;
+  }
+}
+
+static void parse_obj (const char *text, long size, obj_data_t &data)
+  // Both passes over the file text, on as many threads as there are chunks
+{
+  vector<obj_chunk_t> chunks;
+  vector<thread> threads;
+  obj_chunk_t chunk;
+  unsigned n_chunks, i;
+  const char *p = text, *next;
+
+  n_chunks = thread::hardware_concurrency();
+  n_chunks = (unsigned) max(1L, min((long) max(n_chunks, 1U), size/OBJ_CHUNK_SIZE));
+  for (i=0; (i<n_chunks) && (p < text + size); i++) { // equal shares of the file, each moved on to just after a newline
+    if (i+1 == n_chunks) next = text + size;
+    else {
+      next = (const char *) memchr(max(p, text + (size*(i+1))/n_chunks), '\n', text + size - max(p, text + (size*(i+1))/n_chunks));
+      next = (next == NULL) ? text + size : next + 1;
+    }
+    chunk.begin = p;
+    chunk.end = next;
+    chunks.push_back(chunk);
+    p = next;
+  }
+
+  for (i=1; i<chunks.size(); i++) threads.push_back(thread(parse_chunk, ref(chunks[i]), (obj_data_t *) NULL));
+  if (!chunks.empty()) parse_chunk(chunks[0], NULL);
+  for (i=0; i<threads.size(); i++) threads[i].join();
+  threads.clear();
+
+  data.n_vertices = data.n_texels = data.n_normals = data.n_triangles = 0;
+  for (i=0; i<chunks.size(); i++) {
+    chunks[i].first_vertex = data.n_vertices; data.n_vertices += chunks[i].vertices;
+    chunks[i].first_texel = data.n_texels; data.n_texels += chunks[i].texels;
+    chunks[i].first_normal = data.n_normals; data.n_normals += chunks[i].normals;
+    chunks[i].first_triangle = data.n_triangles; data.n_triangles += chunks[i].triangles;
+  }
+  data.vertices = (float*) malloc(max(3*data.n_vertices, 1L)*sizeof(float));
+  data.texels = (float*) malloc(max(2*data.n_texels, 1L)*sizeof(float));
+  data.normals = (float*) malloc(max(3*data.n_normals, 1L)*sizeof(float));
+  data.corners = (int*) malloc(max(9*data.n_triangles, 1L)*sizeof(int));
+  if ((data.vertices == NULL) || (data.texels == NULL) || (data.normals == NULL) || (data.corners == NULL)) return;
+
+  for (i=1; i<chunks.size(); i++) threads.push_back(thread(parse_chunk, ref(chunks[i]), &data));
+  if (!chunks.empty()) parse_chunk(chunks[0], &data);
+  for (i=0; i<threads.size(); i++) threads[i].join();
+}
+
 // Model_obj class's member functions
 
 // constructor
 Model_obj::Model_obj()
 {
-  TotalConnectedPoints = 0;
-  TotalConnectedTriangles = 0;
-  TotalConnectedTexels = 0;
+  Vertex_Data = NULL;
+  Indices = NULL;
+  TotalVertices = 0;
+  TotalIndices = 0;
+  Cache_Text = NULL;
+  Cache_Size = 0;
 }
 
 // calculate normal of a plane given three points on that plane
@@ -36,153 +287,250 @@ vector3d Model_obj::calculateNormal(vector3d coord1, vector3d coord2, vector3d c
 // load obj file and store its data
 bool Model_obj::Load(string filename, float zoom_number)
 {
-  int POINTS_PER_VERTEX = 3;
-  int POINTS_PER_TEXEL = 2;
-  int TOTAL_FLOATS_IN_TRIANGLE = 9;
-  
-	string line;
-	ifstream objFile(filename.c_str());
-	if (objFile.good())
-	{
-		objFile.seekg(0, ios::end); // go to end of the file,
-		long fileSize = objFile.tellg(); // get file size
-		objFile.seekg(0, ios::beg); // go back to the beginning of file
-    
-		vertexBuffer = (float*) malloc (fileSize); // allocate memory for the vertice buffer
-    texelBuffer = (float*) malloc (fileSize); // allocate memory for the texel buffer
-    
-		Face_Vertices = (float*) malloc(fileSize*sizeof(float)); // allocate memory for the triangles
-		Normals  = (float*) malloc(fileSize*sizeof(float)); // allocate memory for the normals
-    UVs = (float*) malloc(fileSize*sizeof(float)); // allocate memory for the texels
-    
-		int triangle_index = 0;
-		int normal_index = 0;
-    int texel_index = 0;
-    
-		while (!objFile.eof())
-		{		
-      getline (objFile,line);
-      
-			if (line.c_str()[0] == 'v' && line.c_str()[1] == ' ') // first two charactes are 'v ' : a vertex coordinate is stored on this line
-			{
-				line[0] = ' '; // set first character to 0, this will allow us to use sscanf and prevent further search from stopping at this line
- 
-				sscanf(line.c_str(),"%f %f %f", &vertexBuffer[TotalConnectedPoints], &vertexBuffer[TotalConnectedPoints+1], &vertexBuffer[TotalConnectedPoints+2]); // read floats from the line: v vertex.x vertex.y vertex.z
-        
-        // scale to correct length
-        vertexBuffer[TotalConnectedPoints] *= (MARS_RADIUS/zoom_number);
-				vertexBuffer[TotalConnectedPoints + 1] *= (MARS_RADIUS/zoom_number);
-				vertexBuffer[TotalConnectedPoints + 2] *= (MARS_RADIUS/zoom_number);
- 
-				TotalConnectedPoints += POINTS_PER_VERTEX; // add 3 to the total number of elements of vertexBuffer
-			}
-      
-      if (line.c_str()[1] == 't') // first two characters are 'vt' : a texture coordinate is stored on this line
-			{
-				line[0] = ' '; // set first character to 0, this will allow us to use sscanf and prevent further search from stopping at this line
-        line[1] = ' '; // set second character to 0, this will allow us to use sscanf and prevent further search from stopping at this line
- 
-				sscanf(line.c_str(),"%f %f", &texelBuffer[TotalConnectedTexels], &texelBuffer[TotalConnectedTexels+1]); // read floats from the line: vt UV.u UV.v
- 
-				TotalConnectedTexels += POINTS_PER_TEXEL; // add 2 to the total number of elements of texelBuffer
-			}
-      
-			if (line.c_str()[0] == 'f') // first character is an 'f': this line stores (vertex_1/UV_1) (vertex_2/UV_2) (vertex_3/UV_3) that define a triangle
-			{
-        line[0] = ' '; // set first character to 0, this will allow us to use sscanf and prevent further search from stopping at this line
-        
-				int vertexNumber[4] = {0, 0, 0};
-        int texelNumber[4] = {0, 0, 0};
-        
-        sscanf(line.c_str(),"%d/%d %d/%d %d/%d", &vertexNumber[0], &texelNumber[0], &vertexNumber[1], &texelNumber[1], &vertexNumber[2], &texelNumber[2]);
-        // read integers from the line:  f  (vertex_1/UV_1)  (vertex_2/UV_2)  (vertex_3/UV_3)
-        
-				vertexNumber[0] -= 1; // obj file starts counting from 1
-				vertexNumber[1] -= 1; // obj file starts counting from 1
-				vertexNumber[2] -= 1; // obj file starts counting from 1
-        
-        texelNumber[0] -= 1; // obj file starts counting from 1
-				texelNumber[1] -= 1; // obj file starts counting from 1
-				texelNumber[2] -= 1; // obj file starts counting from 1
-        
-        // feed vertex coordinate data of the triangle to Face_Vertices 
-				int tCounter = 0;
-				for (int i = 0; i < POINTS_PER_VERTEX; i++)					
-				{
-					Face_Vertices[triangle_index+tCounter] = vertexBuffer[3*vertexNumber[i]];
-					Face_Vertices[triangle_index+tCounter+1] = vertexBuffer[3*vertexNumber[i]+1];
-					Face_Vertices[triangle_index+tCounter+2] = vertexBuffer[3*vertexNumber[i]+2];
-					tCounter += POINTS_PER_VERTEX;
-				}
-        
-        // calculate the normal vector of this triangle
-				vector3d coord1 = vector3d(Face_Vertices[triangle_index], Face_Vertices[triangle_index+1], Face_Vertices[triangle_index+2]);
-				vector3d coord2 = vector3d(Face_Vertices[triangle_index+3], Face_Vertices[triangle_index+4], Face_Vertices[triangle_index+5]);
-				vector3d coord3 = vector3d(Face_Vertices[triangle_index+6], Face_Vertices[triangle_index+7], Face_Vertices[triangle_index+8]);
-				vector3d norm = calculateNormal(coord1, coord2, coord3);
-        
-        // feed this normal data to Normals
-				tCounter = 0;
-				for (int i = 0; i < POINTS_PER_VERTEX; i++)
-				{
-					Normals[normal_index+tCounter] = norm.x;
-					Normals[normal_index+tCounter+1] = norm.y;
-					Normals[normal_index+tCounter+2] = norm.z;
-					tCounter += POINTS_PER_VERTEX;
-				}
-        
-        // feed UV data of this triangle to UVs
-        tCounter = 0;
-				for (int i = 0; i < POINTS_PER_VERTEX; i++)
-				{
-					UVs[texel_index+tCounter] = 1.0-texelBuffer[2*texelNumber[i]]; // somehow texture image is inverted, so need '1.0-' here
-					UVs[texel_index+tCounter+1] = 1.0-texelBuffer[2*texelNumber[i]+1]; // somehow texture image is inverted, so need '1.0-' here
-					tCounter += POINTS_PER_TEXEL;
-				}
-        
-        // increment indices of arrays
-				triangle_index += TOTAL_FLOATS_IN_TRIANGLE;
-				normal_index += TOTAL_FLOATS_IN_TRIANGLE;
-        texel_index += 6;
-				TotalConnectedTriangles += TOTAL_FLOATS_IN_TRIANGLE;
-			}
-		}
-		
-    objFile.close(); // close OBJ file
-	}
-	else 
-	{
-		cout << "Error while opening file";
-    return false;								
-	}
-	return true;
+  obj_data_t data;
+  struct stat file_status;
+  const char *text;
+  unsigned long long hash;
+  long size, i, j, k, n_corners;
+  int *corner, *first_vertex = NULL, *next_vertex = NULL, *vertex_texel = NULL, *vertex_normal = NULL;
+  vector3d coord[3], norm;
+  GLuint index[3], *shrunk;
+  float *f;
+  bool ok;
+
+  // Straight from the mesh cache if it is up to date, otherwise parse the obj file and write the cache
+  if (stat(filename.c_str(), &file_status) != 0) {
+    cout << "Error while opening file";
+    return false;
+  }
+  Release();
+  if (LoadCache(filename, file_status.st_size, file_status.st_mtime, zoom_number)) return true;
+  if ((text = map_file(filename, size)) == NULL) {
+    cout << "Error while opening file";
+    return false;
+  }
+  parse_obj(text, size, data);
+  hash = hash_bytes(text, size);
+  unmap_file(text, size);
+
+  // Each distinct {vertex, texel, normal} corner is stored once. The vertices sharing a position are chained
+  // from first_vertex through next_vertex, and those chains are short, so a corner is matched in a step or two.
+  n_corners = 3*data.n_triangles;
+  ok = (data.vertices != NULL) && (data.texels != NULL) && (data.normals != NULL) && (data.corners != NULL);
+  if (ok) {
+    first_vertex = (int*) malloc(max(data.n_vertices, 1L)*sizeof(int));
+    next_vertex = (int*) malloc(max(n_corners, 1L)*sizeof(int));
+    vertex_texel = (int*) malloc(max(n_corners, 1L)*sizeof(int));
+    vertex_normal = (int*) malloc(max(n_corners, 1L)*sizeof(int));
+    Vertex_Data = (float*) malloc(max(n_corners, 1L)*FLOATS_PER_VERTEX*sizeof(float));
+    Indices = (GLuint*) malloc(max(n_corners, 1L)*sizeof(GLuint));
+    ok = (first_vertex != NULL) && (next_vertex != NULL) && (vertex_texel != NULL) && (vertex_normal != NULL) && (Vertex_Data != NULL) && (Indices != NULL);
+  }
+  if (ok) {
+    for (i=0; i<data.n_vertices; i++) first_vertex[i] = -1;
+    for (i=0; i<data.n_triangles; i++) {
+      corner = data.corners + 9*i;
+      if (corner[0] < 0) continue; // refers to a vertex that is not there
+      for (j=0; j<3; j++, corner+=3) {
+        for (k=first_vertex[corner[0]]; k>=0; k=next_vertex[k]) if ((vertex_texel[k] == corner[1]) && (vertex_normal[k] == corner[2])) break;
+        if (k < 0) { // a new vertex
+          k = TotalVertices++;
+          next_vertex[k] = first_vertex[corner[0]];
+          first_vertex[corner[0]] = k;
+          vertex_texel[k] = corner[1];
+          vertex_normal[k] = corner[2];
+          f = Vertex_Data + FLOATS_PER_VERTEX*k;
+          if (corner[1] >= 0) {
+            f[0] = 1.0-data.texels[2*corner[1]]; // somehow texture image is inverted, so need '1.0-' here
+            f[1] = 1.0-data.texels[2*corner[1]+1];
+          }
+          else f[0] = f[1] = 0.0;
+          if (corner[2] >= 0) norm = vector3d(data.normals[3*corner[2]], data.normals[3*corner[2]+1], data.normals[3*corner[2]+2]).norm();
+          else norm = vector3d(0.0, 0.0, 0.0); // summed from the faces below
+          f[2] = norm.x; f[3] = norm.y; f[4] = norm.z;
+          f[5] = data.vertices[3*corner[0]]*(MARS_RADIUS/zoom_number); // scale to correct length
+          f[6] = data.vertices[3*corner[0]+1]*(MARS_RADIUS/zoom_number);
+          f[7] = data.vertices[3*corner[0]+2]*(MARS_RADIUS/zoom_number);
+        }
+        index[j] = (GLuint) k;
+        Indices[TotalIndices++] = index[j];
+        f = Vertex_Data + FLOATS_PER_VERTEX*k;
+        coord[j] = vector3d(f[5], f[6], f[7]);
+      }
+
+      // add the normal vector of this triangle to each of its vertices that has no normal in the file
+      norm = calculateNormal(coord[0], coord[1], coord[2]);
+      for (j=0; j<3; j++) if (vertex_normal[index[j]] < 0) {
+        f = Vertex_Data + FLOATS_PER_VERTEX*index[j];
+        f[2] += norm.x; f[3] += norm.y; f[4] += norm.z;
+      }
+    }
+
+    // those vertices' normals are the average direction of the faces around them
+    for (k=0; k<TotalVertices; k++) if (vertex_normal[k] < 0) {
+      f = Vertex_Data + FLOATS_PER_VERTEX*k;
+      norm = vector3d(f[2], f[3], f[4]).norm();
+      f[2] = norm.x; f[3] = norm.y; f[4] = norm.z;
+    }
+
+    // hand back what the shared vertices and any skipped triangles did not use
+    f = (float*) realloc(Vertex_Data, max(TotalVertices, 1L)*FLOATS_PER_VERTEX*sizeof(float));
+    if (f != NULL) Vertex_Data = f;
+    shrunk = (GLuint*) realloc(Indices, max(TotalIndices, 1L)*sizeof(GLuint));
+    if (shrunk != NULL) Indices = shrunk;
+  }
+
+  free(first_vertex);
+  free(next_vertex);
+  free(vertex_texel);
+  free(vertex_normal);
+  free(data.vertices);
+  free(data.texels);
+  free(data.normals);
+  free(data.corners);
+  if (ok) SaveCache(filename, file_status.st_size, file_status.st_mtime, hash, zoom_number);
+  else Release();
+	return ok;
 }
 
-// 'destructor'
+// the mesh from filename's cache, if the cache was made from the file as it is now with the same zoom_number
+bool Model_obj::LoadCache(string filename, long long source_size, long long source_time, float zoom_number)
+{
+  mesh_cache_header_t header;
+  const char *source;
+  long size;
+  bool up_to_date;
+
+  if ((Cache_Text = map_file(filename + MESH_CACHE_SUFFIX, Cache_Size)) == NULL) return false;
+  if (Cache_Size < (long) sizeof(header)) {
+    Release();
+    return false;
+  }
+  memcpy(&header, Cache_Text, sizeof(header));
+  if (memcmp(header.magic, "MLMC", 4) || (header.version != MESH_CACHE_VERSION) || (header.zoom_number != zoom_number)
+      || (header.source_size != source_size) || (header.vertices < 0) || (header.indices < 0)
+      || ((double) Cache_Size != sizeof(header) + (double) header.vertices*FLOATS_PER_VERTEX*sizeof(float) + (double) header.indices*sizeof(GLuint))) {
+    Release();
+    return false;
+  }
+
+  // A changed modification time alone (the file copied, say) costs a hash of the file, not a parse
+  up_to_date = (header.source_time == source_time);
+  if (!up_to_date && ((source = map_file(filename, size)) != NULL)) {
+    up_to_date = (hash_bytes(source, size) == header.source_hash);
+    unmap_file(source, size);
+    if (up_to_date) {
+      header.source_time = source_time;
+      fstream out((filename + MESH_CACHE_SUFFIX).c_str(), ios::binary | ios::in | ios::out);
+      out.write((const char*) &header, sizeof(header));
+    }
+  }
+  if (!up_to_date) {
+    Release();
+    return false;
+  }
+
+  Vertex_Data = (float*) (Cache_Text + sizeof(header));
+  Indices = (GLuint*) (Cache_Text + sizeof(header) + header.vertices*FLOATS_PER_VERTEX*sizeof(float));
+  TotalVertices = header.vertices;
+  TotalIndices = header.indices;
+  return true;
+}
+
+// write the mesh to filename's cache, by way of a temporary file so that no other run sees half a cache
+void Model_obj::SaveCache(string filename, long long source_size, long long source_time, unsigned long long hash, float zoom_number)
+{
+  mesh_cache_header_t header;
+  string cache_filename = filename + MESH_CACHE_SUFFIX, temporary_filename = cache_filename + ".tmp";
+  ofstream out(temporary_filename.c_str(), ios::binary | ios::trunc);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "MLMC", 4);
+  header.version = MESH_CACHE_VERSION;
+  header.source_size = source_size;
+  header.source_time = source_time;
+  header.source_hash = hash;
+  header.zoom_number = zoom_number;
+  header.vertices = TotalVertices;
+  header.indices = TotalIndices;
+  out.write((const char*) &header, sizeof(header));
+  out.write((const char*) Vertex_Data, TotalVertices*FLOATS_PER_VERTEX*sizeof(float));
+  out.write((const char*) Indices, TotalIndices*sizeof(GLuint));
+  out.close();
+  if (!out.good()) remove(temporary_filename.c_str()); // e.g. a read-only directory - just parse again next time
+  else {
+    remove(cache_filename.c_str()); // rename() will not replace a file on Windows
+    rename(temporary_filename.c_str(), cache_filename.c_str());
+  }
+}
+
+// 'destructor' - buffer objects in GL contexts other than the current one go when their windows do
 void Model_obj::Release()
 {
-  free(this->Face_Vertices);
-  free(this->Normals);
-  free(this->UVs);
-  free(this->vertexBuffer);
-  free(this->texelBuffer);
+  unsigned i;
+
+  for (i=0; i<Buffers.size(); i++) if ((Buffers[i].vertex_buffer != 0) && (Buffers[i].window == glutGetWindow())) {
+    glDeleteBuffers(1, &Buffers[i].vertex_buffer);
+    glDeleteBuffers(1, &Buffers[i].index_buffer);
+  }
+  Buffers.clear();
+  if (Cache_Text != NULL) unmap_file(Cache_Text, Cache_Size); // the mesh is in the cache file's memory
+  else {
+    free(this->Vertex_Data);
+    free(this->Indices);
+  }
+  Cache_Text = NULL;
+  Cache_Size = 0;
+  Vertex_Data = NULL;
+  Indices = NULL;
+  TotalVertices = 0;
+  TotalIndices = 0;
+}
+
+// buffer objects for the current GL context, uploading the mesh to them the first time
+Model_obj::gl_buffers_t& Model_obj::CurrentBuffers()
+{
+  gl_buffers_t buffers;
+  unsigned i;
+
+  buffers.window = glutGetWindow();
+  for (i=0; i<Buffers.size(); i++) if (Buffers[i].window == buffers.window) return Buffers[i];
+
+  buffers.vertex_buffer = 0;
+  buffers.index_buffer = 0;
+  if (buffer_objects_available()) {
+    glGenBuffers(1, &buffers.vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, TotalVertices*FLOATS_PER_VERTEX*sizeof(float), Vertex_Data, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glGenBuffers(1, &buffers.index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, TotalIndices*sizeof(GLuint), Indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
+  Buffers.push_back(buffers);
+  return Buffers.back();
 }
 
 // rendering function
 void Model_obj::Draw()
 {
-  glEnableClientState(GL_VERTEX_ARRAY); // enable vertex array
- 	glEnableClientState(GL_NORMAL_ARRAY); // enable normal array
-  glEnableClientState(GL_TEXTURE_COORD_ARRAY); // enable UV array
-  
-	glVertexPointer(3, GL_FLOAT,	0, Face_Vertices); // vertex pointer to Face_Vertices array
-  glTexCoordPointer(2, GL_FLOAT, 0, UVs); // uv pointer to UVs arrays
-	glNormalPointer(GL_FLOAT, 0, Normals); // normal pointer to Normals array
-  
-	glDrawArrays(GL_TRIANGLES, 0, TotalConnectedTriangles); // draw the triangles
-  
+  gl_buffers_t &buffers = CurrentBuffers();
+
+  if (buffers.vertex_buffer != 0) { // the mesh is already on the GPU, so the pointers are offsets into the buffers
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.vertex_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.index_buffer);
+    glInterleavedArrays(GL_T2F_N3F_V3F, 0, NULL); // enables and points the UV, normal and vertex arrays
+    glDrawElements(GL_TRIANGLES, TotalIndices, GL_UNSIGNED_INT, NULL); // draw the triangles
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
+  else { // no buffer objects, draw from the client-side arrays
+    glInterleavedArrays(GL_T2F_N3F_V3F, 0, Vertex_Data);
+    glDrawElements(GL_TRIANGLES, TotalIndices, GL_UNSIGNED_INT, Indices);
+  }
+
 	glDisableClientState(GL_VERTEX_ARRAY); // disable vertex array
 	glDisableClientState(GL_NORMAL_ARRAY); // disable normal array
   glDisableClientState(GL_TEXTURE_COORD_ARRAY); // disable UV array
 }
-
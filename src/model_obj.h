@@ -15,38 +15,70 @@
 // Adapt from the obj loader on http://openglsamples.sourceforge.net/
 // to take in UV data.
 
+// The first Load() of an obj file writes its mesh, ready for upload, to a cache
+// file next to it, and later loads map the cache instead of parsing the file.
+// The cache is used only if it was made with the same zoom_number from a file of
+// the same size and modification time, or failing that the same contents.
+//
+// Cache file layout (native byte order), <obj file>.mlmc:
+//   header  "MLMC", version byte, 3 zero bytes, then 8 bytes each: the obj file's size,
+//           modification time and hash, zoom_number, vertex count and index count
+//   data    Vertex_Data then Indices, exactly as uploaded to the buffer objects
+
 #ifndef __MODEL_OBJ_INCLUDED__
 #define __MODEL_OBJ_INCLUDED__
 
+#include <vector>
+
 #include "global_1.h"
 
 using namespace std;
 
+#define MESH_CACHE_VERSION 1
+#define MESH_CACHE_SUFFIX ".mlmc"
+
+struct mesh_cache_header_t {
+  char magic[4];
+  unsigned char version, unused[3];
+  long long source_size, source_time;
+  unsigned long long source_hash;
+  double zoom_number;
+  long long vertices, indices;
+};
+
 class Model_obj
 {
   public:
-    // Normals : stores {normal_of_face_1.x, normal_of_face_1.y, normal_of_face_1.z, normal_of_face_2.x, normal_of_face_2.y, ...}
-    // Face_Vertices : stores {Face_1_Vertex_1.x, Face_1_Vertex_1.y, Face_1_Vertex_1.z, Face_1_Vertex_2.x, Face_1_Vertex_2.y, Face_1_Vertex_2.z, Face_1_Vertex_3.x ,...}
-    // UVs : store {Face_1_Vertex_1.u, Face_1_Vertex_1.v, Face_1_Vertex_2.u, Face_1_Vertex_2.v, Face_1_Vertex_3.u, Face_1_Vertex_3.v, Face_2_Vertex_1.u, ...}
-    // vertexBuffer : stores {v1.x, v1.y, v1.z, v2.x, v2.y, v2.z, v3.x, ...}
-    // texelBuffer: stores {vt1.u, vt1.v, vt2.u, vt2.v, vt3.u, ...}
-    // TotalConnectedPoints : total number of elements of vertexBuffer
-    // TotalConnectedTexels : total number of elements of texelBuffer
-    // TotalConnectedTriangles : total number of elements of Face_Vertices
-    float* Normals;
-    float* Face_Vertices;
-    float* UVs;
-    float* vertexBuffer;
-    float* texelBuffer;
-    long TotalConnectedPoints;
-    long TotalConnectedTexels;
-    long TotalConnectedTriangles;
-    
+    // The mesh is indexed: each distinct (vertex, UV) pair in the obj file is stored once, and triangles refer to it
+    // Vertex_Data : stores {Vertex_1.u, Vertex_1.v, Vertex_1.normal.x, Vertex_1.normal.y, Vertex_1.normal.z, Vertex_1.x, Vertex_1.y, Vertex_1.z, Vertex_2.u, ...},
+    //               OpenGL's GL_T2F_N3F_V3F interleaved layout, with each normal the average of the faces around the vertex
+    // Indices : stores {Face_1_Vertex_1, Face_1_Vertex_2, Face_1_Vertex_3, Face_2_Vertex_1, ...}, counting vertices in Vertex_Data from 0
+    // TotalVertices : total number of vertices in Vertex_Data
+    // TotalIndices : total number of elements of Indices
+    float* Vertex_Data;
+    GLuint* Indices;
+    long TotalVertices;
+    long TotalIndices;
+
     Model_obj();
     vector3d calculateNormal(vector3d coord1, vector3d coord2, vector3d coord3);
-    bool Load(string filename, float zoom_number);
+    bool Load(string filename, float zoom_number); // v, vt, vn and f lines, faces with any number of corners, negative indices
     void Draw();
     void Release();
+
+  private:
+    // The mesh in GPU buffer objects, uploaded by the first Draw() in each GL context - every GLUT window has its own
+    struct gl_buffers_t {
+      int window;
+      GLuint vertex_buffer, index_buffer; // both 0 if this context has no buffer objects
+    };
+    vector<gl_buffers_t> Buffers;
+    const char* Cache_Text; // the mapped cache file, if Vertex_Data and Indices are in it
+    long Cache_Size;
+
+    gl_buffers_t& CurrentBuffers();
+    bool LoadCache(string filename, long long source_size, long long source_time, float zoom_number);
+    void SaveCache(string filename, long long source_size, long long source_time, unsigned long long hash, float zoom_number);
 };
 
 #endif
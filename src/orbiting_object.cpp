@@ -16,12 +16,40 @@
 
 // Orbiting_object class's member functions
 
-// constructor
-Orbiting_object::Orbiting_object(vector3d initial_position, vector3d initial_velocity, double initial_mass)
+// constructor, caches the orbital elements for the analytic ephemeris
+Orbiting_object::Orbiting_object(vector3d initial_position, vector3d initial_velocity, double initial_mass, bool analytic_ephemeris)
 {
+  double mu = GRAVITY*MARS_MASS, r = initial_position.abs(), v2 = initial_velocity.abs2();
+  double semi_minor_axis, eccentric_anomaly;
+  vector3d h, e;
+
   object_position = initial_position;
   object_velocity = initial_velocity;
   object_mass = initial_mass;
+  previous_delta_t = 0.0;
+
+  h = initial_position^initial_velocity;
+  e = ((v2 - mu/r)*initial_position - (initial_position*initial_velocity)*initial_velocity)/mu;
+  semi_major_axis = 1.0/(2.0/r - v2/mu);
+  eccentricity = e.abs();
+  analytic = analytic_ephemeris && (semi_major_axis > 0.0) && (eccentricity < 1.0) && (h.abs() > 0.0);
+  if (!analytic) {
+    mean_motion = 0.0; mean_anomaly_at_epoch = 0.0;
+    return;
+  }
+
+  // A (near-)circular orbit has no periapsis of its own, so measure the anomaly from the initial position
+  if (eccentricity < SMALL_NUM) {
+    eccentricity = 0.0;
+    periapsis_direction = initial_position.norm();
+  }
+  else periapsis_direction = e.norm();
+  quadrature_direction = (h^periapsis_direction).norm();
+  mean_motion = sqrt(mu/(semi_major_axis*semi_major_axis*semi_major_axis));
+
+  semi_minor_axis = semi_major_axis*sqrt(1.0 - eccentricity*eccentricity);
+  eccentric_anomaly = atan2((initial_position*quadrature_direction)/semi_minor_axis, (initial_position*periapsis_direction)/semi_major_axis + eccentricity);
+  mean_anomaly_at_epoch = eccentric_anomaly - eccentricity*sin(eccentric_anomaly);
 }
 
 // get position
@@ -48,21 +76,81 @@ double Orbiting_object::get_mass(void)
   return object_mass;
 }
 
+// get ephemeris mode
+bool Orbiting_object::get_analytic(void)
+{
+  return analytic;
+}
+
+// position and velocity at the given time, from Kepler's equation on the cached elements
+void Orbiting_object::ephemeris(double time, vector3d &position, vector3d &velocity)
+{
+  double mean_anomaly, eccentric_anomaly, correction, cos_E, sin_E;
+  unsigned i;
+
+  mean_anomaly = fmod(mean_anomaly_at_epoch + mean_motion*time, 2.0*M_PI);
+  eccentric_anomaly = (eccentricity < 0.8) ? mean_anomaly : M_PI;
+  for (i=0; i<50; i++) { // Newton's method on E - e sin E = M, a few iterations for the moons
+    correction = (eccentric_anomaly - eccentricity*sin(eccentric_anomaly) - mean_anomaly)/(1.0 - eccentricity*cos(eccentric_anomaly));
+    eccentric_anomaly -= correction;
+    if (fabs(correction) < 1.0e-15) break;
+  }
+
+  cos_E = cos(eccentric_anomaly);
+  sin_E = sin(eccentric_anomaly);
+  position = periapsis_direction*(semi_major_axis*(cos_E - eccentricity)) + quadrature_direction*(semi_major_axis*sqrt(1.0 - eccentricity*eccentricity)*sin_E);
+  velocity = (periapsis_direction*(-sin_E) + quadrature_direction*(sqrt(1.0 - eccentricity*eccentricity)*cos_E))
+             *(sqrt(GRAVITY*MARS_MASS*semi_major_axis)/(semi_major_axis*(1.0 - eccentricity*cos_E)));
+}
+
 // update mechanical dynamics
-void Orbiting_object::update_object(void)
+void Orbiting_object::update_object(double delta_t, double simulation_time)
 {
   vector3d temp_object_position;
   
+  if (analytic) { // no integration needed, just evaluate the ephemeris at the end of the step
+    ephemeris(simulation_time + delta_t, object_position, object_velocity);
+    previous_delta_t = delta_t;
+    return;
+  }
+  
   if (simulation_time == 0.0) { // first iteration, use Euler
     previous_object_position = object_position;
     object_position = object_position + object_velocity*delta_t + get_acceleration()*(0.5*delta_t*delta_t);
     object_velocity = object_velocity + get_acceleration()*delta_t;
   }
-  else { // subsequent iterations, use Verlet
+  else if (delta_t == previous_delta_t) { // subsequent iterations, use Verlet
     temp_object_position = object_position;
     object_position = object_position*2.0 - previous_object_position + get_acceleration()*(delta_t*delta_t);
     object_velocity = object_velocity + get_acceleration()*delta_t;
     previous_object_position = temp_object_position;
   }
+  else { // step length has changed, use Verlet with the previous displacement rescaled to the new step
+    temp_object_position = object_position;
+    object_position = object_position + (object_position - previous_object_position)*(delta_t/previous_delta_t) + get_acceleration()*(0.5*delta_t*(delta_t+previous_delta_t));
+    object_velocity = object_velocity + get_acceleration()*delta_t;
+    previous_object_position = temp_object_position;
+  }
+  previous_delta_t = delta_t;
 }
 
+
+// jump along the two-body orbit, leaving the previous position one step of delta_t behind so that
+// update_object() carries on smoothly
+void Orbiting_object::jump_object(double jump_time, double delta_t, double simulation_time)
+{
+  Kepler_solver conic;
+  vector3d p, v;
+  
+  if (analytic) {
+    ephemeris(simulation_time + jump_time, object_position, object_velocity);
+    previous_delta_t = delta_t;
+    return;
+  }
+  
+  conic.propagate(object_position, object_velocity, jump_time - delta_t, previous_object_position, v);
+  conic.propagate(object_position, object_velocity, jump_time, p, v);
+  object_position = p;
+  object_velocity = v;
+  previous_delta_t = delta_t;
+}
@@ -18,8 +18,8 @@
 #include <cmath>
 
 #include "define_constants.h"
-#include "global_2.h"
 #include "vector3d.h"
+#include "kepler_solver.h"
 
 using namespace std;
 
@@ -30,15 +30,25 @@ class Orbiting_object
     vector3d previous_object_position;
     vector3d object_velocity;
     double object_mass;
+    double previous_delta_t; // length of the last step, so that the step length may vary
+    
+    // Analytic ephemeris: the two-body ellipse through the initial state, fixed at construction.
+    // periapsis_direction and quadrature_direction span the orbital plane, the latter 90 degrees ahead.
+    bool analytic;
+    double semi_major_axis, eccentricity, mean_motion, mean_anomaly_at_epoch;
+    vector3d periapsis_direction, quadrature_direction;
   
   public:
-    Orbiting_object() {object_position=vector3d(0.0,0.0,0.0); previous_object_position=vector3d(0.0,0.0,0.0); object_velocity=vector3d(0.0,0.0,0.0); object_mass=0.0;}
-    Orbiting_object(vector3d initial_position, vector3d initial_velocity, double initial_mass); // constructor
+    Orbiting_object() {object_position=vector3d(0.0,0.0,0.0); previous_object_position=vector3d(0.0,0.0,0.0); object_velocity=vector3d(0.0,0.0,0.0); object_mass=0.0; previous_delta_t=0.0; analytic=false; semi_major_axis=0.0; eccentricity=0.0; mean_motion=0.0; mean_anomaly_at_epoch=0.0;}
+    Orbiting_object(vector3d initial_position, vector3d initial_velocity, double initial_mass, bool analytic_ephemeris = true); // constructor
     vector3d get_position(void);
     vector3d get_velocity(void);
     vector3d get_acceleration(void);
     double get_mass(void);
-    void update_object(void);
+    bool get_analytic(void);
+    void ephemeris(double time, vector3d &position, vector3d &velocity); // state at any time since the initial state, analytic mode only
+    void update_object(double delta_t, double simulation_time);
+    void jump_object(double jump_time, double delta_t, double simulation_time); // coast analytically, then carry on with steps of delta_t
 };
 
 #endif
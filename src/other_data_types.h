@@ -26,6 +26,21 @@ struct track_t {
   vector3d pos[N_TRACK];
 };
 
+// Keeping the simulation in step with the wall clock, see pacing_owed()
+struct pacing_t {
+  unsigned long long last_wall; // microseconds
+  double owed; // simulation time the steps are behind the wall clock
+  unsigned long long report_wall; // start of the current SPEED_REPORT_INTERVAL
+  double report_simulation_time;
+  double achieved; // simulation seconds per wall clock second over the last interval, 0 until one has passed
+};
+
+// The ends of the last time step, so that a long adaptive step can be drawn as it goes, see publish_coast_view()
+struct coast_step_t {
+  double start, end; // simulation time
+  vector3d start_position, start_velocity, end_position, end_velocity;
+};
+
 // Quaternions for orbital view transformation
 struct quat_t {
   vector3d v;
@@ -39,10 +54,24 @@ struct closeup_coords_t {
   vector3d right;
 };
 
+// Tunable constants of the autopilot. The defaults are the original hand-tuned values; ./tune_autopilot
+// searches for better ones, and lander and campaign read them back with --gains=file.
+struct autopilot_gains_t {
+  double kp = 0.3; // throttle per m/s of radial speed error in entry, descent and landing
+  double entry_speed = 440.0; // (m/s) target descent rate above switch_altitude is entry_speed + entry_kh*altitude
+  double entry_kh = 0.003; // (1/s)
+  double landing_speed = 0.5; // (m/s) target descent rate below switch_altitude is landing_speed + landing_kh*altitude
+  double landing_kh = 0.05; // (1/s)
+  double switch_altitude = 12000.0; // (m) below this the parachute may be deployed
+  double vertical_rise = 1000.0; // (m) climb straight up to this altitude after a launch
+  double ascent_pitch = 30.0; // (degrees) then pitch over this far until out of the atmosphere
+};
+
 // Enumerated data types
 enum parachute_status_t { NOT_DEPLOYED = 0, DEPLOYED = 1, LOST = 2 };
 enum lander_phases {let_it_be, chariots_of_fire, the_sound_of_silence, viva_la_vida, let_it_go}; // current state of lander
-enum autopilot_modes {descent_mode, transfer_mode, maintain_mode, launch_mode}; // current autopilot mode
+enum autopilot_modes {descent_mode, transfer_mode, maintain_mode, launch_mode, powered_descent_mode}; // current autopilot mode
+enum integrator_t { VERLET = 0, DORMAND_PRINCE = 1, VELOCITY_VERLET = 2, YOSHIDA_4 = 3, N_INTEGRATORS = 4 }; // lander dynamics integrator
 enum manual_attitude_command {roll_command, pitch_command, yaw_command, stabilize_command, reset_command}; // for manual attitude control
 
 #endif
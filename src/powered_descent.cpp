@@ -0,0 +1,189 @@
+// Mars lander simulator
+// Version 1.8
+// Powered_descent_solver class implementation
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+#include <cmath>
+
+#include "powered_descent.h"
+
+#define PD_RHO 1.0 // ADMM penalty, in (m/s^2)^-1
+#define PD_MISS_WEIGHT 10.0 // penalty per m/s of end velocity error, and per m/s of altitude error over the flight
+#define PD_TOLERANCE 1.0e-4 // (m/s^2) stop early once the thrust profile has converged this far
+
+const Powered_descent_solver powered_descent_solver;
+
+static vector3d thrust_cone_prox (const vector3d &v, double threshold, double max_acceleration)
+  // Minimizes |a| threshold + |a - v|^2/2 over the thrust cone and |a| <= max_acceleration: the
+  // nearest point of the cone, shortened by threshold
+{
+  const double cos_tilt = cos(PD_MAX_TILT*M_PI/180.0), sin_tilt = sin(PD_MAX_TILT*M_PI/180.0);
+  double horizontal = sqrt(v.x*v.x + v.y*v.y), along, length;
+  vector3d p, edge;
+
+  if (horizontal*cos_tilt <= v.z*sin_tilt) p = v;
+  else if (horizontal == 0.0) return vector3d(0.0, 0.0, 0.0); // straight down
+  else { // onto the edge of the cone on v's side, or to the tip
+    edge = vector3d(sin_tilt*v.x/horizontal, sin_tilt*v.y/horizontal, cos_tilt);
+    along = v*edge;
+    if (along <= 0.0) return vector3d(0.0, 0.0, 0.0);
+    p = edge*along;
+  }
+  length = p.abs();
+  if (length <= threshold) return vector3d(0.0, 0.0, 0.0);
+  return p*(fmin(length - threshold, max_acceleration)/length);
+}
+
+// Powered_descent_solver class's member functions
+
+// constructor
+Powered_descent_solver::Powered_descent_solver()
+{
+  const int n = PD_STEPS;
+  double p[PD_STEPS][PD_STEPS], b[PD_STEPS], s[2][2], det, sum;
+  int i, j, k;
+
+  // Altitude at the end of segment k, over dt^2*n, gains (k-j-1/2)/n per unit vertical thrust in segment j < k
+  for (k=1; k<n; k++) for (j=0; j<n; j++) g_matrix[k-1][j] = (j < k) ? (k-j-0.5)/n : 0.0;
+  for (j=0; j<n; j++) {
+    e_matrix[0][j] = 1.0/n; // vertical speed change over dt*n
+    e_matrix[1][j] = (n-j-0.5)/n; // end altitude over dt^2*n
+  }
+
+  // Cholesky factorization of I + G^T G
+  for (i=0; i<n; i++) for (j=0; j<n; j++) {
+    p[i][j] = (i == j) ? 1.0 : 0.0;
+    for (k=0; k<n-1; k++) p[i][j] += g_matrix[k][i]*g_matrix[k][j];
+  }
+  for (j=0; j<n; j++) {
+    for (i=j; i<n; i++) {
+      sum = p[i][j];
+      for (k=0; k<j; k++) sum -= factor[i][k]*factor[j][k];
+      if (i == j) factor[j][j] = sqrt(sum);
+      else factor[i][j] = sum/factor[j][j];
+    }
+    for (i=0; i<j; i++) factor[i][j] = 0.0;
+  }
+
+  // Schur complement for the two end point constraints
+  for (i=0; i<2; i++) {
+    for (j=0; j<n; j++) b[j] = e_matrix[i][j];
+    cholesky_solve(b);
+    for (j=0; j<n; j++) y_matrix[j][i] = b[j];
+  }
+  for (i=0; i<2; i++) for (k=0; k<2; k++) {
+    s[i][k] = 0.0;
+    for (j=0; j<n; j++) s[i][k] += e_matrix[i][j]*y_matrix[j][k];
+  }
+  det = s[0][0]*s[1][1] - s[0][1]*s[1][0];
+  s_inverse[0][0] = s[1][1]/det; s_inverse[0][1] = -s[0][1]/det;
+  s_inverse[1][0] = -s[1][0]/det; s_inverse[1][1] = s[0][0]/det;
+}
+
+// overwrite b with (I + G^T G)^-1 b
+void Powered_descent_solver::cholesky_solve(double b[]) const
+{
+  int i, k;
+
+  for (i=0; i<PD_STEPS; i++) {
+    for (k=0; k<i; k++) b[i] -= factor[i][k]*b[k];
+    b[i] /= factor[i][i];
+  }
+  for (i=PD_STEPS-1; i>=0; i--) {
+    for (k=i+1; k<PD_STEPS; k++) b[i] -= factor[k][i]*b[k];
+    b[i] /= factor[i][i];
+  }
+}
+
+// thrust profile for one time of flight, by ADMM
+double Powered_descent_solver::solve(const powered_descent_problem_t &problem, double time_of_flight, const vector3d guess[],
+                                    vector3d thrust[]) const
+{
+  const int n = PD_STEPS;
+  const double dt = time_of_flight/n, scale = 1.0/(dt*dt*n);
+  vector3d x[PD_STEPS], u[PD_STEPS], v, last;
+  double c[PD_STEPS], w[PD_STEPS-1], y[PD_STEPS-1], b[PD_STEPS], end_point[2], lambda[2], residual[2];
+  double horizontal_x, horizontal_y, altitude, fuel, miss, change;
+  int i, j, k;
+
+  // Scaled altitude at the end of each segment with no thrust, and the end point conditions
+  for (k=1; k<=n; k++) c[k-1] = (problem.altitude + problem.velocity.z*k*dt - 0.5*problem.gravity*dt*dt*k*k)*scale;
+  end_point[0] = (-problem.end_speed - problem.velocity.z)/(n*dt) + problem.gravity;
+  end_point[1] = -c[n-1];
+
+  for (j=0; j<n; j++) {
+    thrust[j] = guess[j];
+    u[j] = vector3d(0.0, 0.0, 0.0);
+  }
+  for (k=0; k<n-1; k++) {
+    w[k] = c[k];
+    for (j=0; j<n; j++) w[k] += g_matrix[k][j]*thrust[j].z;
+    w[k] = fmax(w[k], 0.0);
+    y[k] = 0.0;
+  }
+
+  for (i=0; i<PD_ITERATIONS; i++) {
+    // Nearest profile to thrust - u that stops horizontally, in the least squares sense together with the altitudes
+    horizontal_x = -problem.velocity.x/(n*dt);
+    horizontal_y = -problem.velocity.y/(n*dt);
+    for (j=0; j<n; j++) {
+      horizontal_x -= (thrust[j].x - u[j].x)/n;
+      horizontal_y -= (thrust[j].y - u[j].y)/n;
+    }
+    for (j=0; j<n; j++) {
+      x[j].x = thrust[j].x - u[j].x + horizontal_x;
+      x[j].y = thrust[j].y - u[j].y + horizontal_y;
+      b[j] = thrust[j].z - u[j].z;
+      for (k=j; k<n-1; k++) b[j] += g_matrix[k][j]*(w[k] - y[k] - c[k]);
+    }
+    cholesky_solve(b);
+    for (k=0; k<2; k++) {
+      residual[k] = -end_point[k];
+      for (j=0; j<n; j++) residual[k] += e_matrix[k][j]*b[j];
+    }
+    lambda[0] = s_inverse[0][0]*residual[0] + s_inverse[0][1]*residual[1];
+    lambda[1] = s_inverse[1][0]*residual[0] + s_inverse[1][1]*residual[1];
+    for (j=0; j<n; j++) x[j].z = b[j] - y_matrix[j][0]*lambda[0] - y_matrix[j][1]*lambda[1];
+
+    // Thrust within its cone and limit, shrunk towards zero for the fuel it costs
+    change = 0.0;
+    for (j=0; j<n; j++) {
+      last = thrust[j];
+      thrust[j] = thrust_cone_prox(x[j] + u[j], 1.0/PD_RHO, problem.max_acceleration);
+      u[j] += x[j] - thrust[j];
+      change = fmax(change, fmax((x[j] - thrust[j]).abs(), (thrust[j] - last).abs()));
+    }
+
+    // Altitudes kept above the ground
+    for (k=0; k<n-1; k++) {
+      altitude = c[k];
+      for (j=0; j<=k; j++) altitude += g_matrix[k][j]*x[j].z;
+      w[k] = fmax(altitude + y[k], 0.0);
+      y[k] += altitude - w[k];
+    }
+    if (change < PD_TOLERANCE) break; // both the constraint violation and the last move are negligible
+  }
+
+  // Fly the thrust profile, which is within its limits, and see how far it misses
+  v = problem.velocity;
+  altitude = problem.altitude;
+  fuel = 0.0;
+  miss = 0.0;
+  for (j=0; j<n; j++) {
+    altitude += v.z*dt + 0.5*(thrust[j].z - problem.gravity)*dt*dt;
+    v += (thrust[j] - vector3d(0.0, 0.0, problem.gravity))*dt;
+    fuel += thrust[j].abs()*dt;
+    if ((j < n-1) && (altitude < 0.0)) miss -= altitude/time_of_flight;
+  }
+  miss += (v - vector3d(0.0, 0.0, -problem.end_speed)).abs() + fabs(altitude)/time_of_flight;
+  return fuel + PD_MISS_WEIGHT*miss;
+}
@@ -0,0 +1,100 @@
+// Mars lander simulator
+// Version 1.8
+// Powered_descent_solver class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Fuel-optimal powered descent, after Acikmese and Ploen's convex (G-FOLD)
+// formulation. In a flat frame at the lander, with x and y horizontal and z up,
+// the time to the end of the plan is split into PD_STEPS equal segments of constant thrust
+// acceleration a_k, and the plan minimizes sum |a_k| dt subject to
+//
+//   |a_k| <= a_max, the thrust within PD_MAX_TILT of the vertical,
+//   the altitude at every segment boundary >= 0,
+//   arrival at zero altitude, descending straight down at the given end speed.
+//
+// Zero altitude here is PD_END_ALTITUDE above the ground, where the descent law
+// takes back the last few metres: with the engine's delay and lag, holding an
+// open-loop thrust profile right down to the ground lands too hard.
+//
+// The engine can be throttled right down to zero, so there is no lower thrust
+// bound to convexify and the problem is a second-order cone program as it
+// stands. Gravity is uniform, the mass is held at its value at the start of
+// the plan (so a_max is on the safe side) and drag is left out, which can only
+// leave the lander slower than planned; re-planning at PD_REPLAN_INTERVAL
+// takes up the difference.
+//
+// The solver is ADMM on the cone, altitude and end point constraints. With
+// positions measured in units of dt^2*PD_STEPS, the linear algebra does not
+// depend on the state or the time of flight, so it is factorized once by the
+// constructor and each solve is at most PD_ITERATIONS passes over a few small fixed
+// arrays: no allocation and a bounded amount of work. The time of flight is
+// chosen by a line search that solves for up to PD_SOLVES times per plan.
+
+#ifndef __POWERED_DESCENT_INCLUDED__
+#define __POWERED_DESCENT_INCLUDED__
+
+#include "define_constants.h"
+#include "vector3d.h"
+
+using namespace std;
+
+#define PD_STEPS 20 // constant thrust segments in a plan
+#define PD_ITERATIONS 400 // ADMM iterations per solve - the compute budget
+#define PD_SOLVES 3 // solves per re-plan, for the time of flight line search
+#define PD_TIME_STEP 0.03 // fraction by which the line search moves the time of flight at each re-plan
+#define PD_FIRST_SOLVES 8 // solves for the first plan, which has no previous time of flight to start from
+#define PD_REPLAN_INTERVAL 0.1 // (s) re-plan at 10 Hz, following the current plan in between
+#define PD_START_ALTITUDE 2000.0 // (m) the planner takes over from the descent law below this
+#define PD_MAX_TILT 45.0 // (degrees) of the thrust from the vertical
+#define PD_END_ALTITUDE 10.0 // (m) the plan hands over to the descent law this far above the ground
+#define PD_MIN_TIME_OF_FLIGHT 1.0 // (s)
+
+// One convex descent problem, in the plan's local frame
+struct powered_descent_problem_t {
+  double altitude; // (m) above the end of the plan
+  vector3d velocity; // (m/s) relative to the ground
+  double end_speed; // (m/s) descent rate at the end of the plan
+  double gravity, max_acceleration; // (m/s^2)
+};
+
+// The plan being followed, see powered_descent_guidance()
+struct powered_descent_plan_t {
+  bool valid;
+  double start_time, next_replan; // simulation times the plan was made at and is next made at
+  double time_of_flight; // (s) from start_time to the end of the plan
+  vector3d east, north, up; // the plan's local frame
+  vector3d thrust[PD_STEPS]; // (m/s^2) thrust acceleration in each segment, local frame
+  double predicted_fuel; // (l) to the end of the plan
+};
+
+class Powered_descent_solver
+{
+  private:
+    double g_matrix[PD_STEPS-1][PD_STEPS]; // scaled altitude at each inner segment boundary per unit vertical thrust
+    double e_matrix[2][PD_STEPS]; // end point rows: scaled vertical speed change, then scaled altitude
+    double factor[PD_STEPS][PD_STEPS]; // Cholesky factor of I + G^T G
+    double y_matrix[PD_STEPS][2]; // (I + G^T G)^-1 E^T
+    double s_inverse[2][2]; // (E (I + G^T G)^-1 E^T)^-1
+
+    void cholesky_solve(double b[]) const;
+
+  public:
+    Powered_descent_solver(); // constructor, factorizes the matrices common to every problem
+
+    // best thrust profile for the given time of flight, starting the iterations from guess; returns
+    // the fuel per unit mass (sum |a_k| dt) plus a penalty for missing the end point or going underground
+    double solve(const powered_descent_problem_t &problem, double time_of_flight, const vector3d guess[], vector3d thrust[]) const;
+};
+
+extern const Powered_descent_solver powered_descent_solver;
+
+#endif
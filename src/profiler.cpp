@@ -0,0 +1,134 @@
+// Mars lander simulator
+// Version 1.8
+// Profiler class implementation
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+#include <chrono>
+
+#include "profiler.h"
+
+const char *profile_phase_name[N_PROFILE_PHASES] = {"idle", "numerical_dynamics", "update_visualization",
+  "draw_closeup_window", "draw_orbital_window", "draw_instrument_window", "glutSwapBuffers"};
+
+// Profiler class's member functions
+
+// constructor
+Profiler::Profiler()
+{
+  unsigned p, b;
+
+  for (p=0; p<N_PROFILE_PHASES; p++) {
+    for (b=0; b<PROFILE_BUCKETS; b++) counts[p][b] = 0;
+    total_ns[p] = 0;
+    max_ns[p] = 0;
+  }
+  mark();
+}
+
+// monotonic clock in nanoseconds
+unsigned long long Profiler::now(void)
+{
+  return (unsigned long long) chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// histogram bucket for a duration - exact below 16ns, then eight per power of two
+unsigned Profiler::bucket(unsigned long long ns)
+{
+  unsigned octave;
+
+  if (ns < 2*PROFILE_SUB_BUCKETS) return (unsigned) ns;
+  octave = 63 - __builtin_clzll(ns);
+  return (octave-2)*PROFILE_SUB_BUCKETS + (unsigned) ((ns >> (octave-3)) & (PROFILE_SUB_BUCKETS-1));
+}
+
+// shortest duration that falls in bucket b
+unsigned long long Profiler::bucket_low(unsigned b)
+{
+  if (b < 2*PROFILE_SUB_BUCKETS) return b;
+  return ((unsigned long long) (PROFILE_SUB_BUCKETS + b%PROFILE_SUB_BUCKETS)) << (b/PROFILE_SUB_BUCKETS - 1);
+}
+
+// count one duration - a single writer per phase, so plain loads and stores will do
+void Profiler::record(profile_phase_t phase, unsigned long long ns)
+{
+  atomic<unsigned long> &count = counts[phase][bucket(ns)];
+
+  count.store(count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+  total_ns[phase].store(total_ns[phase].load(memory_order_relaxed) + ns, memory_order_relaxed);
+  if (ns > max_ns[phase].load(memory_order_relaxed)) max_ns[phase].store(ns, memory_order_relaxed);
+}
+
+// start a new window for stats()
+void Profiler::mark(void)
+{
+  unsigned p, b;
+
+  for (p=0; p<N_PROFILE_PHASES; p++) {
+    for (b=0; b<PROFILE_BUCKETS; b++) mark_counts[p][b] = counts[p][b].load(memory_order_relaxed);
+    mark_total_ns[p] = total_ns[p].load(memory_order_relaxed);
+  }
+  mark_time = now();
+}
+
+// length of the current window
+double Profiler::seconds_since_mark(void)
+{
+  return (now() - mark_time)/1.0e9;
+}
+
+// count, mean and percentiles for the session or for the window since mark(), in microseconds
+profile_stats_t Profiler::stats(profile_phase_t phase, bool since_mark)
+{
+  unsigned long n[PROFILE_BUCKETS], seen = 0, rank50, rank99;
+  unsigned long long total = total_ns[phase].load(memory_order_relaxed);
+  profile_stats_t s;
+  unsigned b, top = 0;
+
+  s.count = 0;
+  for (b=0; b<PROFILE_BUCKETS; b++) {
+    n[b] = counts[phase][b].load(memory_order_relaxed);
+    if (since_mark) n[b] -= mark_counts[phase][b];
+    if (n[b]) top = b;
+    s.count += n[b];
+  }
+  if (since_mark) total -= mark_total_ns[phase];
+  s.mean = s.p50 = s.p99 = s.max = 0.0;
+  if (!s.count) return s;
+
+  // percentiles are taken as the middle of their bucket
+  rank50 = (s.count+1)/2;
+  rank99 = s.count - s.count/100;
+  for (b=0; b<PROFILE_BUCKETS; b++) {
+    if (!n[b]) continue;
+    if ((seen < rank50) && (seen + n[b] >= rank50)) s.p50 = (bucket_low(b) + bucket_low(b+1))/2.0e3;
+    if ((seen < rank99) && (seen + n[b] >= rank99)) s.p99 = (bucket_low(b) + bucket_low(b+1))/2.0e3;
+    seen += n[b];
+  }
+  s.mean = total/1.0e3/s.count;
+  s.max = since_mark ? bucket_low(top+1)/1.0e3 : max_ns[phase].load(memory_order_relaxed)/1.0e3;
+  if (s.p50 > s.max) s.p50 = s.max;
+  if (s.p99 > s.max) s.p99 = s.max;
+  return s;
+}
+
+// whole session, one line per phase
+void Profiler::dump(ostream &out)
+{
+  profile_stats_t s;
+  unsigned p;
+
+  out << "# phase calls mean_us p50_us p99_us max_us" << endl;
+  for (p=0; p<N_PROFILE_PHASES; p++) {
+    s = stats((profile_phase_t) p, false);
+    out << profile_phase_name[p] << " " << s.count << " " << s.mean << " " << s.p50 << " " << s.p99 << " " << s.max << endl;
+  }
+}
@@ -0,0 +1,80 @@
+// Mars lander simulator
+// Version 1.8
+// Profiler class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Always-on timing of the phases of a frame, cheap enough to leave in the hot
+// path: recording a duration is a clock read and two counter increments. Each
+// phase keeps a log-linear latency histogram, eight buckets per power of two,
+// so that percentiles come out within about 6% without storing samples. Each
+// phase is only ever recorded by one thread at a time, so the counters are
+// atomic just so that another thread can read them while they are updated.
+// mark() starts a window, so that stats() can report on the recent past as
+// well as on the whole session.
+
+#ifndef __PROFILER_INCLUDED__
+#define __PROFILER_INCLUDED__
+
+#include <atomic>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+#define PROFILE_SUB_BUCKETS 8 // buckets per power of two
+#define PROFILE_BUCKETS (62*PROFILE_SUB_BUCKETS) // enough for any 64 bit duration in nanoseconds
+
+enum profile_phase_t { IDLE_PHASE = 0, DYNAMICS_PHASE = 1, VISUALIZATION_PHASE = 2, CLOSEUP_PHASE = 3,
+                       ORBITAL_PHASE = 4, INSTRUMENT_PHASE = 5, SWAP_PHASE = 6, N_PROFILE_PHASES = 7 };
+extern const char *profile_phase_name[N_PROFILE_PHASES];
+
+// Latencies in microseconds
+struct profile_stats_t {
+  unsigned long count;
+  double mean, p50, p99, max;
+};
+
+class Profiler
+{
+  private:
+    atomic<unsigned long> counts[N_PROFILE_PHASES][PROFILE_BUCKETS];
+    atomic<unsigned long long> total_ns[N_PROFILE_PHASES], max_ns[N_PROFILE_PHASES];
+    unsigned long mark_counts[N_PROFILE_PHASES][PROFILE_BUCKETS];
+    unsigned long long mark_total_ns[N_PROFILE_PHASES], mark_time;
+
+    static unsigned bucket(unsigned long long ns);
+    static unsigned long long bucket_low(unsigned b);
+
+  public:
+    Profiler(); // constructor
+    static unsigned long long now(void); // monotonic clock in nanoseconds
+    void record(profile_phase_t phase, unsigned long long ns);
+    void mark(void); // start a new window
+    double seconds_since_mark(void);
+    profile_stats_t stats(profile_phase_t phase, bool since_mark); // the window's max is only good to a bucket
+    void dump(ostream &out); // one line per phase for the whole session
+};
+
+// Records the time from construction to destruction
+class Scoped_timer
+{
+  private:
+    Profiler &profiler;
+    profile_phase_t phase;
+    unsigned long long start;
+
+  public:
+    Scoped_timer(Profiler &p, profile_phase_t ph) : profiler(p), phase(ph) {start = Profiler::now();}
+    ~Scoped_timer() {profiler.record(phase, Profiler::now() - start);}
+};
+
+#endif
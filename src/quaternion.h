@@ -0,0 +1,50 @@
+// Mars lander simulator
+// Version 1.8
+// Quaternion class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+#ifndef __QUATERNION_INCLUDED__
+#define __QUATERNION_INCLUDED__
+
+#include <cmath>
+#include <iostream>
+
+#include "vector3d.h"
+
+using namespace std;
+
+class quaternion {
+  // Utility class for rotations held as unit quaternions w + xi + yj + zk. The lander's attitude is the
+  // rotation from the world frame to the lander's body axes, whose images are x_axis() (out, roll),
+  // y_axis() (left, pitch) and z_axis() (up, yaw).
+public:
+  quaternion() {w=1.0; x=0.0; y=0.0; z=0.0;}
+  quaternion (double a, double b, double c, double d) {w=a; x=b; y=c; z=d;}
+  quaternion operator* (const quaternion &q) const { return quaternion(w*q.w - x*q.x - y*q.y - z*q.z, w*q.x + x*q.w + y*q.z - z*q.y,
+                                                                       w*q.y - x*q.z + y*q.w + z*q.x, w*q.z + x*q.y - y*q.x + z*q.w); }
+  quaternion conjugate() const { return quaternion(w, -x, -y, -z); }
+  double abs2() const { return (w*w + x*x + y*y + z*z); }
+  double abs() const { return sqrt(this->abs2()); }
+  quaternion norm() const { double s(this->abs()); if (s==0) return quaternion(); else return quaternion(w/s, x/s, y/s, z/s); }
+  vector3d rotate (const vector3d &v) const { // q v q*, for a unit quaternion
+    vector3d u(x, y, z), t = 2.0*(u^v);
+    return v + w*t + (u^t);
+  }
+  vector3d x_axis() const { return vector3d(1.0 - 2.0*(y*y + z*z), 2.0*(x*y + w*z), 2.0*(x*z - w*y)); }
+  vector3d y_axis() const { return vector3d(2.0*(x*y - w*z), 1.0 - 2.0*(x*x + z*z), 2.0*(y*z + w*x)); }
+  vector3d z_axis() const { return vector3d(2.0*(x*z + w*y), 2.0*(y*z - w*x), 1.0 - 2.0*(x*x + y*y)); }
+  friend ostream& operator << (ostream &out, const quaternion &q) { out << q.w << ' ' << q.x << ' ' << q.y << ' ' << q.z; return out; }
+  double w, x, y, z;
+private:
+};
+
+#endif
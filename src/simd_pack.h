@@ -0,0 +1,224 @@
+// Mars lander simulator
+// Version 1.8
+// SIMD pack header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// A "pack" holds one double per lane for as many lanes as the instruction set
+// allows: eight with AVX-512, four with AVX2, two with SSE2 (which every x86-64
+// compiler may use) and one otherwise. Each pack type provides the same few
+// operations, so that kernels such as Lander_batch's are written only once.
+// Plain arithmetic uses the + - * / operators, which g++ and clang provide for
+// the SIMD types too. vector3d_pack is the structure-of-arrays counterpart of
+// vector3d, one pack per component, with the same operators.
+
+#ifndef __SIMD_PACK_INCLUDED__
+#define __SIMD_PACK_INCLUDED__
+
+#include <cmath>
+
+#if defined (__AVX512F__) || defined (__AVX2__)
+#include <immintrin.h>
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+#endif
+
+#include "vector3d.h"
+
+#if defined (__AVX512F__)
+
+struct simd_pack_t {
+  typedef __m512d value;
+  typedef __mmask8 mask;
+  static const unsigned width = 8;
+  static value load (const double *p) { return _mm512_loadu_pd(p); }
+  static void store (double *p, value v) { _mm512_storeu_pd(p, v); }
+  static value set (double a) { return _mm512_set1_pd(a); }
+  static value sqrt (value a) { return _mm512_sqrt_pd(a); }
+  static value min (value a, value b) { return _mm512_min_pd(a, b); }
+  static value max (value a, value b) { return _mm512_max_pd(a, b); }
+  static value round (value a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+  static value fma (value a, value b, value c) { return _mm512_fmadd_pd(a, b, c); }
+  static value pow2 (value n) { // 2^n for whole n, by writing n straight into the exponent field
+    __m512i bits = _mm512_castpd_si512(n + _mm512_set1_pd(6755399441055744.0)); // 1.5*2^52 leaves n in the low bits
+    return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_add_epi64(bits, _mm512_set1_epi64(1023)), 52));
+  }
+  static mask less (value a, value b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+  static mask less_equal (value a, value b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+  static mask equal (value a, value b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+  static mask both (mask a, mask b) { return (mask) (a & b); }
+  static mask either (mask a, mask b) { return (mask) (a | b); }
+  static mask negate (mask a) { return (mask) ~a; }
+  static value select (mask m, value a, value b) { return _mm512_mask_blend_pd(m, b, a); }
+  static bool any (mask m) { return m != 0; }
+};
+
+#define SIMD_PACK_PATH "AVX-512"
+
+#elif defined (__AVX2__)
+
+struct simd_pack_t {
+  typedef __m256d value;
+  typedef __m256d mask;
+  static const unsigned width = 4;
+  static value load (const double *p) { return _mm256_loadu_pd(p); }
+  static void store (double *p, value v) { _mm256_storeu_pd(p, v); }
+  static value set (double a) { return _mm256_set1_pd(a); }
+  static value sqrt (value a) { return _mm256_sqrt_pd(a); }
+  static value min (value a, value b) { return _mm256_min_pd(a, b); }
+  static value max (value a, value b) { return _mm256_max_pd(a, b); }
+  static value round (value a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+#ifdef __FMA__
+  static value fma (value a, value b, value c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+  static value fma (value a, value b, value c) { return a*b + c; }
+#endif
+  static value pow2 (value n) { // 2^n for whole n, by writing n straight into the exponent field
+    __m256i bits = _mm256_castpd_si256(n + _mm256_set1_pd(6755399441055744.0)); // 1.5*2^52 leaves n in the low bits
+    return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52));
+  }
+  static mask less (value a, value b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static mask less_equal (value a, value b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+  static mask equal (value a, value b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+  static mask both (mask a, mask b) { return _mm256_and_pd(a, b); }
+  static mask either (mask a, mask b) { return _mm256_or_pd(a, b); }
+  static mask negate (mask a) { return _mm256_xor_pd(a, _mm256_castsi256_pd(_mm256_set1_epi64x(-1))); }
+  static value select (mask m, value a, value b) { return _mm256_blendv_pd(b, a, m); }
+  static bool any (mask m) { return _mm256_movemask_pd(m) != 0; }
+};
+
+#define SIMD_PACK_PATH "AVX2"
+
+#elif defined (__SSE2__)
+
+struct simd_pack_t {
+  typedef __m128d value;
+  typedef __m128d mask;
+  static const unsigned width = 2;
+  static value load (const double *p) { return _mm_loadu_pd(p); }
+  static void store (double *p, value v) { _mm_storeu_pd(p, v); }
+  static value set (double a) { return _mm_set1_pd(a); }
+  static value sqrt (value a) { return _mm_sqrt_pd(a); }
+  static value min (value a, value b) { return _mm_min_pd(a, b); }
+  static value max (value a, value b) { return _mm_max_pd(a, b); }
+#ifdef __SSE4_1__
+  static value round (value a) { return _mm_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+#else
+  static value round (value a) { // adding and taking away 1.5*2^52 rounds to nearest for |a| < 2^51
+    value magic = _mm_set1_pd(6755399441055744.0);
+    return (a + magic) - magic;
+  }
+#endif
+  static value fma (value a, value b, value c) { return a*b + c; }
+  static value pow2 (value n) { // 2^n for whole n, by writing n straight into the exponent field
+    __m128i bits = _mm_castpd_si128(n + _mm_set1_pd(6755399441055744.0)); // 1.5*2^52 leaves n in the low bits
+    return _mm_castsi128_pd(_mm_slli_epi64(_mm_add_epi64(bits, _mm_set1_epi64x(1023)), 52));
+  }
+  static mask less (value a, value b) { return _mm_cmplt_pd(a, b); }
+  static mask less_equal (value a, value b) { return _mm_cmple_pd(a, b); }
+  static mask equal (value a, value b) { return _mm_cmpeq_pd(a, b); }
+  static mask both (mask a, mask b) { return _mm_and_pd(a, b); }
+  static mask either (mask a, mask b) { return _mm_or_pd(a, b); }
+  static mask negate (mask a) { return _mm_xor_pd(a, _mm_castsi128_pd(_mm_set1_epi64x(-1))); }
+  static value select (mask m, value a, value b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+  static bool any (mask m) { return _mm_movemask_pd(m) != 0; }
+};
+
+#define SIMD_PACK_PATH "SSE2"
+
+#else
+
+struct simd_pack_t {
+  typedef double value;
+  typedef bool mask;
+  static const unsigned width = 1;
+  static value load (const double *p) { return *p; }
+  static void store (double *p, value v) { *p = v; }
+  static value set (double a) { return a; }
+  static value sqrt (value a) { return std::sqrt(a); }
+  static value min (value a, value b) { return (a < b) ? a : b; }
+  static value max (value a, value b) { return (a > b) ? a : b; }
+  static value exp (value a) { return std::exp(a); }
+  static mask less (value a, value b) { return a < b; }
+  static mask less_equal (value a, value b) { return a <= b; }
+  static mask equal (value a, value b) { return a == b; }
+  static mask both (mask a, mask b) { return a && b; }
+  static mask either (mask a, mask b) { return a || b; }
+  static mask negate (mask a) { return !a; }
+  static value select (mask m, value a, value b) { return m ? a : b; }
+  static bool any (mask m) { return m; }
+};
+
+#define SIMD_PACK_PATH "scalar"
+
+#endif
+
+#if defined (__AVX512F__) || defined (__AVX2__) || defined (__SSE2__)
+static inline simd_pack_t::value pack_exp (simd_pack_t::value x)
+  // exp(x) for the range needed by the atmosphere model: x = n*ln2 + r with |r| <= ln2/2,
+  // then a degree 11 Taylor series for exp(r), which is good to about one part in 10^15
+{
+  typedef simd_pack_t P;
+  P::value n, r, p;
+
+  x = P::min(P::max(x, P::set(-700.0)), P::set(700.0));
+  n = P::round(x*P::set(1.4426950408889634)); // log2(e)
+  r = P::fma(n, P::set(-6.93147180369123816490e-01), x); // ln2 split in two, so that n*ln2 is exact enough
+  r = P::fma(n, P::set(-1.90821492927058770002e-10), r);
+  p = P::set(1.0/39916800.0);
+  p = P::fma(p, r, P::set(1.0/3628800.0));
+  p = P::fma(p, r, P::set(1.0/362880.0));
+  p = P::fma(p, r, P::set(1.0/40320.0));
+  p = P::fma(p, r, P::set(1.0/5040.0));
+  p = P::fma(p, r, P::set(1.0/720.0));
+  p = P::fma(p, r, P::set(1.0/120.0));
+  p = P::fma(p, r, P::set(1.0/24.0));
+  p = P::fma(p, r, P::set(1.0/6.0));
+  p = P::fma(p, r, P::set(0.5));
+  p = P::fma(p, r, P::set(1.0));
+  p = P::fma(p, r, P::set(1.0));
+  return p*P::pow2(n);
+}
+#else
+static inline simd_pack_t::value pack_exp (simd_pack_t::value x)
+{
+  return simd_pack_t::exp(x);
+}
+#endif
+
+struct vector3d_pack {
+  // One vector3d per lane, as three packs
+  typedef simd_pack_t P;
+  typedef P::value V;
+
+  vector3d_pack() {}
+  vector3d_pack (V a, V b, V c) : x(a), y(b), z(c) {}
+  static vector3d_pack load (const double *px, const double *py, const double *pz) { return vector3d_pack(P::load(px), P::load(py), P::load(pz)); }
+  void store (double *px, double *py, double *pz) const { P::store(px, x); P::store(py, y); P::store(pz, z); }
+  static vector3d_pack set (const vector3d &v) { return vector3d_pack(P::set(v.x), P::set(v.y), P::set(v.z)); } // the same in every lane
+  static vector3d_pack select (P::mask m, const vector3d_pack &a, const vector3d_pack &b) {
+    return vector3d_pack(P::select(m, a.x, b.x), P::select(m, a.y, b.y), P::select(m, a.z, b.z));
+  }
+  vector3d_pack operator+ (const vector3d_pack &v) const { return vector3d_pack(x+v.x, y+v.y, z+v.z); }
+  vector3d_pack operator- (const vector3d_pack &v) const { return vector3d_pack(x-v.x, y-v.y, z-v.z); }
+  V operator* (const vector3d_pack &v) const { return x*v.x + y*v.y + z*v.z; }
+  friend vector3d_pack operator* (const vector3d_pack &v, V a) { return vector3d_pack(v.x*a, v.y*a, v.z*a); }
+  friend vector3d_pack operator* (V a, const vector3d_pack &v) { return vector3d_pack(v.x*a, v.y*a, v.z*a); }
+  vector3d_pack operator/ (V a) const { return vector3d_pack(x/a, y/a, z/a); }
+  V abs2() const { return x*x + y*y + z*z; }
+  V abs() const { return P::sqrt(abs2()); }
+  V x, y, z;
+};
+
+#endif
@@ -0,0 +1,65 @@
+// Mars lander simulator
+// Version 1.8
+// SimulationContext class implementation
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+#include "simulation_context.h"
+
+// SimulationContext class's member functions
+
+// constructor - settings that survive a reset take their GUI start-up values here,
+// everything else is overwritten by reset_simulation_state()
+SimulationContext::SimulationContext()
+{
+  altitude = 0.0; climb_speed = 0.0; ground_speed = 0.0;
+  throttle = 0.0; fuel = 1.0;
+  parachute_status = NOT_DEPLOYED;
+  parachute_lost = false;
+  landed = false; crashed = false;
+  lander_unheld = true;
+
+  scenario = 0;
+  delta_t = 0.1; simulation_time = 0.0;
+  integrator = VERLET;
+  control_interval = 0.1; adaptive_step = 0.1;
+  time_warp = false;
+  time_warp_limit = HUGE_VAL;
+  rotation_on = true; steady_wind_on = false; gust_wind_on = false;
+  moon_effect_on = false;
+  planet_rotation_angle = 0.0; planet_rotation = matrix3d();
+  gust_speed = 0.0;
+  random_state = 0x9E3779B97F4A7C15ULL;
+  telemetry = NULL;
+
+  stabilized_attitude = false; stabilized_attitude_in_plane_wrt_mars = false;
+  stabilized_attitude_angle = 0.0;
+  input_attitude_command = stabilize_command;
+  input_attitude_angle = 0.0;
+  closeup_coords.initialized = false;
+  closeup_coords.backwards = false;
+  closeup_coords.right = vector3d(1.0, 0.0, 0.0);
+  terrain_angle = 0.0;
+
+  autopilot_enabled = false;
+  current_lander_phase = let_it_be;
+  current_autopilot_mode = maintain_mode;
+  accept_input_altitude = false;
+  input_altitude = 15000;
+  target_radial_speed = 0.0; actual_radial_speed = 0.0;
+  target_tangential_speed = 0.0; actual_tangential_speed = 0.0;
+  current_radius = 0.0; target_radius = 0.0;
+  one_more_ignition_needed = false;
+  powered_descent.valid = false;
+
+  lagged_throttle = 0.0;
+  last_time_lag_updated = -1.0;
+}
@@ -0,0 +1,121 @@
+// Mars lander simulator
+// Version 1.8
+// SimulationContext class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Everything the dynamics, autopilot and attitude control routines read or
+// write lives in one SimulationContext, which they take explicitly. The GUI
+// keeps a single default instance; batch tools may create as many as they
+// like, e.g. one per thread.
+
+#ifndef __SIMULATION_CONTEXT_INCLUDED__
+#define __SIMULATION_CONTEXT_INCLUDED__
+
+#include <cmath>
+#include <deque>
+#include <vector>
+
+#include "define_constants.h"
+#include "vector3d.h"
+#include "quaternion.h"
+#include "matrix3d.h"
+#include "kepler_solver.h"
+#include "orbiting_object.h"
+#include "other_data_types.h"
+#include "powered_descent.h"
+
+using namespace std;
+
+class Telemetry_recorder;
+
+// Quantities derived from the lander state that the autopilot, attitude control, parachute checks and
+// instruments all need. update_derived_state() works them out once a step, after the integrator has
+// moved the lander, and they hold until the position, velocity or fuel next change.
+struct DerivedState
+{
+  double radius, altitude; // distance from the centre of Mars, and above the surface
+  vector3d radial; // unit vector from the centre of Mars to the lander
+  double radial_speed, tangential_speed;
+  vector3d surface_velocity, air_velocity; // of the ground directly below, and of the (possibly windy) atmosphere
+  double density, mass;
+  vector3d lander_drag, chute_drag; // drag forces, the parachute's as if it were deployed
+};
+
+class SimulationContext
+{
+  public:
+    // Lander state - velocity_from_positions, altitude, climb_speed and ground_speed are estimated
+    // from the current and last positions, so not sensitive to any errors in the velocity update
+    vector3d position, velocity;
+    quaternion attitude; // rotation from the world frame to the lander's body axes, see quaternion.h
+    vector3d previous_position; // 'x(t-dt)' used by the Verlet integrator
+    vector3d last_position, velocity_from_positions;
+    double altitude, climb_speed, ground_speed;
+    double throttle, fuel;
+    parachute_status_t parachute_status;
+    bool parachute_lost;
+    bool landed, crashed;
+    bool lander_unheld; // for launching lander
+
+    // Simulation parameters
+    unsigned short scenario;
+    double delta_t, simulation_time; // with the adaptive integrator, delta_t is the length of the last step
+    integrator_t integrator;
+    double control_interval; // longest adaptive step while the engine, parachute or autopilot need attention
+    double adaptive_step; // next step proposed by the adaptive integrator's error control
+    bool time_warp; // jump analytically along coast arcs, see kepler_coast()
+    double time_warp_limit; // never jump past this simulation time, e.g. the end of a headless run
+    bool rotation_on, steady_wind_on, gust_wind_on; // for modelling planet rotation and wind
+    bool moon_effect_on; // gravitational effect of Phobos & Deimos on lander
+    matrix3d planet_rotation; // turn of the planet in one step, while the lander is held on the launchpad
+    double planet_rotation_angle; // angle planet_rotation was worked out for, see rotate_with_planet()
+    double gust_speed; // for modelling planet rotation and wind
+    unsigned long long random_state; // per-run random number generator state
+    Telemetry_recorder *telemetry; // if not NULL, receives the state after every step
+    DerivedState derived; // see update_derived_state()
+    autopilot_gains_t autopilot_gains; // see other_data_types.h
+
+    // Phobos & Deimos
+    Orbiting_object Phobos, Deimos;
+    Kepler_solver lander_Kepler, Phobos_Kepler, Deimos_Kepler;
+
+    // Attitude control
+    bool stabilized_attitude, stabilized_attitude_in_plane_wrt_mars;
+    double stabilized_attitude_angle;
+    vector3d out_axis, left_axis, up_axis; // the lander's body axes, kept in line with attitude by set_attitude()
+    vector3d previous_out, previous_left, previous_up; // for manual attitude control
+    manual_attitude_command input_attitude_command;
+    double input_attitude_angle; // for manual attitude control
+    closeup_coords_t closeup_coords; // any-angle attitude stabilizers reference closeup_coords.right
+    double terrain_angle; // close-up terrain texture rotation, kept in step with closeup_coords
+
+    // Autopilot
+    bool autopilot_enabled;
+    lander_phases current_lander_phase;
+    autopilot_modes current_autopilot_mode;
+    bool accept_input_altitude; // for user input altitude
+    int input_altitude; // for user input altitude
+    double target_radial_speed, actual_radial_speed;
+    double target_tangential_speed, actual_tangential_speed;
+    double current_radius, target_radius;
+    bool one_more_ignition_needed;
+    powered_descent_plan_t powered_descent; // see powered_descent_guidance()
+
+    // Engine delay and lag - the delay works on simulation time, so it holds for any step length
+    deque<double> throttle_history_time, throttle_history; // throttle commands over the last ENGINE_DELAY
+    double lagged_throttle, last_time_lag_updated;
+
+    // constructor
+    SimulationContext();
+};
+
+#endif
@@ -0,0 +1,56 @@
+// Mars lander simulator
+// Version 1.8
+// Snapshot_buffer class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// A triple buffer for handing the simulation state from the thread that steps
+// it to the thread that draws it. The writer fills the back slot and publishes
+// it by swapping it with the middle slot; the reader takes the middle slot by
+// swapping it with the front slot, which it then has to itself until it next
+// takes one. Neither side ever waits for the other: the writer can publish
+// after every step however slow the drawing is, and the reader always gets the
+// most recent state published, with any in between simply overwritten.
+
+#ifndef __SNAPSHOT_BUFFER_INCLUDED__
+#define __SNAPSHOT_BUFFER_INCLUDED__
+
+#include <atomic>
+
+using namespace std;
+
+#define SNAPSHOT_FRESH 4 // set in middle when it holds a slot the reader has not taken yet
+#define SNAPSHOT_INDEX 3
+
+template <class T> class Snapshot_buffer
+{
+  private:
+    T slots[3];
+    atomic<unsigned> middle; // slot index, plus SNAPSHOT_FRESH
+    unsigned back, front; // owned by the writer and the reader respectively
+
+  public:
+    Snapshot_buffer() {back=0; middle=1; front=2;}
+
+    // writer's side - fill back(), then publish it
+    T &get_back(void) {return slots[back];}
+    void publish(void) {back = middle.exchange(back | SNAPSHOT_FRESH, memory_order_acq_rel) & SNAPSHOT_INDEX;}
+
+    // reader's side - take the latest slot published, returns false if nothing new has been published since the last take
+    bool take(void) {
+      if (!(middle.load(memory_order_relaxed) & SNAPSHOT_FRESH)) return false;
+      front = middle.exchange(front, memory_order_acq_rel) & SNAPSHOT_INDEX;
+      return true;
+    }
+    T &get_front(void) {return slots[front];}
+};
+
+#endif
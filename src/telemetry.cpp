@@ -0,0 +1,235 @@
+// Mars lander simulator
+// Version 1.8
+// Telemetry_recorder class implementation
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+#include "telemetry.h"
+#include "simulation_context.h"
+
+#define TELEMETRY_COLUMN(name, type) {#name, type, offsetof(telemetry_record_t, name)}
+
+const telemetry_column_t telemetry_columns[] = {
+  TELEMETRY_COLUMN(time, 'd'),
+  TELEMETRY_COLUMN(position_x, 'd'), TELEMETRY_COLUMN(position_y, 'd'), TELEMETRY_COLUMN(position_z, 'd'),
+  TELEMETRY_COLUMN(velocity_x, 'd'), TELEMETRY_COLUMN(velocity_y, 'd'), TELEMETRY_COLUMN(velocity_z, 'd'),
+  TELEMETRY_COLUMN(altitude, 'd'), TELEMETRY_COLUMN(throttle, 'd'), TELEMETRY_COLUMN(lagged_throttle, 'd'), TELEMETRY_COLUMN(fuel, 'd'),
+  TELEMETRY_COLUMN(energy, 'd'), TELEMETRY_COLUMN(semi_major_axis, 'd'), TELEMETRY_COLUMN(eccentricity, 'd'),
+  TELEMETRY_COLUMN(periapsis, 'd'), TELEMETRY_COLUMN(apoapsis, 'd'),
+  TELEMETRY_COLUMN(target_radial_speed, 'd'), TELEMETRY_COLUMN(actual_radial_speed, 'd'),
+  TELEMETRY_COLUMN(lander_phase, 'i'), TELEMETRY_COLUMN(autopilot_mode, 'i'), TELEMETRY_COLUMN(parachute_status, 'i'), TELEMETRY_COLUMN(flags, 'i')
+};
+const unsigned telemetry_n_columns = sizeof(telemetry_columns)/sizeof(telemetry_columns[0]);
+
+// Telemetry_recorder class's member functions
+
+// constructor
+Telemetry_recorder::Telemetry_recorder()
+{
+  head = 0;
+  tail = 0;
+  cached_tail = 0;
+  running = false;
+  dropped = 0;
+}
+
+// destructor
+Telemetry_recorder::~Telemetry_recorder()
+{
+  stop();
+}
+
+// create the file, write its header and start the writer thread
+bool Telemetry_recorder::start(string filename)
+{
+  unsigned char header[7] = {'M', 'L', 'T', 'M', TELEMETRY_VERSION, (unsigned char) (telemetry_n_columns & 0xff), (unsigned char) (telemetry_n_columns >> 8)};
+  unsigned char name_length;
+  unsigned i;
+
+  stop();
+  file.open(filename.c_str(), ios::binary | ios::trunc);
+  if (!file.good()) return false;
+  file.write((const char *) header, sizeof(header));
+  for (i=0; i<telemetry_n_columns; i++) {
+    name_length = (unsigned char) strlen(telemetry_columns[i].name);
+    file.put(telemetry_columns[i].type);
+    file.put((char) name_length);
+    file.write(telemetry_columns[i].name, name_length);
+  }
+
+  ring.resize(TELEMETRY_RING_SIZE);
+  column_buffer.resize(TELEMETRY_BLOCK_SIZE*sizeof(double));
+  head = 0;
+  tail = 0;
+  cached_tail = 0;
+  dropped = 0;
+  running = true;
+  writer = thread(&Telemetry_recorder::writer_loop, this);
+  return file.good();
+}
+
+// stop the writer thread once it has written out everything still queued, then close the file
+void Telemetry_recorder::stop(void)
+{
+  if (!running) return;
+  running = false;
+  writer.join();
+  file.close();
+}
+
+// is a file open
+bool Telemetry_recorder::is_recording(void)
+{
+  return running;
+}
+
+// copy the state after a time step into the ring - never blocks
+void Telemetry_recorder::push(const SimulationContext &sim)
+{
+  unsigned long h = head.load(memory_order_relaxed);
+  telemetry_record_t *r;
+
+  if (h - cached_tail >= TELEMETRY_RING_SIZE) {
+    cached_tail = tail.load(memory_order_acquire);
+    if (h - cached_tail >= TELEMETRY_RING_SIZE) { // writer is a whole ring behind
+      dropped++;
+      return;
+    }
+  }
+  r = &ring[h & (TELEMETRY_RING_SIZE-1)];
+  r->time = sim.simulation_time;
+  r->position_x = sim.position.x; r->position_y = sim.position.y; r->position_z = sim.position.z;
+  r->velocity_x = sim.velocity.x; r->velocity_y = sim.velocity.y; r->velocity_z = sim.velocity.z;
+  r->altitude = sim.altitude;
+  r->throttle = sim.throttle;
+  r->lagged_throttle = sim.lagged_throttle;
+  r->fuel = sim.fuel;
+  r->energy = sim.lander_Kepler.energy;
+  r->semi_major_axis = sim.lander_Kepler.a;
+  r->eccentricity = sim.lander_Kepler.e.abs();
+  r->periapsis = sim.lander_Kepler.q;
+  r->apoapsis = sim.lander_Kepler.q_complement;
+  r->target_radial_speed = sim.target_radial_speed;
+  r->actual_radial_speed = sim.actual_radial_speed;
+  r->lander_phase = (int) sim.current_lander_phase;
+  r->autopilot_mode = (int) sim.current_autopilot_mode;
+  r->parachute_status = (int) sim.parachute_status;
+  r->flags = (sim.autopilot_enabled ? 1 : 0) | (sim.landed ? 2 : 0) | (sim.crashed ? 4 : 0);
+  head.store(h+1, memory_order_release);
+}
+
+// number of records lost because the ring was full
+unsigned long Telemetry_recorder::get_dropped(void)
+{
+  return dropped;
+}
+
+// write n records from the ring, starting at position first, as one block of columns
+void Telemetry_recorder::write_block(unsigned long first, unsigned long n)
+{
+  unsigned int count = (unsigned int) n;
+  const telemetry_record_t *records = &ring[first & (TELEMETRY_RING_SIZE-1)];
+  unsigned long i;
+  unsigned c;
+  size_t offset;
+
+  if ((first & (TELEMETRY_RING_SIZE-1)) + n > TELEMETRY_RING_SIZE) { // wraps round, write as two blocks
+    i = TELEMETRY_RING_SIZE - (first & (TELEMETRY_RING_SIZE-1));
+    write_block(first, i);
+    write_block(first+i, n-i);
+    return;
+  }
+
+  file.write((const char *) &count, sizeof(count));
+  for (c=0; c<telemetry_n_columns; c++) {
+    offset = telemetry_columns[c].offset;
+    if (telemetry_columns[c].type == 'd') {
+      double *out = (double *) &column_buffer[0];
+      for (i=0; i<n; i++) out[i] = *(const double *) (((const char *) &records[i]) + offset);
+      file.write(&column_buffer[0], n*sizeof(double));
+    } else {
+      int *out = (int *) &column_buffer[0];
+      for (i=0; i<n; i++) out[i] = *(const int *) (((const char *) &records[i]) + offset);
+      file.write(&column_buffer[0], n*sizeof(int));
+    }
+  }
+}
+
+// writer thread body - drains the ring in blocks, sleeping briefly whenever it is empty
+void Telemetry_recorder::writer_loop(void)
+{
+  unsigned long t = tail.load(memory_order_relaxed), h, n;
+  bool last_pass;
+
+  while (true) {
+    last_pass = !running.load(memory_order_acquire); // once stopped, the simulation pushes nothing more
+    h = head.load(memory_order_acquire);
+    while (t != h) {
+      n = h - t;
+      if (n > TELEMETRY_BLOCK_SIZE) n = TELEMETRY_BLOCK_SIZE;
+      write_block(t, n);
+      t += n;
+      tail.store(t, memory_order_release);
+    }
+    if (last_pass) break;
+    this_thread::sleep_for(chrono::milliseconds(2));
+  }
+  file.flush();
+}
+
+// read a whole file back, integers converted to double
+bool Telemetry_recorder::read(string filename, vector<string> &names, vector< vector<double> > &columns)
+{
+  ifstream in(filename.c_str(), ios::binary);
+  unsigned char header[7];
+  vector<char> types;
+  unsigned n_columns, c;
+  unsigned int count, i;
+  int name_length, type, int_value;
+  double double_value;
+  char name[256];
+
+  in.read((char *) header, sizeof(header));
+  if ((in.gcount() != sizeof(header)) || memcmp(header, "MLTM", 4) || (header[4] != TELEMETRY_VERSION)) return false;
+  n_columns = header[5] | (header[6] << 8);
+  names.clear();
+  for (c=0; c<n_columns; c++) {
+    type = in.get();
+    name_length = in.get();
+    if ((name_length == EOF) || ((type != 'd') && (type != 'i'))) return false;
+    in.read(name, name_length);
+    names.push_back(string(name, name_length));
+    types.push_back((char) type);
+  }
+
+  columns.assign(n_columns, vector<double>());
+  while (in.read((char *) &count, sizeof(count))) {
+    vector< vector<double> > block(n_columns);
+    for (c=0; c<n_columns; c++) {
+      for (i=0; i<count; i++) {
+        if (types[c] == 'd') {
+          in.read((char *) &double_value, sizeof(double_value));
+          block[c].push_back(double_value);
+        } else {
+          in.read((char *) &int_value, sizeof(int_value));
+          block[c].push_back(int_value);
+        }
+      }
+    }
+    if (!in) break; // a block cut short by a crash is dropped
+    for (c=0; c<n_columns; c++) columns[c].insert(columns[c].end(), block[c].begin(), block[c].end());
+  }
+  return true;
+}
@@ -0,0 +1,94 @@
+// Mars lander simulator
+// Version 1.8
+// Telemetry_recorder class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Logs the lander state at every time step without slowing the simulation
+// down. The simulation thread copies one fixed-size record per step into a
+// single-producer single-consumer ring; nothing is locked and nothing is
+// allocated. A writer thread drains the ring in blocks and writes each block
+// column by column, which keeps the file compact and fast to load into
+// analysis tools. If the writer ever falls a whole ring behind, records are
+// dropped rather than holding up the simulation, and the count is reported.
+//
+// File layout (native byte order, little-endian on all supported platforms):
+//   header  "MLTM", version byte, 2 byte column count,
+//           then per column a type byte ('d' double or 'i' 32 bit int), a name length byte and the name
+//   block   4 byte record count n, then for each column in turn its n values
+// telemetry_csv converts a file to CSV.
+
+#ifndef __TELEMETRY_INCLUDED__
+#define __TELEMETRY_INCLUDED__
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_RING_SIZE 65536 // records, must be a power of two
+#define TELEMETRY_BLOCK_SIZE 4096 // most records per block written
+
+class SimulationContext;
+
+// One record per time step
+struct telemetry_record_t {
+  double time;
+  double position_x, position_y, position_z;
+  double velocity_x, velocity_y, velocity_z;
+  double altitude, throttle, lagged_throttle, fuel;
+  double energy, semi_major_axis, eccentricity, periapsis, apoapsis; // lander_Kepler's elements
+  double target_radial_speed, actual_radial_speed; // as seen by the autopilot
+  int lander_phase, autopilot_mode, parachute_status, flags; // flags: 1 autopilot on, 2 landed, 4 crashed
+};
+
+// Column descriptions, in file order
+struct telemetry_column_t {
+  const char *name;
+  char type;
+  size_t offset;
+};
+extern const telemetry_column_t telemetry_columns[];
+extern const unsigned telemetry_n_columns;
+
+class Telemetry_recorder
+{
+  private:
+    vector<telemetry_record_t> ring;
+    atomic<unsigned long> head, tail; // written by the simulation and the writer thread respectively
+    unsigned long cached_tail; // simulation's last look at tail, so it need not touch the writer's cache line every step
+    atomic<bool> running;
+    unsigned long dropped;
+    ofstream file;
+    thread writer;
+    vector<char> column_buffer;
+
+    void write_block(unsigned long first, unsigned long n);
+    void writer_loop(void);
+
+  public:
+    Telemetry_recorder(); // constructor
+    ~Telemetry_recorder();
+    bool start(string filename); // create the file and start the writer thread
+    void stop(void); // write out everything still queued and close the file
+    bool is_recording(void);
+    void push(const SimulationContext &sim); // called from the simulation thread after each step
+    unsigned long get_dropped(void);
+
+    // read a whole file back, integers converted to double, returns false if it is not a telemetry file
+    static bool read(string filename, vector<string> &names, vector< vector<double> > &columns);
+};
+
+#endif
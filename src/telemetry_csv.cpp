@@ -0,0 +1,57 @@
+// Mars lander simulator
+// Version 1.8
+// Telemetry to CSV converter
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Converts a telemetry file written by Telemetry_recorder to CSV, one row per
+// time step with the column names as the first row.
+//
+// Usage: ./telemetry_csv telemetry.mltm [output.csv]
+
+#include <iostream>
+
+#include "telemetry.h"
+
+int main (int argc, char* argv[])
+{
+  vector<string> names;
+  vector< vector<double> > columns;
+  ofstream file;
+  unsigned long row;
+  unsigned c;
+
+  if ((argc < 2) || (argc > 3)) {
+    cerr << "Usage: " << argv[0] << " telemetry_file [csv_file]" << endl;
+    return 1;
+  }
+  if (!Telemetry_recorder::read(argv[1], names, columns)) {
+    cerr << "Cannot read telemetry file " << argv[1] << endl;
+    return 1;
+  }
+  if (argc == 3) {
+    file.open(argv[2]);
+    if (!file.good()) {
+      cerr << "Cannot create " << argv[2] << endl;
+      return 1;
+    }
+  }
+  ostream &out = (argc == 3) ? file : cout;
+
+  out.precision(17); // enough to read every double back exactly
+  for (c=0; c<names.size(); c++) out << (c ? "," : "") << names[c];
+  out << "\n";
+  for (row=0; !columns.empty() && (row<columns[0].size()); row++) {
+    for (c=0; c<columns.size(); c++) out << (c ? "," : "") << columns[c][row];
+    out << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,444 @@
+// Mars lander simulator
+// Version 1.8
+// Texture_loader class implementation
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+#include <cstring>
+#include <sys/stat.h>
+
+#include "texture_loader.h"
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+#ifdef WIN32
+// opengl32.dll stops at OpenGL 1.1, so glCompressedTexImage2D (OpenGL 1.3) is looked up in the driver
+typedef void (APIENTRY *gl_compressed_tex_image_2d_t) (GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height,
+                                                        GLint border, GLsizei image_size, const void *data);
+static gl_compressed_tex_image_2d_t gl_compressed_tex_image_2d = NULL;
+#define glCompressedTexImage2D gl_compressed_tex_image_2d
+#endif
+
+static long level_size (texture_format_t format, int width, int height)
+  // Bytes in one mip level - DXT1 packs each 4x4 block, or part block at the edges, into 8 bytes
+{
+  if (format == TEXTURE_DXT1) return 8L*((width+3)/4)*((height+3)/4);
+  else if (format == TEXTURE_LUMINANCE) return (long) width*height;
+  else return 3L*width*height;
+}
+
+static int nearest_power_of_two (int n)
+  // The size gluBuild2DMipmaps() scales to: n rounded to a power of two, down except from 3*2^k
+{
+  int power = 1;
+
+  while (n > 1) {
+    if (n == 3) return 4*power;
+    n >>= 1;
+    power *= 2;
+  }
+  return power;
+}
+
+static void scale_image (const unsigned char *in, int width, int height, int channels, unsigned char *out, int new_width, int new_height)
+  // Resamples an image bilinearly, pixel centre to pixel centre
+{
+  double fx, fy, tx, ty;
+  int x, y, c, x0, x1, y0, y1;
+
+  for (y=0; y<new_height; y++) {
+    fy = fmin(fmax((y+0.5)*height/new_height - 0.5, 0.0), height-1.0);
+    y0 = (int) fy; y1 = min(y0+1, height-1); ty = fy - y0;
+    for (x=0; x<new_width; x++) {
+      fx = fmin(fmax((x+0.5)*width/new_width - 0.5, 0.0), width-1.0);
+      x0 = (int) fx; x1 = min(x0+1, width-1); tx = fx - x0;
+      for (c=0; c<channels; c++) {
+        *out++ = (unsigned char) (0.5 + (1.0-ty)*((1.0-tx)*in[(y0*width+x0)*channels+c] + tx*in[(y0*width+x1)*channels+c])
+                                       + ty*((1.0-tx)*in[(y1*width+x0)*channels+c] + tx*in[(y1*width+x1)*channels+c]));
+      }
+    }
+  }
+}
+
+static void halve_image (const unsigned char *in, int width, int height, int channels, unsigned char *out)
+  // The next mip level down: each pixel the average of the 2x2 block above it, or 2x1 once a side is down to 1
+{
+  int x, y, c, dx = (width > 1) ? channels : 0, dy = (height > 1) ? channels*width : 0;
+  const unsigned char *p;
+
+  for (y=0; y<max(height/2, 1); y++) for (x=0; x<max(width/2, 1); x++) for (c=0; c<channels; c++) {
+    p = in + (2*y*width + 2*x)*channels + c;
+    *out++ = (unsigned char) ((p[0] + p[dx] + p[dy] + p[dx+dy] + 2)/4);
+  }
+}
+
+static void compress_block (const unsigned char *rgb, int width, int height, int bx, int by, unsigned char *block)
+  // One 4x4 block of a DXT1 texture, with the end colours at the corners of the block's colour bounding box
+  // that follow the way red and blue vary with green
+{
+  unsigned char pixel[16][3];
+  int i, c, lo[3], hi[3], inset, end[2][3], palette[4][3], mean[3], covariance, best, distance, d, tmp;
+  unsigned colour[2], indices = 0;
+
+  for (i=0; i<16; i++) for (c=0; c<3; c++) pixel[i][c] = rgb[(min(by+i/4, height-1)*width + min(bx+i%4, width-1))*3 + c];
+  for (c=0; c<3; c++) {
+    lo[c] = 255; hi[c] = 0; mean[c] = 0;
+    for (i=0; i<16; i++) {
+      lo[c] = min(lo[c], (int) pixel[i][c]);
+      hi[c] = max(hi[c], (int) pixel[i][c]);
+      mean[c] += pixel[i][c];
+    }
+    inset = (hi[c] - lo[c])/16; // pulls the ends in from outlying pixels
+    end[0][c] = hi[c] - inset;
+    end[1][c] = lo[c] + inset;
+  }
+  for (c=0; c<3; c+=2) { // red and blue falling as green rises: swap their ends
+    covariance = 0;
+    for (i=0; i<16; i++) covariance += (16*pixel[i][c] - mean[c])*(16*pixel[i][1] - mean[1]);
+    if (covariance < 0) {
+      tmp = end[0][c]; end[0][c] = end[1][c]; end[1][c] = tmp;
+    }
+  }
+  for (i=0; i<2; i++) colour[i] = ((end[i][0] >> 3) << 11) | ((end[i][1] >> 2) << 5) | (end[i][2] >> 3);
+  if (colour[0] < colour[1]) { // four colour blocks need the larger end first
+    tmp = colour[0]; colour[0] = colour[1]; colour[1] = tmp;
+  }
+  for (i=0; i<2; i++) {
+    palette[i][0] = ((colour[i] >> 11) << 3) | (colour[i] >> 13);
+    palette[i][1] = (((colour[i] >> 5) & 63) << 2) | ((colour[i] >> 9) & 3);
+    palette[i][2] = ((colour[i] & 31) << 3) | ((colour[i] >> 2) & 7);
+  }
+  for (c=0; c<3; c++) {
+    palette[2][c] = (2*palette[0][c] + palette[1][c])/3;
+    palette[3][c] = (palette[0][c] + 2*palette[1][c])/3;
+  }
+  if (colour[0] > colour[1]) for (i=0; i<16; i++) { // otherwise the block is flat, and every index 0
+    best = 0; distance = 1 << 30;
+    for (tmp=0; tmp<4; tmp++) {
+      d = 0;
+      for (c=0; c<3; c++) d += (pixel[i][c] - palette[tmp][c])*(pixel[i][c] - palette[tmp][c]);
+      if (d < distance) {
+        distance = d;
+        best = tmp;
+      }
+    }
+    indices |= best << (2*i);
+  }
+  block[0] = colour[0] & 255; block[1] = colour[0] >> 8;
+  block[2] = colour[1] & 255; block[3] = colour[1] >> 8;
+  for (i=0; i<4; i++) block[4+i] = (indices >> (8*i)) & 255;
+}
+
+static bool parse_levels (const char *text, long size, const texture_cache_header_t &header, vector<texture_level_t> &levels)
+  // Finds the mip levels that follow a cache header, checking that each is the size its format calls for and
+  // that they go all the way down to 1x1
+{
+  texture_level_t level;
+  unsigned int bytes;
+  long position = 0;
+  int i;
+
+  levels.clear();
+  level.width = header.width;
+  level.height = header.height;
+  for (i=0; i<header.levels; i++) {
+    if (position + 4 > size) return false;
+    memcpy(&bytes, text + position, 4);
+    level.size = level_size((texture_format_t) header.format, level.width, level.height);
+    if (((long) bytes != level.size) || (position + 4 + level.size > size)) return false;
+    level.data = (const unsigned char*) text + position + 4;
+    levels.push_back(level);
+    position += 4 + ((level.size + 3) & ~3L);
+    if ((level.width == 1) && (level.height == 1)) break;
+    level.width = max(level.width/2, 1);
+    level.height = max(level.height/2, 1);
+  }
+  return (i == header.levels-1) && (position == size);
+}
+
+static bool load_cache (texture_job_t &job, string cache_filename, long long source_size, long long source_time)
+  // The texture's levels from its cache file, if that is up to date
+{
+  texture_cache_header_t header;
+  const char *source;
+  long size;
+  bool up_to_date;
+
+  if ((job.cache_text = map_file(cache_filename, job.cache_size)) == NULL) return false;
+  up_to_date = (job.cache_size >= (long) sizeof(header));
+  if (up_to_date) {
+    memcpy(&header, job.cache_text, sizeof(header));
+    up_to_date = !memcmp(header.magic, "MLTC", 4) && (header.version == TEXTURE_CACHE_VERSION) && (header.format == job.format)
+      && (header.source_size == source_size) && (header.width > 0) && (header.height > 0)
+      && parse_levels(job.cache_text + sizeof(header), job.cache_size - sizeof(header), header, job.levels);
+  }
+
+  // A generated texture must have the same key; an image with a changed modification time alone (copied, say)
+  // costs a hash of the file, not a decode
+  if (up_to_date && (job.generator != NULL)) up_to_date = (header.source_hash == job.key);
+  else if (up_to_date && (header.source_time != source_time)) {
+    up_to_date = ((source = map_file(job.filename, size)) != NULL) && (hash_bytes(source, size) == header.source_hash);
+    if (source != NULL) unmap_file(source, size);
+    if (up_to_date) {
+      header.source_time = source_time;
+      fstream out(cache_filename.c_str(), ios::binary | ios::in | ios::out);
+      out.write((const char*) &header, sizeof(header));
+    }
+  }
+  if (!up_to_date) {
+    unmap_file(job.cache_text, job.cache_size);
+    job.cache_text = NULL;
+    job.levels.clear();
+  }
+  return up_to_date;
+}
+
+static bool make_levels (texture_job_t &job, const unsigned char *image, int width, int height, texture_cache_header_t &header)
+  // Scales an image to powers of two as gluBuild2DMipmaps() would and makes its chain of mip levels, compressed
+  // if the job asks for it, in job.pixels laid out as in the cache file
+{
+  int channels = (job.format == TEXTURE_LUMINANCE) ? 1 : 3, x, y;
+  vector<unsigned char> level, next;
+  unsigned int bytes;
+  long position;
+
+  header.width = nearest_power_of_two(width);
+  header.height = nearest_power_of_two(height);
+  level.resize((size_t) header.width*header.height*channels);
+  if ((header.width == width) && (header.height == height)) memcpy(&level[0], image, level.size());
+  else scale_image(image, width, height, channels, &level[0], header.width, header.height);
+
+  job.pixels.clear();
+  width = header.width;
+  height = header.height;
+  for (header.levels=1; ; header.levels++) {
+    bytes = (unsigned int) level_size(job.format, width, height);
+    position = job.pixels.size();
+    job.pixels.resize(position + 4 + ((bytes + 3) & ~3U), 0);
+    memcpy(&job.pixels[position], &bytes, 4);
+    if (job.format == TEXTURE_DXT1) {
+      for (y=0; y<height; y+=4) for (x=0; x<width; x+=4) compress_block(&level[0], width, height, x, y, &job.pixels[position + 4 + 8*((y/4)*((width+3)/4) + x/4)]);
+    } else memcpy(&job.pixels[position+4], &level[0], bytes);
+    if ((width == 1) && (height == 1)) break;
+    next.resize((size_t) max(width/2, 1)*max(height/2, 1)*channels);
+    halve_image(&level[0], width, height, channels, &next[0]);
+    level.swap(next);
+    width = max(width/2, 1);
+    height = max(height/2, 1);
+  }
+  return parse_levels((const char*) &job.pixels[0], job.pixels.size(), header, job.levels);
+}
+
+static void save_cache (const texture_job_t &job, string cache_filename, const texture_cache_header_t &header)
+  // Writes the levels to the cache file, by way of a temporary file so that no other run sees half a cache
+{
+  string temporary_filename = cache_filename + ".tmp";
+  ofstream out(temporary_filename.c_str(), ios::binary | ios::trunc);
+
+  out.write((const char*) &header, sizeof(header));
+  out.write((const char*) &job.pixels[0], job.pixels.size());
+  out.close();
+  if (!out.good()) remove(temporary_filename.c_str()); // e.g. a read-only directory - just make it again next time
+  else {
+    remove(cache_filename.c_str()); // rename() will not replace a file on Windows
+    rename(temporary_filename.c_str(), cache_filename.c_str());
+  }
+}
+
+static void load_texture (texture_job_t *job)
+  // The body of a loader thread: the texture's levels from its cache, or else made from the image, or by the
+  // generator, and cached for next time
+{
+  string cache_filename = (job->generator != NULL) ? job->filename : job->filename + TEXTURE_CACHE_SUFFIX;
+  texture_cache_header_t header;
+  struct stat file_status;
+  vector<unsigned char> generated;
+  unsigned char *image = NULL;
+  const char *source;
+  long size;
+  int width, height, channels;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "MLTC", 4);
+  header.version = TEXTURE_CACHE_VERSION;
+  header.format = job->format;
+  if (job->generator != NULL) {
+    if (!load_cache(*job, cache_filename, 0, 0) && job->generator(job->key, generated, width, height)
+        && ((long) generated.size() == (long) width*height) && (width > 0) && (height > 0)) {
+      header.source_hash = job->key;
+      if (make_levels(*job, &generated[0], width, height, header)) save_cache(*job, cache_filename, header);
+    }
+  } else if ((stat(job->filename.c_str(), &file_status) == 0) && !load_cache(*job, cache_filename, file_status.st_size, file_status.st_mtime)
+             && ((source = map_file(job->filename, size)) != NULL)) {
+    image = SOIL_load_image_from_memory((const unsigned char*) source, size, &width, &height, &channels, SOIL_LOAD_RGB);
+    header.source_size = file_status.st_size;
+    header.source_time = file_status.st_mtime;
+    header.source_hash = hash_bytes(source, size);
+    unmap_file(source, size);
+    if ((image != NULL) && make_levels(*job, image, width, height, header)) save_cache(*job, cache_filename, header);
+    if (image != NULL) SOIL_free_image_data(image);
+  }
+  job->loaded.store(true, memory_order_release);
+}
+
+static bool upload_texture (texture_job_t &job)
+  // Makes a mipmapped texture from the loaded levels, in the current GL context, leaving out any levels too
+  // large for it
+{
+  GLint max_size = 0;
+  GLuint id;
+  unsigned i, first = 0;
+
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+  while ((first+1 < job.levels.size()) && ((job.levels[first].width > max_size) || (job.levels[first].height > max_size))) first++;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D, id);
+  if (glGetError() != GL_NO_ERROR) {
+    cerr << "Error when binding " << id << endl;
+    return false;
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // the rows of the small RGB levels are not whole words
+  for (i=first; i<job.levels.size(); i++) {
+    const texture_level_t &level = job.levels[i];
+    if (job.format == TEXTURE_DXT1) glCompressedTexImage2D(GL_TEXTURE_2D, i-first, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, level.width, level.height, 0, level.size, level.data);
+    else if (job.format == TEXTURE_LUMINANCE) glTexImage2D(GL_TEXTURE_2D, i-first, GL_LUMINANCE, level.width, level.height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, level.data);
+    else glTexImage2D(GL_TEXTURE_2D, i-first, GL_RGB, level.width, level.height, 0, GL_RGB, GL_UNSIGNED_BYTE, level.data);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  if (glGetError() != GL_NO_ERROR) {
+    cerr << "Error when creating texture image " << id << endl;
+    glDeleteTextures(1, &id);
+    return false;
+  }
+  *job.id = id; // only now will the drawing code use it
+  return true;
+}
+
+static void release_levels (texture_job_t &job)
+  // Frees the loaded levels, once uploaded or no longer wanted
+{
+  if (job.cache_text != NULL) unmap_file(job.cache_text, job.cache_size);
+  job.cache_text = NULL;
+  job.levels.clear();
+  vector<unsigned char>().swap(job.pixels);
+}
+
+// Texture_loader class's member functions
+
+// destructor
+Texture_loader::~Texture_loader()
+{
+  list<texture_job_t>::iterator job;
+
+  for (job=jobs.begin(); job!=jobs.end(); job++) {
+    if (job->loader.joinable()) job->loader.join();
+    release_levels(*job);
+  }
+}
+
+// S3TC for the image textures loaded from now on, if the current context has it
+void Texture_loader::set_compression(bool on)
+{
+  const char *extensions = (const char *) glGetString(GL_EXTENSIONS);
+
+  compress = on && (extensions != NULL) && (strstr(extensions, "GL_EXT_texture_compression_s3tc") != NULL);
+#ifdef WIN32
+  if (compress) {
+    gl_compressed_tex_image_2d = (gl_compressed_tex_image_2d_t) wglGetProcAddress("glCompressedTexImage2D");
+    compress = (gl_compressed_tex_image_2d != NULL);
+  }
+#endif
+}
+
+// a new job, not yet started
+texture_job_t& Texture_loader::add_job(string filename, int window, GLuint &id)
+{
+  texture_job_t &job = *jobs.emplace(jobs.end());
+
+  job.filename = filename;
+  job.generator = NULL;
+  job.key = 0;
+  job.format = compress ? TEXTURE_DXT1 : TEXTURE_RGB;
+  job.window = window;
+  job.id = &id;
+  job.loaded.store(false);
+  job.cache_text = NULL;
+  job.cache_size = 0;
+  return job;
+}
+
+// start loading an image for a window
+void Texture_loader::start(string filename, int window, GLuint &id)
+{
+  texture_job_t &job = add_job(filename, window, id);
+
+  job.loader = thread(load_texture, &job);
+}
+
+// start making a generated luminance texture for a window, or loading it from cache_filename
+void Texture_loader::start(string cache_filename, unsigned long long key, texture_generator_t generator, int window, GLuint &id)
+{
+  texture_job_t &job = add_job(cache_filename, window, id);
+
+  job.generator = generator;
+  job.key = key;
+  job.format = TEXTURE_LUMINANCE;
+  job.loader = thread(load_texture, &job);
+}
+
+// upload the textures loaded so far, returns how many; failed is set if any could not be had
+int Texture_loader::poll(bool &failed)
+{
+  list<texture_job_t>::iterator job;
+  int window, uploaded = 0;
+
+  failed = false;
+  if (jobs.empty()) return 0;
+  window = glutGetWindow();
+  job = jobs.begin();
+  while (job != jobs.end()) {
+    if (!job->loaded.load(memory_order_acquire)) {
+      job++;
+      continue;
+    }
+    job->loader.join();
+    if (job->levels.empty()) {
+      cerr << "Cannot load texture " << job->filename << endl;
+      failed = true;
+    } else {
+      glutSetWindow(job->window);
+      if (upload_texture(*job)) {
+        glutPostRedisplay();
+        uploaded++;
+      } else failed = true;
+    }
+    release_levels(*job);
+    job = jobs.erase(job);
+  }
+  if (window) glutSetWindow(window);
+  return uploaded;
+}
+
+// are any textures not yet uploaded
+bool Texture_loader::busy(void)
+{
+  return !jobs.empty();
+}
@@ -0,0 +1,109 @@
+// Mars lander simulator
+// Version 1.8
+// Texture_loader class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Loads image textures in the background. Each image is loaded on a thread of
+// its own, so the loads run side by side and the windows can draw straight
+// away; poll(), from the GLUT idle function, uploads each texture to its
+// window's GL context once it is loaded. GL calls stay on the GLUT thread.
+// A texture handle stays 0 until its texture is uploaded, and the drawing code
+// shows its untextured version of the object until then.
+//
+// The first load of an image decodes it with SOIL, scales it to powers of two
+// as gluBuild2DMipmaps() would, makes its whole chain of mipmaps and writes
+// them to a cache file next to the image; later loads map the cache, and the
+// upload is then just one glTexImage2D() per mip level, with no work on the CPU.
+// Generated textures are cached the same way, under a key that stands for
+// everything they are made from. With compression on (see set_compression()) the
+// mipmaps are S3TC (DXT1) compressed, a sixth of the size to load and upload.
+// The cache is used only if it was made in the same format from an image of the
+// same size and modification time, or failing that the same contents.
+//
+// Cache file layout (native byte order), <image file>.mltc:
+//   header  "MLTC", version byte, format byte, 2 zero bytes, then 8 bytes each: the image file's size,
+//           modification time and hash (or 0, 0 and the key of a generated texture), then 4 bytes each:
+//           the width, height and number of mip levels of the texture, and 4 zero bytes
+//   levels  for each mip level, largest first down to 1x1: its size in bytes (4 bytes), then the level
+//           as glTexImage2D() or glCompressedTexImage2D() takes it, padded to a multiple of 4 bytes
+
+#ifndef __TEXTURE_LOADER_INCLUDED__
+#define __TEXTURE_LOADER_INCLUDED__
+
+#include <atomic>
+#include <list>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "global_1.h"
+
+using namespace std;
+
+#define TEXTURE_CACHE_VERSION 1
+#define TEXTURE_CACHE_SUFFIX ".mltc"
+
+enum texture_format_t { TEXTURE_RGB = 0, TEXTURE_LUMINANCE = 1, TEXTURE_DXT1 = 2 };
+
+struct texture_cache_header_t {
+  char magic[4];
+  unsigned char version, format, unused[2];
+  long long source_size, source_time;
+  unsigned long long source_hash;
+  int width, height, levels, unused_2;
+};
+
+// Makes the largest mip level of a generated luminance texture from its key - called on a loader thread
+typedef bool (*texture_generator_t) (unsigned long long key, vector<unsigned char> &pixels, int &width, int &height);
+
+// One mip level, ready for upload
+struct texture_level_t {
+  int width, height;
+  long size; // bytes
+  const unsigned char *data;
+};
+
+// One texture on its way to the GPU
+struct texture_job_t {
+  string filename; // the image file, or for a generated texture its cache file
+  texture_generator_t generator; // NULL for an image file
+  unsigned long long key; // what a generated texture is made from
+  texture_format_t format;
+  int window; // the GLUT window whose context the texture belongs to
+  GLuint *id; // set when the texture is uploaded
+  thread loader;
+  atomic<bool> loaded; // levels are ready, or empty if the texture could not be had
+  vector<texture_level_t> levels;
+  const char *cache_text; // the mapped cache file, if the levels are in it
+  long cache_size;
+  vector<unsigned char> pixels; // otherwise the levels, just made
+};
+
+class Texture_loader
+{
+  private:
+    list<texture_job_t> jobs; // a list, since the jobs cannot be moved while their threads run
+    bool compress;
+
+    texture_job_t& add_job(string filename, int window, GLuint &id);
+
+  public:
+    Texture_loader() {compress=false;}
+    ~Texture_loader(); // waits for any loads still running
+    void set_compression(bool on); // S3TC for the image textures loaded from now on, if the current context has it
+    void start(string filename, int window, GLuint &id); // start loading an image for a window
+    void start(string cache_filename, unsigned long long key, texture_generator_t generator, int window, GLuint &id); // a generated texture
+    int poll(bool &failed); // upload the textures loaded so far, returns how many; failed is set if any could not be had
+    bool busy(void); // are any textures not yet uploaded
+};
+
+#endif
@@ -0,0 +1,94 @@
+// Mars lander simulator
+// Version 1.8
+// Work_stealing_pool class implementation
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+#include "thread_pool.h"
+
+// Work_stealing_pool class's member functions
+
+// constructor
+Work_stealing_pool::Work_stealing_pool(unsigned threads)
+{
+  unsigned i;
+
+  n_threads = threads;
+  if (n_threads == 0) n_threads = thread::hardware_concurrency();
+  if (n_threads == 0) n_threads = 1; // hardware_concurrency() may not know
+  for (i=0; i<n_threads; i++) queues.push_back(new worker_queue_t);
+}
+
+// destructor
+Work_stealing_pool::~Work_stealing_pool()
+{
+  unsigned i;
+
+  for (i=0; i<n_threads; i++) delete queues[i];
+}
+
+// get number of threads
+unsigned Work_stealing_pool::get_threads(void) const
+{
+  return n_threads;
+}
+
+// take the next task from the back of this thread's own deque
+bool Work_stealing_pool::pop_local(unsigned thread_id, unsigned long &task)
+{
+  lock_guard<mutex> guard(queues[thread_id]->lock);
+
+  if (queues[thread_id]->tasks.empty()) return false;
+  task = queues[thread_id]->tasks.back();
+  queues[thread_id]->tasks.pop_back();
+  return true;
+}
+
+// take a task from the front of another thread's deque, trying each victim in turn
+bool Work_stealing_pool::steal(unsigned thread_id, unsigned long &task)
+{
+  unsigned i, victim;
+
+  for (i=1; i<n_threads; i++) {
+    victim = (thread_id + i) % n_threads;
+    lock_guard<mutex> guard(queues[victim]->lock);
+    if (!queues[victim]->tasks.empty()) {
+      task = queues[victim]->tasks.front();
+      queues[victim]->tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+// worker thread body, runs until there is nothing left to take or steal
+void Work_stealing_pool::worker(unsigned thread_id, const function<void(unsigned long, unsigned)> &task_function)
+{
+  unsigned long task;
+
+  // No tasks are added once the run has started, so an empty sweep of all deques means we are done
+  while (pop_local(thread_id, task) || steal(thread_id, task)) task_function(task, thread_id);
+}
+
+// run all tasks
+void Work_stealing_pool::run(unsigned long n_tasks, const function<void(unsigned long, unsigned)> &task_function)
+{
+  unsigned long t;
+  unsigned i;
+  vector<thread> threads;
+
+  // Deal out contiguous blocks, so that each thread starts on its own part of the range
+  for (t=0; t<n_tasks; t++) queues[(unsigned)((t*n_threads)/n_tasks)]->tasks.push_front(t);
+
+  for (i=1; i<n_threads; i++) threads.push_back(thread(&Work_stealing_pool::worker, this, i, cref(task_function)));
+  worker(0, task_function); // the calling thread does its share too
+  for (i=0; i<threads.size(); i++) threads[i].join();
+}
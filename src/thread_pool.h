@@ -0,0 +1,56 @@
+// Mars lander simulator
+// Version 1.8
+// Work_stealing_pool class header
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Runs a batch of independent tasks, numbered 0 to n-1, on a fixed number of
+// threads. Each thread owns a deque of task numbers: it takes work from the
+// back of its own deque and, once that is empty, steals from the front of
+// another thread's deque. Tasks that take wildly different times (a gusty
+// descent vs. an early crash) therefore never leave a core idle while work
+// remains queued elsewhere.
+
+#ifndef __THREAD_POOL_INCLUDED__
+#define __THREAD_POOL_INCLUDED__
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class Work_stealing_pool
+{
+  private:
+    struct worker_queue_t {
+      mutex lock;
+      deque<unsigned long> tasks;
+    };
+    unsigned n_threads;
+    vector<worker_queue_t*> queues;
+
+    bool pop_local(unsigned thread_id, unsigned long &task);
+    bool steal(unsigned thread_id, unsigned long &task);
+    void worker(unsigned thread_id, const function<void(unsigned long, unsigned)> &task_function);
+
+  public:
+    Work_stealing_pool(unsigned threads = 0); // constructor, zero means one thread per core
+    ~Work_stealing_pool();
+    unsigned get_threads(void) const;
+
+    // run task_function(task, thread_id) for every task in [0, n_tasks), returns when all are done
+    void run(unsigned long n_tasks, const function<void(unsigned long, unsigned)> &task_function);
+};
+
+#endif
@@ -0,0 +1,547 @@
+// Mars lander simulator
+// Version 1.8
+// Autopilot gain tuner
+// Thanh T Bui, October 2026
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation, to make use of it
+// for non-commercial purposes, provided that (a) its original authorship
+// is acknowledged and (b) no modified versions of the source code are
+// published. Restriction (b) is designed to protect the integrity of the
+// exercise for future generations of students. The authors would be happy
+// to receive any suggested modifications by private correspondence to
+// ahg@eng.cam.ac.uk, gc121@eng.cam.ac.uk, and dvan2@cam.ac.uk.
+
+// Searches for the descent gains of autopilot_gains_t that use the least fuel
+// while every landing stays within MAX_IMPACT_DESCENT_RATE and
+// MAX_IMPACT_GROUND_SPEED. Each candidate is flown headless in every chosen
+// scenario, once in calm air and once per gust seed, on a work-stealing thread
+// pool. The search is CMA-ES (covariance matrix adaptation) on the logarithms of
+// the gains, starting from the hand-tuned defaults. A candidate's cost is the
+// mean over its runs of the fuel used, or for a crash FUEL_CAPACITY plus a
+// penalty that grows with the touchdown speed, so the search is led back
+// towards safe landings. The gain set written out is the cheapest one found
+// for which every run landed safely.
+//
+// Two things keep a generation down to seconds:
+//
+// - Most of a descent is spent coasting with the engine off, and while that
+//   lasts the gains make no difference. A reference run per scenario and seed,
+//   flown once with the engine held off, keeps a checkpoint every
+//   CHECKPOINT_STEPS steps and, for every SUMMARY_STEPS steps, the least
+//   altitude and radial speed and the greatest hover throttle that the
+//   autopilot saw. From these each candidate can tell the last point before
+//   its own gains could have opened the throttle or deployed the parachute,
+//   and it starts from the checkpoint before that point. The result is exactly
+//   that of a run from the start.
+//
+// - A run stops as soon as the lander cannot reach the ground slowly enough
+//   even with full thrust, the densest air and the parachute, and is scored as
+//   a crash at the least touchdown speed it could still manage.
+//
+// Usage: ./tune_autopilot [--scenarios=1,4,5] [--seeds=N] [--generations=N] [--population=N]
+//                         [--threads=N] [--seed=N] [--time-limit=seconds] [--output=file]
+
+#include <algorithm>
+
+#include "lander_dynamics.h"
+#include "thread_pool.h"
+
+#define N_TUNED_GAINS 6 // the descent gains, see tuned_gains[]
+#define CHECKPOINT_STEPS 500 // steps between reference run checkpoints
+#define SUMMARY_STEPS 10 // steps per reference run summary
+#define MAX_GUST_SPEED 121.3 // (m/s) greatest gust weibull_random_number() can return, from a 53 bit uniform number
+#define HOPELESS_SPEED (2.0*MAX_IMPACT_DESCENT_RATE) // stop runs that cannot touch down slower than this
+#define CRASH_PENALTY 100.0 // (l per m/s) of touchdown speed over the limits
+
+// The gains searched over, with the range each is kept within
+struct tuned_gain_t {
+  double autopilot_gains_t::*value;
+  double lowest, highest;
+};
+
+const tuned_gain_t tuned_gains[N_TUNED_GAINS] = {
+  {&autopilot_gains_t::kp, 0.02, 5.0},
+  {&autopilot_gains_t::entry_speed, 50.0, 2000.0},
+  {&autopilot_gains_t::entry_kh, 0.00001, 0.05},
+  {&autopilot_gains_t::landing_speed, 0.05, 0.95*MAX_IMPACT_DESCENT_RATE},
+  {&autopilot_gains_t::landing_kh, 0.002, 1.0},
+  {&autopilot_gains_t::switch_altitude, 1000.0, 50000.0}
+};
+
+// What the autopilot saw during SUMMARY_STEPS steps of a reference run
+struct coast_summary_t {
+  bool uses_gains; // a phase other than viva_la_vida that reads the gains, i.e. let_it_go
+  bool descending; // some of the steps were in viva_la_vida
+  double lowest_altitude, lowest_radial_speed, highest_offset; // over the viva_la_vida steps
+};
+
+// One scenario and gust seed, with its reference run
+struct tuning_run_t {
+  unsigned short scenario;
+  bool gust_wind_on;
+  unsigned long long seed;
+  vector<SimulationContext> checkpoints; // after 0, CHECKPOINT_STEPS, 2*CHECKPOINT_STEPS... steps
+  vector<coast_summary_t> summaries; // of steps 0 to SUMMARY_STEPS-1, and so on
+};
+
+// Outcome of one run of one candidate
+struct run_outcome_t {
+  bool safe;
+  double cost, fuel_used;
+  unsigned long steps; // flown, not counting those shared with the reference run
+};
+
+// Settings of the search
+struct tuner_settings_t {
+  vector<unsigned short> scenarios;
+  unsigned gust_seeds, generations, population, threads;
+  unsigned long long seed;
+  double time_limit;
+  string output_filename;
+};
+
+// A candidate and how it did over all the runs
+struct candidate_t {
+  double x[N_TUNED_GAINS]; // logarithms of the gains over their defaults
+  autopilot_gains_t gains;
+  double cost, penalty, fuel_used;
+  bool safe;
+};
+
+autopilot_gains_t gains_from_point (const double x[], double &penalty)
+  // Gains at a point of the search space, with those outside their ranges brought back to the nearest end
+  // and the squared distance moved returned as a penalty
+{
+  autopilot_gains_t defaults, gains;
+  double g;
+  unsigned i;
+
+  penalty = 0.0;
+  for (i=0; i<N_TUNED_GAINS; i++) {
+    g = defaults.*tuned_gains[i].value*exp(x[i]);
+    if (g < tuned_gains[i].lowest) {
+      penalty += pow(log(tuned_gains[i].lowest/g), 2.0);
+      g = tuned_gains[i].lowest;
+    }
+    if (g > tuned_gains[i].highest) {
+      penalty += pow(log(g/tuned_gains[i].highest), 2.0);
+      g = tuned_gains[i].highest;
+    }
+    gains.*tuned_gains[i].value = g;
+  }
+  return gains;
+}
+
+void start_run (SimulationContext &sim, const tuning_run_t &run)
+  // Resets a context to the start of a run, with the autopilot on
+{
+  sim.scenario = run.scenario;
+  sim.gust_wind_on = run.gust_wind_on;
+  reset_simulation_state(sim);
+  seed_random_number(sim, run.seed);
+  sim.autopilot_enabled = true;
+}
+
+void fly_reference_run (tuning_run_t &run, double time_limit)
+  // Flies the run with the engine held off and the parachute stowed, recording checkpoints and summaries
+{
+  SimulationContext sim;
+  coast_summary_t *summary = NULL;
+  lander_phases phase;
+  double throttle_before, throttle_after, offset;
+  unsigned long steps = 0;
+
+  start_run(sim, run);
+  sim.autopilot_gains.entry_speed = 1.0e12; // the target is always far above the actual radial speed,
+  sim.autopilot_gains.switch_altitude = -1.0; // and the lander never drops below the switch altitude
+  sim.time_warp_limit = time_limit;
+  while (!sim.landed && (sim.simulation_time < time_limit)) {
+    if (steps%CHECKPOINT_STEPS == 0) run.checkpoints.push_back(sim);
+    if (steps%SUMMARY_STEPS == 0) {
+      run.summaries.push_back(coast_summary_t());
+      summary = &run.summaries.back();
+      summary->uses_gains = false;
+      summary->descending = false;
+      summary->lowest_altitude = summary->lowest_radial_speed = summary->highest_offset = 0.0;
+    }
+    phase = sim.current_lander_phase; // the autopilot only changes phase at the end of a step
+    throttle_before = sim.throttle;
+    advance_simulation(sim);
+
+    // sim.derived is still what the autopilot saw, and hover_throttle() needs the throttle it started with
+    if (phase == let_it_go) summary->uses_gains = true;
+    else if (phase == viva_la_vida) {
+      throttle_after = sim.throttle;
+      sim.throttle = throttle_before;
+      offset = hover_throttle(sim);
+      sim.throttle = throttle_after;
+      if (!summary->descending) {
+        summary->descending = true;
+        summary->lowest_altitude = sim.derived.altitude;
+        summary->lowest_radial_speed = sim.derived.radial_speed;
+        summary->highest_offset = offset;
+      }
+      summary->lowest_altitude = min(summary->lowest_altitude, sim.derived.altitude);
+      summary->lowest_radial_speed = min(summary->lowest_radial_speed, sim.derived.radial_speed);
+      summary->highest_offset = max(summary->highest_offset, offset);
+    }
+    update_flight_status(sim);
+    steps++;
+  }
+}
+
+bool coasting_for (const coast_summary_t &summary, const autopilot_gains_t &gains)
+  // Whether the autopilot, with these gains, would also have kept the engine off and the parachute
+  // stowed through the steps of a summary - in viva_la_vida the throttle stays at zero while
+  // Kp*(target - radial speed) <= -offset, and the target is least at the lowest altitude
+{
+  if (summary.uses_gains) return false;
+  if (!summary.descending) return true;
+  if (summary.lowest_altitude < gains.switch_altitude) return false;
+  return gains.kp*(-gains.entry_speed - gains.entry_kh*summary.lowest_altitude - summary.lowest_radial_speed)
+    + summary.highest_offset < -1.0e-6;
+}
+
+double least_touchdown_speed (const SimulationContext &sim)
+  // Lower bound on the descent rate at touchdown, for a lander that from now on has full thrust
+  // at the lightest mass, air as dense as at the surface, the parachute if it still has one and
+  // the strongest gust across its path. The radial deceleration is then at most A + k*v^2 for
+  // descent rate v, and integrating that over the remaining height gives the bound.
+{
+  const DerivedState &d = sim.derived;
+  double k, a, height, horizontal_air_speed, v2;
+
+  if (d.radial_speed >= 0.0) return 0.0;
+  k = 0.5*mars_atmosphere.density(0.0)*DRAG_COEF_LANDER*M_PI*LANDER_SIZE*LANDER_SIZE;
+  if (sim.parachute_status != LOST) k += 0.5*mars_atmosphere.density(0.0)*DRAG_COEF_CHUTE*5.0*2.0*LANDER_SIZE*2.0*LANDER_SIZE;
+  k /= UNLOADED_LANDER_MASS;
+  horizontal_air_speed = (d.air_velocity - sim.velocity + d.radial_speed*d.radial).abs();
+  if (sim.gust_wind_on) horizontal_air_speed += MAX_GUST_SPEED;
+  a = ((sim.fuel > 0.0) ? MAX_THRUST/UNLOADED_LANDER_MASS : 0.0) - GRAVITY*MARS_MASS/(d.radius*d.radius)
+    + d.tangential_speed*d.tangential_speed/MARS_RADIUS + k*horizontal_air_speed*horizontal_air_speed;
+  height = max(d.altitude - LANDER_SIZE/2.0, 0.0);
+  v2 = d.radial_speed*d.radial_speed*exp(-2.0*k*height) + a*expm1(-2.0*k*height)/k;
+  return (v2 > 0.0) ? sqrt(v2) : 0.0;
+}
+
+run_outcome_t fly_run (const tuning_run_t &run, const autopilot_gains_t &gains, double time_limit)
+  // Flies one run with the candidate's gains, from the last reference checkpoint that they share
+{
+  run_outcome_t outcome;
+  unsigned long first_active = 0, c;
+  double speed;
+
+  while ((first_active < run.summaries.size()) && coasting_for(run.summaries[first_active], gains)) first_active++;
+  c = min((first_active*SUMMARY_STEPS)/CHECKPOINT_STEPS, (unsigned long) run.checkpoints.size()-1);
+  SimulationContext sim = run.checkpoints[c];
+  sim.autopilot_gains = gains;
+  sim.time_warp_limit = time_limit;
+  outcome.steps = 0;
+
+  while (!sim.landed && (sim.simulation_time < time_limit)) {
+    advance_simulation(sim);
+    update_flight_status(sim);
+    outcome.steps++;
+    if ((outcome.steps%SUMMARY_STEPS == 0) && !sim.landed && (sim.current_lander_phase == viva_la_vida)) {
+      speed = least_touchdown_speed(sim);
+      if (speed > HOPELESS_SPEED) {
+        outcome.safe = false;
+        outcome.fuel_used = FUEL_CAPACITY*(1.0-sim.fuel);
+        outcome.cost = FUEL_CAPACITY + CRASH_PENALTY*(speed - MAX_IMPACT_DESCENT_RATE);
+        return outcome;
+      }
+    }
+  }
+
+  outcome.fuel_used = FUEL_CAPACITY*(1.0-sim.fuel);
+  if (!sim.landed) { // still up there at the time limit
+    outcome.safe = false;
+    outcome.cost = 2.0*FUEL_CAPACITY;
+  }
+  else {
+    outcome.safe = !sim.crashed && (sim.altitude >= LANDER_SIZE/2.0);
+    outcome.cost = outcome.fuel_used;
+    if (!outcome.safe) outcome.cost = FUEL_CAPACITY + CRASH_PENALTY*(max(fabs(sim.climb_speed) - MAX_IMPACT_DESCENT_RATE, 0.0)
+                                                                      + max(sim.ground_speed - MAX_IMPACT_GROUND_SPEED, 0.0));
+  }
+  return outcome;
+}
+
+void evaluate (vector<candidate_t> &candidates, const vector<tuning_run_t> &runs, double time_limit, Work_stealing_pool &pool,
+               unsigned long &total_steps)
+  // Flies every run for every candidate, spread over the pool, and fills in their costs
+{
+  vector<run_outcome_t> outcomes(candidates.size()*runs.size());
+  unsigned long i, r;
+
+  pool.run(outcomes.size(), [&](unsigned long task, unsigned) {
+    outcomes[task] = fly_run(runs[task%runs.size()], candidates[task/runs.size()].gains, time_limit);
+  });
+  for (i=0; i<candidates.size(); i++) {
+    candidate_t &c = candidates[i];
+    c.cost = 0.0; c.fuel_used = 0.0; c.safe = true;
+    for (r=0; r<runs.size(); r++) {
+      const run_outcome_t &o = outcomes[i*runs.size() + r];
+      c.cost += o.cost/runs.size();
+      c.fuel_used += o.fuel_used/runs.size();
+      c.safe = c.safe && o.safe;
+      total_steps += o.steps;
+    }
+    c.cost += FUEL_CAPACITY*c.penalty;
+  }
+}
+
+void symmetric_eigen (double a[N_TUNED_GAINS][N_TUNED_GAINS], double values[N_TUNED_GAINS], double vectors[N_TUNED_GAINS][N_TUNED_GAINS])
+  // Eigenvalues and eigenvectors (the columns of vectors) of a symmetric matrix, by cyclic Jacobi rotations
+{
+  double m[N_TUNED_GAINS][N_TUNED_GAINS], off, theta, t, c, s, mkp, mkq;
+  unsigned i, j, k, p, q, sweep;
+
+  for (i=0; i<N_TUNED_GAINS; i++) for (j=0; j<N_TUNED_GAINS; j++) {
+    m[i][j] = a[i][j];
+    vectors[i][j] = (i == j) ? 1.0 : 0.0;
+  }
+  for (sweep=0; sweep<50; sweep++) {
+    off = 0.0;
+    for (p=0; p<N_TUNED_GAINS; p++) for (q=p+1; q<N_TUNED_GAINS; q++) off += m[p][q]*m[p][q];
+    if (off < 1.0e-30) break;
+    for (p=0; p<N_TUNED_GAINS; p++) for (q=p+1; q<N_TUNED_GAINS; q++) {
+      if (m[p][q] == 0.0) continue;
+      theta = (m[q][q] - m[p][p])/(2.0*m[p][q]);
+      t = ((theta >= 0.0) ? 1.0 : -1.0)/(fabs(theta) + sqrt(theta*theta + 1.0));
+      c = 1.0/sqrt(t*t + 1.0);
+      s = t*c;
+      for (k=0; k<N_TUNED_GAINS; k++) { // columns p and q, then rows p and q
+        mkp = m[k][p]; mkq = m[k][q];
+        m[k][p] = c*mkp - s*mkq;
+        m[k][q] = s*mkp + c*mkq;
+      }
+      for (k=0; k<N_TUNED_GAINS; k++) {
+        mkp = m[p][k]; mkq = m[q][k];
+        m[p][k] = c*mkp - s*mkq;
+        m[q][k] = s*mkp + c*mkq;
+      }
+      for (k=0; k<N_TUNED_GAINS; k++) {
+        mkp = vectors[k][p]; mkq = vectors[k][q];
+        vectors[k][p] = c*mkp - s*mkq;
+        vectors[k][q] = s*mkp + c*mkq;
+      }
+    }
+  }
+  for (i=0; i<N_TUNED_GAINS; i++) values[i] = max(m[i][i], 1.0e-20);
+}
+
+double normal_random_number (unsigned long long &random_state)
+  // Standard normal random number, by the Box-Muller transform
+{
+  double u = uniform_random_number(random_state), v = uniform_random_number(random_state);
+
+  return sqrt(-2.0*log(1.0-u))*cos(2.0*M_PI*v);
+}
+
+void print_candidate (string title, const candidate_t &c, unsigned long n_runs)
+  // One line summary of a candidate's gains and how it did
+{
+  unsigned i;
+
+  cout << title << (c.safe ? "all safe" : "not all safe") << ", mean fuel " << c.fuel_used << " l over " << n_runs << " runs, cost " << c.cost << " (";
+  for (i=0; i<N_TUNED_GAINS; i++) cout << ((i > 0) ? " " : "") << c.gains.*tuned_gains[i].value;
+  cout << ")" << endl;
+}
+
+void print_usage (char *name)
+{
+  cerr << "Usage: " << name << " [--scenarios=1,4,5] [--seeds=N] [--generations=N] [--population=N] [--threads=N] [--seed=N]"
+       << " [--time-limit=seconds] [--output=file]" << endl;
+}
+
+int main (int argc, char* argv[])
+  // Parses the settings, flies the reference runs, then runs CMA-ES and writes out the best safe gains
+{
+  const unsigned n = N_TUNED_GAINS;
+  tuner_settings_t settings;
+  vector<tuning_run_t> runs;
+  vector<candidate_t> population, baseline(1);
+  vector<double> weights;
+  candidate_t best;
+  double mean[n], sigma = 0.3, C[n][n], B[n][n], D[n], p_sigma[n], p_c[n], y_w[n], step[n], z[n], old_mean[n];
+  double mu_eff = 0.0, c_sigma, d_sigma, c_c, c_1, c_mu, chi_n, norm_p_sigma, h_sigma, sum;
+  unsigned long total_steps = 0, reference_steps = 0, i, k;
+  unsigned long long random_state, t_start, t_end;
+  unsigned mu, g, j, l, s;
+  size_t comma;
+  int a;
+
+  settings.scenarios.push_back(1); settings.scenarios.push_back(4); settings.scenarios.push_back(5);
+  settings.gust_seeds = 4;
+  settings.generations = 40;
+  settings.population = 4 + (unsigned) (3.0*log((double) n));
+  settings.threads = 0;
+  settings.seed = 1;
+  settings.time_limit = 100000.0;
+
+  for (a=1; a<argc; a++) {
+    string arg = argv[a];
+    if (arg.compare(0, 12, "--scenarios=") == 0) {
+      string list = arg.substr(12);
+      settings.scenarios.clear();
+      while (!list.empty()) {
+        comma = list.find(',');
+        settings.scenarios.push_back((unsigned short) atoi(list.substr(0, comma).c_str()));
+        list = (comma == string::npos) ? "" : list.substr(comma+1);
+      }
+    }
+    else if (arg.compare(0, 8, "--seeds=") == 0) settings.gust_seeds = (unsigned) atoi(arg.substr(8).c_str());
+    else if (arg.compare(0, 14, "--generations=") == 0) settings.generations = (unsigned) atoi(arg.substr(14).c_str());
+    else if (arg.compare(0, 13, "--population=") == 0) settings.population = (unsigned) atoi(arg.substr(13).c_str());
+    else if (arg.compare(0, 10, "--threads=") == 0) settings.threads = (unsigned) atoi(arg.substr(10).c_str());
+    else if (arg.compare(0, 7, "--seed=") == 0) settings.seed = strtoull(arg.substr(7).c_str(), NULL, 10);
+    else if (arg.compare(0, 13, "--time-limit=") == 0) settings.time_limit = atof(arg.substr(13).c_str());
+    else if (arg.compare(0, 9, "--output=") == 0) settings.output_filename = arg.substr(9);
+    else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  for (j=0; j<settings.scenarios.size(); j++) {
+    if (settings.scenarios[j] >= 7) {
+      cerr << "Scenarios 7 to 9 are launches, which the descent gains do not affect" << endl;
+      return 1;
+    }
+  }
+  if (settings.scenarios.empty() || (settings.population < 4)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  // Runs in calm air, then with gusts, each from its own seed
+  for (j=0; j<settings.scenarios.size(); j++) {
+    for (s=0; s<=settings.gust_seeds; s++) {
+      tuning_run_t run;
+      run.scenario = settings.scenarios[j];
+      run.gust_wind_on = (s > 0);
+      run.seed = s;
+      runs.push_back(run);
+    }
+  }
+  Work_stealing_pool pool(settings.threads);
+  microsecond_time(t_start);
+  pool.run(runs.size(), [&](unsigned long task, unsigned) {
+    fly_reference_run(runs[task], settings.time_limit);
+  });
+  for (i=0; i<runs.size(); i++) reference_steps += (runs[i].summaries.size()-1)*SUMMARY_STEPS;
+
+  cout.precision(4);
+  cout << "Tuning " << n << " gains on scenarios";
+  for (j=0; j<settings.scenarios.size(); j++) cout << " " << settings.scenarios[j];
+  cout << ", " << runs.size() << " runs per candidate (" << settings.gust_seeds << " gust seeds), population "
+       << settings.population << ", " << pool.get_threads() << " threads" << endl;
+
+  // The hand-tuned defaults, for comparison and as the fallback
+  for (l=0; l<n; l++) baseline[0].x[l] = 0.0;
+  baseline[0].gains = gains_from_point(baseline[0].x, baseline[0].penalty);
+  evaluate(baseline, runs, settings.time_limit, pool, total_steps);
+  print_candidate("Defaults: ", baseline[0], runs.size());
+  best = baseline[0];
+
+  // CMA-ES constants, as in Hansen's tutorial
+  mu = settings.population/2;
+  for (l=0; l<mu; l++) weights.push_back(log(mu + 0.5) - log(l + 1.0));
+  sum = 0.0;
+  for (l=0; l<mu; l++) sum += weights[l];
+  for (l=0; l<mu; l++) {
+    weights[l] /= sum;
+    mu_eff += weights[l]*weights[l];
+  }
+  mu_eff = 1.0/mu_eff;
+  c_sigma = (mu_eff + 2.0)/(n + mu_eff + 5.0);
+  d_sigma = 1.0 + 2.0*max(0.0, sqrt((mu_eff - 1.0)/(n + 1.0)) - 1.0) + c_sigma;
+  c_c = (4.0 + mu_eff/n)/(n + 4.0 + 2.0*mu_eff/n);
+  c_1 = 2.0/((n + 1.3)*(n + 1.3) + mu_eff);
+  c_mu = min(1.0 - c_1, 2.0*(mu_eff - 2.0 + 1.0/mu_eff)/((n + 2.0)*(n + 2.0) + mu_eff));
+  chi_n = sqrt((double) n)*(1.0 - 1.0/(4.0*n) + 1.0/(21.0*n*n));
+
+  for (j=0; j<n; j++) {
+    mean[j] = 0.0; p_sigma[j] = 0.0; p_c[j] = 0.0;
+    for (l=0; l<n; l++) C[j][l] = (j == l) ? 1.0 : 0.0;
+  }
+  seed_random_number(random_state, settings.seed);
+  population.resize(settings.population);
+
+  for (g=0; g<settings.generations; g++) {
+    symmetric_eigen(C, D, B);
+    for (j=0; j<n; j++) D[j] = sqrt(D[j]);
+
+    // Sample the population, x = mean + sigma*B*D*z
+    for (k=0; k<population.size(); k++) {
+      for (j=0; j<n; j++) z[j] = normal_random_number(random_state);
+      for (j=0; j<n; j++) {
+        step[j] = 0.0;
+        for (l=0; l<n; l++) step[j] += B[j][l]*D[l]*z[l];
+        population[k].x[j] = mean[j] + sigma*step[j];
+      }
+      population[k].gains = gains_from_point(population[k].x, population[k].penalty);
+    }
+    evaluate(population, runs, settings.time_limit, pool, total_steps);
+    sort(population.begin(), population.end(), [](const candidate_t &p, const candidate_t &q) { return p.cost < q.cost; });
+    for (k=0; k<population.size(); k++) {
+      if (population[k].safe && (population[k].penalty == 0.0) && (!best.safe || (population[k].fuel_used < best.fuel_used))) best = population[k];
+    }
+
+    // Move the mean towards the best mu candidates
+    for (j=0; j<n; j++) {
+      old_mean[j] = mean[j];
+      mean[j] = 0.0;
+      for (l=0; l<mu; l++) mean[j] += weights[l]*population[l].x[j];
+      y_w[j] = (mean[j] - old_mean[j])/sigma;
+    }
+
+    // Evolution paths, with C^(-1/2) = B*D^(-1)*B^T for the step size path
+    for (j=0; j<n; j++) {
+      z[j] = 0.0;
+      for (l=0; l<n; l++) z[j] += B[l][j]*y_w[l];
+      z[j] /= D[j];
+    }
+    norm_p_sigma = 0.0;
+    for (j=0; j<n; j++) {
+      sum = 0.0;
+      for (l=0; l<n; l++) sum += B[j][l]*z[l];
+      p_sigma[j] = (1.0 - c_sigma)*p_sigma[j] + sqrt(c_sigma*(2.0 - c_sigma)*mu_eff)*sum;
+      norm_p_sigma += p_sigma[j]*p_sigma[j];
+    }
+    norm_p_sigma = sqrt(norm_p_sigma);
+    h_sigma = (norm_p_sigma/sqrt(1.0 - pow(1.0 - c_sigma, 2.0*(g + 1))) < (1.4 + 2.0/(n + 1.0))*chi_n) ? 1.0 : 0.0;
+    for (j=0; j<n; j++) p_c[j] = (1.0 - c_c)*p_c[j] + h_sigma*sqrt(c_c*(2.0 - c_c)*mu_eff)*y_w[j];
+
+    // Rank one and rank mu updates of the covariance, then the step size
+    for (j=0; j<n; j++) for (l=0; l<n; l++) {
+      sum = 0.0;
+      for (k=0; k<mu; k++) sum += weights[k]*(population[k].x[j] - old_mean[j])*(population[k].x[l] - old_mean[l])/(sigma*sigma);
+      C[j][l] = (1.0 - c_1 - c_mu)*C[j][l] + c_1*(p_c[j]*p_c[l] + (1.0 - h_sigma)*c_c*(2.0 - c_c)*C[j][l]) + c_mu*sum;
+    }
+    sigma *= exp((c_sigma/d_sigma)*(norm_p_sigma/chi_n - 1.0));
+
+    microsecond_time(t_end);
+    cout << "Generation " << g+1 << ": best cost " << population[0].cost << ", sigma " << sigma << ", best safe mean fuel "
+         << best.fuel_used << " l, " << (t_end-t_start)/1000000.0 << " s" << endl;
+  }
+
+  microsecond_time(t_end);
+  print_candidate("Tuned: ", best, runs.size());
+  cout << "Simulated " << total_steps << " steps for " << settings.population*settings.generations + 1 << " candidates, after "
+       << reference_steps << " reference steps, in " << (t_end-t_start)/1000000.0 << " s" << endl;
+  if (!best.safe) cerr << "No gains found that land safely in every run" << endl;
+
+  if (settings.output_filename.empty()) write_autopilot_gains(cout, best.gains);
+  else {
+    ofstream out(settings.output_filename.c_str());
+    out << "# Autopilot gains from ./tune_autopilot, mean fuel " << best.fuel_used << " l over " << runs.size() << " runs" << endl;
+    write_autopilot_gains(out, best.gains);
+    if (!out.good()) {
+      cerr << "Cannot write gains file " << settings.output_filename << endl;
+      return 1;
+    }
+  }
+  return best.safe ? 0 : 1;
+}
@@ -15,32 +15,37 @@
 #ifndef __VECTOR3D_INCLUDED__
 #define __VECTOR3D_INCLUDED__
 
+#include <cmath>
 #include <iostream>
 
 using namespace std;
 
 class vector3d {
-  // Utility class for three-dimensional vector operations
+  // Utility class for three-dimensional vector operations. Everything that does not need a square root is
+  // constexpr, so that constant vectors can be worked out by the compiler.
 public:
-  vector3d() {x=0.0; y=0.0; z=0.0;}
-  vector3d (double a, double b, double c=0.0) {x=a; y=b; z=c;}
-  bool operator== (const vector3d &v) const { if ((x==v.x)&&(y==v.y)&&(z==v.z)) return true; else return false; }
-  bool operator!= (const vector3d &v) const { if ((x!=v.x)||(y!=v.y)||(z!=v.z)) return true; else return false; }
-  vector3d operator+ (const vector3d &v) const { return vector3d(x+v.x, y+v.y, z+v.z); }
-  vector3d operator- (const vector3d &v) const { return vector3d(x-v.x, y-v.y, z-v.z); }
-  friend vector3d operator- (const vector3d &v) { return vector3d(-v.x, -v.y, -v.z); }
+  constexpr vector3d() : x(0.0), y(0.0), z(0.0) {}
+  constexpr vector3d (double a, double b, double c=0.0) : x(a), y(b), z(c) {}
+  constexpr bool operator== (const vector3d &v) const { return (x==v.x)&&(y==v.y)&&(z==v.z); }
+  constexpr bool operator!= (const vector3d &v) const { return (x!=v.x)||(y!=v.y)||(z!=v.z); }
+  constexpr vector3d operator+ (const vector3d &v) const { return vector3d(x+v.x, y+v.y, z+v.z); }
+  constexpr vector3d operator- (const vector3d &v) const { return vector3d(x-v.x, y-v.y, z-v.z); }
+  friend constexpr vector3d operator- (const vector3d &v) { return vector3d(-v.x, -v.y, -v.z); }
   vector3d& operator+= (const vector3d &v) { x+=v.x; y+=v.y; z+=v.z; return *this; }
   vector3d& operator-= (const vector3d &v) { x-=v.x; y-=v.y; z-=v.z; return *this; }
-  vector3d operator^ (const vector3d &v) const { return vector3d(y*v.z-z*v.y, z*v.x-x*v.z, x*v.y-y*v.x); }
-  double operator* (const vector3d &v) const { return (x*v.x + y*v.y +z*v.z); }
-  friend vector3d operator* (const vector3d &v, const double &a) { return vector3d(v.x*a, v.y*a, v.z*a); }
-  friend vector3d operator* (const double &a, const vector3d &v) { return vector3d(v.x*a, v.y*a, v.z*a); }
+  constexpr vector3d operator^ (const vector3d &v) const { return vector3d(y*v.z-z*v.y, z*v.x-x*v.z, x*v.y-y*v.x); }
+  constexpr double operator* (const vector3d &v) const { return (x*v.x + y*v.y +z*v.z); }
+  friend constexpr vector3d operator* (const vector3d &v, const double &a) { return vector3d(v.x*a, v.y*a, v.z*a); }
+  friend constexpr vector3d operator* (const double &a, const vector3d &v) { return vector3d(v.x*a, v.y*a, v.z*a); }
   vector3d& operator*= (const double &a) { x*=a; y*=a; z*=a; return *this; }
-  vector3d operator/ (const double &a) const { return vector3d(x/a, y/a, z/a); }
+  constexpr vector3d operator/ (const double &a) const { return vector3d(x/a, y/a, z/a); }
   vector3d& operator/= (const double &a) { x/=a; y/=a; z/=a; return *this; }
-  double abs2() const { return (x*x + y*y + z*z); }
+  constexpr double abs2() const { return (x*x + y*y + z*z); }
   double abs() const { return sqrt(this->abs2()); }
-  vector3d norm() const { double s(this->abs()); if (s==0) return *this; else return vector3d(x/s, y/s, z/s); }
+  double inv_abs() const { return 1.0/sqrt(this->abs2()); }
+  vector3d norm() const { double s2(this->abs2()), r; if (s2==0) return *this; r = 1.0/sqrt(s2); return vector3d(x*r, y*r, z*r); } // one reciprocal square root, three multiplies
+  vector3d unit (double &s) const { double r; s = this->abs(); if (s==0) return *this; r = 1.0/s; return vector3d(x*r, y*r, z*r); } // norm(), and abs() in s
+  vector3d unit (double &s, double &s2) const { double r; s2 = this->abs2(); s = sqrt(s2); if (s==0) return *this; r = 1.0/s; return vector3d(x*r, y*r, z*r); } // and abs2() in s2
   friend ostream& operator << (ostream &out, const vector3d &v) { out << v.x << ' ' << v.y << ' ' << v.z; return out; }
   double x, y, z;
 private: